@@ -566,6 +566,17 @@ void GameActivity_showSoftInput(GameActivity* activity, uint32_t flags);
  */
 void GameActivity_restartInput(GameActivity* activity);
 
+/**
+ * Exchange only the changed part of the text with the IME instead of the whole
+ * text, see GameTextInput_setStateDiffsEnabled. This is disabled by default:
+ * while it is enabled, GameActivity.stateChanged is no longer called, so leave
+ * it disabled if your GameActivity subclass overrides stateChanged.
+ * Note that this method can be called from *any* thread; it will send a message
+ * to the main thread of the process where the change will take place.
+ */
+void GameActivity_setTextInputStateDiffsEnabled(GameActivity* activity,
+                                                bool enabled);
+
 /**
  * Set the text entry state (see documentation of the GameTextInputState struct
  * in the Game Text Input library reference).
@@ -81,6 +81,7 @@ extern "C" {
  */
 
 struct android_app;
+struct GameActivityCommandQueue;
 
 /**
  * Data associated with an ALooper fd that will be returned as the "outData"
@@ -120,6 +121,22 @@ struct android_input_buffer {
    */
   uint64_t motionEventsBufferSize;
 
+  /**
+   * Storage of the history of the events in `motionEvents`, which their
+   * history arrays point into. It is reused once the events are cleared.
+   */
+  uint8_t* motionHistory;
+
+  /**
+   * The number of bytes of `motionHistory` in use.
+   */
+  uint64_t motionHistorySize;
+
+  /**
+   * The size of the `motionHistory` buffer.
+   */
+  uint64_t motionHistoryBufferSize;
+
   /**
    * Pointer to a read-only array of GameActivityKeyEvent.
    * Only the first keyEventsCount events are valid.
@@ -236,8 +253,8 @@ struct android_app {
 
   /**
    * This is used for buffering input from GameActivity. Once ready, the
-   * application thread switches the buffers and processes what was
-   * accumulated.
+   * application thread moves the events waiting in the input queue to the
+   * current buffer, switches the buffers and processes what was accumulated.
    */
   struct android_input_buffer inputBuffers[NATIVE_APP_GLUE_MAX_INPUT_BUFFERS];
 
@@ -256,8 +273,14 @@ struct android_app {
   pthread_mutex_t mutex;
   pthread_cond_t cond;
 
-  int msgread;
-  int msgwrite;
+  /**
+   * Commands for the app thread, which polls the eventfd of the queue and
+   * processes all the commands waiting at each wakeup.
+   */
+  struct GameActivityCommandQueue* cmdQueue;
+  /** Set while an APP_CMD_TOUCH_EVENT or APP_CMD_KEY_EVENT is queued. */
+  int touchEventCmdPending;
+  int keyEventCmdPending;
 
   pthread_t thread;
 
@@ -273,6 +296,25 @@ struct android_app {
   android_key_event_filter keyEventFilter;
   android_motion_event_filter motionEventFilter;
 
+  /**
+   * Ring of the input events received on the main thread and not read yet by
+   * the app thread. The main thread only writes inputQueueTail and the app
+   * thread inputQueueHead, so neither takes a lock.
+   */
+  uint8_t* inputQueue;
+  uint64_t inputQueueHead;
+  uint64_t inputQueueTail;
+  /**
+   * Input events that didn't fit in inputQueue, oldest first, protected by
+   * mutex. While inputOverflowPending is set the main thread adds all its
+   * events to this list, so that they are read after those in inputQueue.
+   */
+  struct android_input_overflow* inputOverflow;
+  struct android_input_overflow* inputOverflowLast;
+  bool inputOverflowPending;
+
+  bool coalesceMotionEvents;
+
   /** @endcond */
 };
 
@@ -437,7 +479,7 @@ enum NativeAppGlueAppCmd : int8_t {
 
 /**
  * Call when ALooper_pollAll() returns LOOPER_ID_MAIN, reading the next
- * app command message.
+ * app command message. Returns -1 when no command is waiting.
  */
 int8_t android_app_read_cmd(struct android_app* android_app);
 
@@ -458,13 +500,16 @@ void android_app_post_exec_cmd(struct android_app* android_app, int8_t cmd);
 /**
  * Call this before processing input events to get the events buffer.
  * The function returns NULL if there are no events to process.
+ *
+ * It must be called from the app thread, which is where the events received
+ * since the last call are copied to the buffer.
  */
 struct android_input_buffer* android_app_swap_input_buffers(
     struct android_app* android_app);
 
 /**
  * Clear the array of motion events that were waiting to be handled, and release
- * each of them.
+ * each of them. Their history storage is kept for the next events.
  *
  * This method should be called after you have processed the motion events in
  * your game loop. You should handle events at each iteration of your game loop.
@@ -508,6 +553,18 @@ void android_app_set_key_event_filter(struct android_app* app,
 void android_app_set_motion_event_filter(struct android_app* app,
                                          android_motion_event_filter filter);
 
+/**
+ * Set whether consecutive `AMOTION_EVENT_ACTION_MOVE` events of the same
+ * pointers are merged into one event when they are waiting for
+ * android_app_swap_input_buffers. This happens when the app thread falls
+ * behind the input. The merged event is the last one, with the other events
+ * added to its history, so no sample is lost.
+ *
+ * Motion events are not coalesced by default.
+ */
+void android_app_set_motion_event_coalescing(struct android_app* app,
+                                             bool coalesce);
+
 /**
  * You can send your custom events using the function below.
  *
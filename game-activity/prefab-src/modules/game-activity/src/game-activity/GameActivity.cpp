@@ -23,7 +23,6 @@
 #include <android/native_window_jni.h>
 #include <dlfcn.h>
 #include <errno.h>
-#include <fcntl.h>
 #include <game-activity/GameActivity.h>
 #include <game-activity/GameActivityLog.h>
 #include <jni.h>
@@ -35,11 +34,14 @@
 #include <system_utils.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "GameActivityCommandQueue_internal.h"
 #include "GameActivityEvents_internal.h"
 
 namespace {
@@ -134,17 +136,6 @@ static struct {
   jclass clazz;
 } gWindowInsetsCompatTypeClassInfo;
 
-/*
- * Contains a command to be executed by the GameActivity
- * on the application main thread.
- */
-struct ActivityWork {
-  int32_t cmd;
-  int64_t arg1;
-  int64_t arg2;
-  int64_t arg3;
-};
-
 /*
  * The type of commands that can be passed to the GameActivity and that
  * are executed on the application main thread.
@@ -157,7 +148,8 @@ enum {
   CMD_HIDE_SOFT_INPUT,
   CMD_SET_SOFT_INPUT_STATE,
   CMD_SET_IME_EDITOR_INFO,
-  CMD_RESTART_INPUT
+  CMD_RESTART_INPUT,
+  CMD_SET_TEXT_INPUT_STATE_DIFFS
 };
 
 /*
@@ -198,51 +190,6 @@ static struct Configuration {
 
 static std::mutex gConfigMutex;
 
-/*
- * Write a command to be executed by the GameActivity on the application main
- * thread.
- */
-static void write_work(int fd, int32_t cmd, int64_t arg1 = 0, int64_t arg2 = 0,
-                       int64_t arg3 = 0) {
-  ActivityWork work;
-  work.cmd = cmd;
-  work.arg1 = arg1;
-  work.arg2 = arg2;
-  work.arg3 = arg3;
-
-  LOG_TRACE("write_work: cmd=%d", cmd);
-restart:
-  int res = write(fd, &work, sizeof(work));
-  if (res < 0 && errno == EINTR) {
-    goto restart;
-  }
-
-  if (res == sizeof(work)) return;
-
-  if (res < 0) {
-    ALOGW("Failed writing to work fd: %s", strerror(errno));
-  } else {
-    ALOGW("Truncated writing to work fd: %d", res);
-  }
-}
-
-/*
- * Read commands to be executed by the GameActivity on the application main
- * thread.
- */
-static bool read_work(int fd, ActivityWork *outWork) {
-  int res = read(fd, outWork, sizeof(ActivityWork));
-  // no need to worry about EINTR, poll loop will just come back again.
-  if (res == sizeof(ActivityWork)) return true;
-
-  if (res < 0) {
-    ALOGW("Failed reading work fd: %s", strerror(errno));
-  } else {
-    ALOGW("Truncated reading work fd: %d", res);
-  }
-  return false;
-}
-
 /*
  * Native state for interacting with the GameActivity class.
  */
@@ -252,7 +199,7 @@ struct NativeCode : public GameActivity {
     memset(&callbacks, 0, sizeof(callbacks));
     memset(&insetsState, 0, sizeof(insetsState));
     nativeWindow = NULL;
-    mainWorkRead = mainWorkWrite = -1;
+    mainWork.eventFd = -1;
     gameTextInput = NULL;
     softwareKeyboardVisible = false;
     sdkVersion = gamesdk::GetSystemPropAsInt("ro.build.version.sdk");
@@ -272,15 +219,14 @@ struct NativeCode : public GameActivity {
       }
     }
     GameTextInput_destroy(gameTextInput);
-    if (looper != NULL && mainWorkRead >= 0) {
-      ALooper_removeFd(looper, mainWorkRead);
+    if (looper != NULL && mainWork.eventFd >= 0) {
+      ALooper_removeFd(looper, mainWork.eventFd);
     }
     ALooper_release(looper);
     looper = NULL;
 
     setSurface(NULL);
-    if (mainWorkRead >= 0) close(mainWorkRead);
-    if (mainWorkWrite >= 0) close(mainWorkWrite);
+    GameActivityCommandQueue_destroy(&mainWork);
   }
 
   void setSurface(jobject _surface) {
@@ -304,9 +250,14 @@ struct NativeCode : public GameActivity {
   int32_t lastWindowWidth;
   int32_t lastWindowHeight;
 
-  // These are used to wake up the main thread to process work.
-  int mainWorkRead;
-  int mainWorkWrite;
+  // Commands to execute on the main thread, which is woken up by its eventfd
+  // to process them.
+  GameActivityCommandQueue mainWork;
+  // Commands that didn't fit in mainWork, oldest first. While there are some,
+  // the new commands are added here too, so that they run in order.
+  std::mutex mainWorkOverflowMutex;
+  std::deque<GameActivityCommand> mainWorkOverflow;
+  std::atomic<bool> mainWorkOverflowPending{false};
   ALooper *looper;
 
   // Need to hold on to a reference here in case the upper layers destroy our
@@ -325,26 +276,58 @@ struct NativeCode : public GameActivity {
 
 static void readConfigurationValues(NativeCode *code, jobject javaConfig);
 
+/*
+ * Write a command to be executed by the GameActivity on the application main
+ * thread. It can be called from any thread and does not block, the commands
+ * that don't fit in the queue are kept in an overflow list.
+ */
+static void write_work(NativeCode *code, int32_t cmd, int64_t arg1 = 0,
+                       int64_t arg2 = 0, int64_t arg3 = 0) {
+  GameActivityCommand work;
+  work.cmd = cmd;
+  work.arg1 = arg1;
+  work.arg2 = arg2;
+  work.arg3 = arg3;
+
+  LOG_TRACE("write_work: cmd=%d", cmd);
+  if (!code->mainWorkOverflowPending.load(std::memory_order_acquire) &&
+      GameActivityCommandQueue_push(&code->mainWork, &work)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(code->mainWorkOverflowMutex);
+    code->mainWorkOverflow.push_back(work);
+    code->mainWorkOverflowPending.store(true, std::memory_order_release);
+  }
+  GameActivityCommandQueue_signal(&code->mainWork);
+}
+
 extern "C" void GameActivity_finish(GameActivity *activity) {
   NativeCode *code = static_cast<NativeCode *>(activity);
-  write_work(code->mainWorkWrite, CMD_FINISH, 0);
+  write_work(code, CMD_FINISH, 0);
 }
 
 extern "C" void GameActivity_setWindowFlags(GameActivity *activity,
                                             uint32_t values, uint32_t mask) {
   NativeCode *code = static_cast<NativeCode *>(activity);
-  write_work(code->mainWorkWrite, CMD_SET_WINDOW_FLAGS, values, mask);
+  write_work(code, CMD_SET_WINDOW_FLAGS, values, mask);
 }
 
 extern "C" void GameActivity_showSoftInput(GameActivity *activity,
                                            uint32_t flags) {
   NativeCode *code = static_cast<NativeCode *>(activity);
-  write_work(code->mainWorkWrite, CMD_SHOW_SOFT_INPUT, flags);
+  write_work(code, CMD_SHOW_SOFT_INPUT, flags);
 }
 
 extern "C" void GameActivity_restartInput(GameActivity *activity) {
   NativeCode *code = static_cast<NativeCode *>(activity);
-  write_work(code->mainWorkWrite, CMD_RESTART_INPUT);
+  write_work(code, CMD_RESTART_INPUT);
+}
+
+extern "C" void GameActivity_setTextInputStateDiffsEnabled(
+    GameActivity *activity, bool enabled) {
+  NativeCode *code = static_cast<NativeCode *>(activity);
+  write_work(code, CMD_SET_TEXT_INPUT_STATE_DIFFS, enabled);
 }
 
 extern "C" void GameActivity_setTextInputState(
@@ -352,7 +335,7 @@ extern "C" void GameActivity_setTextInputState(
   NativeCode *code = static_cast<NativeCode *>(activity);
   std::lock_guard<std::mutex> lock(code->gameTextInputStateMutex);
   code->gameTextInputState = *state;
-  write_work(code->mainWorkWrite, CMD_SET_SOFT_INPUT_STATE);
+  write_work(code, CMD_SET_SOFT_INPUT_STATE);
 }
 
 extern "C" void GameActivity_getTextInputState(
@@ -365,7 +348,7 @@ extern "C" void GameActivity_getTextInputState(
 extern "C" void GameActivity_hideSoftInput(GameActivity *activity,
                                            uint32_t flags) {
   NativeCode *code = static_cast<NativeCode *>(activity);
-  write_work(code->mainWorkWrite, CMD_HIDE_SOFT_INPUT, flags);
+  write_work(code, CMD_HIDE_SOFT_INPUT, flags);
 }
 
 extern "C" void GameActivity_getWindowInsets(GameActivity *activity,
@@ -399,19 +382,9 @@ static void checkAndClearException(JNIEnv *env, const char *methodName) {
 }
 
 /*
- * Callback for handling native events on the application's main thread.
+ * Execute a command on the application's main thread.
  */
-static int mainWorkCallback(int fd, int events, void *data) {
-  ALOGD("************** mainWorkCallback *********");
-  NativeCode *code = (NativeCode *)data;
-  if ((events & POLLIN) == 0) {
-    return 1;
-  }
-
-  ActivityWork work;
-  if (!read_work(code->mainWorkRead, &work)) {
-    return 1;
-  }
+static void executeWork(NativeCode *code, const GameActivityCommand &work) {
   LOG_TRACE("mainWorkCallback: cmd=%d", work.cmd);
   switch (work.cmd) {
     case CMD_FINISH: {
@@ -447,11 +420,48 @@ static int mainWorkCallback(int fd, int events, void *data) {
     case CMD_RESTART_INPUT: {
       GameTextInput_restartInput(code->gameTextInput);
     } break;
+    case CMD_SET_TEXT_INPUT_STATE_DIFFS: {
+      GameTextInput_setStateDiffsEnabled(code->gameTextInput, work.arg1 != 0);
+    } break;
     default:
       ALOGW("Unknown work command: %d", work.cmd);
       break;
   }
+}
 
+/*
+ * Callback for handling native events on the application's main thread.
+ */
+static int mainWorkCallback(int fd, int events, void *data) {
+  ALOGD("************** mainWorkCallback *********");
+  NativeCode *code = (NativeCode *)data;
+  if ((events & POLLIN) == 0) {
+    return 1;
+  }
+
+  // All the commands written since the last wakeup are executed at once
+  GameActivityCommand work;
+  while (GameActivityCommandQueue_pop(&code->mainWork, &work)) {
+    executeWork(code, work);
+  }
+
+  if (code->mainWorkOverflowPending.load(std::memory_order_acquire)) {
+    std::vector<GameActivityCommand> works;
+    {
+      std::lock_guard<std::mutex> lock(code->mainWorkOverflowMutex);
+      // The commands written to mainWork before the overflow ones
+      while (GameActivityCommandQueue_pop(&code->mainWork, &work)) {
+        works.push_back(work);
+      }
+      works.insert(works.end(), code->mainWorkOverflow.begin(),
+                   code->mainWorkOverflow.end());
+      code->mainWorkOverflow.clear();
+      code->mainWorkOverflowPending.store(false, std::memory_order_release);
+    }
+    for (const GameActivityCommand &overflowWork : works) {
+      executeWork(code, overflowWork);
+    }
+  }
   return 1;
 }
 
@@ -476,28 +486,15 @@ static jlong initializeNativeCode_native(
   }
   ALooper_acquire(code->looper);
 
-  int msgpipe[2];
-  if (pipe(msgpipe)) {
-    g_error_msg = "could not create pipe: ";
+  if (!GameActivityCommandQueue_init(&code->mainWork)) {
+    g_error_msg = "could not create eventfd: ";
     g_error_msg += strerror(errno);
 
     ALOGW("%s", g_error_msg.c_str());
     delete code;
     return 0;
   }
-  code->mainWorkRead = msgpipe[0];
-  code->mainWorkWrite = msgpipe[1];
-  int result = fcntl(code->mainWorkRead, F_SETFL, O_NONBLOCK);
-  SLOGW_IF(result != 0,
-           "Could not make main work read pipe "
-           "non-blocking: %s",
-           strerror(errno));
-  result = fcntl(code->mainWorkWrite, F_SETFL, O_NONBLOCK);
-  SLOGW_IF(result != 0,
-           "Could not make main work write pipe "
-           "non-blocking: %s",
-           strerror(errno));
-  ALooper_addFd(code->looper, code->mainWorkRead, 0, ALOOPER_EVENT_INPUT,
+  ALooper_addFd(code->looper, code->mainWork.eventFd, 0, ALOOPER_EVENT_INPUT,
                 mainWorkCallback, code);
 
   code->GameActivity::callbacks = &code->callbacks;
@@ -861,8 +858,7 @@ extern "C" void GameActivity_setImeEditorInfo(
     GameActivity *activity, GameTextInputType inputType,
     GameTextInputActionType actionId, GameTextInputImeOptions imeOptions) {
   NativeCode *code = static_cast<NativeCode *>(activity);
-  write_work(code->mainWorkWrite, CMD_SET_IME_EDITOR_INFO, inputType, actionId,
-             imeOptions);
+  write_work(code, CMD_SET_IME_EDITOR_INFO, inputType, actionId, imeOptions);
 }
 
 extern "C" int GameActivity_getColorMode(GameActivity *) {
@@ -1021,10 +1017,15 @@ extern "C" int GameActivity_getLocaleVariant(char *dst, size_t dst_size,
                           gConfiguration.locales[localeIdx].variant);
 }
 
+static jobject getEnabledPointerAxes_native(JNIEnv *env,
+                                            jobject javaGameActivity) {
+  return GameActivityPointerAxes_newEnabledAxesBuffer(env);
+}
+
 static bool onTouchEvent_native(JNIEnv *env, jobject javaGameActivity,
-                                jlong handle, jobject motionEvent,
-                                int pointerCount, int historySize, int deviceId,
-                                int source, int action, int64_t eventTime,
+                                jlong handle, jobject packedEvent,
+                                int packedSize, int deviceId, int source,
+                                int action, int64_t eventTime,
                                 int64_t downTime, int flags, int metaState,
                                 int actionButton, int buttonState,
                                 int classification, int edgeFlags,
@@ -1053,8 +1054,13 @@ static bool onTouchEvent_native(JNIEnv *env, jobject javaGameActivity,
   c_event.precisionX = precisionX;
   c_event.precisionY = precisionY;
 
-  GameActivityMotionEvent_fromJava(env, motionEvent, &c_event, pointerCount,
-                                   historySize);
+  // The pointers and their history are packed by GameActivity.java. The event
+  // is only valid during the callback, so its history is kept in storage
+  // reused by the next event instead of allocated for each event
+  if (!GameActivityMotionEvent_fromDirectBuffer(env, packedEvent, packedSize,
+                                                &c_event)) {
+    return false;
+  }
   return code->callbacks.onTouchEvent(code, &c_event);
 }
 
@@ -1087,6 +1093,20 @@ static void onTextInput_native(JNIEnv *env, jobject activity, jlong handle,
   GameTextInput_processEvent(code->gameTextInput, textInputEvent);
 }
 
+static void onTextInputDiff_native(JNIEnv *env, jobject activity, jlong handle,
+                                   jint start, jint end, jstring text,
+                                   jint selectionStart, jint selectionEnd,
+                                   jint composingRegionStart,
+                                   jint composingRegionEnd) {
+  if (handle == 0) return;
+  NativeCode *code = (NativeCode *)handle;
+  GameTextInputSpan selection = {selectionStart, selectionEnd};
+  GameTextInputSpan composingRegion = {composingRegionStart,
+                                       composingRegionEnd};
+  GameTextInput_processStateDiff(code->gameTextInput, start, end, text,
+                                 &selection, &composingRegion);
+}
+
 static void onWindowInsetsChanged_native(JNIEnv *env, jobject activity,
                                          jlong handle) {
   if (handle == 0) return;
@@ -1197,7 +1217,9 @@ static const JNINativeMethod g_methods[] = {
     {"onSurfaceRedrawNeededNative", "(JLandroid/view/Surface;)V",
      (void *)onSurfaceRedrawNeeded_native},
     {"onSurfaceDestroyedNative", "(J)V", (void *)onSurfaceDestroyed_native},
-    {"onTouchEventNative", "(JLandroid/view/MotionEvent;IIIIIJJIIIIIIFF)Z",
+    {"getEnabledPointerAxesNative", "()Ljava/nio/ByteBuffer;",
+     (void *)getEnabledPointerAxes_native},
+    {"onTouchEventNative", "(JLjava/nio/ByteBuffer;IIIIJJIIIIIIFF)Z",
      (void *)onTouchEvent_native},
     {"onKeyDownNative", "(JLandroid/view/KeyEvent;)Z",
      (void *)onKeyDown_native},
@@ -1205,6 +1227,8 @@ static const JNINativeMethod g_methods[] = {
     {"onTextInputEventNative",
      "(JLcom/google/androidgamesdk/gametextinput/State;)V",
      (void *)onTextInput_native},
+    {"onTextInputDiffNative", "(JIILjava/lang/String;IIII)V",
+     (void *)onTextInputDiff_native},
     {"onWindowInsetsChangedNative", "(J)V",
      (void *)onWindowInsetsChanged_native},
     {"setInputConnectionNative",
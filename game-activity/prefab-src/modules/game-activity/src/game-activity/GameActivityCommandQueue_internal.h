@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * @addtogroup GameActivity Game Activity Command Queue Internal
+ * Queue of the commands passed between the GameActivity main thread and the
+ * native app thread. Please do not rely on anything in this file as this can
+ * be changed without notice.
+ * @{
+ */
+
+/**
+ * @file GameActivityCommandQueue_internal.h
+ */
+#ifndef ANDROID_GAME_SDK_GAME_ACTIVITY_COMMAND_QUEUE_INTERNAL_H
+#define ANDROID_GAME_SDK_GAME_ACTIVITY_COMMAND_QUEUE_INTERNAL_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The maximum number of commands waiting in a queue, a power of two. */
+#define GAMEACTIVITY_COMMAND_QUEUE_SIZE 256
+
+/**
+ * A command and its arguments.
+ */
+typedef struct GameActivityCommand {
+  int32_t cmd;
+  int64_t arg1;
+  int64_t arg2;
+  int64_t arg3;
+} GameActivityCommand;
+
+/**
+ * A bounded queue of commands, written by any thread and read by a single
+ * thread without locks. The reader polls `eventFd`, which becomes readable
+ * once for a burst of commands, and reads them all in one wakeup.
+ *
+ * Each cell has a sequence number telling whether it is free for the writer
+ * of a position, or ready for the reader.
+ */
+typedef struct GameActivityCommandQueue {
+  struct {
+    uint64_t sequence;
+    GameActivityCommand command;
+  } cells[GAMEACTIVITY_COMMAND_QUEUE_SIZE];
+  uint64_t writePosition;
+  uint64_t readPosition;
+
+  /** Polled by the reader, readable when commands may be waiting. */
+  int eventFd;
+  /** Set when eventFd was signalled and not reset yet by the reader. */
+  int signalled;
+
+  /** Writers waiting in GameActivityCommandQueue_pushWait for a free cell. */
+  int waiters;
+  pthread_mutex_t waitMutex;
+  pthread_cond_t cellFreed;
+} GameActivityCommandQueue;
+
+/**
+ * \brief Initialize an empty queue. Returns false, with errno set, if the
+ * eventfd could not be created.
+ */
+static inline bool GameActivityCommandQueue_init(
+    GameActivityCommandQueue* queue) {
+  for (uint64_t i = 0; i < GAMEACTIVITY_COMMAND_QUEUE_SIZE; ++i) {
+    queue->cells[i].sequence = i;
+  }
+  queue->writePosition = 0;
+  queue->readPosition = 0;
+  queue->signalled = 0;
+  queue->waiters = 0;
+  queue->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (queue->eventFd < 0) {
+    return false;
+  }
+  pthread_mutex_init(&queue->waitMutex, NULL);
+  pthread_cond_init(&queue->cellFreed, NULL);
+  return true;
+}
+
+/**
+ * \brief Release the resources of a queue successfully initialized, or do
+ * nothing if its eventFd is -1.
+ */
+static inline void GameActivityCommandQueue_destroy(
+    GameActivityCommandQueue* queue) {
+  if (queue->eventFd >= 0) {
+    close(queue->eventFd);
+    queue->eventFd = -1;
+    pthread_cond_destroy(&queue->cellFreed);
+    pthread_mutex_destroy(&queue->waitMutex);
+  }
+}
+
+/**
+ * \brief Wake up the reader, from any thread.
+ */
+static inline void GameActivityCommandQueue_signal(
+    GameActivityCommandQueue* queue) {
+  // Only the first command after the reader reset the eventfd signals it
+  if (!__atomic_exchange_n(&queue->signalled, 1, __ATOMIC_SEQ_CST)) {
+    uint64_t one = 1;
+    while (write(queue->eventFd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+  }
+}
+
+/**
+ * \brief Add a command to the queue, from any thread, and wake up the reader.
+ * Returns false if the queue is full.
+ */
+static inline bool GameActivityCommandQueue_push(
+    GameActivityCommandQueue* queue, const GameActivityCommand* command) {
+  uint64_t position = __atomic_load_n(&queue->writePosition, __ATOMIC_RELAXED);
+  for (;;) {
+    uint64_t index = position & (GAMEACTIVITY_COMMAND_QUEUE_SIZE - 1);
+    uint64_t sequence =
+        __atomic_load_n(&queue->cells[index].sequence, __ATOMIC_ACQUIRE);
+    if (sequence == position) {
+      if (__atomic_compare_exchange_n(&queue->writePosition, &position,
+                                      position + 1, true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        queue->cells[index].command = *command;
+        __atomic_store_n(&queue->cells[index].sequence, position + 1,
+                         __ATOMIC_RELEASE);
+        break;
+      }
+    } else if ((int64_t)(sequence - position) < 0) {
+      // The reader did not free this cell yet
+      return false;
+    } else {
+      position = __atomic_load_n(&queue->writePosition, __ATOMIC_RELAXED);
+    }
+  }
+
+  GameActivityCommandQueue_signal(queue);
+  return true;
+}
+
+/**
+ * \brief Add a command to the queue, from any thread, waiting for the reader
+ * to free a cell if the queue is full. The caller must not hold a lock the
+ * reader takes before reading its next command.
+ */
+static inline void GameActivityCommandQueue_pushWait(
+    GameActivityCommandQueue* queue, const GameActivityCommand* command) {
+  if (GameActivityCommandQueue_push(queue, command)) {
+    return;
+  }
+  pthread_mutex_lock(&queue->waitMutex);
+  __atomic_add_fetch(&queue->waiters, 1, __ATOMIC_RELAXED);
+  // Either the reader sees the waiter, or the waiter sees the freed cell
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  while (!GameActivityCommandQueue_push(queue, command)) {
+    pthread_cond_wait(&queue->cellFreed, &queue->waitMutex);
+  }
+  __atomic_sub_fetch(&queue->waiters, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&queue->waitMutex);
+}
+
+static inline bool GameActivityCommandQueue_tryPop(
+    GameActivityCommandQueue* queue, GameActivityCommand* outCommand) {
+  const uint64_t position = queue->readPosition;
+  const uint64_t index = position & (GAMEACTIVITY_COMMAND_QUEUE_SIZE - 1);
+  if (__atomic_load_n(&queue->cells[index].sequence, __ATOMIC_ACQUIRE) !=
+      position + 1) {
+    return false;
+  }
+  *outCommand = queue->cells[index].command;
+  __atomic_store_n(&queue->cells[index].sequence,
+                   position + GAMEACTIVITY_COMMAND_QUEUE_SIZE,
+                   __ATOMIC_RELEASE);
+  queue->readPosition = position + 1;
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&queue->waiters, __ATOMIC_RELAXED) > 0) {
+    pthread_mutex_lock(&queue->waitMutex);
+    pthread_cond_broadcast(&queue->cellFreed);
+    pthread_mutex_unlock(&queue->waitMutex);
+  }
+  return true;
+}
+
+/**
+ * \brief Take the oldest command of the queue, from the reader thread.
+ * Returns false if the queue is empty, in which case the eventfd is reset
+ * until the next command is added.
+ */
+static inline bool GameActivityCommandQueue_pop(
+    GameActivityCommandQueue* queue, GameActivityCommand* outCommand) {
+  if (GameActivityCommandQueue_tryPop(queue, outCommand)) {
+    return true;
+  }
+
+  // Reset the eventfd before the flag, so a command added meanwhile either
+  // signals it again or is seen below.
+  uint64_t count;
+  while (read(queue->eventFd, &count, sizeof(count)) < 0 && errno == EINTR) {
+  }
+  __atomic_exchange_n(&queue->signalled, 0, __ATOMIC_SEQ_CST);
+  return GameActivityCommandQueue_tryPop(queue, outCommand);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+
+#endif  // ANDROID_GAME_SDK_GAME_ACTIVITY_COMMAND_QUEUE_INTERNAL_H
@@ -16,8 +16,11 @@
 
 #include <game-activity/GameActivityEvents.h>
 #include <game-activity/GameActivityLog.h>
+#include <string.h>
 #include <sys/system_properties.h>
 
+#include <atomic>
+#include <memory>
 #include <string>
 
 #include "GameActivityEvents_internal.h"
@@ -30,12 +33,27 @@ static bool enabledAxes[GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT] = {
     // `GameActivityPointerAxes_enableAxis`).
     false};
 
+static_assert(GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT <= 64,
+              "enabledAxesMask has one bit per axis");
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "enabledAxesMask is read from Java as a plain long");
+
+// The same as enabledAxes, bit i is set when axis i is enabled. The Java
+// GameActivity reads it through a direct ByteBuffer, on the UI thread, to only
+// pack the values of the enabled axes. Axes may be enabled from any thread, so
+// it is atomic on the native side. An event packed while the mask changes
+// still decodes correctly, as the mask used is packed with it.
+static std::atomic<uint64_t> enabledAxesMask{(1ull << AMOTION_EVENT_AXIS_X) |
+                                             (1ull << AMOTION_EVENT_AXIS_Y)};
+
 extern "C" void GameActivityPointerAxes_enableAxis(int32_t axis) {
   if (axis < 0 || axis >= GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
     return;
   }
 
   enabledAxes[axis] = true;
+  enabledAxesMask.fetch_or(1ull << axis, std::memory_order_relaxed);
 }
 
 float GameActivityPointerAxes_getAxisValue(
@@ -58,6 +76,11 @@ extern "C" void GameActivityPointerAxes_disableAxis(int32_t axis) {
   }
 
   enabledAxes[axis] = false;
+  enabledAxesMask.fetch_and(~(1ull << axis), std::memory_order_relaxed);
+}
+
+extern "C" jobject GameActivityPointerAxes_newEnabledAxesBuffer(JNIEnv *env) {
+  return env->NewDirectByteBuffer(&enabledAxesMask, sizeof(uint64_t));
 }
 
 float GameActivityMotionEvent_getHistoricalAxisValue(
@@ -122,9 +145,12 @@ static struct {
 
 extern "C" void GameActivityMotionEvent_destroy(
     GameActivityMotionEvent *c_event) {
-  delete c_event->historicalAxisValues;
-  delete c_event->historicalEventTimesMillis;
-  delete c_event->historicalEventTimesNanos;
+  delete[] c_event->historicalAxisValues;
+  delete[] c_event->historicalEventTimesMillis;
+  delete[] c_event->historicalEventTimesNanos;
+  c_event->historicalAxisValues = nullptr;
+  c_event->historicalEventTimesMillis = nullptr;
+  c_event->historicalEventTimesNanos = nullptr;
 }
 
 static void initMotionEvents(JNIEnv *env) {
@@ -188,11 +214,9 @@ static void initMotionEvents(JNIEnv *env) {
       env->GetMethodID(motionEventClass, "getHistoricalAxisValue", "(III)F");
 }
 
-extern "C" void GameActivityMotionEvent_fromJava(
-    JNIEnv *env, jobject motionEvent, GameActivityMotionEvent *out_event,
-    int pointerCount, int historySize) {
-  pointerCount =
-      std::min(pointerCount, GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT);
+static void readPointersFromJava(JNIEnv *env, jobject motionEvent,
+                                 GameActivityMotionEvent *out_event,
+                                 int pointerCount) {
   out_event->pointerCount = pointerCount;
   for (int i = 0; i < pointerCount; ++i) {
     out_event->pointers[i] = {
@@ -219,13 +243,18 @@ extern "C" void GameActivityMotionEvent_fromJava(
       }
     }
   }
+}
 
+// Fills the history arrays of out_event, which must have room for
+// historySize entries of pointerCount pointers. Disabled axes read as 0.
+static void readHistoryFromJava(JNIEnv *env, jobject motionEvent,
+                                GameActivityMotionEvent *out_event,
+                                int historySize) {
+  const int pointerCount = out_event->pointerCount;
   out_event->historySize = historySize;
-  out_event->historicalAxisValues =
-      new float[historySize * pointerCount *
-                GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
-  out_event->historicalEventTimesMillis = new int64_t[historySize];
-  out_event->historicalEventTimesNanos = new int64_t[historySize];
+  memset(out_event->historicalAxisValues, 0,
+         sizeof(float) * historySize * pointerCount *
+             GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT);
 
   for (int historyIndex = 0; historyIndex < historySize; historyIndex++) {
     out_event->historicalEventTimesMillis[historyIndex] = env->CallLongMethod(
@@ -251,6 +280,162 @@ extern "C" void GameActivityMotionEvent_fromJava(
   }
 }
 
+extern "C" void GameActivityMotionEvent_fromJava(
+    JNIEnv *env, jobject motionEvent, GameActivityMotionEvent *out_event,
+    int pointerCount, int historySize) {
+  pointerCount =
+      std::min(pointerCount, GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT);
+  readPointersFromJava(env, motionEvent, out_event, pointerCount);
+
+  out_event->historicalAxisValues =
+      new float[historySize * pointerCount *
+                GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+  out_event->historicalEventTimesMillis = new int64_t[historySize];
+  out_event->historicalEventTimesNanos = new int64_t[historySize];
+  readHistoryFromJava(env, motionEvent, out_event, historySize);
+}
+
+// History storage of GameActivityMotionEvent_fromDirectBuffer. It only
+// grows, so once it fits the largest event no more allocations are made.
+static struct {
+  std::unique_ptr<float[]> axisValues;
+  std::unique_ptr<int64_t[]> eventTimes;
+  size_t axisValuesSize;
+  size_t eventTimesSize;
+} gReusedHistory;
+
+// Points the history of out_event to gReusedHistory, after growing it to fit
+// historySize entries of pointerCount pointers.
+static void useReusedHistory(GameActivityMotionEvent *out_event,
+                             int pointerCount, int historySize) {
+  const size_t axisValuesSize =
+      historySize * pointerCount * GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+  if (axisValuesSize > gReusedHistory.axisValuesSize) {
+    gReusedHistory.axisValues.reset(new float[axisValuesSize]);
+    gReusedHistory.axisValuesSize = axisValuesSize;
+  }
+  // Millisecond times, followed by the same times in nanoseconds
+  const size_t eventTimesSize = 2 * historySize;
+  if (eventTimesSize > gReusedHistory.eventTimesSize) {
+    gReusedHistory.eventTimes.reset(new int64_t[eventTimesSize]);
+    gReusedHistory.eventTimesSize = eventTimesSize;
+  }
+  out_event->historicalAxisValues = gReusedHistory.axisValues.get();
+  out_event->historicalEventTimesMillis = gReusedHistory.eventTimes.get();
+  out_event->historicalEventTimesNanos =
+      gReusedHistory.eventTimes.get() + historySize;
+}
+
+namespace {
+
+// Reads the values written by GameActivity.packMotionEvent, in native byte
+// order and without alignment.
+class PackedMotionEventReader {
+ public:
+  explicit PackedMotionEventReader(const uint8_t *data) : data_(data) {}
+
+  template <typename T>
+  T read() {
+    T value;
+    memcpy(&value, data_, sizeof(T));
+    data_ += sizeof(T);
+    return value;
+  }
+
+  // Reads one float for each bit of axesMask into axisValues, or skips them
+  // when axisValues is null.
+  void readAxes(uint64_t axesMask, float *axisValues) {
+    for (uint64_t bits = axesMask; bits != 0; bits &= bits - 1) {
+      const float value = read<float>();
+      if (axisValues != nullptr) {
+        axisValues[__builtin_ctzll(bits)] = value;
+      }
+    }
+  }
+
+ private:
+  const uint8_t *data_;
+};
+
+// Axes mask, pointer count and history size
+constexpr size_t kPackedHeaderSize = 16;
+// Id, tool type, raw X and raw Y, followed by the axis values
+constexpr size_t kPackedPointerSize = 16;
+// Event time in milliseconds, followed by the axis values of each pointer
+constexpr size_t kPackedHistorySize = 8;
+
+}  // anonymous namespace
+
+extern "C" bool GameActivityMotionEvent_fromDirectBuffer(
+    JNIEnv *env, jobject packedEvent, int packedSize,
+    GameActivityMotionEvent *out_event) {
+  const uint8_t *data =
+      static_cast<const uint8_t *>(env->GetDirectBufferAddress(packedEvent));
+  if (data == nullptr || packedSize < (int)kPackedHeaderSize) {
+    ALOGE("Invalid packed motion event");
+    return false;
+  }
+
+  PackedMotionEventReader reader(data);
+  const uint64_t axesMask = reader.read<uint64_t>();
+  const int32_t packedPointerCount = reader.read<int32_t>();
+  const int32_t historySize = reader.read<int32_t>();
+  const size_t axesSize = sizeof(float) * __builtin_popcountll(axesMask);
+  if ((axesMask >> GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) != 0 ||
+      packedPointerCount < 0 || historySize < 0 ||
+      kPackedHeaderSize +
+              packedPointerCount * (kPackedPointerSize + axesSize) +
+              historySize *
+                  (kPackedHistorySize + packedPointerCount * axesSize) >
+          (size_t)packedSize) {
+    ALOGE("Invalid packed motion event");
+    return false;
+  }
+
+  // Pointers past the maximum are skipped, they are still in the history
+  const int pointerCount = std::min<int>(
+      packedPointerCount, GAMEACTIVITY_MAX_NUM_POINTERS_IN_MOTION_EVENT);
+  out_event->pointerCount = pointerCount;
+  for (int i = 0; i < packedPointerCount; ++i) {
+    if (i >= pointerCount) {
+      reader.read<int32_t>();
+      reader.read<int32_t>();
+      reader.read<float>();
+      reader.read<float>();
+      reader.readAxes(axesMask, nullptr);
+      continue;
+    }
+    GameActivityPointerAxes &pointer = out_event->pointers[i];
+    pointer.id = reader.read<int32_t>();
+    pointer.toolType = reader.read<int32_t>();
+    pointer.rawX = reader.read<float>();
+    pointer.rawY = reader.read<float>();
+    memset(pointer.axisValues, 0, sizeof(pointer.axisValues));
+    reader.readAxes(axesMask, pointer.axisValues);
+  }
+
+  useReusedHistory(out_event, pointerCount, historySize);
+  out_event->historySize = historySize;
+  memset(out_event->historicalAxisValues, 0,
+         sizeof(float) * historySize * pointerCount *
+             GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT);
+  for (int historyIndex = 0; historyIndex < historySize; historyIndex++) {
+    const int64_t eventTime = reader.read<int64_t>();
+    out_event->historicalEventTimesMillis[historyIndex] = eventTime;
+    out_event->historicalEventTimesNanos[historyIndex] = eventTime * 1000000;
+    float *axisValues =
+        &out_event->historicalAxisValues[historyIndex * pointerCount *
+                                         GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+    for (int i = 0; i < packedPointerCount; ++i) {
+      reader.readAxes(
+          axesMask, i < pointerCount
+                        ? &axisValues[i * GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT]
+                        : nullptr);
+    }
+  }
+  return true;
+}
+
 static struct {
   jmethodID getDeviceId;
   jmethodID getSource;
@@ -56,6 +56,36 @@ void GameActivityMotionEvent_fromJava(JNIEnv* env, jobject motionEvent,
                                       GameActivityMotionEvent* out_event,
                                       int pointerCount, int historySize);
 
+/**
+ * \brief Create a direct `java.nio.ByteBuffer` holding the 64 bit mask of the
+ * enabled axes, bit i being set when axis i is enabled.
+ *
+ * The buffer tracks `GameActivityPointerAxes_enableAxis` and
+ * `GameActivityPointerAxes_disableAxis`, GameActivity reads it to only pack
+ * the values of the enabled axes.
+ */
+jobject GameActivityPointerAxes_newEnabledAxesBuffer(JNIEnv* env);
+
+/**
+ * \brief Convert a motion event packed by the Java GameActivity in a direct
+ * `java.nio.ByteBuffer` to a `GameActivityMotionEvent`.
+ *
+ * Only the pointers and their history are read from the buffer, the other
+ * fields of out_event are left unchanged. The buffer is decoded in a single
+ * pass, without JNI calls for each axis.
+ *
+ * The history is stored in buffers owned by the library instead of being
+ * allocated. It is only valid until the next call, and out_event must not be
+ * passed to `GameActivityMotionEvent_destroy`. This is what GameActivity uses
+ * for the events passed to `onTouchEvent`, it must only be called from one
+ * thread.
+ * Returns false, logging an error, when the buffer is not a valid packed
+ * event of packedSize bytes.
+ */
+bool GameActivityMotionEvent_fromDirectBuffer(
+    JNIEnv* env, jobject packedEvent, int packedSize,
+    GameActivityMotionEvent* out_event);
+
 /**
  * \brief Convert a Java `KeyEvent` to a `GameActivityKeyEvent`.
  *
@@ -20,13 +20,21 @@
 #include <assert.h>
 #include <errno.h>
 #include <jni.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "../GameActivityCommandQueue_internal.h"
+
 #define NATIVE_APP_GLUE_MOTION_EVENTS_DEFAULT_BUF_SIZE 16
 #define NATIVE_APP_GLUE_KEY_EVENTS_DEFAULT_BUF_SIZE 4
+// Room for the history of a few multi-touch events, in bytes
+#define NATIVE_APP_GLUE_MOTION_HISTORY_DEFAULT_BUF_SIZE 16384
+// Size of the input queue in bytes, a power of two. It holds a few hundred
+// multi-touch events, with their history, until the app thread reads them.
+#define NATIVE_APP_GLUE_INPUT_QUEUE_SIZE (256 * 1024)
 
 #define LOGI(...) \
   ((void)__android_log_print(ANDROID_LOG_INFO, "threaded_app", __VA_ARGS__))
@@ -61,14 +69,19 @@ static void free_saved_state(struct android_app* android_app) {
   pthread_mutex_unlock(&android_app->mutex);
 }
 
+static bool pop_cmd(struct android_app* android_app, int8_t* cmd) {
+  GameActivityCommand command;
+  if (!GameActivityCommandQueue_pop(android_app->cmdQueue, &command)) {
+    return false;
+  }
+  *cmd = (int8_t)command.cmd;
+  if (*cmd == APP_CMD_SAVE_STATE) free_saved_state(android_app);
+  return true;
+}
+
 int8_t android_app_read_cmd(struct android_app* android_app) {
   int8_t cmd;
-  if (read(android_app->msgread, &cmd, sizeof(cmd)) != sizeof(cmd)) {
-    LOGE("No data on command pipe!");
-    return -1;
-  }
-  if (cmd == APP_CMD_SAVE_STATE) free_saved_state(android_app);
-  return cmd;
+  return pop_cmd(android_app, &cmd) ? cmd : -1;
 }
 
 static void print_cur_config(struct android_app* android_app) {
@@ -139,6 +152,17 @@ void android_app_pre_exec_cmd(struct android_app* android_app, int8_t cmd) {
       LOGV("APP_CMD_DESTROY");
       android_app->destroyRequested = 1;
       break;
+
+    // Events received from now on need a new command
+    case APP_CMD_TOUCH_EVENT:
+      __atomic_exchange_n(&android_app->touchEventCmdPending, 0,
+                          __ATOMIC_SEQ_CST);
+      break;
+
+    case APP_CMD_KEY_EVENT:
+      __atomic_exchange_n(&android_app->keyEventCmdPending, 0,
+                          __ATOMIC_SEQ_CST);
+      break;
   }
 }
 
@@ -182,10 +206,13 @@ static void android_app_destroy(struct android_app* android_app) {
 
 static void process_cmd(struct android_app* app,
                         struct android_poll_source* source) {
-  int8_t cmd = android_app_read_cmd(app);
-  android_app_pre_exec_cmd(app, cmd);
-  if (app->onAppCmd != NULL) app->onAppCmd(app, cmd);
-  android_app_post_exec_cmd(app, cmd);
+  // All the commands written since the last wakeup are processed at once
+  int8_t cmd;
+  while (pop_cmd(app, &cmd)) {
+    android_app_pre_exec_cmd(app, cmd);
+    if (app->onAppCmd != NULL) app->onAppCmd(app, cmd);
+    android_app_post_exec_cmd(app, cmd);
+  }
 }
 
 // This is run on a separate thread (i.e: not the main thread).
@@ -215,6 +242,10 @@ static void* android_app_entry(void* param) {
     buf->motionEvents = (GameActivityMotionEvent*)malloc(
         sizeof(GameActivityMotionEvent) * buf->motionEventsBufferSize);
 
+    buf->motionHistoryBufferSize =
+        NATIVE_APP_GLUE_MOTION_HISTORY_DEFAULT_BUF_SIZE;
+    buf->motionHistory = (uint8_t*)malloc(buf->motionHistoryBufferSize);
+
     buf->keyEventsBufferSize = NATIVE_APP_GLUE_KEY_EVENTS_DEFAULT_BUF_SIZE;
     buf->keyEvents = (GameActivityKeyEvent*)malloc(
         sizeof(GameActivityKeyEvent) * buf->keyEventsBufferSize);
@@ -225,7 +256,7 @@ static void* android_app_entry(void* param) {
   android_app->cmdPollSource.process = process_cmd;
 
   ALooper* looper = ALooper_prepare(ALOOPER_PREPARE_ALLOW_NON_CALLBACKS);
-  ALooper_addFd(looper, android_app->msgread, LOOPER_ID_MAIN,
+  ALooper_addFd(looper, android_app->cmdQueue->eventFd, LOOPER_ID_MAIN,
                 ALOOPER_EVENT_INPUT, NULL, &android_app->cmdPollSource);
   android_app->looper = looper;
 
@@ -290,17 +321,18 @@ static struct android_app* android_app_create(GameActivity* activity,
     memcpy(android_app->savedState, savedState, savedStateSize);
   }
 
-  int msgpipe[2];
-  if (pipe(msgpipe)) {
-    LOGE("could not create pipe: %s", strerror(errno));
+  android_app->cmdQueue = (struct GameActivityCommandQueue*)malloc(
+      sizeof(struct GameActivityCommandQueue));
+  if (!GameActivityCommandQueue_init(android_app->cmdQueue)) {
+    LOGE("could not create eventfd: %s", strerror(errno));
     return NULL;
   }
-  android_app->msgread = msgpipe[0];
-  android_app->msgwrite = msgpipe[1];
 
   android_app->keyEventFilter = default_key_filter;
   android_app->motionEventFilter = default_motion_filter;
 
+  android_app->inputQueue = (uint8_t*)malloc(NATIVE_APP_GLUE_INPUT_QUEUE_SIZE);
+
   LOGV("Launching android_app_entry in a thread");
   pthread_attr_t attr;
   pthread_attr_init(&attr);
@@ -317,23 +349,29 @@ static struct android_app* android_app_create(GameActivity* activity,
   return android_app;
 }
 
+// Must not be called with android_app->mutex held: when the queue is full, it
+// waits for the app thread, which may need the mutex to read the commands.
 void android_app_write_cmd(struct android_app* android_app, int8_t cmd) {
-  if (write(android_app->msgwrite, &cmd, sizeof(cmd)) != sizeof(cmd)) {
-    LOGE("Failure writing android_app cmd: %s", strerror(errno));
-  }
+  GameActivityCommand command = {cmd, 0, 0, 0};
+  GameActivityCommandQueue_pushWait(android_app->cmdQueue, &command);
 }
 
 static void android_app_set_window(struct android_app* android_app,
                                    ANativeWindow* window) {
   LOGV("android_app_set_window called");
   pthread_mutex_lock(&android_app->mutex);
-  if (android_app->pendingWindow != NULL) {
+  const bool hadWindow = android_app->pendingWindow != NULL;
+  android_app->pendingWindow = window;
+  pthread_mutex_unlock(&android_app->mutex);
+
+  if (hadWindow) {
     android_app_write_cmd(android_app, APP_CMD_TERM_WINDOW);
   }
-  android_app->pendingWindow = window;
   if (window != NULL) {
     android_app_write_cmd(android_app, APP_CMD_INIT_WINDOW);
   }
+
+  pthread_mutex_lock(&android_app->mutex);
   while (android_app->window != android_app->pendingWindow) {
     pthread_cond_wait(&android_app->cond, &android_app->mutex);
   }
@@ -342,19 +380,39 @@ static void android_app_set_window(struct android_app* android_app,
 
 static void android_app_set_activity_state(struct android_app* android_app,
                                            int8_t cmd) {
-  pthread_mutex_lock(&android_app->mutex);
   android_app_write_cmd(android_app, cmd);
+  // The app thread has to handle a pause or a stop before the activity goes
+  // on, but it can start and resume without the main thread waiting for it.
+  if (cmd != APP_CMD_PAUSE && cmd != APP_CMD_STOP) {
+    return;
+  }
+  pthread_mutex_lock(&android_app->mutex);
   while (android_app->activityState != cmd) {
     pthread_cond_wait(&android_app->cond, &android_app->mutex);
   }
   pthread_mutex_unlock(&android_app->mutex);
 }
 
+// An input queue record that didn't fit in the ring, see below
+struct android_input_overflow {
+  struct android_input_overflow* next;
+  // The record, 8-byte aligned
+  uint64_t record[];
+};
+
+static void free_input_overflow(struct android_input_overflow* overflow) {
+  while (overflow != NULL) {
+    struct android_input_overflow* next = overflow->next;
+    free(overflow);
+    overflow = next;
+  }
+}
+
 static void android_app_free(struct android_app* android_app) {
   int input_buf_idx = 0;
 
-  pthread_mutex_lock(&android_app->mutex);
   android_app_write_cmd(android_app, APP_CMD_DESTROY);
+  pthread_mutex_lock(&android_app->mutex);
   while (!android_app->destroyed) {
     pthread_cond_wait(&android_app->cond, &android_app->mutex);
   }
@@ -367,11 +425,14 @@ static void android_app_free(struct android_app* android_app) {
 
     android_app_clear_motion_events(buf);
     free(buf->motionEvents);
+    free(buf->motionHistory);
     free(buf->keyEvents);
   }
+  free(android_app->inputQueue);
+  free_input_overflow(android_app->inputOverflow);
 
-  close(android_app->msgread);
-  close(android_app->msgwrite);
+  GameActivityCommandQueue_destroy(android_app->cmdQueue);
+  free(android_app->cmdQueue);
   pthread_cond_destroy(&android_app->cond);
   pthread_mutex_destroy(&android_app->mutex);
   free(android_app);
@@ -405,7 +466,11 @@ static void onSaveInstanceState(GameActivity* activity,
   void* savedState = NULL;
   pthread_mutex_lock(&android_app->mutex);
   android_app->stateSaved = 0;
+  pthread_mutex_unlock(&android_app->mutex);
+
   android_app_write_cmd(android_app, APP_CMD_SAVE_STATE);
+
+  pthread_mutex_lock(&android_app->mutex);
   while (!android_app->stateSaved) {
     pthread_cond_wait(&android_app->cond, &android_app->mutex);
   }
@@ -476,25 +541,255 @@ static void onNativeWindowResized(GameActivity* activity, ANativeWindow* window,
 
 void android_app_set_motion_event_filter(struct android_app* app,
                                          android_motion_event_filter filter) {
-  pthread_mutex_lock(&app->mutex);
-  app->motionEventFilter = filter;
-  pthread_mutex_unlock(&app->mutex);
+  __atomic_store_n(&app->motionEventFilter, filter, __ATOMIC_RELEASE);
 }
 
-static bool onTouchEvent(GameActivity* activity,
-                         const GameActivityMotionEvent* event) {
-  struct android_app* android_app = ToApp(activity);
+void android_app_set_motion_event_coalescing(struct android_app* app,
+                                             bool coalesce) {
+  __atomic_store_n(&app->coalesceMotionEvents, coalesce, __ATOMIC_RELAXED);
+}
+
+// --------------------------------------------------------------------
+// Input queue
+//
+// The events received by onTouchEvent and onKey on the main thread are
+// written to android_app->inputQueue, a single producer single consumer ring
+// of records, and moved to the current input buffer by the app thread in
+// android_app_swap_input_buffers. A record is published by storing the new
+// inputQueueTail once it is complete, and its room is given back by storing
+// the new inputQueueHead once it is read, so neither thread takes a lock.
+//
+// The records that don't fit in the ring, when the app thread falls behind or
+// for a very large event, are allocated on the heap and added to the
+// android_app->inputOverflow list under the mutex instead of being dropped.
+// --------------------------------------------------------------------
+
+#define INPUT_QUEUE_MOTION_EVENT 1
+#define INPUT_QUEUE_KEY_EVENT 2
+// Padding up to the end of the ring, the next record is at its start
+#define INPUT_QUEUE_WRAP 3
+
+#define INPUT_QUEUE_ALIGN(size) (((size) + 7) & ~(uint64_t)7)
+
+struct input_queue_record {
+  uint32_t type;
+  // In bytes, with this header, and a multiple of 8
+  uint32_t size;
+};
+
+// Followed by the event up to its last pointer, so only the pointers in use
+// are copied, then the history times in milliseconds, in nanoseconds, and the
+// history axis values.
+struct queued_motion_event {
+  struct input_queue_record header;
+  int32_t historySize;
+  float precisionX;
+  float precisionY;
+  uint32_t eventSize;
+};
+
+struct queued_key_event {
+  struct input_queue_record header;
+  GameActivityKeyEvent event;
+};
+
+// Returns room for a record of size bytes in the ring, or NULL if it is full.
+static struct input_queue_record* input_queue_reserve_ring(
+    struct android_app* android_app, uint64_t size, uint64_t* newTail) {
+  const uint64_t head =
+      __atomic_load_n(&android_app->inputQueueHead, __ATOMIC_ACQUIRE);
+  uint64_t tail =
+      __atomic_load_n(&android_app->inputQueueTail, __ATOMIC_RELAXED);
+  uint64_t offset = tail % NATIVE_APP_GLUE_INPUT_QUEUE_SIZE;
+  const uint64_t padding = offset + size > NATIVE_APP_GLUE_INPUT_QUEUE_SIZE
+                               ? NATIVE_APP_GLUE_INPUT_QUEUE_SIZE - offset
+                               : 0;
+  if (tail + padding + size - head > NATIVE_APP_GLUE_INPUT_QUEUE_SIZE) {
+    return NULL;
+  }
+
+  if (padding > 0) {
+    struct input_queue_record* wrap =
+        (struct input_queue_record*)(android_app->inputQueue + offset);
+    wrap->type = INPUT_QUEUE_WRAP;
+    wrap->size = (uint32_t)padding;
+    tail += padding;
+    offset = 0;
+  }
+  *newTail = tail + size;
+
+  struct input_queue_record* record =
+      (struct input_queue_record*)(android_app->inputQueue + offset);
+  record->size = (uint32_t)size;
+  return record;
+}
+
+// Returns room for a record of size bytes, in the ring or, if it doesn't fit,
+// on the heap with *newTail set to 0. The record is only seen by the app
+// thread after input_queue_publish(record, newTail).
+static struct input_queue_record* input_queue_reserve(
+    struct android_app* android_app, uint64_t size, uint64_t* newTail) {
+  // Keep adding to the overflow list until the app thread has read it, so
+  // the events stay in order
+  if (!__atomic_load_n(&android_app->inputOverflowPending, __ATOMIC_ACQUIRE)) {
+    struct input_queue_record* record =
+        input_queue_reserve_ring(android_app, size, newTail);
+    if (record != NULL) {
+      return record;
+    }
+    LOGW_ONCE("input queue full, events are allocated on the heap");
+  }
+
+  struct android_input_overflow* overflow = (struct android_input_overflow*)
+      malloc(sizeof(struct android_input_overflow) + size);
+  if (overflow == NULL) {
+    LOGE("input queue: out of memory");
+    abort();
+  }
+  overflow->next = NULL;
+  *newTail = 0;
+
+  struct input_queue_record* record =
+      (struct input_queue_record*)overflow->record;
+  record->size = (uint32_t)size;
+  return record;
+}
+
+static void input_queue_publish(struct android_app* android_app,
+                                struct input_queue_record* record,
+                                uint64_t newTail) {
+  if (newTail != 0) {
+    __atomic_store_n(&android_app->inputQueueTail, newTail, __ATOMIC_RELEASE);
+    return;
+  }
+
+  struct android_input_overflow* overflow =
+      (struct android_input_overflow*)((uint8_t*)record -
+                                       offsetof(struct android_input_overflow,
+                                                record));
   pthread_mutex_lock(&android_app->mutex);
+  if (android_app->inputOverflowLast != NULL) {
+    android_app->inputOverflowLast->next = overflow;
+  } else {
+    android_app->inputOverflow = overflow;
+  }
+  android_app->inputOverflowLast = overflow;
+  __atomic_store_n(&android_app->inputOverflowPending, true, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&android_app->mutex);
+}
+
+// Returns the record at *position, skipping the padding at the end of the
+// ring, or NULL when *position reaches tail.
+static const struct input_queue_record* input_queue_record_at(
+    const struct android_app* android_app, uint64_t* position, uint64_t tail) {
+  while (*position != tail) {
+    const uint64_t offset = *position % NATIVE_APP_GLUE_INPUT_QUEUE_SIZE;
+    const struct input_queue_record* record =
+        (const struct input_queue_record*)(android_app->inputQueue + offset);
+    if (record->type != INPUT_QUEUE_WRAP) {
+      return record;
+    }
+    *position += record->size;
+  }
+  return NULL;
+}
+
+static uint64_t motion_event_size(uint32_t pointerCount) {
+  return offsetof(GameActivityMotionEvent, pointers) +
+         sizeof(GameActivityPointerAxes) * pointerCount;
+}
 
-  if (android_app->motionEventFilter != NULL &&
-      !android_app->motionEventFilter(event)) {
-    pthread_mutex_unlock(&android_app->mutex);
+static uint64_t motion_history_size(int historySize, uint32_t pointerCount) {
+  return 2 * sizeof(int64_t) * historySize +
+         sizeof(float) * historySize * pointerCount *
+             GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+}
+
+static const GameActivityMotionEvent* queued_motion_event_data(
+    const struct queued_motion_event* queued) {
+  return (const GameActivityMotionEvent*)(queued + 1);
+}
+
+// The history times in milliseconds, in nanoseconds, then the axis values
+static const uint8_t* queued_motion_event_history(
+    const struct queued_motion_event* queued) {
+  return (const uint8_t*)(queued + 1) + INPUT_QUEUE_ALIGN(queued->eventSize);
+}
+
+// Whether next can be merged into previous, both being moves of the same
+// pointers
+static bool can_coalesce_motion_events(
+    const struct queued_motion_event* previous,
+    const struct queued_motion_event* next) {
+  const GameActivityMotionEvent* a = queued_motion_event_data(previous);
+  const GameActivityMotionEvent* b = queued_motion_event_data(next);
+  if (a->action != AMOTION_EVENT_ACTION_MOVE ||
+      b->action != AMOTION_EVENT_ACTION_MOVE || a->deviceId != b->deviceId ||
+      a->source != b->source || a->flags != b->flags ||
+      a->metaState != b->metaState || a->buttonState != b->buttonState ||
+      a->classification != b->classification ||
+      a->pointerCount != b->pointerCount) {
     return false;
   }
+  for (uint32_t i = 0; i < a->pointerCount; ++i) {
+    if (a->pointers[i].id != b->pointers[i].id ||
+        a->pointers[i].toolType != b->pointers[i].toolType) {
+      return false;
+    }
+  }
+  return true;
+}
 
-  struct android_input_buffer* inputBuffer =
-      &android_app->inputBuffers[android_app->currentInputBuffer];
+// Returns size bytes of the history storage of inputBuffer, 8-byte aligned.
+// The storage only grows, so once it fits the largest burst of events no more
+// allocations are made.
+static uint8_t* reserve_motion_history(struct android_input_buffer* inputBuffer,
+                                       uint64_t size) {
+  if (inputBuffer->motionHistorySize + size >
+      inputBuffer->motionHistoryBufferSize) {
+    uint8_t* oldHistory = inputBuffer->motionHistory;
+    while (inputBuffer->motionHistorySize + size >
+           inputBuffer->motionHistoryBufferSize) {
+      inputBuffer->motionHistoryBufferSize *= 2;
+    }
+    inputBuffer->motionHistory = (uint8_t*)realloc(
+        inputBuffer->motionHistory, inputBuffer->motionHistoryBufferSize);
+
+    if (inputBuffer->motionHistory == NULL) {
+      LOGE("onTouchEvent: out of memory");
+      abort();
+    }
+
+    // Move the history pointers of the events already in the buffer
+    for (uint64_t i = 0; i < inputBuffer->motionEventsCount; ++i) {
+      GameActivityMotionEvent* previous = &inputBuffer->motionEvents[i];
+      if (previous->historySize > 0) {
+        previous->historicalEventTimesMillis =
+            (int64_t*)(inputBuffer->motionHistory +
+                       ((uint8_t*)previous->historicalEventTimesMillis -
+                        oldHistory));
+        previous->historicalEventTimesNanos =
+            (int64_t*)(inputBuffer->motionHistory +
+                       ((uint8_t*)previous->historicalEventTimesNanos -
+                        oldHistory));
+        previous->historicalAxisValues =
+            (float*)(inputBuffer->motionHistory +
+                     ((uint8_t*)previous->historicalAxisValues - oldHistory));
+      }
+    }
+  }
+
+  uint8_t* history =
+      inputBuffer->motionHistory + inputBuffer->motionHistorySize;
+  inputBuffer->motionHistorySize += size;
+  return history;
+}
 
+// Adds the event of last to inputBuffer, with room for historySize entries
+// of history
+static GameActivityMotionEvent* add_motion_event(
+    struct android_input_buffer* inputBuffer,
+    const struct queued_motion_event* last, int historySize) {
   // Add to the list of active motion events
   if (inputBuffer->motionEventsCount >= inputBuffer->motionEventsBufferSize) {
     inputBuffer->motionEventsBufferSize *= 2;
@@ -508,86 +803,286 @@ static bool onTouchEvent(GameActivity* activity,
     }
   }
 
-  int new_ix = inputBuffer->motionEventsCount;
-  memcpy(&inputBuffer->motionEvents[new_ix], event,
-         sizeof(GameActivityMotionEvent));
+  GameActivityMotionEvent* event =
+      &inputBuffer->motionEvents[inputBuffer->motionEventsCount];
+  memcpy(event, queued_motion_event_data(last), last->eventSize);
+  event->historySize = historySize;
+  event->precisionX = last->precisionX;
+  event->precisionY = last->precisionY;
   ++inputBuffer->motionEventsCount;
 
-  android_app_write_cmd(android_app, APP_CMD_TOUCH_EVENT);
-  pthread_mutex_unlock(&android_app->mutex);
+  if (historySize == 0) {
+    event->historicalEventTimesMillis = NULL;
+    event->historicalEventTimesNanos = NULL;
+    event->historicalAxisValues = NULL;
+    return event;
+  }
+
+  // Times first, keeping every array 8-byte aligned
+  uint8_t* history = reserve_motion_history(
+      inputBuffer, motion_history_size(historySize, event->pointerCount));
+  event->historicalEventTimesMillis = (int64_t*)history;
+  event->historicalEventTimesNanos = (int64_t*)history + historySize;
+  event->historicalAxisValues = (float*)(history + 2 * sizeof(int64_t) *
+                                                       historySize);
+  return event;
+}
+
+// Copies the history of queued to the history of event from historyIndex,
+// followed by the position of queued if it is merged into event, and returns
+// the index after them.
+static int append_motion_history(GameActivityMotionEvent* event,
+                                 const struct queued_motion_event* queued,
+                                 int historyIndex, bool merged) {
+  const uint64_t rowSize = sizeof(float) * event->pointerCount *
+                           GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+  const int queuedHistorySize = queued->historySize;
+  const uint8_t* queuedHistory = queued_motion_event_history(queued);
+  memcpy(event->historicalEventTimesMillis + historyIndex, queuedHistory,
+         sizeof(int64_t) * queuedHistorySize);
+  queuedHistory += sizeof(int64_t) * queuedHistorySize;
+  memcpy(event->historicalEventTimesNanos + historyIndex, queuedHistory,
+         sizeof(int64_t) * queuedHistorySize);
+  queuedHistory += sizeof(int64_t) * queuedHistorySize;
+  memcpy((uint8_t*)event->historicalAxisValues + rowSize * historyIndex,
+         queuedHistory, rowSize * queuedHistorySize);
+  historyIndex += queuedHistorySize;
+
+  if (merged) {
+    const GameActivityMotionEvent* data = queued_motion_event_data(queued);
+    event->historicalEventTimesMillis[historyIndex] = data->eventTime;
+    event->historicalEventTimesNanos[historyIndex] = data->eventTime * 1000000;
+    float* axisValues = (float*)((uint8_t*)event->historicalAxisValues +
+                                 rowSize * historyIndex);
+    for (uint32_t p = 0; p < data->pointerCount; ++p) {
+      memcpy(axisValues + p * GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT,
+             data->pointers[p].axisValues, sizeof(data->pointers[p].axisValues));
+    }
+    ++historyIndex;
+  }
+  return historyIndex;
+}
+
+// Moves the motion event record at position to inputBuffer, merged with the
+// following moves when coalescing is enabled, and returns the position after
+// the records read.
+static uint64_t read_motion_events(struct android_app* android_app,
+                                   struct android_input_buffer* inputBuffer,
+                                   uint64_t position, uint64_t tail) {
+  const struct queued_motion_event* first =
+      (const struct queued_motion_event*)input_queue_record_at(
+          android_app, &position, tail);
+  const struct queued_motion_event* last = first;
+  uint64_t end = position + first->header.size;
+  int historySize = first->historySize;
+  int count = 1;
+
+  if (__atomic_load_n(&android_app->coalesceMotionEvents, __ATOMIC_RELAXED)) {
+    uint64_t nextPosition = end;
+    const struct input_queue_record* next;
+    while ((next = input_queue_record_at(android_app, &nextPosition, tail)) !=
+               NULL &&
+           next->type == INPUT_QUEUE_MOTION_EVENT &&
+           can_coalesce_motion_events(
+               last, (const struct queued_motion_event*)next)) {
+      last = (const struct queued_motion_event*)next;
+      // The position of the merged events is added to the history
+      historySize += 1 + last->historySize;
+      nextPosition += next->size;
+      end = nextPosition;
+      ++count;
+    }
+  }
+
+  GameActivityMotionEvent* event =
+      add_motion_event(inputBuffer, last, historySize);
+  if (historySize == 0) {
+    return end;
+  }
+
+  int historyIndex = 0;
+  for (int i = 0; i < count; ++i) {
+    const struct queued_motion_event* queued =
+        (const struct queued_motion_event*)input_queue_record_at(
+            android_app, &position, tail);
+    position += queued->header.size;
+    historyIndex =
+        append_motion_history(event, queued, historyIndex, queued != last);
+  }
+  return end;
+}
+
+static void read_key_event(struct android_input_buffer* inputBuffer,
+                           const struct queued_key_event* queued) {
+  // Add to the list of active key down events
+  if (inputBuffer->keyEventsCount >= inputBuffer->keyEventsBufferSize) {
+    inputBuffer->keyEventsBufferSize = inputBuffer->keyEventsBufferSize * 2;
+    inputBuffer->keyEvents = (GameActivityKeyEvent*)realloc(
+        inputBuffer->keyEvents,
+        sizeof(GameActivityKeyEvent) * inputBuffer->keyEventsBufferSize);
+
+    if (inputBuffer->keyEvents == NULL) {
+      LOGE("onKey: out of memory");
+      abort();
+    }
+  }
+
+  memcpy(&inputBuffer->keyEvents[inputBuffer->keyEventsCount], &queued->event,
+         sizeof(GameActivityKeyEvent));
+  ++inputBuffer->keyEventsCount;
+}
+
+static bool onTouchEvent(GameActivity* activity,
+                         const GameActivityMotionEvent* event) {
+  struct android_app* android_app = ToApp(activity);
+
+  android_motion_event_filter filter =
+      __atomic_load_n(&android_app->motionEventFilter, __ATOMIC_ACQUIRE);
+  if (filter != NULL && !filter(event)) {
+    return false;
+  }
+
+  const uint64_t eventSize = motion_event_size(event->pointerCount);
+  const uint64_t historySize =
+      motion_history_size(event->historySize, event->pointerCount);
+  const uint64_t size = sizeof(struct queued_motion_event) +
+                        INPUT_QUEUE_ALIGN(eventSize) + historySize;
+  uint64_t newTail;
+  struct queued_motion_event* queued =
+      (struct queued_motion_event*)input_queue_reserve(android_app, size,
+                                                       &newTail);
+  queued->header.type = INPUT_QUEUE_MOTION_EVENT;
+  queued->historySize = event->historySize;
+  queued->precisionX = event->precisionX;
+  queued->precisionY = event->precisionY;
+  queued->eventSize = (uint32_t)eventSize;
+  memcpy(queued + 1, event, eventSize);
+
+  if (event->historySize > 0) {
+    const uint64_t eventTimesSize = sizeof(int64_t) * event->historySize;
+    uint8_t* history = (uint8_t*)queued_motion_event_history(queued);
+    memcpy(history, event->historicalEventTimesMillis, eventTimesSize);
+    history += eventTimesSize;
+    memcpy(history, event->historicalEventTimesNanos, eventTimesSize);
+    history += eventTimesSize;
+    memcpy(history, event->historicalAxisValues,
+           historySize - 2 * eventTimesSize);
+  }
+  input_queue_publish(android_app, &queued->header, newTail);
+
+  // One command is enough for all the events until the app thread handles it
+  if (!__atomic_exchange_n(&android_app->touchEventCmdPending, 1,
+                           __ATOMIC_SEQ_CST)) {
+    android_app_write_cmd(android_app, APP_CMD_TOUCH_EVENT);
+  }
   return true;
 }
 
-struct android_input_buffer* android_app_swap_input_buffers(
-    struct android_app* android_app) {
+// Moves the records of the ring to inputBuffer
+static void read_input_queue(struct android_app* android_app,
+                             struct android_input_buffer* inputBuffer) {
+  const uint64_t tail =
+      __atomic_load_n(&android_app->inputQueueTail, __ATOMIC_ACQUIRE);
+  uint64_t head = android_app->inputQueueHead;
+  const struct input_queue_record* record;
+  while ((record = input_queue_record_at(android_app, &head, tail)) != NULL) {
+    if (record->type == INPUT_QUEUE_KEY_EVENT) {
+      read_key_event(inputBuffer, (const struct queued_key_event*)record);
+      head += record->size;
+    } else {
+      head = read_motion_events(android_app, inputBuffer, head, tail);
+    }
+  }
+  __atomic_store_n(&android_app->inputQueueHead, head, __ATOMIC_RELEASE);
+}
+
+// Moves the records of the overflow list to inputBuffer, after the older ones
+// still in the ring
+static void read_input_overflow(struct android_app* android_app,
+                                struct android_input_buffer* inputBuffer) {
+  if (!__atomic_load_n(&android_app->inputOverflowPending, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+
   pthread_mutex_lock(&android_app->mutex);
+  // The main thread doesn't add to the ring while the list isn't empty, so
+  // the ring only holds events older than those of the list
+  read_input_queue(android_app, inputBuffer);
+  struct android_input_overflow* overflow = android_app->inputOverflow;
+  android_app->inputOverflow = NULL;
+  android_app->inputOverflowLast = NULL;
+  __atomic_store_n(&android_app->inputOverflowPending, false,
+                   __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&android_app->mutex);
 
+  for (struct android_input_overflow* o = overflow; o != NULL; o = o->next) {
+    const struct input_queue_record* record =
+        (const struct input_queue_record*)o->record;
+    if (record->type == INPUT_QUEUE_KEY_EVENT) {
+      read_key_event(inputBuffer, (const struct queued_key_event*)record);
+    } else {
+      const struct queued_motion_event* queued =
+          (const struct queued_motion_event*)record;
+      GameActivityMotionEvent* event =
+          add_motion_event(inputBuffer, queued, queued->historySize);
+      if (queued->historySize > 0) {
+        append_motion_history(event, queued, 0, false);
+      }
+    }
+  }
+  free_input_overflow(overflow);
+}
+
+struct android_input_buffer* android_app_swap_input_buffers(
+    struct android_app* android_app) {
   struct android_input_buffer* inputBuffer =
       &android_app->inputBuffers[android_app->currentInputBuffer];
 
+  read_input_queue(android_app, inputBuffer);
+  read_input_overflow(android_app, inputBuffer);
+
   if (inputBuffer->motionEventsCount == 0 && inputBuffer->keyEventsCount == 0) {
-    inputBuffer = NULL;
-  } else {
-    android_app->currentInputBuffer = (android_app->currentInputBuffer + 1) %
-                                      NATIVE_APP_GLUE_MAX_INPUT_BUFFERS;
+    return NULL;
   }
-
-  pthread_mutex_unlock(&android_app->mutex);
-
+  android_app->currentInputBuffer = (android_app->currentInputBuffer + 1) %
+                                    NATIVE_APP_GLUE_MAX_INPUT_BUFFERS;
   return inputBuffer;
 }
 
 void android_app_clear_motion_events(struct android_input_buffer* inputBuffer) {
   // We do not need to lock here if the inputBuffer has already been swapped
-  // as is handled by the game loop thread
-  while (inputBuffer->motionEventsCount > 0) {
-    GameActivityMotionEvent_destroy(
-        &inputBuffer->motionEvents[inputBuffer->motionEventsCount - 1]);
-
-    inputBuffer->motionEventsCount--;
-  }
-  assert(inputBuffer->motionEventsCount == 0);
+  // as is handled by the game loop thread. The history of the events is in
+  // inputBuffer->motionHistory, which is kept for the next events.
+  inputBuffer->motionEventsCount = 0;
+  inputBuffer->motionHistorySize = 0;
 }
 
 void android_app_set_key_event_filter(struct android_app* app,
                                       android_key_event_filter filter) {
-  pthread_mutex_lock(&app->mutex);
-  app->keyEventFilter = filter;
-  pthread_mutex_unlock(&app->mutex);
+  __atomic_store_n(&app->keyEventFilter, filter, __ATOMIC_RELEASE);
 }
 
 static bool onKey(GameActivity* activity, const GameActivityKeyEvent* event) {
   struct android_app* android_app = ToApp(activity);
-  pthread_mutex_lock(&android_app->mutex);
 
-  if (android_app->keyEventFilter != NULL &&
-      !android_app->keyEventFilter(event)) {
-    pthread_mutex_unlock(&android_app->mutex);
+  android_key_event_filter filter =
+      __atomic_load_n(&android_app->keyEventFilter, __ATOMIC_ACQUIRE);
+  if (filter != NULL && !filter(event)) {
     return false;
   }
 
-  struct android_input_buffer* inputBuffer =
-      &android_app->inputBuffers[android_app->currentInputBuffer];
-
-  // Add to the list of active key down events
-  if (inputBuffer->keyEventsCount >= inputBuffer->keyEventsBufferSize) {
-    inputBuffer->keyEventsBufferSize = inputBuffer->keyEventsBufferSize * 2;
-    inputBuffer->keyEvents = (GameActivityKeyEvent*)realloc(
-        inputBuffer->keyEvents,
-        sizeof(GameActivityKeyEvent) * inputBuffer->keyEventsBufferSize);
-
-    if (inputBuffer->keyEvents == NULL) {
-      LOGE("onKey: out of memory");
-      abort();
-    }
+  uint64_t newTail;
+  struct queued_key_event* queued =
+      (struct queued_key_event*)input_queue_reserve(
+          android_app, sizeof(struct queued_key_event), &newTail);
+  queued->header.type = INPUT_QUEUE_KEY_EVENT;
+  memcpy(&queued->event, event, sizeof(GameActivityKeyEvent));
+  input_queue_publish(android_app, &queued->header, newTail);
+
+  if (!__atomic_exchange_n(&android_app->keyEventCmdPending, 1,
+                           __ATOMIC_SEQ_CST)) {
+    android_app_write_cmd(android_app, APP_CMD_KEY_EVENT);
   }
-
-  int new_ix = inputBuffer->keyEventsCount;
-  memcpy(&inputBuffer->keyEvents[new_ix], event, sizeof(GameActivityKeyEvent));
-  ++inputBuffer->keyEventsCount;
-
-  android_app_write_cmd(android_app, APP_CMD_KEY_EVENT);
-  pthread_mutex_unlock(&android_app->mutex);
   return true;
 }
 
@@ -617,9 +1112,9 @@ static void onContentRectChanged(GameActivity* activity, const ARect* rect) {
 
   pthread_mutex_lock(&android_app->mutex);
   android_app->contentRect = *rect;
+  pthread_mutex_unlock(&android_app->mutex);
 
   android_app_write_cmd(android_app, APP_CMD_CONTENT_RECT_CHANGED);
-  pthread_mutex_unlock(&android_app->mutex);
 }
 
 static void onSoftwareKeyboardVisibilityChanged(GameActivity* activity,
@@ -630,9 +1125,9 @@ static void onSoftwareKeyboardVisibilityChanged(GameActivity* activity,
 
   pthread_mutex_lock(&android_app->mutex);
   android_app->softwareKeyboardVisible = visible;
+  pthread_mutex_unlock(&android_app->mutex);
 
   android_app_write_cmd(android_app, APP_CMD_SOFTWARE_KB_VIS_CHANGED);
-  pthread_mutex_unlock(&android_app->mutex);
 }
 
 static bool onEditorAction(GameActivity* activity, int action) {
@@ -642,9 +1137,9 @@ static bool onEditorAction(GameActivity* activity, int action) {
 
   pthread_mutex_lock(&android_app->mutex);
   android_app->editorAction = action;
+  pthread_mutex_unlock(&android_app->mutex);
 
   android_app_write_cmd(android_app, APP_CMD_EDITOR_ACTION);
-  pthread_mutex_unlock(&android_app->mutex);
   return true;
 }
 
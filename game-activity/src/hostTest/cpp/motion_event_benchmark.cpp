@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// motion_event_benchmark times GameActivityMotionEvent_fromDirectBuffer, which
+// decodes the motion events packed by the Java GameActivity, against
+// GameActivityMotionEvent_fromJava, which reads each value of the event with
+// a JNI call. The JNIEnv here only counts these calls, so the host times
+// leave out their cost on a device, reported as JNI calls per event.
+//
+//   motion_event_benchmark [--events N]
+
+#include <android/log.h>
+#include <game-activity/GameActivityEvents.h>
+#include <jni.h>
+#include <sys/system_properties.h>
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "GameActivityEvents_internal.h"
+
+namespace {
+
+// A JNIEnv whose method calls return 0 and are counted. Direct buffers are
+// their own address.
+class HostEnv {
+ public:
+  HostEnv() : functions_() {
+    functions_.FindClass = findClass;
+    functions_.GetMethodID = getMethodId;
+    functions_.CallIntMethodV = callIntMethodV;
+    functions_.CallLongMethodV = callLongMethodV;
+    functions_.CallFloatMethodV = callFloatMethodV;
+    functions_.NewDirectByteBuffer = newDirectByteBuffer;
+    functions_.GetDirectBufferAddress = getDirectBufferAddress;
+    env_.functions = &functions_;
+  }
+
+  HostEnv(const HostEnv &) = delete;
+  HostEnv &operator=(const HostEnv &) = delete;
+
+  JNIEnv *get() { return &env_; }
+
+  static int64_t callCount() { return callCount_; }
+
+ private:
+  static jclass findClass(JNIEnv *, const char *) {
+    return reinterpret_cast<jclass>(&callCount_);
+  }
+  static jmethodID getMethodId(JNIEnv *, jclass, const char *,
+                               const char *) {
+    return reinterpret_cast<jmethodID>(&callCount_);
+  }
+  static jint callIntMethodV(JNIEnv *, jobject, jmethodID, va_list) {
+    ++callCount_;
+    return 0;
+  }
+  static jlong callLongMethodV(JNIEnv *, jobject, jmethodID, va_list) {
+    ++callCount_;
+    return 0;
+  }
+  static jfloat callFloatMethodV(JNIEnv *, jobject, jmethodID, va_list) {
+    ++callCount_;
+    return 0.0f;
+  }
+  static jobject newDirectByteBuffer(JNIEnv *, void *address, jlong) {
+    return static_cast<jobject>(address);
+  }
+  static void *getDirectBufferAddress(JNIEnv *, jobject buffer) {
+    return buffer;
+  }
+
+  JNIEnv env_;
+  JNINativeInterface functions_;
+  static int64_t callCount_;
+};
+
+int64_t HostEnv::callCount_ = 0;
+
+struct EventShape {
+  const char *name;
+  int pointerCount;
+  int historySize;
+  std::vector<int32_t> axes;
+};
+
+template <typename T>
+void append(std::vector<uint8_t> &packed, const T value) {
+  const size_t offset = packed.size();
+  packed.resize(offset + sizeof(T));
+  memcpy(&packed[offset], &value, sizeof(T));
+}
+
+// Packs an event of the given shape the way GameActivity.packMotionEvent does
+std::vector<uint8_t> packMotionEvent(const EventShape &shape) {
+  uint64_t axesMask = 0;
+  for (const int32_t axis : shape.axes) {
+    axesMask |= 1ull << axis;
+  }
+  std::vector<uint8_t> packed;
+  append(packed, axesMask);
+  append(packed, static_cast<int32_t>(shape.pointerCount));
+  append(packed, static_cast<int32_t>(shape.historySize));
+  for (int i = 0; i < shape.pointerCount; ++i) {
+    append(packed, static_cast<int32_t>(i));
+    append(packed, static_cast<int32_t>(AMOTION_EVENT_TOOL_TYPE_FINGER));
+    append(packed, 100.0f * i);
+    append(packed, 200.0f * i);
+    for (size_t axis = 0; axis < shape.axes.size(); ++axis) {
+      append(packed, static_cast<float>(i + axis));
+    }
+  }
+  for (int history = 0; history < shape.historySize; ++history) {
+    append(packed, static_cast<int64_t>(history));
+    for (int i = 0; i < shape.pointerCount; ++i) {
+      for (size_t axis = 0; axis < shape.axes.size(); ++axis) {
+        append(packed, static_cast<float>(history + i + axis));
+      }
+    }
+  }
+  return packed;
+}
+
+double elapsedSeconds(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void benchmarkShape(HostEnv &env, const EventShape &shape,
+                    const int32_t eventCount) {
+  for (int32_t axis = 0; axis < GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+       ++axis) {
+    GameActivityPointerAxes_disableAxis(axis);
+  }
+  for (const int32_t axis : shape.axes) {
+    GameActivityPointerAxes_enableAxis(axis);
+  }
+  std::vector<uint8_t> packed = packMotionEvent(shape);
+  const jobject packedEvent = env.get()->NewDirectByteBuffer(
+      packed.data(), static_cast<jlong>(packed.size()));
+  GameActivityMotionEvent event;
+  memset(&event, 0, sizeof(event));
+
+  auto start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i < eventCount; ++i) {
+    if (!GameActivityMotionEvent_fromDirectBuffer(
+            env.get(), packedEvent, static_cast<int>(packed.size()),
+            &event)) {
+      fprintf(stderr, "%s: invalid packed event\n", shape.name);
+      return;
+    }
+  }
+  const double directSeconds = elapsedSeconds(start);
+
+  const int64_t callsBefore = HostEnv::callCount();
+  start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i < eventCount; ++i) {
+    GameActivityMotionEvent_fromJava(env.get(), nullptr, &event,
+                                     shape.pointerCount, shape.historySize);
+    GameActivityMotionEvent_destroy(&event);
+  }
+  const double javaSeconds = elapsedSeconds(start);
+  const double callsPerEvent =
+      static_cast<double>(HostEnv::callCount() - callsBefore) / eventCount;
+
+  printf("%-28s %12.2f %12.2f %12.1f\n", shape.name,
+         eventCount / directSeconds / 1.0e6, eventCount / javaSeconds / 1.0e6,
+         callsPerEvent);
+}
+
+}  // anonymous namespace
+
+// liblog and the system properties, read for the SDK version
+extern "C" {
+
+int __android_log_print(int priority, const char *tag, const char *format,
+                        ...) {
+  if (priority < ANDROID_LOG_WARN) {
+    return 0;
+  }
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "%s: ", tag);
+  const int result = vfprintf(stderr, format, args);
+  fputc('\n', stderr);
+  va_end(args);
+  return result;
+}
+
+const prop_info *__system_property_find(const char *) {
+  static int property;
+  return reinterpret_cast<const prop_info *>(&property);
+}
+
+void __system_property_read_callback(
+    const prop_info *,
+    void (*callback)(void *cookie, const char *name, const char *value,
+                     uint32_t serial),
+    void *cookie) {
+  callback(cookie, "ro.build.version.sdk", "33", 0);
+}
+
+}  // extern "C"
+
+int main(int argc, char **argv) {
+  int32_t eventCount = 200000;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+      eventCount = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--events N]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (eventCount <= 0) {
+    fprintf(stderr, "--events must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  HostEnv env;
+  GameActivityEventsInit(env.get());
+  const std::vector<int32_t> touchAxes = {
+      AMOTION_EVENT_AXIS_X, AMOTION_EVENT_AXIS_Y, AMOTION_EVENT_AXIS_PRESSURE,
+      AMOTION_EVENT_AXIS_SIZE};
+  const std::vector<int32_t> gamepadAxes = {
+      AMOTION_EVENT_AXIS_X,        AMOTION_EVENT_AXIS_Y,
+      AMOTION_EVENT_AXIS_Z,        AMOTION_EVENT_AXIS_RZ,
+      AMOTION_EVENT_AXIS_HAT_X,    AMOTION_EVENT_AXIS_HAT_Y,
+      AMOTION_EVENT_AXIS_LTRIGGER, AMOTION_EVENT_AXIS_RTRIGGER};
+  const EventShape shapes[] = {
+      {"touch, 1 pointer", 1, 0, {AMOTION_EVENT_AXIS_X, AMOTION_EVENT_AXIS_Y}},
+      {"touch, 1 pointer, 4 history", 1, 4, touchAxes},
+      {"touch, 5 pointers, 4 history", 5, 4, touchAxes},
+      {"gamepad, 2 history", 1, 2, gamepadAxes},
+  };
+
+  printf("%-28s %12s %12s %12s\n", "event", "buffer M/s", "JNI M/s",
+         "JNI calls");
+  for (const EventShape &shape : shapes) {
+    benchmarkShape(env, shape, eventCount);
+  }
+  return EXIT_SUCCESS;
+}
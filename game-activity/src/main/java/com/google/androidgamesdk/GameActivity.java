@@ -49,13 +49,16 @@ import androidx.core.view.WindowInsetsCompat;
 import androidx.core.view.WindowInsetsControllerCompat;
 import com.google.androidgamesdk.gametextinput.GameTextInput;
 import com.google.androidgamesdk.gametextinput.InputConnection;
-import com.google.androidgamesdk.gametextinput.Listener;
 import com.google.androidgamesdk.gametextinput.Settings;
 import com.google.androidgamesdk.gametextinput.State;
+import com.google.androidgamesdk.gametextinput.StateDiffListener;
 import dalvik.system.BaseDexClassLoader;
 import java.io.File;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 
-public class GameActivity extends AppCompatActivity implements SurfaceHolder.Callback2, Listener,
+public class GameActivity extends AppCompatActivity implements SurfaceHolder.Callback2,
+                                                               StateDiffListener,
                                                                OnApplyWindowInsetsListener,
                                                                OnGlobalLayoutListener {
   private static final String LOG_TAG = "GameActivity";
@@ -85,14 +88,93 @@ public class GameActivity extends AppCompatActivity implements SurfaceHolder.Cal
    */
   protected InputEnabledSurfaceView mSurfaceView;
 
+  /**
+   * The pointers and history of a motion event are packed in this buffer for
+   * onTouchEventNative, so that the native code reads them without JNI calls for each axis.
+   * It grows to fit the largest event and is then reused.
+   */
+  private ByteBuffer mMotionEventBuffer;
+
+  /**
+   * Mask of the axes enabled by the native code, bit i being set when axis i is enabled.
+   * It is updated by the native code, only these axes are packed.
+   */
+  private ByteBuffer mEnabledPointerAxes;
+
+  private static final int MIN_MOTION_EVENT_BUFFER_SIZE = 1024;
+
+  // Sizes of the parts of a packed motion event, without the axis values
+  private static final int PACKED_HEADER_SIZE = 16;
+  private static final int PACKED_POINTER_SIZE = 16;
+  private static final int PACKED_HISTORY_SIZE = 8;
+
+  /**
+   * Packs the pointers and history of the event in mMotionEventBuffer, in native byte order, as
+   * read by GameActivityMotionEvent_fromDirectBuffer:
+   * - the mask of packed axes, the pointer count and the history size,
+   * - for each pointer, its id, tool type, raw X and raw Y, followed by the value of each packed
+   *   axis,
+   * - for each history entry, its event time in milliseconds, followed by the value of each
+   *   packed axis for each pointer.
+   *
+   * @return the size of the packed event in bytes.
+   */
+  private int packMotionEvent(MotionEvent event) {
+    final long axes = mEnabledPointerAxes.getLong(0);
+    final int axesSize = 4 * Long.bitCount(axes);
+    final int pointerCount = event.getPointerCount();
+    final int historySize = event.getHistorySize();
+    final int size = PACKED_HEADER_SIZE + pointerCount * (PACKED_POINTER_SIZE + axesSize)
+        + historySize * (PACKED_HISTORY_SIZE + pointerCount * axesSize);
+
+    if (mMotionEventBuffer == null || mMotionEventBuffer.capacity() < size) {
+      int capacity = (mMotionEventBuffer == null) ? MIN_MOTION_EVENT_BUFFER_SIZE
+                                                  : mMotionEventBuffer.capacity();
+      while (capacity < size) {
+        capacity *= 2;
+      }
+      mMotionEventBuffer = ByteBuffer.allocateDirect(capacity).order(ByteOrder.nativeOrder());
+    }
+
+    ByteBuffer buffer = mMotionEventBuffer;
+    buffer.clear();
+    buffer.putLong(axes).putInt(pointerCount).putInt(historySize);
+
+    final boolean hasRawCoordinates = Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q;
+    for (int i = 0; i < pointerCount; ++i) {
+      buffer.putInt(event.getPointerId(i)).putInt(event.getToolType(i));
+      buffer.putFloat(hasRawCoordinates ? event.getRawX(i) : 0);
+      buffer.putFloat(hasRawCoordinates ? event.getRawY(i) : 0);
+      for (long bits = axes; bits != 0; bits &= bits - 1) {
+        buffer.putFloat(event.getAxisValue(Long.numberOfTrailingZeros(bits), i));
+      }
+    }
+
+    for (int historyIndex = 0; historyIndex < historySize; ++historyIndex) {
+      buffer.putLong(event.getHistoricalEventTime(historyIndex));
+      for (int i = 0; i < pointerCount; ++i) {
+        for (long bits = axes; bits != 0; bits &= bits - 1) {
+          buffer.putFloat(
+              event.getHistoricalAxisValue(Long.numberOfTrailingZeros(bits), i, historyIndex));
+        }
+      }
+    }
+    return size;
+  }
+
   protected boolean processMotionEvent(MotionEvent event) {
+    if (mNativeHandle == 0) {
+      return false;
+    }
+
     int action = (Build.VERSION.SDK_INT >= Build.VERSION_CODES.M) ? event.getActionButton() : 0;
     int cls = (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) ? event.getClassification() : 0;
+    int packedSize = packMotionEvent(event);
 
-    return onTouchEventNative(mNativeHandle, event, event.getPointerCount(), event.getHistorySize(),
-        event.getDeviceId(), event.getSource(), event.getAction(), event.getEventTime(),
-        event.getDownTime(), event.getFlags(), event.getMetaState(), action, event.getButtonState(),
-        cls, event.getEdgeFlags(), event.getXPrecision(), event.getYPrecision());
+    return onTouchEventNative(mNativeHandle, mMotionEventBuffer, packedSize, event.getDeviceId(),
+        event.getSource(), event.getAction(), event.getEventTime(), event.getDownTime(),
+        event.getFlags(), event.getMetaState(), action, event.getButtonState(), cls,
+        event.getEdgeFlags(), event.getXPrecision(), event.getYPrecision());
   }
 
   @Override
@@ -137,6 +219,15 @@ public class GameActivity extends AppCompatActivity implements SurfaceHolder.Cal
     onTextInputEventNative(mNativeHandle, newState);
   }
 
+  // Called instead of stateChanged when the IME has changed the input, once
+  // enabled with GameActivity_setTextInputStateDiffsEnabled
+  @Override
+  public void stateDiffChanged(int start, int end, String text, int selectionStart,
+      int selectionEnd, int composingRegionStart, int composingRegionEnd) {
+    onTextInputDiffNative(mNativeHandle, start, end, text, selectionStart, selectionEnd,
+        composingRegionStart, composingRegionEnd);
+  }
+
   @Override
   public void onGlobalLayout() {
     mSurfaceView.getLocationInWindow(mLocation);
@@ -212,10 +303,12 @@ public class GameActivity extends AppCompatActivity implements SurfaceHolder.Cal
 
   protected native void onSurfaceDestroyedNative(long handle);
 
-  protected native boolean onTouchEventNative(long handle, MotionEvent motionEvent,
-      int pointerCount, int historySize, int deviceId, int source, int action, long eventTime,
-      long downTime, int flags, int metaState, int actionButton, int buttonState,
-      int classification, int edgeFlags, float precisionX, float precisionY);
+  protected native ByteBuffer getEnabledPointerAxesNative();
+
+  protected native boolean onTouchEventNative(long handle, ByteBuffer packedEvent, int packedSize,
+      int deviceId, int source, int action, long eventTime, long downTime, int flags,
+      int metaState, int actionButton, int buttonState, int classification, int edgeFlags,
+      float precisionX, float precisionY);
 
   protected native boolean onKeyDownNative(long handle, KeyEvent keyEvent);
 
@@ -223,6 +316,9 @@ public class GameActivity extends AppCompatActivity implements SurfaceHolder.Cal
 
   protected native void onTextInputEventNative(long handle, State softKeyboardEvent);
 
+  protected native void onTextInputDiffNative(long handle, int start, int end, String text,
+      int selectionStart, int selectionEnd, int composingRegionStart, int composingRegionEnd);
+
   protected native void setInputConnectionNative(long handle, InputConnection c);
 
   protected native void onWindowInsetsChangedNative(long handle);
@@ -359,6 +455,8 @@ public class GameActivity extends AppCompatActivity implements SurfaceHolder.Cal
           "Unable to initialize native code \"" + path + "\": " + getDlError());
     }
 
+    mEnabledPointerAxes = getEnabledPointerAxesNative().order(ByteOrder.nativeOrder());
+
     // Set up the input connection
     if (mSurfaceView != null) {
       setInputConnectionNative(mNativeHandle, mSurfaceView.mInputConnection);
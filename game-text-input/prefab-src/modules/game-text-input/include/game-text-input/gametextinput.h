@@ -131,6 +131,38 @@ void GameTextInput_setInputConnection(GameTextInput *input,
  */
 void GameTextInput_processEvent(GameTextInput *input, jobject eventState);
 
+/**
+ * Exchange only the changed part of the text with the Java InputConnection,
+ * instead of the whole text, when the IME or GameTextInput_setState modify it.
+ * Editing long texts then costs the same per keystroke as editing short ones.
+ * While the text is longer than max_string_size, whole states are exchanged.
+ * The Java gametextinput.Listener must implement
+ * gametextinput.StateDiffListener to receive the changes, other listeners
+ * still receive whole states. When using GameActivity, call
+ * GameActivity_setTextInputStateDiffsEnabled instead.
+ * @param input A valid GameTextInput library handle.
+ * @param enabled Whether the changes are exchanged instead of whole states.
+ * This is disabled by default.
+ */
+void GameTextInput_setStateDiffsEnabled(GameTextInput *input, bool enabled);
+
+/**
+ * Unless using GameActivity, it is required to call this function from your
+ * Java gametextinput.StateDiffListener.stateDiffChanged method to update the
+ * text and trigger any event callbacks. See
+ * GameTextInput_setStateDiffsEnabled.
+ * @param input A valid GameTextInput library handle.
+ * @param start The start of the replaced text, in UTF-16 code units.
+ * @param end The end of the replaced text, in UTF-16 code units.
+ * @param text A Java String replacing the text from start to end.
+ * @param selection The new selection.
+ * @param composingRegion The new composing region.
+ */
+void GameTextInput_processStateDiff(GameTextInput *input, int32_t start,
+                                    int32_t end, jstring text,
+                                    const GameTextInputSpan *selection,
+                                    const GameTextInputSpan *composingRegion);
+
 /**
  * Free any resources owned by the GameTextInput library.
  * Any subsequent calls to the library will fail until GameTextInput_init is
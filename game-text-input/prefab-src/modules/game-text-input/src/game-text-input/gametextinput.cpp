@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #define LOG_TAG "GameTextInput"
@@ -49,7 +50,11 @@ struct GameTextInput {
     return currentState_;
   }
   void setInputConnection(jobject inputConnection);
+  void setStateDiffsEnabled(bool enabled);
   void processEvent(jobject textInputEvent);
+  void processStateDiff(int32_t start, int32_t end, jstring text,
+                        const GameTextInputSpan &selection,
+                        const GameTextInputSpan &composingRegion);
   void showIme(uint32_t flags);
   void hideIme(uint32_t flags);
   void restartInput();
@@ -66,6 +71,11 @@ struct GameTextInput {
  private:
   // Copy string and set other fields
   void setStateInner(const GameTextInputState &state);
+  // Send the part of state that differs from currentState_ to the
+  // InputConnection, returns false if it could not apply it.
+  bool sendStateDiff(const GameTextInputState &state);
+  // Byte offset in currentState_ of an offset in UTF-16 code units.
+  int32_t byteOffset(int32_t utf16Offset);
   static void processCallback(void *context, const GameTextInputState *state);
   JNIEnv *env_ = nullptr;
   // Cached at initialization from
@@ -79,6 +89,9 @@ struct GameTextInput {
   jclass inputConnectionClass_ = nullptr;
   jobject inputConnection_ = nullptr;
   jmethodID inputConnectionSetStateMethod_;
+  jmethodID inputConnectionSetStateDiffMethod_;
+  jmethodID inputConnectionGetStateMethod_;
+  jmethodID setStateDiffsEnabledMethod_;
   jmethodID setSoftKeyboardActiveMethod_;
   jmethodID restartInputMethod_;
   void (*eventCallback_)(void *context,
@@ -90,6 +103,18 @@ struct GameTextInput {
   StateClassInfo stateClassInfo_ = {};
   // Constant-sized buffer used to store state text.
   std::vector<char> stateStringBuffer_;
+  // Whether only the changed parts of the state are exchanged with Java.
+  bool stateDiffsEnabled_ = false;
+  // A position in stateStringBuffer_, in bytes and UTF-16 code units, from
+  // which offsets are looked up. It is moved to the end of each change, so
+  // that finding where the next keystroke goes doesn't scan the whole text.
+  int32_t anchorByteOffset_ = 0;
+  int32_t anchorUtf16Offset_ = 0;
+  // Whether the text was longer than stateStringBuffer_ and its end dropped.
+  // The changes can't be applied to it then, the whole state is copied.
+  bool truncated_ = false;
+  // Inserted text sent to Java, kept to reuse its storage.
+  std::string diffText_;
 };
 
 std::unique_ptr<GameTextInput> s_gameTextInput;
@@ -156,10 +181,21 @@ void GameTextInput_setInputConnection(GameTextInput *input,
   input->setInputConnection(inputConnection);
 }
 
+void GameTextInput_setStateDiffsEnabled(GameTextInput *input, bool enabled) {
+  input->setStateDiffsEnabled(enabled);
+}
+
 void GameTextInput_processEvent(GameTextInput *input, jobject textInputEvent) {
   input->processEvent(textInputEvent);
 }
 
+void GameTextInput_processStateDiff(GameTextInput *input, int32_t start,
+                                    int32_t end, jstring text,
+                                    const GameTextInputSpan *selection,
+                                    const GameTextInputSpan *composingRegion) {
+  input->processStateDiff(start, end, text, *selection, *composingRegion);
+}
+
 void GameTextInput_processImeInsets(GameTextInput *input, const ARect *insets) {
   input->processImeInsets(insets);
 }
@@ -209,6 +245,13 @@ GameTextInput::GameTextInput(JNIEnv *env, uint32_t max_string_size)
   inputConnectionSetStateMethod_ =
       env_->GetMethodID(inputConnectionClass_, "setState",
                         "(Lcom/google/androidgamesdk/gametextinput/State;)V");
+  inputConnectionSetStateDiffMethod_ = env_->GetMethodID(
+      inputConnectionClass_, "setStateDiff", "(IILjava/lang/String;IIII)Z");
+  inputConnectionGetStateMethod_ =
+      env_->GetMethodID(inputConnectionClass_, "getState",
+                        "()Lcom/google/androidgamesdk/gametextinput/State;");
+  setStateDiffsEnabledMethod_ = env_->GetMethodID(
+      inputConnectionClass_, "setStateDiffsEnabled", "(Z)V");
   setSoftKeyboardActiveMethod_ = env_->GetMethodID(
       inputConnectionClass_, "setSoftKeyboardActive", "(ZI)V");
   restartInputMethod_ =
@@ -243,6 +286,10 @@ GameTextInput::~GameTextInput() {
 
 void GameTextInput::setState(const GameTextInputState &state) {
   if (inputConnection_ == nullptr) return;
+  if (stateDiffsEnabled_ && sendStateDiff(state)) {
+    setStateInner(state);
+    return;
+  }
   jobject jstate = stateToJava(state);
   env_->CallVoidMethod(inputConnection_, inputConnectionSetStateMethod_,
                        jstate);
@@ -266,10 +313,103 @@ void GameTextInput::setStateInner(const GameTextInputState &state) {
   currentState_.text_UTF8 = stateStringBuffer_.data();
   std::copy(state.text_UTF8, state.text_UTF8 + bytes_needed - 1,
             stateStringBuffer_.data());
-  currentState_.text_length = state.text_length;
+  currentState_.text_length = bytes_needed - 1;
   currentState_.selection = state.selection;
   currentState_.composingRegion = state.composingRegion;
   stateStringBuffer_[bytes_needed - 1] = 0;
+  anchorByteOffset_ = 0;
+  anchorUtf16Offset_ = 0;
+  truncated_ = currentState_.text_length < state.text_length;
+}
+
+// Number of UTF-16 code units of the character starting with this byte. Java
+// passes supplementary characters either as 4 UTF-8 bytes or, in modified
+// UTF-8, as two 3 byte surrogates.
+static int32_t utf16Length(char leadByte) {
+  return static_cast<uint8_t>(leadByte) >= 0xF0 ? 2 : 1;
+}
+
+static bool isContinuationByte(char byte) {
+  return (static_cast<uint8_t>(byte) & 0xC0) == 0x80;
+}
+
+static int32_t utf16Length(const char *text, int32_t length) {
+  int32_t units = 0;
+  for (int32_t i = 0; i < length; ++i) {
+    if (!isContinuationByte(text[i])) units += utf16Length(text[i]);
+  }
+  return units;
+}
+
+int32_t GameTextInput::byteOffset(int32_t utf16Offset) {
+  const char *text = stateStringBuffer_.data();
+  const int32_t length = currentState_.text_length;
+  int32_t byte = anchorByteOffset_;
+  int32_t units = anchorUtf16Offset_;
+  if (utf16Offset < units / 2) {
+    byte = 0;
+    units = 0;
+  }
+  while (units > utf16Offset && byte > 0) {
+    do {
+      --byte;
+    } while (byte > 0 && isContinuationByte(text[byte]));
+    units -= utf16Length(text[byte]);
+  }
+  while (units < utf16Offset && byte < length) {
+    units += utf16Length(text[byte]);
+    do {
+      ++byte;
+    } while (byte < length && isContinuationByte(text[byte]));
+  }
+  return byte;
+}
+
+bool GameTextInput::sendStateDiff(const GameTextInputState &state) {
+  std::unique_lock<std::mutex> lock(currentStateMutex_);
+  // Java has the end of the text that was dropped
+  if (truncated_) return false;
+  const char *oldText = currentState_.text_UTF8;
+  const char *newText = state.text_UTF8;
+  int32_t oldLength = oldText == nullptr ? 0 : currentState_.text_length;
+  int32_t newLength = newText == nullptr ? 0 : state.text_length;
+
+  // Only the span between the common prefix and suffix is sent, cut on
+  // character boundaries.
+  int32_t prefix = 0;
+  const int32_t maxCommon = std::min(oldLength, newLength);
+  while (prefix < maxCommon && oldText[prefix] == newText[prefix]) ++prefix;
+  while (prefix > 0 && prefix < maxCommon &&
+         isContinuationByte(newText[prefix])) {
+    --prefix;
+  }
+  int32_t suffix = 0;
+  while (suffix < maxCommon - prefix &&
+         oldText[oldLength - suffix - 1] == newText[newLength - suffix - 1]) {
+    ++suffix;
+  }
+  while (suffix > 0 && isContinuationByte(newText[newLength - suffix])) {
+    --suffix;
+  }
+
+  const int32_t start = utf16Length(oldText, prefix);
+  const int32_t end =
+      start + utf16Length(oldText + prefix, oldLength - suffix - prefix);
+  if (newText == nullptr) {
+    diffText_.clear();
+  } else {
+    diffText_.assign(newText + prefix, newText + newLength - suffix);
+  }
+  lock.unlock();
+
+  // Note that this expects 'modified' UTF-8, like stateToJava
+  jstring jtext = env_->NewStringUTF(diffText_.c_str());
+  bool applied = env_->CallBooleanMethod(
+      inputConnection_, inputConnectionSetStateDiffMethod_, start, end, jtext,
+      state.selection.start, state.selection.end, state.composingRegion.start,
+      state.composingRegion.end);
+  env_->DeleteLocalRef(jtext);
+  return applied;
 }
 
 void GameTextInput::setInputConnection(jobject inputConnection) {
@@ -277,6 +417,14 @@ void GameTextInput::setInputConnection(jobject inputConnection) {
     env_->DeleteGlobalRef(inputConnection_);
   }
   inputConnection_ = env_->NewGlobalRef(inputConnection);
+  if (stateDiffsEnabled_) setStateDiffsEnabled(true);
+}
+
+void GameTextInput::setStateDiffsEnabled(bool enabled) {
+  stateDiffsEnabled_ = enabled;
+  if (inputConnection_ == nullptr) return;
+  env_->CallVoidMethod(inputConnection_, setStateDiffsEnabledMethod_,
+                       static_cast<jboolean>(enabled));
 }
 
 /*static*/ void GameTextInput::processCallback(
@@ -293,6 +441,78 @@ void GameTextInput::processEvent(jobject textInputEvent) {
   }
 }
 
+void GameTextInput::processStateDiff(int32_t start, int32_t end, jstring text,
+                                     const GameTextInputSpan &selection,
+                                     const GameTextInputSpan &composingRegion) {
+  {
+    std::unique_lock<std::mutex> lock(currentStateMutex_);
+    if (truncated_ && inputConnection_ != nullptr) {
+      // The change may be in the text that was dropped
+      lock.unlock();
+      jobject state = env_->CallObjectMethod(inputConnection_,
+                                             inputConnectionGetStateMethod_);
+      processEvent(state);
+      env_->DeleteLocalRef(state);
+      return;
+    }
+    if (currentState_.text_UTF8 == nullptr) {
+      // The state was never set, start from an empty text
+      currentState_.text_UTF8 = stateStringBuffer_.data();
+      currentState_.text_length = 0;
+      stateStringBuffer_[0] = 0;
+      anchorByteOffset_ = 0;
+      anchorUtf16Offset_ = 0;
+    }
+    char *buffer = stateStringBuffer_.data();
+    const int32_t capacity =
+        static_cast<int32_t>(stateStringBuffer_.size()) - 1;
+    const int32_t length = currentState_.text_length;
+    const int32_t startByte = byteOffset(std::max(start, 0));
+    const int32_t endByte = std::max(startByte, byteOffset(end));
+
+    // Note that this is 'modified' UTF-8, like in stateFromJava
+    const char *text_chars =
+        text == nullptr ? nullptr : env_->GetStringUTFChars(text, NULL);
+    const int32_t text_len =
+        text == nullptr ? 0 : env_->GetStringUTFLength(text);
+    const int32_t text_units =
+        text == nullptr ? 0 : env_->GetStringLength(text);
+
+    // Move the text after the change, then copy the change, truncating the
+    // text to the buffer size like setStateInner.
+    const int32_t tailStart = std::min(startByte + text_len, capacity);
+    const int32_t tailLength =
+        std::min(length - endByte, capacity - tailStart);
+    memmove(buffer + tailStart, buffer + endByte, tailLength);
+    if (text_chars != nullptr) {
+      memcpy(buffer + startByte, text_chars, tailStart - startByte);
+      env_->ReleaseStringUTFChars(text, text_chars);
+    }
+    currentState_.text_length = tailStart + tailLength;
+    buffer[currentState_.text_length] = 0;
+    currentState_.selection = selection;
+    currentState_.composingRegion = composingRegion;
+
+    if (tailStart == startByte + text_len) {
+      anchorByteOffset_ = tailStart;
+      anchorUtf16Offset_ = std::max(start, 0) + text_units;
+    } else {
+      anchorByteOffset_ = 0;
+      anchorUtf16Offset_ = 0;
+    }
+    truncated_ =
+        currentState_.text_length < startByte + text_len + length - endByte;
+    if (truncated_) {
+      __android_log_print(ANDROID_LOG_WARN, LOG_TAG,
+                          "Text input truncated to %d bytes", capacity);
+    }
+  }
+  if (eventCallback_) {
+    std::lock_guard<std::mutex> lock(currentStateMutex_);
+    eventCallback_(eventCallbackContext_, &currentState_);
+  }
+}
+
 void GameTextInput::showIme(uint32_t flags) {
   if (inputConnection_ == nullptr) return;
   env_->CallVoidMethod(inputConnection_, setSoftKeyboardActiveMethod_, true,
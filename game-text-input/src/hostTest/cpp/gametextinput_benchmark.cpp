@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// gametextinput_benchmark times keystrokes at the end of texts of several
+// lengths, typed by the IME or set by the app with GameTextInput_setState,
+// when state diffs are exchanged with the Java InputConnection and when whole
+// states are copied. HostJni converts the Strings between UTF-16 and modified
+// UTF-8 like the JVM, the other costs of the JNI calls on a device are left
+// out. The results are checked by gametextinput_host_tests.
+//
+//   gametextinput_benchmark [--keystrokes N]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "game-text-input/gametextinput.h"
+#include "gametextinput_host.h"
+
+using gametextinput_host::HostJni;
+using gametextinput_host::SupplementaryEncoding;
+
+namespace {
+
+constexpr SupplementaryEncoding ENCODING = SupplementaryEncoding::FOUR_BYTES;
+
+double elapsedSeconds(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// Mostly ASCII, with 2 and 3 byte characters and surrogate pairs
+std::u16string makeText(const int32_t length) {
+  const std::u16string words[] = {u"text ", u"input ", u"é ", u"中文 ",
+                                  u"\U0001F600 "};
+  std::u16string text;
+  for (size_t i = 0; text.size() < static_cast<size_t>(length); ++i) {
+    text += words[i % std::size(words)];
+  }
+  text.resize(length);
+  return text;
+}
+
+GameTextInput *initInput(HostJni &hostJni, const bool stateDiffs) {
+  GameTextInput *input = GameTextInput_init(hostJni.getEnv(), 0);
+  GameTextInput_setInputConnection(input, hostJni.getInputConnection());
+  GameTextInput_setStateDiffsEnabled(input, stateDiffs);
+  return input;
+}
+
+// Keystrokes typed by the IME, alternately a character and a backspace
+double imeKeystrokesPerSecond(const std::u16string &text,
+                              const bool stateDiffs,
+                              const int32_t keystrokes) {
+  HostJni hostJni(ENCODING);
+  GameTextInput *input = initInput(hostJni, stateDiffs);
+  const int32_t length = static_cast<int32_t>(text.size());
+  hostJni.imeEdit(input, 0, 0, text, {length, length}, {-1, -1});
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i < keystrokes; ++i) {
+    if (i % 2 == 0) {
+      hostJni.imeEdit(input, length, length, u"a", {length + 1, length + 1},
+                      {length, length + 1});
+    } else {
+      hostJni.imeEdit(input, length, length + 1, u"", {length, length},
+                      {-1, -1});
+    }
+  }
+  const double seconds = elapsedSeconds(start);
+  GameTextInput_destroy(input);
+  return keystrokes / seconds;
+}
+
+// Keystrokes set by the app, alternately a character and a backspace
+double appKeystrokesPerSecond(const std::u16string &text,
+                              const bool stateDiffs,
+                              const int32_t keystrokes) {
+  HostJni hostJni(ENCODING);
+  GameTextInput *input = initInput(hostJni, stateDiffs);
+  const int32_t length = static_cast<int32_t>(text.size());
+  const std::string texts[] = {
+      gametextinput_host::toModifiedUtf8(text + u"a", ENCODING),
+      gametextinput_host::toModifiedUtf8(text, ENCODING)};
+  const GameTextInputState states[] = {
+      {texts[0].c_str(),
+       static_cast<int32_t>(texts[0].size()),
+       {length + 1, length + 1},
+       {-1, -1}},
+      {texts[1].c_str(),
+       static_cast<int32_t>(texts[1].size()),
+       {length, length},
+       {-1, -1}}};
+  GameTextInput_setState(input, &states[1]);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int32_t i = 0; i < keystrokes; ++i) {
+    GameTextInput_setState(input, &states[i % 2]);
+  }
+  const double seconds = elapsedSeconds(start);
+  GameTextInput_destroy(input);
+  return keystrokes / seconds;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char **argv) {
+  int32_t keystrokes = 5000;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--keystrokes") == 0 && i + 1 < argc) {
+      keystrokes = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--keystrokes N]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (keystrokes <= 0) {
+    fprintf(stderr, "--keystrokes must be positive\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("%-14s %14s %14s %14s %14s\n", "UTF-16 length", "IME diff k/s",
+         "IME copy k/s", "app diff k/s", "app copy k/s");
+  for (const int32_t length : {100, 1000, 10000, 30000}) {
+    const std::u16string text = makeText(length);
+    printf("%-14d %14.1f %14.1f %14.1f %14.1f\n", length,
+           imeKeystrokesPerSecond(text, true, keystrokes) / 1.0e3,
+           imeKeystrokesPerSecond(text, false, keystrokes) / 1.0e3,
+           appKeystrokesPerSecond(text, true, keystrokes) / 1.0e3,
+           appKeystrokesPerSecond(text, false, keystrokes) / 1.0e3);
+  }
+  return EXIT_SUCCESS;
+}
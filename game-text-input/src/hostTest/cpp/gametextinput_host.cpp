@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gametextinput_host.h"
+
+#include <android/log.h>
+
+#include <cstdio>
+
+namespace gametextinput_host {
+
+namespace {
+
+int64_t sWarningCount = 0;
+
+bool isHighSurrogate(const uint32_t unit) {
+  return unit >= 0xD800 && unit < 0xDC00;
+}
+
+bool isLowSurrogate(const uint32_t unit) {
+  return unit >= 0xDC00 && unit < 0xE000;
+}
+
+}  // namespace
+
+std::string toModifiedUtf8(const std::u16string &text,
+                           const SupplementaryEncoding encoding) {
+  std::string utf8;
+  utf8.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    uint32_t c = text[i];
+    if (encoding == SupplementaryEncoding::FOUR_BYTES && isHighSurrogate(c) &&
+        i + 1 < text.size() && isLowSurrogate(text[i + 1])) {
+      c = 0x10000 + ((c - 0xD800) << 10) + (text[++i] - 0xDC00);
+      utf8 += static_cast<char>(0xF0 | (c >> 18));
+      utf8 += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c != 0 && c < 0x80) {
+      utf8 += static_cast<char>(c);
+    } else if (c < 0x800) {
+      utf8 += static_cast<char>(0xC0 | (c >> 6));
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+      utf8 += static_cast<char>(0xE0 | (c >> 12));
+      utf8 += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      utf8 += static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+  return utf8;
+}
+
+std::u16string fromModifiedUtf8(const char *text) {
+  std::u16string utf16;
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(text);
+  while (*bytes != 0) {
+    uint32_t c = *bytes;
+    int32_t length = 1;
+    if (c >= 0xF0) {
+      c &= 0x07;
+      length = 4;
+    } else if (c >= 0xE0) {
+      c &= 0x0F;
+      length = 3;
+    } else if (c >= 0xC0) {
+      c &= 0x1F;
+      length = 2;
+    }
+    for (int32_t i = 1; i < length && bytes[i] != 0; ++i) {
+      c = (c << 6) | (bytes[i] & 0x3F);
+    }
+    for (int32_t i = 0; i < length && *bytes != 0; ++i) ++bytes;
+    if (c >= 0x10000) {
+      c -= 0x10000;
+      utf16 += static_cast<char16_t>(0xD800 + (c >> 10));
+      utf16 += static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+    } else {
+      utf16 += static_cast<char16_t>(c);
+    }
+  }
+  return utf16;
+}
+
+int64_t warningCount() { return sWarningCount; }
+
+struct HostJni::HostObject {
+  virtual ~HostObject() = default;
+};
+
+// A java.lang.String, its modified UTF-8 is encoded when first asked for
+struct HostJni::HostString : HostObject {
+  std::u16string text;
+  std::string modifiedUtf8;
+  bool encoded = false;
+};
+
+struct HostJni::HostState : HostObject {
+  std::u16string text;
+  GameTextInputSpan selection;
+  GameTextInputSpan composingRegion;
+};
+
+HostJni::HostJni(const SupplementaryEncoding encoding)
+    : mFunctions(), mEncoding(encoding) {
+  mFunctions.FindClass = findClass;
+  mFunctions.NewGlobalRef = newGlobalRef;
+  mFunctions.DeleteGlobalRef = deleteGlobalRef;
+  mFunctions.DeleteLocalRef = deleteLocalRef;
+  mFunctions.NewObjectV = newObjectV;
+  mFunctions.GetMethodID = getMethodId;
+  mFunctions.GetFieldID = getFieldId;
+  mFunctions.CallObjectMethodV = callObjectMethodV;
+  mFunctions.CallBooleanMethodV = callBooleanMethodV;
+  mFunctions.CallVoidMethodV = callVoidMethodV;
+  mFunctions.GetObjectField = getObjectField;
+  mFunctions.GetIntField = getIntField;
+  mFunctions.NewStringUTF = newStringUtf;
+  mFunctions.GetStringLength = getStringLength;
+  mFunctions.GetStringUTFLength = getStringUtfLength;
+  mFunctions.GetStringUTFChars = getStringUtfChars;
+  mFunctions.ReleaseStringUTFChars = releaseStringUtfChars;
+  mEnv.functions = &mFunctions;
+}
+
+HostJni::~HostJni() {
+  for (HostObject *object : mLocalRefs) {
+    delete object;
+  }
+}
+
+void HostJni::imeEdit(GameTextInput *input, const int32_t start,
+                      const int32_t end, const std::u16string &text,
+                      const GameTextInputSpan &selection,
+                      const GameTextInputSpan &composingRegion) {
+  mText.replace(start, end - start, text);
+  mSelection = selection;
+  mComposingRegion = composingRegion;
+  mImeChangePending = false;
+  if (mStateDiffsEnabled) {
+    jstring jtext = newString(text);
+    GameTextInput_processStateDiff(input, start, end, jtext, &selection,
+                                   &composingRegion);
+    deleteLocalRef(&mEnv, jtext);
+  } else {
+    jobject state = newState(mText, selection, composingRegion);
+    GameTextInput_processEvent(input, state);
+    deleteLocalRef(&mEnv, state);
+  }
+}
+
+jobject HostJni::newLocalRef(HostObject *object) {
+  mLocalRefs.insert(object);
+  return reinterpret_cast<jobject>(object);
+}
+
+jstring HostJni::newString(const std::u16string &text) {
+  HostString *string = new HostString();
+  string->text = text;
+  return static_cast<jstring>(newLocalRef(string));
+}
+
+jobject HostJni::newState(const std::u16string &text,
+                          const GameTextInputSpan &selection,
+                          const GameTextInputSpan &composingRegion) {
+  HostState *state = new HostState();
+  state->text = text;
+  state->selection = selection;
+  state->composingRegion = composingRegion;
+  return newLocalRef(state);
+}
+
+bool HostJni::replace(const int32_t start, const int32_t end,
+                      const std::u16string &text) {
+  if (mImeChangePending || start < 0 || start > end ||
+      end > static_cast<int32_t>(mText.size())) {
+    return false;
+  }
+  mText.replace(start, end - start, text);
+  return true;
+}
+
+const std::string &HostJni::modifiedUtf8(jstring string) {
+  HostString *hostString =
+      static_cast<HostString *>(reinterpret_cast<HostObject *>(string));
+  if (!hostString->encoded) {
+    hostString->modifiedUtf8 = toModifiedUtf8(hostString->text, mEncoding);
+    hostString->encoded = true;
+  }
+  return hostString->modifiedUtf8;
+}
+
+jclass HostJni::findClass(JNIEnv *env, const char *name) {
+  HostJni *hostJni = fromEnv(env);
+  const std::string className = name;
+  if (className == "com/google/androidgamesdk/gametextinput/State") {
+    return reinterpret_cast<jclass>(&hostJni->mStateClass);
+  }
+  return reinterpret_cast<jclass>(&hostJni->mInputConnectionClass);
+}
+
+jobject HostJni::newGlobalRef(JNIEnv *, jobject object) { return object; }
+
+void HostJni::deleteGlobalRef(JNIEnv *, jobject) {}
+
+void HostJni::deleteLocalRef(JNIEnv *env, jobject object) {
+  HostJni *hostJni = fromEnv(env);
+  HostObject *hostObject = reinterpret_cast<HostObject *>(object);
+  if (hostJni->mLocalRefs.erase(hostObject) != 0) {
+    delete hostObject;
+  }
+}
+
+// The State constructor
+jobject HostJni::newObjectV(JNIEnv *env, jclass, jmethodID, va_list args) {
+  HostJni *hostJni = fromEnv(env);
+  const jstring text = va_arg(args, jstring);
+  GameTextInputSpan selection;
+  GameTextInputSpan composingRegion;
+  selection.start = va_arg(args, jint);
+  selection.end = va_arg(args, jint);
+  composingRegion.start = va_arg(args, jint);
+  composingRegion.end = va_arg(args, jint);
+  const HostString *string =
+      static_cast<const HostString *>(reinterpret_cast<HostObject *>(text));
+  return hostJni->newState(string->text, selection, composingRegion);
+}
+
+jmethodID HostJni::getMethodId(JNIEnv *env, jclass, const char *name,
+                               const char *) {
+  std::string &methodName = fromEnv(env)->mMethodNames[name];
+  methodName = name;
+  return reinterpret_cast<jmethodID>(&methodName);
+}
+
+jfieldID HostJni::getFieldId(JNIEnv *env, jclass, const char *name,
+                             const char *) {
+  std::string &fieldName = fromEnv(env)->mFieldNames[name];
+  fieldName = name;
+  return reinterpret_cast<jfieldID>(&fieldName);
+}
+
+// InputConnection.getState
+jobject HostJni::callObjectMethodV(JNIEnv *env, jobject, jmethodID, va_list) {
+  HostJni *hostJni = fromEnv(env);
+  ++hostJni->mGetStateCount;
+  return hostJni->newState(hostJni->mText, hostJni->mSelection,
+                           hostJni->mComposingRegion);
+}
+
+// InputConnection.setStateDiff
+jboolean HostJni::callBooleanMethodV(JNIEnv *env, jobject, jmethodID,
+                                     va_list args) {
+  HostJni *hostJni = fromEnv(env);
+  ++hostJni->mSetStateDiffCount;
+  const jint start = va_arg(args, jint);
+  const jint end = va_arg(args, jint);
+  const jstring text = va_arg(args, jstring);
+  GameTextInputSpan selection;
+  GameTextInputSpan composingRegion;
+  selection.start = va_arg(args, jint);
+  selection.end = va_arg(args, jint);
+  composingRegion.start = va_arg(args, jint);
+  composingRegion.end = va_arg(args, jint);
+  const HostString *string =
+      static_cast<const HostString *>(reinterpret_cast<HostObject *>(text));
+  if (!hostJni->replace(start, end, string->text)) {
+    return JNI_FALSE;
+  }
+  hostJni->mSelection = selection;
+  hostJni->mComposingRegion = composingRegion.start != composingRegion.end
+                                  ? composingRegion
+                                  : GameTextInputSpan{-1, -1};
+  return JNI_TRUE;
+}
+
+void HostJni::callVoidMethodV(JNIEnv *env, jobject, jmethodID methodId,
+                              va_list args) {
+  HostJni *hostJni = fromEnv(env);
+  const std::string &name = methodName(methodId);
+  if (name == "setState") {
+    ++hostJni->mSetStateCount;
+    const HostState *state = static_cast<const HostState *>(
+        reinterpret_cast<HostObject *>(va_arg(args, jobject)));
+    hostJni->mText = state->text;
+    hostJni->mSelection = state->selection;
+    hostJni->mComposingRegion =
+        state->composingRegion.start != state->composingRegion.end
+            ? state->composingRegion
+            : GameTextInputSpan{-1, -1};
+    hostJni->mImeChangePending = false;
+  } else if (name == "setStateDiffsEnabled") {
+    hostJni->mStateDiffsEnabled = va_arg(args, int) != 0;
+  }
+  // setSoftKeyboardActive and restartInput have no effect
+}
+
+jobject HostJni::getObjectField(JNIEnv *env, jobject object, jfieldID) {
+  const HostState *state =
+      static_cast<const HostState *>(reinterpret_cast<HostObject *>(object));
+  return fromEnv(env)->newString(state->text);
+}
+
+jint HostJni::getIntField(JNIEnv *, jobject object, jfieldID fieldId) {
+  const HostState *state =
+      static_cast<const HostState *>(reinterpret_cast<HostObject *>(object));
+  const std::string &name = fieldName(fieldId);
+  if (name == "selectionStart") {
+    return state->selection.start;
+  } else if (name == "selectionEnd") {
+    return state->selection.end;
+  } else if (name == "composingRegionStart") {
+    return state->composingRegion.start;
+  }
+  return state->composingRegion.end;
+}
+
+jstring HostJni::newStringUtf(JNIEnv *env, const char *chars) {
+  return fromEnv(env)->newString(fromModifiedUtf8(chars));
+}
+
+jsize HostJni::getStringLength(JNIEnv *, jstring string) {
+  const HostString *hostString =
+      static_cast<const HostString *>(reinterpret_cast<HostObject *>(string));
+  return static_cast<jsize>(hostString->text.size());
+}
+
+jsize HostJni::getStringUtfLength(JNIEnv *env, jstring string) {
+  return static_cast<jsize>(fromEnv(env)->modifiedUtf8(string).size());
+}
+
+const char *HostJni::getStringUtfChars(JNIEnv *env, jstring string,
+                                       jboolean *isCopy) {
+  if (isCopy != nullptr) *isCopy = JNI_FALSE;
+  return fromEnv(env)->modifiedUtf8(string).c_str();
+}
+
+void HostJni::releaseStringUtfChars(JNIEnv *, jstring, const char *) {}
+
+}  // namespace gametextinput_host
+
+extern "C" {
+
+int __android_log_print(int priority, const char *tag, const char *format,
+                        ...) {
+  if (priority == ANDROID_LOG_WARN) {
+    ++gametextinput_host::sWarningCount;
+  }
+  if (priority < ANDROID_LOG_ERROR) {
+    return 0;
+  }
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "%s: ", tag);
+  const int result = vfprintf(stderr, format, args);
+  fputc('\n', stderr);
+  va_end(args);
+  return result;
+}
+
+}  // extern "C"
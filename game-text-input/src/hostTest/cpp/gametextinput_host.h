@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <jni.h>
+
+#include <cstdarg>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+#include "game-text-input/gametextinput.h"
+
+// Host stand-ins for the parts of Android that GameTextInput calls, so that it
+// can run off the device: the log, and a JNIEnv playing the Java
+// gametextinput.InputConnection, its State objects and Strings.
+
+namespace gametextinput_host {
+
+// How GetStringUTFChars encodes supplementary characters: as 4 UTF-8 bytes,
+// like ART, or as two 3 byte surrogates, like the JNI specification.
+enum class SupplementaryEncoding { FOUR_BYTES, SURROGATE_PAIRS };
+
+// The modified UTF-8 of a Java String, where U+0000 is 2 bytes
+std::string toModifiedUtf8(const std::u16string &text,
+                           SupplementaryEncoding encoding);
+
+// The Java String of a modified UTF-8 text, in either encoding
+std::u16string fromModifiedUtf8(const char *text);
+
+// Warnings logged by GameTextInput, they are not printed
+int64_t warningCount();
+
+// A JNIEnv whose methods stand in for the Java side of GameTextInput. The
+// InputConnection keeps its text in UTF-16 and tells GameTextInput of the
+// edits made by the IME, with imeEdit, like InputConnection.stateUpdated. The
+// environment must be the first member, JNI calls find the HostJni from their
+// JNIEnv.
+class HostJni {
+ public:
+  explicit HostJni(SupplementaryEncoding encoding);
+  ~HostJni();
+
+  HostJni(const HostJni &) = delete;
+  HostJni &operator=(const HostJni &) = delete;
+
+  JNIEnv *getEnv() { return &mEnv; }
+
+  // The gametextinput.InputConnection passed to
+  // GameTextInput_setInputConnection
+  jobject getInputConnection() {
+    return reinterpret_cast<jobject>(&mInputConnection);
+  }
+
+  // Replaces the text from start to end, in UTF-16 code units, then sends the
+  // change to input, or the whole state when state diffs aren't enabled
+  void imeEdit(GameTextInput *input, int32_t start, int32_t end,
+               const std::u16string &text, const GameTextInputSpan &selection,
+               const GameTextInputSpan &composingRegion);
+
+  // Makes the next InputConnection.setStateDiff fail, as if the IME changed
+  // the text since the last imeEdit
+  void setImeChangePending() { mImeChangePending = true; }
+
+  const std::u16string &getText() const { return mText; }
+  const GameTextInputSpan &getSelection() const { return mSelection; }
+  const GameTextInputSpan &getComposingRegion() const {
+    return mComposingRegion;
+  }
+  bool getStateDiffsEnabled() const { return mStateDiffsEnabled; }
+
+  // Calls of the InputConnection methods
+  int64_t getSetStateCount() const { return mSetStateCount; }
+  int64_t getSetStateDiffCount() const { return mSetStateDiffCount; }
+  int64_t getGetStateCount() const { return mGetStateCount; }
+
+  // Local references not deleted yet
+  size_t getLocalRefCount() const { return mLocalRefs.size(); }
+
+ private:
+  struct HostObject;
+  struct HostString;
+  struct HostState;
+
+  static HostJni *fromEnv(JNIEnv *env) {
+    return reinterpret_cast<HostJni *>(env);
+  }
+
+  jobject newLocalRef(HostObject *object);
+  jstring newString(const std::u16string &text);
+  jobject newState(const std::u16string &text,
+                   const GameTextInputSpan &selection,
+                   const GameTextInputSpan &composingRegion);
+  // Replaces the text, returns false if it can't apply, like setStateDiff
+  bool replace(int32_t start, int32_t end, const std::u16string &text);
+
+  static jclass findClass(JNIEnv *env, const char *name);
+  static jobject newGlobalRef(JNIEnv *env, jobject object);
+  static void deleteGlobalRef(JNIEnv *env, jobject object);
+  static void deleteLocalRef(JNIEnv *env, jobject object);
+  static jobject newObjectV(JNIEnv *env, jclass clazz, jmethodID methodId,
+                            va_list args);
+  static jmethodID getMethodId(JNIEnv *env, jclass clazz, const char *name,
+                               const char *signature);
+  static jfieldID getFieldId(JNIEnv *env, jclass clazz, const char *name,
+                             const char *signature);
+  static jobject callObjectMethodV(JNIEnv *env, jobject object,
+                                   jmethodID methodId, va_list args);
+  static jboolean callBooleanMethodV(JNIEnv *env, jobject object,
+                                     jmethodID methodId, va_list args);
+  static void callVoidMethodV(JNIEnv *env, jobject object, jmethodID methodId,
+                              va_list args);
+  static jobject getObjectField(JNIEnv *env, jobject object,
+                                jfieldID fieldId);
+  static jint getIntField(JNIEnv *env, jobject object, jfieldID fieldId);
+  static jstring newStringUtf(JNIEnv *env, const char *chars);
+  static jsize getStringLength(JNIEnv *env, jstring string);
+  static jsize getStringUtfLength(JNIEnv *env, jstring string);
+  static const char *getStringUtfChars(JNIEnv *env, jstring string,
+                                       jboolean *isCopy);
+  static void releaseStringUtfChars(JNIEnv *env, jstring string,
+                                    const char *chars);
+
+  // The names a jmethodID or jfieldID was looked up with
+  static const std::string &methodName(jmethodID methodId) {
+    return *reinterpret_cast<const std::string *>(methodId);
+  }
+  static const std::string &fieldName(jfieldID fieldId) {
+    return *reinterpret_cast<const std::string *>(fieldId);
+  }
+
+  const std::string &modifiedUtf8(jstring string);
+
+  JNIEnv mEnv;
+  JNINativeInterface mFunctions;
+  SupplementaryEncoding mEncoding;
+  // Names by name, their addresses are the jmethodID and jfieldID values
+  std::map<std::string, std::string> mMethodNames;
+  std::map<std::string, std::string> mFieldNames;
+  // Objects have no state, only distinct addresses
+  int mStateClass = 0;
+  int mInputConnectionClass = 0;
+  int mInputConnection = 0;
+  std::set<HostObject *> mLocalRefs;
+
+  // The InputConnection state
+  std::u16string mText;
+  GameTextInputSpan mSelection = {0, 0};
+  GameTextInputSpan mComposingRegion = {-1, -1};
+  bool mStateDiffsEnabled = false;
+  bool mImeChangePending = false;
+  int64_t mSetStateCount = 0;
+  int64_t mSetStateDiffCount = 0;
+  int64_t mGetStateCount = 0;
+};
+
+}  // namespace gametextinput_host
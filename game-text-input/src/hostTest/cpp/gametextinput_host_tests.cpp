@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Randomized tests of the state diffs exchanged between GameTextInput and the
+// Java InputConnection, played by HostJni. After each edit, the native state
+// must be the one copying the whole Java state would give.
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+
+#include "game-text-input/gametextinput.h"
+#include "gametextinput_host.h"
+
+using gametextinput_host::HostJni;
+using gametextinput_host::SupplementaryEncoding;
+using gametextinput_host::toModifiedUtf8;
+
+namespace {
+
+constexpr int32_t EDIT_COUNT = 200000;
+
+// ASCII, 2 and 3 byte characters, U+0000 which is 2 bytes in modified UTF-8,
+// and supplementary characters, which are surrogate pairs in Java
+const std::u16string CHARACTERS[] = {
+    u"a", u"Z", u" ", u"é", u"中", std::u16string(1, u'\0'),
+    u"\U0001F600", u"\U0001F3AE"};
+
+struct NativeState {
+  std::string text;
+  GameTextInputSpan selection;
+  GameTextInputSpan composingRegion;
+};
+
+void copyState(void *context, const GameTextInputState *state) {
+  NativeState *nativeState = static_cast<NativeState *>(context);
+  nativeState->text.assign(state->text_UTF8, state->text_length);
+  nativeState->selection = state->selection;
+  nativeState->composingRegion = state->composingRegion;
+}
+
+bool operator==(const GameTextInputSpan &a, const GameTextInputSpan &b) {
+  return a.start == b.start && a.end == b.end;
+}
+
+// Moves an offset in text before a low surrogate, so edits keep pairs whole
+// like the IME does
+int32_t characterBoundary(const std::u16string &text, int32_t offset) {
+  if (offset > 0 && offset < static_cast<int32_t>(text.size()) &&
+      text[offset] >= 0xDC00 && text[offset] < 0xE000 &&
+      text[offset - 1] >= 0xD800 && text[offset - 1] < 0xDC00) {
+    --offset;
+  }
+  return offset;
+}
+
+// The text from start to end replaced, and the cursor after the edit
+struct Edit {
+  int32_t start;
+  int32_t end;
+  std::u16string text;
+  int32_t cursor;
+};
+
+// Mostly keystrokes at the cursor, whose offsets are found from the anchor of
+// the previous change, then backspaces, cursor moves sent as empty changes
+// and replacements anywhere in the text. Texts longer than maxLength are
+// halved.
+Edit randomEdit(std::mt19937 &random, const std::u16string &text,
+                const int32_t cursor, const int32_t maxLength) {
+  const int32_t length = static_cast<int32_t>(text.size());
+  const auto randomCharacters = [&random](const uint32_t maxCount) {
+    std::u16string characters;
+    for (uint32_t count = random() % (maxCount + 1); count > 0; --count) {
+      characters += CHARACTERS[random() % std::size(CHARACTERS)];
+    }
+    return characters;
+  };
+  Edit edit;
+  const uint32_t kind = random() % 100;
+  if (length > maxLength) {
+    edit.start = characterBoundary(text, random() % (length / 2));
+    edit.end = characterBoundary(text, edit.start + length / 2);
+  } else if (kind < 50 || (kind < 65 && cursor == 0)) {
+    edit.start = cursor;
+    edit.end = cursor;
+    edit.text = CHARACTERS[random() % std::size(CHARACTERS)];
+  } else if (kind < 65) {
+    edit.start = characterBoundary(text, cursor - 1);
+    edit.end = cursor;
+  } else if (kind < 75) {
+    edit.start = 0;
+    edit.end = 0;
+    edit.cursor = characterBoundary(text, random() % (length + 1));
+    return edit;
+  } else {
+    edit.start = characterBoundary(text, random() % (length + 1));
+    edit.end = characterBoundary(
+        text, std::min<int32_t>(length, edit.start + random() % 5));
+    edit.text = randomCharacters(3);
+  }
+  edit.cursor = edit.start + static_cast<int32_t>(edit.text.size());
+  return edit;
+}
+
+class GameTextInputStateDiffs
+    : public ::testing::TestWithParam<SupplementaryEncoding> {
+ protected:
+  void init(const uint32_t maxStringSize) {
+    mInput = GameTextInput_init(mHostJni.getEnv(), maxStringSize);
+    GameTextInput_setInputConnection(mInput, mHostJni.getInputConnection());
+    GameTextInput_setStateDiffsEnabled(mInput, true);
+  }
+
+  void TearDown() override { GameTextInput_destroy(mInput); }
+
+  // Makes EDIT_COUNT random edits, from the IME and from the app, and checks
+  // after each that the native text is the modified UTF-8 of the Java text,
+  // truncated to capacity bytes.
+  void checkRandomEdits(const int32_t maxLength, const size_t capacity) {
+    std::mt19937 random(1);
+    int32_t cursor = 0;
+    for (int32_t i = 0; i < EDIT_COUNT; ++i) {
+      const Edit edit = randomEdit(random, mHostJni.getText(), cursor,
+                                   maxLength);
+      cursor = edit.cursor;
+      const GameTextInputSpan selection = {cursor, cursor};
+      if (random() % 8 != 0) {
+        const GameTextInputSpan composingRegion =
+            !edit.text.empty() && random() % 2 == 0
+                ? GameTextInputSpan{edit.start, cursor}
+                : GameTextInputSpan{-1, -1};
+        mHostJni.imeEdit(mInput, edit.start, edit.end, edit.text, selection,
+                         composingRegion);
+      } else {
+        if (random() % 16 == 0) {
+          mHostJni.setImeChangePending();
+          ++mRejectedDiffCount;
+        }
+        std::u16string text = mHostJni.getText();
+        text.replace(edit.start, edit.end - edit.start, edit.text);
+        const std::string textUtf8 = toModifiedUtf8(text, GetParam());
+        const GameTextInputState state = {
+            textUtf8.c_str(), static_cast<int32_t>(textUtf8.size()),
+            selection, {-1, -1}};
+        GameTextInput_setState(mInput, &state);
+        ++mAppEditCount;
+        ASSERT_TRUE(mHostJni.getText() == text) << "edit " << i;
+      }
+
+      NativeState nativeState;
+      GameTextInput_getState(mInput, copyState, &nativeState);
+      ASSERT_EQ(nativeState.text,
+                toModifiedUtf8(mHostJni.getText(), GetParam())
+                    .substr(0, capacity))
+          << "edit " << i;
+      ASSERT_TRUE(nativeState.selection == mHostJni.getSelection())
+          << "edit " << i;
+      ASSERT_TRUE(nativeState.composingRegion ==
+                  mHostJni.getComposingRegion())
+          << "edit " << i;
+    }
+    EXPECT_EQ(mHostJni.getLocalRefCount(), 0u);
+  }
+
+  HostJni mHostJni{GetParam()};
+  GameTextInput *mInput = nullptr;
+  int64_t mAppEditCount = 0;
+  int64_t mRejectedDiffCount = 0;
+};
+
+// Test the changes applied by processStateDiff and sent by sendStateDiff,
+// at offsets found by byteOffset, on texts fitting the buffer
+TEST_P(GameTextInputStateDiffs, RandomEditsMatchWholeStates) {
+  init(0);
+  checkRandomEdits(2000, std::string::npos);
+  EXPECT_EQ(mHostJni.getSetStateDiffCount(), mAppEditCount);
+  // Only the diffs rejected by Java are sent again as whole states
+  EXPECT_EQ(mHostJni.getSetStateCount(), mRejectedDiffCount);
+  EXPECT_EQ(mHostJni.getGetStateCount(), 0);
+}
+
+// Test texts around the buffer size: the changes are applied until the text
+// is truncated, whole states are exchanged after that until it fits again
+TEST_P(GameTextInputStateDiffs, RandomEditsTruncatedAtCapacity) {
+  constexpr uint32_t MAX_STRING_SIZE = 64;
+  const int64_t warnings = gametextinput_host::warningCount();
+  init(MAX_STRING_SIZE);
+  checkRandomEdits(48, MAX_STRING_SIZE - 1);
+  EXPECT_GT(mHostJni.getGetStateCount(), 0);
+  EXPECT_GT(mHostJni.getSetStateCount(), mRejectedDiffCount);
+  EXPECT_GT(mHostJni.getSetStateDiffCount(), 0);
+  EXPECT_GT(gametextinput_host::warningCount(), warnings);
+}
+
+INSTANTIATE_TEST_SUITE_P(Encodings, GameTextInputStateDiffs,
+                         ::testing::Values(
+                             SupplementaryEncoding::FOUR_BYTES,
+                             SupplementaryEncoding::SURROGATE_PAIRS));
+
+}  // namespace
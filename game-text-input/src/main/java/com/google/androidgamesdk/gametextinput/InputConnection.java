@@ -27,6 +27,7 @@ import android.text.SpannableString;
 import android.text.SpannableStringBuilder;
 import android.text.Spanned;
 import android.text.TextUtils;
+import android.text.TextWatcher;
 import android.util.Log;
 import android.view.KeyEvent;
 import android.view.View;
@@ -53,6 +54,46 @@ public class InputConnection extends BaseInputConnection implements View.OnKeyLi
   private final Editable mEditable;
   private Listener listener;
   private boolean mSoftKeyboardActive;
+  private boolean mStateDiffsEnabled;
+
+  /*
+   * The part of mEditable changed since the listener was last notified: the text from
+   * mChangeStart to mChangeEnd replaced a text shorter by mChangeLengthDelta. mChangeStart is -1
+   * when nothing changed.
+   */
+  private int mChangeStart = -1;
+  private int mChangeEnd;
+  private int mChangeLengthDelta;
+
+  private final TextWatcher mChangeTracker = new TextWatcher() {
+    @Override
+    public void beforeTextChanged(CharSequence s, int start, int count, int after) {}
+
+    @Override
+    public void onTextChanged(CharSequence s, int start, int before, int count) {
+      int delta = count - before;
+      if (mChangeStart == -1) {
+        mChangeStart = start;
+        mChangeEnd = start + count;
+        mChangeLengthDelta = delta;
+        return;
+      }
+      // Move the end of the previous change to the new text, the text between the two changes
+      // is sent as changed as well.
+      int end = mChangeEnd;
+      if (end >= start + before) {
+        end += delta;
+      } else if (end > start) {
+        end = start + count;
+      }
+      mChangeStart = Math.min(mChangeStart, start);
+      mChangeEnd = Math.max(end, start + count);
+      mChangeLengthDelta += delta;
+    }
+
+    @Override
+    public void afterTextChanged(Editable s) {}
+  };
 
   /*
    * This class filters EOL characters from the input. For details of how InputFilter.filter
@@ -112,6 +153,7 @@ public class InputConnection extends BaseInputConnection implements View.OnKeyLi
       this.imm = (InputMethodManager) imm;
       this.mEditable = (Editable) (new SpannableStringBuilder());
     }
+    trackChanges();
     // Listen for insets changes
     WindowCompat.setDecorFitsSystemWindows(((Activity) targetView.getContext()).getWindow(), false);
     targetView.setOnKeyListener(this);
@@ -187,6 +229,18 @@ public class InputConnection extends BaseInputConnection implements View.OnKeyLi
     }
   }
 
+  /**
+   * Get the text, selection and composing region state.
+   *
+   * @return The state used by the IME.
+   */
+  public final State getState() {
+    Pair selection = this.getSelection();
+    Pair cr = this.getComposingRegion();
+    return new State(
+        this.mEditable.toString(), selection.first, selection.second, cr.first, cr.second);
+  }
+
   /**
    * Set the text, selection and composing region state.
    *
@@ -203,6 +257,7 @@ public class InputConnection extends BaseInputConnection implements View.OnKeyLi
     mEditable.clear();
     mEditable.clearSpans();
     mEditable.insert(0, (CharSequence) state.text);
+    trackChanges();
     setSelection(state.selectionStart, state.selectionEnd);
     if (state.composingRegionStart != state.composingRegionEnd) {
       setComposingRegion(state.composingRegionStart, state.composingRegionEnd);
@@ -210,6 +265,71 @@ public class InputConnection extends BaseInputConnection implements View.OnKeyLi
     restartInput();
   }
 
+  /**
+   * Set the text, selection and composing region state by replacing only a part of the text.
+   *
+   * @param start                The start of the replaced text, in UTF-16 code units.
+   * @param end                  The end of the replaced text, in UTF-16 code units.
+   * @param text                 The text replacing it.
+   * @param selectionStart       The start of the new selection.
+   * @param selectionEnd         The end of the new selection.
+   * @param composingRegionStart The start of the new composing region.
+   * @param composingRegionEnd   The end of the new composing region.
+   * @return false, without changing the state, if it was changed by the IME since the listener
+   *     was last notified, in which case the change can't apply and setState must be used.
+   */
+  public final boolean setStateDiff(int start, int end, String text, int selectionStart,
+      int selectionEnd, int composingRegionStart, int composingRegionEnd) {
+    Log.d(TAG,
+        "setStateDiff: (" + start + "," + end + ") -> '" + text + "', selection=("
+            + selectionStart + "," + selectionEnd + "), composing region=("
+            + composingRegionStart + "," + composingRegionEnd + ")");
+    int length = mEditable.length();
+    if (mChangeStart != -1 || start < 0 || start > end || end > length) {
+      return false;
+    }
+    mEditable.replace(start, end, text);
+    // Filters may have changed the inserted text: keep the difference to send it with the next
+    // change, so the text of the listener catches up.
+    int inserted = mEditable.length() - length + end - start;
+    if (inserted == text.length()
+        && TextUtils.regionMatches(mEditable, start, text, 0, inserted)) {
+      mChangeStart = -1;
+    } else {
+      mChangeStart = start;
+      mChangeEnd = start + inserted;
+      mChangeLengthDelta = inserted - text.length();
+    }
+    setSelection(selectionStart, selectionEnd);
+    if (composingRegionStart != composingRegionEnd) {
+      setComposingRegion(composingRegionStart, composingRegionEnd);
+    } else {
+      removeComposingSpans(mEditable);
+    }
+    restartInput();
+    return true;
+  }
+
+  /**
+   * Get whether the listener receives only the changed part of the text.
+   *
+   * @return true if a StateDiffListener receives changes instead of states
+   */
+  public final boolean getStateDiffsEnabled() {
+    return mStateDiffsEnabled;
+  }
+
+  /**
+   * Set whether the listener receives only the changed part of the text, when it is a
+   * StateDiffListener, instead of the whole state.
+   *
+   * @param enabled True to send the changes to StateDiffListener.stateDiffChanged
+   */
+  public final void setStateDiffsEnabled(boolean enabled) {
+    Log.d(TAG, "setStateDiffsEnabled: " + enabled);
+    mStateDiffsEnabled = enabled;
+  }
+
   /**
    * Get the current listener for state changes.
    *
@@ -530,11 +650,15 @@ public class InputConnection extends BaseInputConnection implements View.OnKeyLi
     return true;
   }
 
+  // Watch the changes of mEditable, after its spans were cleared.
+  private void trackChanges() {
+    mEditable.setSpan(mChangeTracker, 0, mEditable.length(), Spanned.SPAN_INCLUSIVE_INCLUSIVE);
+    mChangeStart = -1;
+  }
+
   private final void stateUpdated() {
     Pair selection = this.getSelection();
     Pair cr = this.getComposingRegion();
-    State state = new State(
-        this.mEditable.toString(), selection.first, selection.second, cr.first, cr.second);
     settings.mEditorInfo.initialSelStart = selection.first;
     settings.mEditorInfo.initialSelEnd = selection.second;
 
@@ -543,7 +667,25 @@ public class InputConnection extends BaseInputConnection implements View.OnKeyLi
 
     // We always propagate state change events because unfortunately keyboard visibility functions
     // are unreliable, and text editor logic should not depend on them.
+    if (mStateDiffsEnabled && listener instanceof StateDiffListener) {
+      int start = 0;
+      int end = 0;
+      String text = "";
+      if (mChangeStart != -1) {
+        start = mChangeStart;
+        end = mChangeEnd - mChangeLengthDelta;
+        text = mEditable.subSequence(mChangeStart, mChangeEnd).toString();
+        mChangeStart = -1;
+      }
+      ((StateDiffListener) listener)
+          .stateDiffChanged(start, end, text, selection.first, selection.second, cr.first,
+              cr.second);
+      return;
+    }
+    mChangeStart = -1;
     if (listener != null) {
+      State state = new State(
+          this.mEditable.toString(), selection.first, selection.second, cr.first, cr.second);
       listener.stateChanged(state, /*dismissed=*/false);
     }
   }
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.google.androidgamesdk.gametextinput;
+
+/**
+ * Listener receiving only the changed part of the text, instead of the whole
+ * state, when state diffs are enabled with InputConnection.setStateDiffsEnabled.
+ */
+public interface StateDiffListener extends Listener {
+  /*
+   * Called instead of stateChanged when the IME text, selection or composing
+   * region has changed. The text from start to end of the previous state,
+   * in UTF-16 code units, has been replaced by text.
+   *
+   * @param start The start of the replaced text
+   * @param end The end of the replaced text
+   * @param text The text replacing it, empty when text was only deleted
+   * @param selectionStart The start of the new selection
+   * @param selectionEnd The end of the new selection
+   * @param composingRegionStart The start of the new composing region
+   * @param composingRegionEnd The end of the new composing region
+   */
+  void stateDiffChanged(int start, int end, String text, int selectionStart,
+      int selectionEnd, int composingRegionStart, int composingRegionEnd);
+}
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Synthetic controllers and input shared by the Paddleboat unit tests and the
+// host benchmark, so that the benchmark measures the cases the tests check
+
+#pragma once
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "../../main/cpp/GameController.h"
+#include "../../main/cpp/GameControllerMappingUtils.h"
+#include "paddleboat.h"
+
+namespace paddleboat_test {
+
+using namespace paddleboat;
+
+// Axis transform
+// --=========================================================================
+inline uint8_t AxisButtonIndex(const uint32_t buttonMask) {
+    return static_cast<uint8_t>(__builtin_ctz(buttonMask));
+}
+
+// Maps every axis except L1 and R1, with byte ranged sticks that need
+// adjustments, inverted left stick Y and hat X axis, and buttons on the
+// trigger and hat axis.
+inline void SetupTransformTestController(GameController &gameController) {
+    const int32_t axisIds[GameController::GAMECONTROLLER_AXIS_COUNT] = {
+        AMOTION_EVENT_AXIS_X,        AMOTION_EVENT_AXIS_Y,
+        AMOTION_EVENT_AXIS_Z,        AMOTION_EVENT_AXIS_RZ,
+        PADDLEBOAT_AXIS_IGNORED,     AMOTION_EVENT_AXIS_LTRIGGER,
+        PADDLEBOAT_AXIS_IGNORED,     AMOTION_EVENT_AXIS_RTRIGGER,
+        AMOTION_EVENT_AXIS_HAT_X,    AMOTION_EVENT_AXIS_HAT_Y};
+    GameControllerDeviceInfo &deviceInfo = gameController.getDeviceInfo();
+    Paddleboat_Controller_Mapping_File_Controller_Entry controllerEntry;
+    Paddleboat_Controller_Mapping_File_Axis_Entry axisEntry;
+    Paddleboat_Controller_Mapping_File_Button_Entry buttonEntry;
+    memset(&controllerEntry, 0, sizeof(controllerEntry));
+    memset(&axisEntry, 0, sizeof(axisEntry));
+    memset(&buttonEntry, 0, sizeof(buttonEntry));
+    for (int32_t i = 0; i < static_cast<int32_t>(PADDLEBOAT_BUTTON_COUNT);
+         ++i) {
+        buttonEntry.buttonMapping[i] = PADDLEBOAT_BUTTON_IGNORED;
+    }
+    for (int32_t i = 0; i < GameController::GAMECONTROLLER_AXIS_COUNT; ++i) {
+        axisEntry.axisMapping[i] = static_cast<uint16_t>(axisIds[i]);
+        axisEntry.axisPositiveButtonMapping[i] = PADDLEBOAT_AXIS_BUTTON_IGNORED;
+        axisEntry.axisNegativeButtonMapping[i] = PADDLEBOAT_AXIS_BUTTON_IGNORED;
+        if (axisIds[i] == PADDLEBOAT_AXIS_IGNORED) {
+            continue;
+        }
+        const bool isStickAxis = (i < GameController::GAMECONTROLLER_AXIS_L1);
+        deviceInfo.getInfo()->mAxisBitsLow |= (1 << axisIds[i]);
+        deviceInfo.getMinArray()[axisIds[i]] = isStickAxis ? 0.0f : -1.0f;
+        deviceInfo.getMaxArray()[axisIds[i]] = isStickAxis ? 255.0f : 1.0f;
+    }
+    deviceInfo.getMinArray()[AMOTION_EVENT_AXIS_LTRIGGER] = 0.0f;
+    deviceInfo.getMinArray()[AMOTION_EVENT_AXIS_RTRIGGER] = 0.0f;
+    auto setAxisButtons = [&axisEntry](const int32_t axis,
+                                       const uint32_t positiveButton,
+                                       const uint32_t negativeButton) {
+        axisEntry.axisPositiveButtonMapping[axis] =
+            AxisButtonIndex(positiveButton);
+        if (negativeButton != 0) {
+            axisEntry.axisNegativeButtonMapping[axis] =
+                AxisButtonIndex(negativeButton);
+        }
+    };
+    setAxisButtons(GameController::GAMECONTROLLER_AXIS_L2,
+                   PADDLEBOAT_BUTTON_L2, 0);
+    setAxisButtons(GameController::GAMECONTROLLER_AXIS_R2,
+                   PADDLEBOAT_BUTTON_R2, 0);
+    setAxisButtons(GameController::GAMECONTROLLER_AXIS_HAT_X,
+                   PADDLEBOAT_BUTTON_DPAD_RIGHT, PADDLEBOAT_BUTTON_DPAD_LEFT);
+    setAxisButtons(GameController::GAMECONTROLLER_AXIS_HAT_Y,
+                   PADDLEBOAT_BUTTON_DPAD_DOWN, PADDLEBOAT_BUTTON_DPAD_UP);
+    axisEntry.axisInversionBitmask =
+        (1 << GameController::GAMECONTROLLER_AXIS_LSTICK_Y) |
+        (1 << GameController::GAMECONTROLLER_AXIS_HAT_X);
+    gameController.setupController(&controllerEntry, &axisEntry, &buttonEntry);
+}
+
+// The per axis transform GameController used before it precomputed its axis
+// lanes, kept as the reference for the expected results
+inline void ReferenceAxisTransform(
+    const GameController::GameControllerAxisInfo *axisInfo,
+    const float *axisValues, Paddleboat_Controller_Data &data) {
+    for (int32_t axis = 0; axis < GameController::GAMECONTROLLER_AXIS_COUNT;
+         ++axis) {
+        const GameController::GameControllerAxisInfo &info = axisInfo[axis];
+        if (info.axisIndex < 0 ||
+            info.axisIndex >=
+                PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
+            continue;
+        }
+        float axisValue = axisValues[info.axisIndex];
+        if ((info.axisFlags & GAMECONTROLLER_AXIS_FLAG_APPLY_ADJUSTMENTS) !=
+            0) {
+            axisValue = (axisValue * info.axisMultiplier) + info.axisAdjust;
+        }
+        if (info.axisInvert) {
+            axisValue = -axisValue;
+        }
+        if (axis < GameController::GAMECONTROLLER_AXIS_HAT_X) {
+            (&data.leftStick.stickX)[axis] = axisValue;
+        }
+        if (axisValue > -0.1f && axisValue < 0.1f) {
+            data.buttonsDown &=
+                ~(info.axisButtonMask | info.axisButtonNegativeMask);
+        } else if (axisValue > 0.1f) {
+            data.buttonsDown |= info.axisButtonMask;
+        } else if (axisValue < -0.1f) {
+            data.buttonsDown |= info.axisButtonNegativeMask;
+        }
+    }
+}
+
+// Fills the axis values of synthetic motion events, with hat and trigger
+// values landing on the button thresholds
+inline void FillSyntheticMotionEvents(const size_t eventCount,
+                                      std::vector<float> &axisValues) {
+    const float buttonValues[] = {-1.0f, -0.1f, -0.05f, 0.0f,
+                                  0.05f, 0.1f,  0.5f,   1.0f};
+    uint32_t random = 12345;
+    auto nextRandom = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return random >> 8;
+    };
+    axisValues.assign(
+        eventCount * PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT, 0.0f);
+    for (size_t i = 0; i < eventCount; ++i) {
+        float *values =
+            &axisValues[i * PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+        values[AMOTION_EVENT_AXIS_X] = static_cast<float>(nextRandom() % 256);
+        values[AMOTION_EVENT_AXIS_Y] = static_cast<float>(nextRandom() % 256);
+        values[AMOTION_EVENT_AXIS_Z] = static_cast<float>(nextRandom() % 256);
+        values[AMOTION_EVENT_AXIS_RZ] = static_cast<float>(nextRandom() % 256);
+        values[AMOTION_EVENT_AXIS_LTRIGGER] =
+            fabsf(buttonValues[nextRandom() % 8]);
+        values[AMOTION_EVENT_AXIS_RTRIGGER] =
+            fabsf(buttonValues[nextRandom() % 8]);
+        values[AMOTION_EVENT_AXIS_HAT_X] = buttonValues[nextRandom() % 8];
+        values[AMOTION_EVENT_AXIS_HAT_Y] = buttonValues[nextRandom() % 8];
+    }
+}
+
+
+// Large mapping files
+// --=========================================================================
+// Mapping tables sized for synthetic files much larger than the internal
+// GameControllerMappingInfo tables
+struct LargeMappingTables {
+    explicit LargeMappingTables(const uint32_t maxEntryCount)
+        : strings(maxEntryCount),
+          axis(maxEntryCount),
+          buttons(maxEntryCount),
+          controllers(maxEntryCount) {}
+
+    std::vector<Paddleboat_Controller_Mapping_File_String_Entry> strings;
+    std::vector<Paddleboat_Controller_Mapping_File_Axis_Entry> axis;
+    std::vector<Paddleboat_Controller_Mapping_File_Button_Entry> buttons;
+    std::vector<Paddleboat_Controller_Mapping_File_Controller_Entry>
+        controllers;
+    uint32_t stringCount = 0;
+    uint32_t axisCount = 0;
+    uint32_t buttonCount = 0;
+    uint32_t controllerCount = 0;
+};
+
+inline Paddleboat_Controller_Mapping_File_String_Entry MakeMappingString(
+    const char *prefix, const uint32_t id) {
+    Paddleboat_Controller_Mapping_File_String_Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    snprintf(entry.stringTableEntry, sizeof(entry.stringTableEntry), "%s_%u",
+             prefix, id);
+    return entry;
+}
+
+// Builds a mapping file for devices [firstDevice, firstDevice + deviceCount)
+// in shuffled order, each using one of the axis and button configurations
+// [firstConfig, firstConfig + configCount)
+inline void MakeLargeMappingFile(const uint32_t firstDevice,
+                                 const uint32_t deviceCount,
+                                 const uint32_t firstConfig,
+                                 const uint32_t configCount,
+                                 const int16_t minApi,
+                                 LargeMappingTables &file) {
+    for (uint32_t i = 0; i < configCount; ++i) {
+        file.strings[2 * i] = MakeMappingString("Axis", firstConfig + i);
+        file.strings[2 * i + 1] = MakeMappingString("Button", firstConfig + i);
+        memset(&file.axis[i], 0, sizeof(file.axis[i]));
+        file.axis[i].axisNameStringTableIndex = 2 * i;
+        memset(&file.buttons[i], 0, sizeof(file.buttons[i]));
+        file.buttons[i].buttonNameStringTableIndex = 2 * i + 1;
+    }
+    file.stringCount = 2 * configCount;
+    file.axisCount = configCount;
+    file.buttonCount = configCount;
+
+    uint32_t random = 54321;
+    for (uint32_t i = 0; i < deviceCount; ++i) {
+        const uint32_t device = firstDevice + i;
+        Paddleboat_Controller_Mapping_File_Controller_Entry &entry =
+            file.controllers[i];
+        memset(&entry, 0, sizeof(entry));
+        entry.minimumEffectiveApiLevel = minApi;
+        entry.vendorId = static_cast<int32_t>(0x1000 + device / 64);
+        entry.productId = static_cast<int32_t>(device % 64);
+        entry.axisTableIndex = device % configCount;
+        entry.buttonTableIndex = device % configCount;
+        // Fisher-Yates shuffle as the entries are added
+        random = random * 1664525u + 1013904223u;
+        std::swap(entry, file.controllers[(random >> 8) % (i + 1)]);
+    }
+    file.controllerCount = deviceCount;
+}
+
+// Merges the tables of a file the way mergeControllerRemapData does
+inline Paddleboat_ErrorCode MergeLargeMappingFile(
+    const LargeMappingTables &file, const uint32_t maxEntryCount,
+    LargeMappingTables &tables) {
+    std::vector<IndexTableRemap> stringRemap(file.stringCount);
+    std::vector<IndexTableRemap> axisRemap(file.axisCount);
+    std::vector<IndexTableRemap> buttonRemap(file.buttonCount);
+    Paddleboat_ErrorCode errorCode =
+        GameControllerMappingUtils::mergeStringTable(
+            file.strings.data(), file.stringCount, tables.strings.data(),
+            &tables.stringCount, maxEntryCount, stringRemap.data());
+    if (errorCode == PADDLEBOAT_NO_ERROR) {
+        errorCode = GameControllerMappingUtils::mergeAxisTable(
+            file.axis.data(), file.axisCount, tables.axis.data(),
+            &tables.axisCount, maxEntryCount, stringRemap.data(),
+            axisRemap.data());
+    }
+    if (errorCode == PADDLEBOAT_NO_ERROR) {
+        errorCode = GameControllerMappingUtils::mergeButtonTable(
+            file.buttons.data(), file.buttonCount, tables.buttons.data(),
+            &tables.buttonCount, maxEntryCount, stringRemap.data(),
+            buttonRemap.data());
+    }
+    if (errorCode == PADDLEBOAT_NO_ERROR) {
+        errorCode = GameControllerMappingUtils::mergeControllerTable(
+            file.controllers.data(), file.controllerCount,
+            tables.controllers.data(), &tables.controllerCount,
+            maxEntryCount, axisRemap.data(), buttonRemap.data());
+    }
+    return errorCode;
+}
+
+
+// Serializes sorted mapping tables as a mapping file
+inline std::vector<uint8_t> MakeMappingFileImage(
+    const LargeMappingTables &tables) {
+    const size_t headerSize = sizeof(Paddleboat_Controller_Mapping_File_Header);
+    const size_t axisTableSize =
+        tables.axisCount *
+        sizeof(Paddleboat_Controller_Mapping_File_Axis_Entry);
+    const size_t buttonTableSize =
+        tables.buttonCount *
+        sizeof(Paddleboat_Controller_Mapping_File_Button_Entry);
+    const size_t controllerTableSize =
+        tables.controllerCount *
+        sizeof(Paddleboat_Controller_Mapping_File_Controller_Entry);
+    const size_t stringTableSize =
+        tables.stringCount *
+        sizeof(Paddleboat_Controller_Mapping_File_String_Entry);
+    std::vector<uint8_t> image(headerSize + axisTableSize + buttonTableSize +
+                               controllerTableSize + stringTableSize);
+    Paddleboat_Controller_Mapping_File_Header header;
+    memset(&header, 0, sizeof(header));
+    header.fileIdentifier = PADDLEBOAT_MAPPING_FILE_IDENTIFIER;
+    header.libraryMinimumVersion = 0x010200;
+    header.axisTableEntryCount = tables.axisCount;
+    header.buttonTableEntryCount = tables.buttonCount;
+    header.controllerTableEntryCount = tables.controllerCount;
+    header.stringTableEntryCount = tables.stringCount;
+    uint64_t offset = headerSize;
+    header.axisTableOffset = offset;
+    memcpy(&image[offset], tables.axis.data(), axisTableSize);
+    offset += axisTableSize;
+    header.buttonTableOffset = offset;
+    memcpy(&image[offset], tables.buttons.data(), buttonTableSize);
+    offset += buttonTableSize;
+    header.controllerTableOffset = offset;
+    memcpy(&image[offset], tables.controllers.data(), controllerTableSize);
+    offset += controllerTableSize;
+    header.stringTableOffset = offset;
+    memcpy(&image[offset], tables.strings.data(), stringTableSize);
+    memcpy(image.data(), &header, sizeof(header));
+    return image;
+}
+
+// A 10k entry mapping file with an extra entry overriding the first built-in
+// controller entry from API level 40
+inline std::vector<uint8_t> MakeLayeredMappingFile(
+    const Paddleboat_Controller_Mapping_File_Controller_Entry &builtInEntry) {
+    constexpr uint32_t DEVICE_COUNT = 10000;
+    LargeMappingTables file(DEVICE_COUNT + 1);
+    MakeLargeMappingFile(0, DEVICE_COUNT, 0, 100, 16, file);
+    Paddleboat_Controller_Mapping_File_Controller_Entry &overrideEntry =
+        file.controllers[file.controllerCount++];
+    overrideEntry = builtInEntry;
+    overrideEntry.minimumEffectiveApiLevel = 40;
+    overrideEntry.maximumEffectiveApiLevel = 0;
+    overrideEntry.axisTableIndex = 1;
+    overrideEntry.buttonTableIndex = 1;
+    std::sort(file.controllers.begin(),
+              file.controllers.begin() + file.controllerCount,
+              [](const Paddleboat_Controller_Mapping_File_Controller_Entry &a,
+                 const Paddleboat_Controller_Mapping_File_Controller_Entry &b) {
+                  return a.vendorId < b.vendorId ||
+                         (a.vendorId == b.vendorId &&
+                          a.productId < b.productId);
+              });
+    return MakeMappingFileImage(file);
+}
+
+}  // namespace paddleboat_test
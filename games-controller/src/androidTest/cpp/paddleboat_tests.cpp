@@ -17,13 +17,29 @@
 // This file contains unit tests for the GameControllerMappingUtils class
 
 #include <gtest/gtest.h>
+#include <math.h>
+#include <stdio.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../../main/cpp/GameController.h"
+#include "../../main/cpp/GameControllerHistory.h"
+#include "../../main/cpp/GameControllerInputRecording.h"
+#include "../../main/cpp/GameControllerMappingDatabase.h"
 #include "../../main/cpp/GameControllerMappingFile.h"
 #include "../../main/cpp/GameControllerMappingUtils.h"
+#include "../../main/cpp/GameControllerMotionBuffer.h"
+#include "../../main/cpp/InternalControllerTable.h"
+#include "../../main/cpp/SeqLock.h"
 #include "paddleboat.h"
+#include "paddleboat_test_data.h"
 
 using namespace paddleboat;
+using namespace paddleboat_test;
 using namespace std;
 
 #define ARRAY_COUNTOF(array) (sizeof(array) / sizeof(array[0]))
@@ -1388,3 +1404,682 @@ TEST(PaddleboatValidateControllerFileMerge, Validity) {
               pbtest_ctrl_file[0].maximumEffectiveApiLevel);
     free(basePtr);
 }
+
+// Large mapping database test
+// ===========================================================================
+// Test merging and searching synthetic 10k entry mapping files
+TEST(PaddleboatMappingDatabase, LargeFileMerge) {
+    constexpr uint32_t DEVICE_COUNT = 10000;
+    constexpr uint32_t CONFIG_COUNT = 2000;
+    constexpr uint32_t MAX_ENTRY_COUNT = 2 * DEVICE_COUNT;
+    LargeMappingTables tables(MAX_ENTRY_COUNT);
+    LargeMappingTables file(MAX_ENTRY_COUNT);
+
+    // A first file, then a second one overlapping half of its devices and
+    // configurations with entries for a newer API level
+    MakeLargeMappingFile(0, DEVICE_COUNT, 0, CONFIG_COUNT, 16, file);
+    ASSERT_EQ(MergeLargeMappingFile(file, MAX_ENTRY_COUNT, tables),
+              PADDLEBOAT_NO_ERROR);
+    MakeLargeMappingFile(DEVICE_COUNT / 2, DEVICE_COUNT, CONFIG_COUNT / 2,
+                         CONFIG_COUNT, 24, file);
+    ASSERT_EQ(MergeLargeMappingFile(file, MAX_ENTRY_COUNT, tables),
+              PADDLEBOAT_NO_ERROR);
+
+    EXPECT_EQ(tables.stringCount, 3 * CONFIG_COUNT);
+    EXPECT_EQ(tables.axisCount, 3 * CONFIG_COUNT / 2);
+    EXPECT_EQ(tables.buttonCount, 3 * CONFIG_COUNT / 2);
+    EXPECT_EQ(tables.controllerCount, 2 * DEVICE_COUNT);
+    EXPECT_EQ(GameControllerMappingUtils::validateMapTable(
+                  tables.controllers.data(), tables.controllerCount),
+              nullptr);
+
+    // Every device resolves to the entry of its API level, with axis and
+    // button indices remapped to the merged tables
+    MappingTableSearch mapSearch(tables.controllers.data(),
+                                 tables.controllerCount);
+    for (uint32_t device = 0; device < 3 * DEVICE_COUNT / 2; ++device) {
+        const int32_t vendorId = static_cast<int32_t>(0x1000 + device / 64);
+        const int32_t productId = static_cast<int32_t>(device % 64);
+        const bool inFirstFile = device < DEVICE_COUNT;
+        const bool inSecondFile = device >= DEVICE_COUNT / 2;
+        for (const int32_t api : {20, 30}) {
+            mapSearch.initSearchParameters(vendorId, productId, api, api);
+            const bool expectFound = (api == 20) ? inFirstFile : true;
+            ASSERT_EQ(GameControllerMappingUtils::findMatchingMapEntry(
+                          &mapSearch),
+                      expectFound)
+                << "device " << device << " api " << api;
+            if (!expectFound) {
+                continue;
+            }
+            const Paddleboat_Controller_Mapping_File_Controller_Entry &entry =
+                tables.controllers[mapSearch.tableIndex];
+            const bool fromSecondFile = (api == 30 && inSecondFile);
+            EXPECT_EQ(entry.minimumEffectiveApiLevel, fromSecondFile ? 24 : 16);
+            EXPECT_EQ(entry.maximumEffectiveApiLevel,
+                      (inFirstFile && inSecondFile && !fromSecondFile) ? 23
+                                                                       : 0);
+            const uint32_t config =
+                fromSecondFile ? CONFIG_COUNT / 2 + device % CONFIG_COUNT
+                               : device % CONFIG_COUNT;
+            const Paddleboat_Controller_Mapping_File_String_Entry axisName =
+                MakeMappingString("Axis", config);
+            EXPECT_STREQ(tables
+                             .strings[tables.axis[entry.axisTableIndex]
+                                          .axisNameStringTableIndex]
+                             .stringTableEntry,
+                         axisName.stringTableEntry);
+        }
+    }
+
+    // A merge that doesn't fit leaves the table unchanged
+    MakeLargeMappingFile(2 * DEVICE_COUNT, DEVICE_COUNT, 0, CONFIG_COUNT, 16,
+                         file);
+    EXPECT_EQ(MergeLargeMappingFile(file, MAX_ENTRY_COUNT, tables),
+              PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED);
+    EXPECT_EQ(tables.controllerCount, 2 * DEVICE_COUNT);
+}
+
+// Test mapping files are read in place, over the built-in table
+TEST(PaddleboatMappingDatabase, MappedFileLayers) {
+    const Paddleboat_Internal_Mapping_Header *internalHeader =
+        GetInternalMappingHeader();
+    ASSERT_EQ(GameControllerMappingUtils::validateMapTable(
+                  internalHeader->controllerTable,
+                  static_cast<int32_t>(
+                      internalHeader->controllerTableEntryCount)),
+              nullptr);
+    const Paddleboat_Controller_Mapping_File_Controller_Entry &builtInEntry =
+        internalHeader->controllerTable[0];
+    const int32_t builtInApi = std::max<int32_t>(
+        builtInEntry.minimumEffectiveApiLevel, 16);
+    const Paddleboat_Controller_Mapping_File_Axis_Entry *axisEntry = nullptr;
+    const Paddleboat_Controller_Mapping_File_Button_Entry *buttonEntry =
+        nullptr;
+
+    GameControllerMappingDatabase database;
+    EXPECT_EQ(database.findMapping(builtInEntry.vendorId,
+                                   builtInEntry.productId, builtInApi,
+                                   &axisEntry, &buttonEntry),
+              &builtInEntry);
+    EXPECT_EQ(axisEntry,
+              &internalHeader->axisTable[builtInEntry.axisTableIndex]);
+
+    std::vector<uint8_t> image = MakeLayeredMappingFile(builtInEntry);
+    FILE *mappingFile = tmpfile();
+    ASSERT_NE(mappingFile, nullptr);
+    ASSERT_EQ(fwrite(image.data(), 1, image.size(), mappingFile),
+              image.size());
+    fflush(mappingFile);
+
+    ASSERT_EQ(database.addMappingFileDescriptor(
+                  PADDLEBOAT_REMAP_ADD_MODE_DEFAULT, fileno(mappingFile)),
+              PADDLEBOAT_NO_ERROR);
+    fclose(mappingFile);
+
+    // File entries are found in the file, the built-in entry is only
+    // overridden from the API level of the file entry
+    const Paddleboat_Controller_Mapping_File_Controller_Entry *entry =
+        database.findMapping(0x1000, 5, 30, &axisEntry, &buttonEntry);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->productId, 5);
+    EXPECT_EQ(axisEntry->axisNameStringTableIndex, 10u);
+    EXPECT_EQ(database.findMapping(builtInEntry.vendorId,
+                                   builtInEntry.productId, builtInApi,
+                                   &axisEntry, &buttonEntry),
+              &builtInEntry);
+    entry = database.findMapping(builtInEntry.vendorId, builtInEntry.productId,
+                                 40, &axisEntry, &buttonEntry);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_NE(entry, &builtInEntry);
+    EXPECT_EQ(entry->minimumEffectiveApiLevel, 40);
+    EXPECT_EQ(axisEntry->axisNameStringTableIndex, 2u);
+    EXPECT_EQ(buttonEntry->buttonNameStringTableIndex, 3u);
+
+    // Files with out of range indices are rejected
+    const Paddleboat_Controller_Mapping_File_Header *imageHeader =
+        reinterpret_cast<const Paddleboat_Controller_Mapping_File_Header *>(
+            image.data());
+    Paddleboat_Controller_Mapping_File_Header header;
+    memcpy(&header, image.data(), sizeof(header));
+    Paddleboat_Controller_Mapping_File_Controller_Entry badEntry;
+    memcpy(&badEntry, &image[header.controllerTableOffset], sizeof(badEntry));
+    badEntry.axisTableIndex = header.axisTableEntryCount;
+    memcpy(&image[header.controllerTableOffset], &badEntry, sizeof(badEntry));
+    EXPECT_EQ(database.addMappingFileBuffer(
+                  PADDLEBOAT_REMAP_ADD_MODE_REPLACE_ALL, imageHeader,
+                  image.size()),
+              PADDLEBOAT_INVALID_MAPPING_DATA);
+    EXPECT_EQ(database.findMapping(builtInEntry.vendorId,
+                                   builtInEntry.productId, builtInApi,
+                                   &axisEntry, &buttonEntry),
+              &builtInEntry);
+
+    // Replacing drops the built-in table
+    badEntry.axisTableIndex = 0;
+    memcpy(&image[header.controllerTableOffset], &badEntry, sizeof(badEntry));
+    EXPECT_EQ(database.addMappingFileBuffer(
+                  PADDLEBOAT_REMAP_ADD_MODE_REPLACE_ALL, imageHeader,
+                  image.size()),
+              PADDLEBOAT_NO_ERROR);
+    image.clear();
+    EXPECT_EQ(database.findMapping(builtInEntry.vendorId,
+                                   builtInEntry.productId, builtInApi,
+                                   &axisEntry, &buttonEntry),
+              nullptr);
+    EXPECT_NE(database.findMapping(0x1000, 5, 30, &axisEntry, &buttonEntry),
+              nullptr);
+}
+
+// Controller snapshot tests
+// --=========================================================================
+// Controller data where every field is derived from the update count, so a
+// torn copy can be detected
+static void FillControllerData(const uint64_t update,
+                               Paddleboat_Controller_Data &data) {
+    const float value = static_cast<float>(update & 0xFFFF);
+    data.timestamp = update;
+    data.buttonsDown = static_cast<uint32_t>(update);
+    data.leftStick.stickX = value;
+    data.leftStick.stickY = value;
+    data.rightStick.stickX = value;
+    data.rightStick.stickY = value;
+    data.triggerL1 = value;
+    data.triggerL2 = value;
+    data.triggerR1 = value;
+    data.triggerR2 = value;
+    data.virtualPointer.pointerX = value;
+    data.virtualPointer.pointerY = value;
+    data.battery.batteryLevel = value;
+    data.battery.batteryStatus = PADDLEBOAT_CONTROLLER_BATTERY_DISCHARGING;
+}
+
+static bool ControllerDataConsistent(const Paddleboat_Controller_Data &data) {
+    Paddleboat_Controller_Data expected;
+    memset(&expected, 0, sizeof(expected));
+    FillControllerData(data.timestamp, expected);
+    if (data.timestamp == 0) {
+        // Never published
+        memset(&expected, 0, sizeof(expected));
+    }
+    return memcmp(&data, &expected, sizeof(Paddleboat_Controller_Data)) == 0;
+}
+
+// Publishes controller data from an input thread while game threads poll all
+// the controllers, the way GameControllerManager uses its snapshots
+TEST(PaddleboatControllerSnapshot, Stress) {
+    constexpr int32_t READER_COUNT = 2;
+    constexpr uint64_t UPDATE_COUNT = 200000;
+    SeqLock<Paddleboat_Controller_Data> snapshots[PADDLEBOAT_MAX_CONTROLLERS];
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> totalReads(0);
+    std::atomic<uint64_t> tornReads(0);
+    std::atomic<uint64_t> timeTravels(0);
+
+    std::vector<std::thread> readers;
+    for (int32_t r = 0; r < READER_COUNT; ++r) {
+        readers.emplace_back([&]() {
+            uint64_t lastTimestamps[PADDLEBOAT_MAX_CONTROLLERS] = {};
+            uint64_t reads = 0;
+            Paddleboat_Controller_Data data;
+            while (running.load(std::memory_order_relaxed)) {
+                for (int32_t i = 0; i < PADDLEBOAT_MAX_CONTROLLERS; ++i) {
+                    snapshots[i].load(&data);
+                    if (!ControllerDataConsistent(data) ||
+                        (data.timestamp != 0 &&
+                         data.timestamp % PADDLEBOAT_MAX_CONTROLLERS !=
+                             static_cast<uint64_t>(i))) {
+                        ++tornReads;
+                    }
+                    if (data.timestamp < lastTimestamps[i]) {
+                        ++timeTravels;
+                    }
+                    lastTimestamps[i] = data.timestamp;
+                    ++reads;
+                }
+            }
+            totalReads += reads;
+        });
+    }
+    Paddleboat_Controller_Data data;
+    memset(&data, 0, sizeof(data));
+    for (uint64_t update = 1; update <= UPDATE_COUNT; ++update) {
+        FillControllerData(update, data);
+        snapshots[update % PADDLEBOAT_MAX_CONTROLLERS].store(data);
+    }
+    running = false;
+    for (std::thread &reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_GT(totalReads.load(), 0u);
+    EXPECT_EQ(tornReads.load(), 0u);
+    EXPECT_EQ(timeTravels.load(), 0u);
+    // Each snapshot holds the last update published to it
+    for (int32_t i = 0; i < PADDLEBOAT_MAX_CONTROLLERS; ++i) {
+        const uint64_t lastUpdate =
+            UPDATE_COUNT - (UPDATE_COUNT - i) % PADDLEBOAT_MAX_CONTROLLERS;
+        snapshots[i].load(&data);
+        EXPECT_EQ(data.timestamp, lastUpdate) << "controller " << i;
+        EXPECT_TRUE(ControllerDataConsistent(data)) << "controller " << i;
+    }
+}
+
+// Controller history tests
+// --=========================================================================
+static Paddleboat_Controller_History_Entry MakeHistoryEntry(
+    const uint64_t timestamp, const uint32_t buttonsDown) {
+    Paddleboat_Controller_History_Entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.timestamp = timestamp;
+    entry.buttonsDown = buttonsDown;
+    return entry;
+}
+
+// Sets up a controller with the default mapping of the sticks and triggers
+static void SetupHistoryTestController(GameController &gameController) {
+    GameControllerDeviceInfo &deviceInfo = gameController.getDeviceInfo();
+    const int32_t axisIds[] = {
+        AMOTION_EVENT_AXIS_X,        AMOTION_EVENT_AXIS_Y,
+        AMOTION_EVENT_AXIS_Z,        AMOTION_EVENT_AXIS_RZ,
+        AMOTION_EVENT_AXIS_LTRIGGER, AMOTION_EVENT_AXIS_RTRIGGER};
+    for (const int32_t axisId : axisIds) {
+        deviceInfo.getInfo()->mAxisBitsLow |= (1 << axisId);
+        deviceInfo.getMinArray()[axisId] = -1.0f;
+        deviceInfo.getMaxArray()[axisId] = 1.0f;
+    }
+    deviceInfo.getMinArray()[AMOTION_EVENT_AXIS_LTRIGGER] = 0.0f;
+    deviceInfo.getMinArray()[AMOTION_EVENT_AXIS_RTRIGGER] = 0.0f;
+    gameController.setupController(nullptr, nullptr, nullptr);
+}
+
+// Test button edges are reported relative to the previous entry
+TEST(PaddleboatControllerHistory, ButtonEdges) {
+    GameControllerHistory history;
+    history.record(MakeHistoryEntry(1, PADDLEBOAT_BUTTON_A));
+    history.record(MakeHistoryEntry(2, PADDLEBOAT_BUTTON_A |
+                                           PADDLEBOAT_BUTTON_B));
+    history.record(MakeHistoryEntry(3, PADDLEBOAT_BUTTON_B));
+
+    Paddleboat_Controller_History_Entry entries[4];
+    ASSERT_EQ(history.drain(4, entries), 3);
+    EXPECT_EQ(entries[0].buttonsChanged, PADDLEBOAT_BUTTON_A);
+    EXPECT_EQ(entries[1].buttonsChanged, PADDLEBOAT_BUTTON_B);
+    EXPECT_EQ(entries[2].buttonsChanged, PADDLEBOAT_BUTTON_A);
+    EXPECT_EQ(entries[2].buttonsDown, PADDLEBOAT_BUTTON_B);
+    EXPECT_EQ(history.drain(4, entries), 0);
+}
+
+// Test a full history drops new entries and flags the next one recorded
+TEST(PaddleboatControllerHistory, Overflow) {
+    GameControllerHistory history;
+    const uint32_t capacity = GameControllerHistory::CAPACITY;
+    for (uint32_t i = 0; i < capacity + 4; ++i) {
+        history.record(MakeHistoryEntry(i, 0));
+    }
+    std::vector<Paddleboat_Controller_History_Entry> entries(capacity + 4);
+    // Partial drains wrap around the end of the buffer
+    ASSERT_EQ(history.drain(3, entries.data()), 3);
+    history.record(MakeHistoryEntry(1000, PADDLEBOAT_BUTTON_X));
+    ASSERT_EQ(history.drain(capacity + 4, entries.data()),
+              static_cast<int32_t>(capacity - 2));
+    for (uint32_t i = 0; i < capacity - 3; ++i) {
+        EXPECT_EQ(entries[i].timestamp, i + 3);
+        EXPECT_EQ(entries[i].flags, 0u);
+    }
+    const Paddleboat_Controller_History_Entry &last = entries[capacity - 3];
+    EXPECT_EQ(last.timestamp, 1000u);
+    EXPECT_EQ(last.flags, PADDLEBOAT_HISTORY_FLAG_OVERFLOW);
+    EXPECT_EQ(last.buttonsChanged, PADDLEBOAT_BUTTON_X);
+}
+
+// Test entries are received in order while the game thread drains the history
+// concurrently with the input thread
+TEST(PaddleboatControllerHistory, ConcurrentDrain) {
+    constexpr uint64_t ENTRY_COUNT = 200000;
+    GameControllerHistory history;
+    std::atomic<bool> producing(true);
+    std::thread producer([&]() {
+        for (uint64_t i = 1; i <= ENTRY_COUNT; ++i) {
+            history.record(MakeHistoryEntry(i, static_cast<uint32_t>(i)));
+        }
+        producing = false;
+    });
+
+    Paddleboat_Controller_History_Entry entries[32];
+    uint64_t lastTimestamp = 0;
+    uint64_t received = 0;
+    bool done = false;
+    while (!done) {
+        done = !producing.load();
+        int32_t count = 0;
+        while ((count = history.drain(32, entries)) > 0) {
+            for (int32_t i = 0; i < count; ++i) {
+                const Paddleboat_Controller_History_Entry &entry = entries[i];
+                ASSERT_GT(entry.timestamp, lastTimestamp);
+                // Gaps are only allowed where entries were dropped
+                if (entry.timestamp != lastTimestamp + 1) {
+                    ASSERT_NE(entry.flags & PADDLEBOAT_HISTORY_FLAG_OVERFLOW,
+                              0u);
+                }
+                ASSERT_EQ(entry.buttonsChanged,
+                          entry.buttonsDown ^
+                              static_cast<uint32_t>(lastTimestamp));
+                lastTimestamp = entry.timestamp;
+                ++received;
+            }
+        }
+    }
+    producer.join();
+    EXPECT_GT(received, 0u);
+    EXPECT_LE(received, ENTRY_COUNT);
+}
+
+// Test the historical samples of a GameActivity motion event are recorded
+// before the most recent sample, and key events record button edges
+TEST(PaddleboatControllerHistory, GameActivityEvents) {
+    GameController gameController;
+    SetupHistoryTestController(gameController);
+    Paddleboat_Controller_History_Entry entries[8];
+    EXPECT_EQ(gameController.drainHistory(8, entries), -1);
+    gameController.setHistoryRecording(true);
+
+    // Two batched samples of two pointers, with times in milliseconds
+    constexpr size_t STRIDE =
+        2 * PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+    std::vector<float> historicalAxisValues(2 * STRIDE, 0.0f);
+    historicalAxisValues[AMOTION_EVENT_AXIS_X] = 0.25f;
+    historicalAxisValues[STRIDE + AMOTION_EVENT_AXIS_X] = 0.5f;
+    const long historicalTimes[] = {10, 12};
+    GameController::GameActivityMotionHistory motionHistory;
+    motionHistory.historySize = 2;
+    motionHistory.sampleStride = STRIDE;
+    motionHistory.axisValues = historicalAxisValues.data();
+    motionHistory.eventTimesMillis = historicalTimes;
+    float axisValues[PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT] = {};
+    axisValues[AMOTION_EVENT_AXIS_X] = 0.75f;
+    axisValues[AMOTION_EVENT_AXIS_RTRIGGER] = 1.0f;
+    EXPECT_EQ(gameController.processGameActivityMotionEvent(axisValues, 14,
+                                                            &motionHistory),
+              HANDLED_EVENT);
+
+    Paddleboat_GameActivityKeyEvent keyEvent;
+    memset(&keyEvent, 0, sizeof(keyEvent));
+    keyEvent.keyCode = AKEYCODE_BUTTON_A;
+    keyEvent.action = AKEY_EVENT_ACTION_DOWN;
+    keyEvent.eventTime = 15000000;
+    gameController.processGameActivityKeyEvent(&keyEvent, sizeof(keyEvent));
+    keyEvent.action = AKEY_EVENT_ACTION_UP;
+    keyEvent.eventTime = 16000000;
+    gameController.processGameActivityKeyEvent(&keyEvent, sizeof(keyEvent));
+
+    ASSERT_EQ(gameController.drainHistory(8, entries), 5);
+    EXPECT_EQ(entries[0].timestamp, 10000u);
+    EXPECT_FLOAT_EQ(entries[0].leftStick.stickX, 0.25f);
+    EXPECT_EQ(entries[0].flags, PADDLEBOAT_HISTORY_FLAG_HISTORICAL);
+    EXPECT_EQ(entries[1].timestamp, 12000u);
+    EXPECT_FLOAT_EQ(entries[1].leftStick.stickX, 0.5f);
+    EXPECT_EQ(entries[2].timestamp, 14000u);
+    EXPECT_FLOAT_EQ(entries[2].leftStick.stickX, 0.75f);
+    EXPECT_FLOAT_EQ(entries[2].triggerR2, 1.0f);
+    EXPECT_EQ(entries[2].flags, 0u);
+    EXPECT_EQ(entries[2].buttonsChanged, PADDLEBOAT_BUTTON_R2);
+    EXPECT_EQ(entries[3].timestamp, 15000u);
+    EXPECT_EQ(entries[3].buttonsChanged, PADDLEBOAT_BUTTON_A);
+    EXPECT_NE(entries[3].buttonsDown & PADDLEBOAT_BUTTON_A, 0u);
+    EXPECT_EQ(entries[4].buttonsChanged, PADDLEBOAT_BUTTON_A);
+    EXPECT_EQ(entries[4].buttonsDown & PADDLEBOAT_BUTTON_A, 0u);
+
+    // The published data only has the most recent sample
+    Paddleboat_Controller_Data controllerData;
+    gameController.readControllerData(&controllerData);
+    EXPECT_FLOAT_EQ(controllerData.leftStick.stickX, 0.75f);
+}
+
+// Axis transform tests
+// --=========================================================================
+// Test the precomputed axis transform matches the per axis transform on
+// synthetic motion events
+TEST(PaddleboatAxisTransform, MatchesReference) {
+    constexpr size_t EVENT_COUNT = 4096;
+    GameController gameController;
+    SetupTransformTestController(gameController);
+    const GameController::GameControllerAxisInfo *axisInfo =
+        gameController.getAxisInfo();
+    EXPECT_NE(axisInfo[GameController::GAMECONTROLLER_AXIS_LSTICK_X].axisFlags &
+                  GAMECONTROLLER_AXIS_FLAG_APPLY_ADJUSTMENTS,
+              0u);
+    EXPECT_TRUE(axisInfo[GameController::GAMECONTROLLER_AXIS_HAT_X].axisInvert);
+
+    std::vector<float> axisValues;
+    FillSyntheticMotionEvents(EVENT_COUNT, axisValues);
+    Paddleboat_Controller_Data expected;
+    memset(&expected, 0, sizeof(expected));
+    for (size_t i = 0; i < EVENT_COUNT; ++i) {
+        const float *values =
+            &axisValues[i * PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+        ReferenceAxisTransform(axisInfo, values, expected);
+        ASSERT_EQ(gameController.processGameActivityMotionEvent(
+                      values, static_cast<int64_t>(i), nullptr),
+                  HANDLED_EVENT);
+        const Paddleboat_Controller_Data &data =
+            gameController.getControllerData();
+        ASSERT_EQ(data.buttonsDown, expected.buttonsDown) << "event " << i;
+        const float *dataAxes = &data.leftStick.stickX;
+        const float *expectedAxes = &expected.leftStick.stickX;
+        for (int32_t axis = 0; axis < GameController::GAMECONTROLLER_AXIS_HAT_X;
+             ++axis) {
+            ASSERT_FLOAT_EQ(dataAxes[axis], expectedAxes[axis])
+                << "event " << i << " axis " << axis;
+        }
+    }
+}
+
+// Motion data buffer tests
+// --=========================================================================
+static Paddleboat_Motion_Data MakeMotionData(const uint64_t timestamp,
+                                             const Paddleboat_Motion_Type type,
+                                             const float value) {
+    Paddleboat_Motion_Data motionData;
+    motionData.timestamp = timestamp;
+    motionData.motionType = type;
+    motionData.motionX = value;
+    motionData.motionY = -value;
+    motionData.motionZ = 2.0f * value;
+    return motionData;
+}
+
+// Test downsampling averages the samples of each sensor separately
+TEST(PaddleboatMotionBuffer, Downsample) {
+    GameControllerMotionBuffer buffer;
+    const Paddleboat_Motion_Data_Filter filter = {4, 0.0f};
+    for (uint64_t i = 1; i <= 8; ++i) {
+        buffer.add(1, filter,
+                   MakeMotionData(i, PADDLEBOAT_MOTION_ACCELEROMETER,
+                                  static_cast<float>(i)));
+        buffer.add(1, filter,
+                   MakeMotionData(i, PADDLEBOAT_MOTION_GYROSCOPE, 10.0f));
+    }
+    Paddleboat_Motion_Data samples[8];
+    ASSERT_EQ(buffer.drain(8, samples), 4);
+    EXPECT_EQ(samples[0].motionType, PADDLEBOAT_MOTION_ACCELEROMETER);
+    EXPECT_EQ(samples[0].timestamp, 4u);
+    EXPECT_FLOAT_EQ(samples[0].motionX, 2.5f);
+    EXPECT_FLOAT_EQ(samples[0].motionY, -2.5f);
+    EXPECT_FLOAT_EQ(samples[0].motionZ, 5.0f);
+    EXPECT_EQ(samples[1].motionType, PADDLEBOAT_MOTION_GYROSCOPE);
+    EXPECT_FLOAT_EQ(samples[1].motionX, 10.0f);
+    EXPECT_EQ(samples[2].timestamp, 8u);
+    EXPECT_FLOAT_EQ(samples[2].motionX, 6.5f);
+
+    // A new device restarts the filter, dropping the partial run
+    for (uint64_t i = 1; i <= 3; ++i) {
+        buffer.add(1, filter,
+                   MakeMotionData(i, PADDLEBOAT_MOTION_ACCELEROMETER, 100.0f));
+    }
+    for (uint64_t i = 1; i <= 4; ++i) {
+        buffer.add(2, filter,
+                   MakeMotionData(i, PADDLEBOAT_MOTION_ACCELEROMETER, 1.0f));
+    }
+    ASSERT_EQ(buffer.drain(8, samples), 1);
+    EXPECT_FLOAT_EQ(samples[0].motionX, 1.0f);
+}
+
+// Test the low-pass filter converges to a constant input, and starts from the
+// first sample
+TEST(PaddleboatMotionBuffer, LowPass) {
+    GameControllerMotionBuffer buffer;
+    const Paddleboat_Motion_Data_Filter filter = {1, 0.75f};
+    buffer.add(1, filter,
+               MakeMotionData(1, PADDLEBOAT_MOTION_GYROSCOPE, 4.0f));
+    for (uint64_t i = 2; i <= 3; ++i) {
+        buffer.add(1, filter,
+                   MakeMotionData(i, PADDLEBOAT_MOTION_GYROSCOPE, 0.0f));
+    }
+    Paddleboat_Motion_Data samples[4];
+    ASSERT_EQ(buffer.drain(4, samples), 3);
+    EXPECT_FLOAT_EQ(samples[0].motionX, 4.0f);
+    EXPECT_FLOAT_EQ(samples[1].motionX, 3.0f);
+    EXPECT_FLOAT_EQ(samples[2].motionX, 2.25f);
+    EXPECT_FLOAT_EQ(samples[2].motionZ, 4.5f);
+    EXPECT_EQ(samples[2].timestamp, 3u);
+}
+
+// Test samples are received in order while the game thread drains the buffer
+// concurrently with the sensor thread, and a full buffer drops new samples
+TEST(PaddleboatMotionBuffer, ConcurrentDrain) {
+    constexpr uint64_t SAMPLE_COUNT = 200000;
+    GameControllerMotionBuffer buffer;
+    const Paddleboat_Motion_Data_Filter filter = {1, 0.0f};
+    for (uint32_t i = 0; i < GameControllerMotionBuffer::CAPACITY + 4; ++i) {
+        buffer.add(1, filter,
+                   MakeMotionData(0, PADDLEBOAT_MOTION_ACCELEROMETER, 0.0f));
+    }
+    std::vector<Paddleboat_Motion_Data> samples(
+        GameControllerMotionBuffer::CAPACITY + 4);
+    ASSERT_EQ(buffer.drain(static_cast<int32_t>(samples.size()),
+                           samples.data()),
+              static_cast<int32_t>(GameControllerMotionBuffer::CAPACITY));
+
+    std::atomic<bool> producing(true);
+    std::thread producer([&]() {
+        for (uint64_t i = 1; i <= SAMPLE_COUNT; ++i) {
+            buffer.add(1, filter,
+                       MakeMotionData(i, PADDLEBOAT_MOTION_ACCELEROMETER,
+                                      static_cast<float>(i)));
+        }
+        producing = false;
+    });
+    uint64_t lastTimestamp = 0;
+    uint64_t received = 0;
+    bool done = false;
+    while (!done) {
+        done = !producing.load();
+        int32_t count = 0;
+        while ((count = buffer.drain(32, samples.data())) > 0) {
+            for (int32_t i = 0; i < count; ++i) {
+                ASSERT_GT(samples[i].timestamp, lastTimestamp);
+                ASSERT_EQ(samples[i].motionX,
+                          static_cast<float>(samples[i].timestamp));
+                lastTimestamp = samples[i].timestamp;
+                ++received;
+            }
+        }
+    }
+    producer.join();
+    EXPECT_GT(received, 0u);
+    EXPECT_LE(received, SAMPLE_COUNT);
+}
+
+// Input recording tests
+// --=========================================================================
+
+// Test recorded events are written as aligned records with their payloads,
+// with GameActivity event times converted to nanoseconds
+TEST(PaddleboatInputRecording, Records) {
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    GameControllerInputRecorder recorder;
+    EXPECT_EQ(recorder.start(-1), PADDLEBOAT_ERROR_INVALID_PARAMETER);
+    ASSERT_EQ(recorder.start(fileno(file)), PADDLEBOAT_NO_ERROR);
+    EXPECT_TRUE(recorder.isRecording());
+    EXPECT_EQ(recorder.start(fileno(file)),
+              PADDLEBOAT_ERROR_ALREADY_INITIALIZED);
+
+    Paddleboat_GameActivityMotionEventV3 motionEvent;
+    memset(&motionEvent, 0, sizeof(motionEvent));
+    motionEvent.deviceId = 7;
+    motionEvent.source = AINPUT_SOURCE_JOYSTICK;
+    motionEvent.eventTime = 5;
+    motionEvent.pointerCount = 1;
+    motionEvent.pointers[0].axisValues[AMOTION_EVENT_AXIS_X] = 0.5f;
+    const int64_t historyTimes[2] = {3000000, 4000000};
+    float historyValues[2 * PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT] =
+        {};
+    historyValues[PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT] = 0.25f;
+    GameController::GameActivityMotionHistory history;
+    history.historySize = 2;
+    history.sampleStride = PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+    history.axisValues = historyValues;
+    history.eventTimesNanos = historyTimes;
+    recorder.recordGameActivityMotionEvent(
+        reinterpret_cast<const Paddleboat_GameActivityMotionEvent *>(
+            &motionEvent),
+        motionEvent.pointers[0].axisValues, history);
+    recorder.recordControllerDisconnected(7);
+    recorder.recordUpdate();
+    ASSERT_EQ(recorder.stop(), PADDLEBOAT_NO_ERROR);
+    EXPECT_FALSE(recorder.isRecording());
+    // Not recorded once stopped
+    recorder.recordUpdate();
+
+    const size_t motionPayloadSize =
+        sizeof(InputRecordMotionEvent) +
+        2 * (sizeof(int64_t) +
+             sizeof(float) * PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT);
+    const size_t expectedSize = sizeof(InputRecordingHeader) +
+                                3 * sizeof(InputRecordHeader) +
+                                motionPayloadSize + INPUT_RECORD_ALIGNMENT;
+    std::vector<uint64_t> contents(expectedSize / sizeof(uint64_t) + 1);
+    fseek(file, 0, SEEK_SET);
+    ASSERT_EQ(fread(contents.data(), 1, expectedSize + 1, file), expectedSize);
+    fclose(file);
+
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(contents.data());
+    const InputRecordingHeader *fileHeader =
+        reinterpret_cast<const InputRecordingHeader *>(data);
+    EXPECT_EQ(fileHeader->magic, INPUT_RECORDING_MAGIC);
+    EXPECT_EQ(fileHeader->version, INPUT_RECORDING_VERSION);
+    data += sizeof(InputRecordingHeader);
+
+    const InputRecordHeader *header =
+        reinterpret_cast<const InputRecordHeader *>(data);
+    EXPECT_EQ(header->type, INPUT_RECORD_MOTION_EVENT);
+    ASSERT_EQ(header->payloadSize, motionPayloadSize);
+    const InputRecordMotionEvent *recordedEvent =
+        reinterpret_cast<const InputRecordMotionEvent *>(header + 1);
+    EXPECT_EQ(recordedEvent->flags, INPUT_RECORD_FLAG_GAME_ACTIVITY);
+    EXPECT_EQ(recordedEvent->eventTime, 5000000);
+    EXPECT_EQ(recordedEvent->deviceId, 7);
+    EXPECT_EQ(recordedEvent->historySize, 2);
+    EXPECT_EQ(recordedEvent->axisValues[AMOTION_EVENT_AXIS_X], 0.5f);
+    const int64_t *recordedTimes =
+        reinterpret_cast<const int64_t *>(recordedEvent + 1);
+    EXPECT_EQ(recordedTimes[1], 4000000);
+    const float *recordedValues =
+        reinterpret_cast<const float *>(recordedTimes + 2);
+    EXPECT_EQ(recordedValues[PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT],
+              0.25f);
+    data += sizeof(InputRecordHeader) + motionPayloadSize;
+
+    header = reinterpret_cast<const InputRecordHeader *>(data);
+    EXPECT_EQ(header->type, INPUT_RECORD_CONTROLLER_DISCONNECTED);
+    ASSERT_EQ(header->payloadSize, sizeof(int32_t));
+    EXPECT_EQ(*reinterpret_cast<const int32_t *>(header + 1), 7);
+    // Padded to the record alignment
+    data += sizeof(InputRecordHeader) + INPUT_RECORD_ALIGNMENT;
+
+    header = reinterpret_cast<const InputRecordHeader *>(data);
+    EXPECT_EQ(header->type, INPUT_RECORD_UPDATE);
+    EXPECT_EQ(header->payloadSize, 0u);
+}
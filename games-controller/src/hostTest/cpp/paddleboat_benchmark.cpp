@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// paddleboat_benchmark times the Paddleboat internals that the unit tests in
+// androidTest check for correctness, on the same synthetic data, and the
+// controller data polling checked by paddleboat_host_tests. It only reports
+// timings, the results are checked by the tests.
+//
+//   paddleboat_benchmark [--rounds N]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../../androidTest/cpp/paddleboat_test_data.h"
+#include "GameController.h"
+#include "GameControllerMappingDatabase.h"
+#include "GameControllerMappingUtils.h"
+#include "InternalControllerTable.h"
+#include "paddleboat.h"
+#include "paddleboat_host.h"
+
+using paddleboat::GameController;
+using paddleboat::GameControllerMappingDatabase;
+using paddleboat::GameControllerMappingUtils;
+using paddleboat::MappingTableSearch;
+using paddleboat::Paddleboat_Controller_Mapping_File_Controller_Entry;
+using paddleboat::Paddleboat_GameActivityMotionEventV3;
+using paddleboat_host::HostJni;
+using paddleboat_test::LargeMappingTables;
+
+namespace {
+
+constexpr int32_t AXIS_COUNT = PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+
+double ElapsedNs(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+double ElapsedMs(const std::chrono::steady_clock::time_point start) {
+  return ElapsedNs(start) / 1000000.0;
+}
+
+// The precomputed GameController axis transform against the per axis
+// transform it replaced. The GameController timing includes publishing each
+// event.
+void BenchmarkAxisTransform(const int32_t rounds) {
+  constexpr size_t EVENT_COUNT = 4096;
+  GameController gameController;
+  paddleboat_test::SetupTransformTestController(gameController);
+  const GameController::GameControllerAxisInfo *axisInfo =
+      gameController.getAxisInfo();
+  std::vector<float> axisValues;
+  paddleboat_test::FillSyntheticMotionEvents(EVENT_COUNT, axisValues);
+  Paddleboat_Controller_Data reference;
+  memset(&reference, 0, sizeof(reference));
+
+  auto start = std::chrono::steady_clock::now();
+  for (int32_t round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < EVENT_COUNT; ++i) {
+      paddleboat_test::ReferenceAxisTransform(
+          axisInfo, &axisValues[i * AXIS_COUNT], reference);
+    }
+  }
+  const double referenceNs = ElapsedNs(start);
+  start = std::chrono::steady_clock::now();
+  for (int32_t round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < EVENT_COUNT; ++i) {
+      gameController.processGameActivityMotionEvent(
+          &axisValues[i * AXIS_COUNT], static_cast<int64_t>(i), nullptr);
+    }
+  }
+  const double controllerNs = ElapsedNs(start);
+
+  const double eventCount = static_cast<double>(EVENT_COUNT) * rounds;
+  printf("axis transform, per axis:       %8.1f ns/event\n",
+         referenceNs / eventCount);
+  printf("axis transform, GameController: %8.1f ns/event\n",
+         controllerNs / eventCount);
+  // Keeps the reference transform from being optimized out
+  if (reference.buttonsDown == 0xFFFFFFFF) printf("\n");
+}
+
+// Merges of the synthetic 10k entry mapping files of the LargeFileMerge test,
+// then lookups of every device in the merged table
+void BenchmarkMappingMerge(const int32_t rounds) {
+  constexpr uint32_t DEVICE_COUNT = 10000;
+  constexpr uint32_t CONFIG_COUNT = 2000;
+  constexpr uint32_t MAX_ENTRY_COUNT = 2 * DEVICE_COUNT;
+  LargeMappingTables firstFile(MAX_ENTRY_COUNT);
+  LargeMappingTables secondFile(MAX_ENTRY_COUNT);
+  paddleboat_test::MakeLargeMappingFile(0, DEVICE_COUNT, 0, CONFIG_COUNT, 16,
+                                        firstFile);
+  paddleboat_test::MakeLargeMappingFile(DEVICE_COUNT / 2, DEVICE_COUNT,
+                                        CONFIG_COUNT / 2, CONFIG_COUNT, 24,
+                                        secondFile);
+
+  double firstMergeMs = 0.0;
+  double secondMergeMs = 0.0;
+  double lookupMs = 0.0;
+  uint32_t found = 0;
+  for (int32_t round = 0; round < rounds; ++round) {
+    LargeMappingTables tables(MAX_ENTRY_COUNT);
+    auto start = std::chrono::steady_clock::now();
+    paddleboat_test::MergeLargeMappingFile(firstFile, MAX_ENTRY_COUNT, tables);
+    firstMergeMs += ElapsedMs(start);
+    start = std::chrono::steady_clock::now();
+    paddleboat_test::MergeLargeMappingFile(secondFile, MAX_ENTRY_COUNT,
+                                           tables);
+    secondMergeMs += ElapsedMs(start);
+
+    start = std::chrono::steady_clock::now();
+    MappingTableSearch mapSearch(tables.controllers.data(),
+                                 tables.controllerCount);
+    for (uint32_t device = 0; device < 3 * DEVICE_COUNT / 2; ++device) {
+      for (const int32_t api : {20, 30}) {
+        mapSearch.initSearchParameters(
+            static_cast<int32_t>(0x1000 + device / 64),
+            static_cast<int32_t>(device % 64), api, api);
+        if (GameControllerMappingUtils::findMatchingMapEntry(&mapSearch)) {
+          ++found;
+        }
+      }
+    }
+    lookupMs += ElapsedMs(start);
+  }
+
+  printf("mapping merge, first %u entries:  %8.2f ms\n", DEVICE_COUNT,
+         firstMergeMs / rounds);
+  printf("mapping merge, second %u entries: %8.2f ms\n", DEVICE_COUNT,
+         secondMergeMs / rounds);
+  printf("mapping lookups, %u searches:     %8.2f ms (%u found)\n",
+         3 * DEVICE_COUNT, lookupMs / rounds, found / rounds);
+}
+
+// Adding the 10k entry mapping file of the MappedFileLayers test to a mapping
+// database, which maps the file and validates its tables in place
+void BenchmarkMappedFile(const int32_t rounds) {
+  const Paddleboat_Controller_Mapping_File_Controller_Entry &builtInEntry =
+      paddleboat::GetInternalMappingHeader()->controllerTable[0];
+  const std::vector<uint8_t> image =
+      paddleboat_test::MakeLayeredMappingFile(builtInEntry);
+  FILE *mappingFile = tmpfile();
+  if (mappingFile == nullptr ||
+      fwrite(image.data(), 1, image.size(), mappingFile) != image.size()) {
+    fprintf(stderr, "Couldn't write the mapping file\n");
+    if (mappingFile != nullptr) fclose(mappingFile);
+    return;
+  }
+  fflush(mappingFile);
+
+  double addMs = 0.0;
+  int32_t added = 0;
+  for (int32_t round = 0; round < rounds; ++round) {
+    GameControllerMappingDatabase database;
+    const auto start = std::chrono::steady_clock::now();
+    if (database.addMappingFileDescriptor(PADDLEBOAT_REMAP_ADD_MODE_DEFAULT,
+                                          fileno(mappingFile)) ==
+        PADDLEBOAT_NO_ERROR) {
+      ++added;
+    }
+    addMs += ElapsedMs(start);
+  }
+  fclose(mappingFile);
+
+  printf("mapped file, %zu bytes:       %8.2f ms (%d/%d added)\n",
+         image.size(), addMs / rounds, added, rounds);
+}
+
+void statusCallback(const int32_t, const Paddleboat_ControllerStatus,
+                    void *) {}
+
+// Paddleboat_getControllerData polled by readerCount threads, while the
+// calling thread publishes GameActivity motion events as fast as it can
+void BenchmarkControllerDataReads(const int32_t rounds,
+                                  const int32_t readerCount) {
+  const int64_t readsPerReader = static_cast<int64_t>(rounds) * 16384;
+  HostJni hostJni;
+  if (Paddleboat_init(hostJni.getEnv(), hostJni.getContext()) !=
+      PADDLEBOAT_NO_ERROR) {
+    fprintf(stderr, "Paddleboat_init failed\n");
+    return;
+  }
+  Paddleboat_setControllerStatusCallback(statusCallback, nullptr);
+  Paddleboat_update(hostJni.getEnv());
+  const paddleboat::InputRecordControllerConnected controller =
+      paddleboat_host::syntheticController();
+  paddleboat_host::connectController(hostJni, controller);
+  Paddleboat_update(hostJni.getEnv());
+
+  std::unique_ptr<Paddleboat_GameActivityMotionEventV3> event(
+      new Paddleboat_GameActivityMotionEventV3());
+  event->deviceId = controller.info.mDeviceId;
+  event->source = AINPUT_SOURCE_GAMEPAD | AINPUT_SOURCE_JOYSTICK;
+  event->action = AMOTION_EVENT_ACTION_MOVE;
+  event->pointerCount = 1;
+
+  std::atomic<int32_t> readersDone{0};
+  std::vector<double> readerNs(readerCount);
+  std::vector<std::thread> readers;
+  for (int32_t i = 0; i < readerCount; ++i) {
+    readers.emplace_back([&, i]() {
+      Paddleboat_Controller_Data data;
+      const auto start = std::chrono::steady_clock::now();
+      for (int64_t read = 0; read < readsPerReader; ++read) {
+        Paddleboat_getControllerData(0, &data);
+      }
+      readerNs[i] = ElapsedNs(start);
+      ++readersDone;
+    });
+  }
+  int64_t eventCount = 0;
+  const auto start = std::chrono::steady_clock::now();
+  while (readersDone.load() < readerCount) {
+    event->eventTime = eventCount;
+    event->pointers[0].axisValues[AMOTION_EVENT_AXIS_X] =
+        static_cast<float>(eventCount & 0xFF) / 255.0f;
+    Paddleboat_processGameActivityMotionInputEvent(event.get(),
+                                                   sizeof(*event));
+    ++eventCount;
+  }
+  const double publishNs = ElapsedNs(start);
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+  Paddleboat_destroy(hostJni.getEnv());
+
+  double readsPerSecond = 0.0;
+  for (const double ns : readerNs) {
+    readsPerSecond += readsPerReader * 1.0e9 / ns;
+  }
+  printf("controller data, %d readers:   %8.2f M reads/s per reader, "
+         "%.2f M events/s published\n",
+         readerCount, readsPerSecond / readerCount / 1.0e6,
+         eventCount * 1.0e3 / publishNs);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int32_t rounds = 64;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+      rounds = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--rounds N]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (rounds <= 0) {
+    fprintf(stderr, "--rounds must be positive\n");
+    return 1;
+  }
+
+  BenchmarkAxisTransform(rounds);
+  BenchmarkMappingMerge(rounds);
+  BenchmarkMappedFile(rounds);
+  for (const int32_t readerCount : {1, 4}) {
+    BenchmarkControllerDataReads(rounds, readerCount);
+  }
+  return 0;
+}
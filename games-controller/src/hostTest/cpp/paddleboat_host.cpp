@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "paddleboat_host.h"
+
+#include <android/log.h>
+
+#include <cstdio>
+#include <cstring>
+
+namespace paddleboat_host {
+
+namespace {
+// Objects have no state, only distinct addresses
+int sContextObject;
+int sClassObject;
+int sGameControllerManagerObject;
+
+jobject hostObject(int *object) { return reinterpret_cast<jobject>(object); }
+
+const HostArray *hostArray(jarray array) {
+    return reinterpret_cast<const HostArray *>(array);
+}
+}  // namespace
+
+HostJni::HostJni() : mFunctions() {
+    mFunctions.FindClass = findClass;
+    mFunctions.NewGlobalRef = newGlobalRef;
+    mFunctions.DeleteGlobalRef = deleteRef;
+    mFunctions.DeleteLocalRef = deleteRef;
+    mFunctions.NewObjectV = newObjectV;
+    mFunctions.GetObjectClass = getObjectClass;
+    mFunctions.GetMethodID = getMethodId;
+    mFunctions.CallObjectMethodV = callObjectMethodV;
+    mFunctions.CallIntMethodV = callIntMethodV;
+    mFunctions.CallFloatMethodV = callFloatMethodV;
+    mFunctions.CallVoidMethodV = callVoidMethodV;
+    mFunctions.NewStringUTF = newStringUtf;
+    mFunctions.GetStringUTFChars = getStringUtfChars;
+    mFunctions.ReleaseStringUTFChars = releaseStringUtfChars;
+    mFunctions.GetArrayLength = getArrayLength;
+    mFunctions.GetIntArrayRegion = getIntArrayRegion;
+    mFunctions.GetFloatArrayRegion = getFloatArrayRegion;
+    mFunctions.RegisterNatives = registerNatives;
+    mEnv.functions = &mFunctions;
+}
+
+jobject HostJni::getContext() { return hostObject(&sContextObject); }
+
+jclass HostJni::findClass(JNIEnv *, const char *) {
+    return reinterpret_cast<jclass>(&sClassObject);
+}
+
+jobject HostJni::newGlobalRef(JNIEnv *, jobject object) { return object; }
+
+void HostJni::deleteRef(JNIEnv *, jobject) {}
+
+jobject HostJni::newObjectV(JNIEnv *env, jclass, jmethodID, va_list) {
+    ++fromEnv(env)->mJavaCallCount;
+    return hostObject(&sGameControllerManagerObject);
+}
+
+jclass HostJni::getObjectClass(JNIEnv *, jobject) {
+    return reinterpret_cast<jclass>(&sClassObject);
+}
+
+jmethodID HostJni::getMethodId(JNIEnv *env, jclass, const char *name,
+                               const char *) {
+    std::string &methodName = fromEnv(env)->mMethodNames[name];
+    methodName = name;
+    return reinterpret_cast<jmethodID>(&methodName);
+}
+
+jobject HostJni::callObjectMethodV(JNIEnv *env, jobject, jmethodID methodId,
+                                   va_list args) {
+    HostJni *hostJni = fromEnv(env);
+    ++hostJni->mJavaCallCount;
+    const std::string &name = methodName(methodId);
+    if (name == "getDeviceNameById") {
+        const int32_t deviceId = va_arg(args, jint);
+        std::string &deviceName = hostJni->mDeviceNames[deviceId];
+        return reinterpret_cast<jobject>(const_cast<char *>(deviceName.c_str()));
+    }
+    // getClassLoader and ClassLoader.loadClass
+    return hostObject(&sClassObject);
+}
+
+jint HostJni::callIntMethodV(JNIEnv *env, jobject, jmethodID methodId,
+                             va_list) {
+    HostJni *hostJni = fromEnv(env);
+    ++hostJni->mJavaCallCount;
+    const std::string &name = methodName(methodId);
+    if (name == "getApiLevel") {
+        return hostJni->mApiLevel;
+    } else if (name == "getIntegratedSensorFlags") {
+        return hostJni->mIntegratedSensorFlags;
+    }
+    return 0;
+}
+
+jfloat HostJni::callFloatMethodV(JNIEnv *env, jobject, jmethodID, va_list) {
+    ++fromEnv(env)->mJavaCallCount;
+    return 0.0f;
+}
+
+void HostJni::callVoidMethodV(JNIEnv *env, jobject, jmethodID, va_list) {
+    ++fromEnv(env)->mJavaCallCount;
+}
+
+jstring HostJni::newStringUtf(JNIEnv *, const char *chars) {
+    return reinterpret_cast<jstring>(const_cast<char *>(chars));
+}
+
+const char *HostJni::getStringUtfChars(JNIEnv *, jstring string, jboolean *) {
+    return reinterpret_cast<const char *>(string);
+}
+
+void HostJni::releaseStringUtfChars(JNIEnv *, jstring, const char *) {}
+
+jsize HostJni::getArrayLength(JNIEnv *, jarray array) {
+    return hostArray(array)->length;
+}
+
+void HostJni::getIntArrayRegion(JNIEnv *, jintArray array, jsize start,
+                                jsize length, jint *buffer) {
+    memcpy(buffer, static_cast<const jint *>(hostArray(array)->values) + start,
+           length * sizeof(jint));
+}
+
+void HostJni::getFloatArrayRegion(JNIEnv *, jfloatArray array, jsize start,
+                                  jsize length, jfloat *buffer) {
+    memcpy(buffer,
+           static_cast<const jfloat *>(hostArray(array)->values) + start,
+           length * sizeof(jfloat));
+}
+
+jint HostJni::registerNatives(JNIEnv *, jclass, const JNINativeMethod *,
+                              jint) {
+    return JNI_OK;
+}
+
+paddleboat::InputRecordControllerConnected syntheticController() {
+    paddleboat::InputRecordControllerConnected connected;
+    memset(&connected, 0, sizeof(connected));
+    connected.info.mDeviceId = 10;
+    connected.info.mVendorId = 0x045e;
+    connected.info.mProductId = 0x0b13;
+    const int32_t axes[] = {
+        AMOTION_EVENT_AXIS_X,        AMOTION_EVENT_AXIS_Y,
+        AMOTION_EVENT_AXIS_Z,        AMOTION_EVENT_AXIS_RZ,
+        AMOTION_EVENT_AXIS_HAT_X,    AMOTION_EVENT_AXIS_HAT_Y,
+        AMOTION_EVENT_AXIS_LTRIGGER, AMOTION_EVENT_AXIS_RTRIGGER};
+    for (const int32_t axis : axes) {
+        connected.info.mAxisBitsLow |= (1 << axis);
+        const bool isTrigger = axis == AMOTION_EVENT_AXIS_LTRIGGER ||
+                               axis == AMOTION_EVENT_AXIS_RTRIGGER;
+        connected.axisMin[axis] = isTrigger ? 0.0f : -1.0f;
+        connected.axisMax[axis] = 1.0f;
+        connected.axisFlat[axis] = isTrigger ? 0.0f : 0.1f;
+        connected.axisFuzz[axis] = 0.01f;
+    }
+    connected.info.mControllerNumber = 1;
+    connected.info.mControllerFlags = PADDLEBOAT_CONTROLLER_FLAG_ACCELEROMETER |
+                                      PADDLEBOAT_CONTROLLER_FLAG_GYROSCOPE;
+    strncpy(connected.name, "Synthetic Controller",
+            sizeof(connected.name) - 1);
+    return connected;
+}
+
+void connectController(
+    HostJni &hostJni,
+    const paddleboat::InputRecordControllerConnected &connected) {
+    hostJni.setDeviceName(connected.info.mDeviceId, connected.name);
+    const HostArray infoArray = {&connected.info,
+                                 sizeof(connected.info) / sizeof(int32_t)};
+    const HostArray minArray = {connected.axisMin,
+                                paddleboat::MAX_AXIS_COUNT};
+    const HostArray maxArray = {connected.axisMax,
+                                paddleboat::MAX_AXIS_COUNT};
+    const HostArray flatArray = {connected.axisFlat,
+                                 paddleboat::MAX_AXIS_COUNT};
+    const HostArray fuzzArray = {connected.axisFuzz,
+                                 paddleboat::MAX_AXIS_COUNT};
+    Java_com_google_android_games_paddleboat_GameControllerManager_onControllerConnected(
+        hostJni.getEnv(), nullptr, infoArray.asIntArray(),
+        minArray.asFloatArray(), maxArray.asFloatArray(),
+        flatArray.asFloatArray(), fuzzArray.asFloatArray());
+}
+
+}  // namespace paddleboat_host
+
+// libandroid and liblog
+extern "C" {
+
+int32_t AInputEvent_getType(const AInputEvent *event) { return event->type; }
+
+int32_t AInputEvent_getDeviceId(const AInputEvent *event) {
+    return event->keyEvent != nullptr ? event->keyEvent->deviceId
+                                      : event->motionEvent->deviceId;
+}
+
+int32_t AInputEvent_getSource(const AInputEvent *event) {
+    return event->keyEvent != nullptr ? event->keyEvent->source
+                                      : event->motionEvent->source;
+}
+
+int32_t AKeyEvent_getAction(const AInputEvent *event) {
+    return event->keyEvent->action;
+}
+
+int32_t AKeyEvent_getFlags(const AInputEvent *) { return 0; }
+
+int32_t AKeyEvent_getKeyCode(const AInputEvent *event) {
+    return event->keyEvent->keyCode;
+}
+
+int64_t AKeyEvent_getEventTime(const AInputEvent *event) {
+    return event->keyEvent->eventTime;
+}
+
+int32_t AMotionEvent_getAction(const AInputEvent *event) {
+    return event->motionEvent->action;
+}
+
+int32_t AMotionEvent_getFlags(const AInputEvent *) { return 0; }
+
+int32_t AMotionEvent_getButtonState(const AInputEvent *event) {
+    return event->motionEvent->buttonState;
+}
+
+int64_t AMotionEvent_getEventTime(const AInputEvent *event) {
+    return event->motionEvent->eventTime;
+}
+
+float AMotionEvent_getAxisValue(const AInputEvent *event, int32_t axis,
+                                size_t) {
+    if (axis < 0 || axis >= PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
+        return 0.0f;
+    }
+    return event->motionEvent->axisValues[axis];
+}
+
+size_t AMotionEvent_getHistorySize(const AInputEvent *event) {
+    return static_cast<size_t>(event->motionEvent->historySize);
+}
+
+int64_t AMotionEvent_getHistoricalEventTime(const AInputEvent *event,
+                                            size_t historyIndex) {
+    return event->historicalEventTimes[historyIndex];
+}
+
+float AMotionEvent_getHistoricalAxisValue(const AInputEvent *event,
+                                          int32_t axis, size_t,
+                                          size_t historyIndex) {
+    if (axis < 0 || axis >= PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
+        return 0.0f;
+    }
+    return event->historicalAxisValues
+        [historyIndex * PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT + axis];
+}
+
+int __android_log_print(int priority, const char *tag, const char *format,
+                        ...) {
+    if (priority < ANDROID_LOG_WARN) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%s: ", tag);
+    const int result = vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+    return result;
+}
+
+}  // extern "C"
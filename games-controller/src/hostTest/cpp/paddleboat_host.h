@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/input.h>
+#include <jni.h>
+
+#include <cstdarg>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "../../main/cpp/GameControllerInputRecording.h"
+
+// Host stand-ins for the parts of Android that Paddleboat calls, so that its
+// input path can run off the device: the input event accessors of libandroid,
+// the log, and a JNIEnv playing the Java GameControllerManager.
+
+// A key or motion event, viewing the payload of a recorded event
+struct AInputEvent {
+  int32_t type;
+  const paddleboat::InputRecordKeyEvent *keyEvent;
+  const paddleboat::InputRecordMotionEvent *motionEvent;
+  // historySize times and rows of axis values, following motionEvent
+  const int64_t *historicalEventTimes;
+  const float *historicalAxisValues;
+};
+
+// Native methods of the Java GameControllerManager, defined in
+// GameControllerManager.cpp
+extern "C" {
+void Java_com_google_android_games_paddleboat_GameControllerManager_onControllerConnected(
+    JNIEnv *env, jobject gcmObject, jintArray deviceInfoArray,
+    jfloatArray axisMinArray, jfloatArray axisMaxArray,
+    jfloatArray axisFlatArray, jfloatArray axisFuzzArray);
+void Java_com_google_android_games_paddleboat_GameControllerManager_onControllerDisconnected(
+    JNIEnv *env, jobject gcmObject, jint deviceId);
+void Java_com_google_android_games_paddleboat_GameControllerManager_onMotionData(
+    JNIEnv *env, jobject gcmObject, jint deviceId, jint motionType,
+    jlong timestamp, jfloat dataX, jfloat dataY, jfloat dataZ);
+}
+
+namespace paddleboat_host {
+
+// A Java int[] or float[] passed to a native method
+struct HostArray {
+  const void *values;
+  jsize length;
+
+  jintArray asIntArray() const {
+    return reinterpret_cast<jintArray>(const_cast<HostArray *>(this));
+  }
+  jfloatArray asFloatArray() const {
+    return reinterpret_cast<jfloatArray>(const_cast<HostArray *>(this));
+  }
+};
+
+// A JNIEnv whose methods stand in for the Java side of Paddleboat. The Java
+// methods called by Paddleboat report the values set here, and methods which
+// control hardware, like vibration and lights, do nothing. The environment
+// must be the first member, JNI calls find the HostJni from their JNIEnv.
+class HostJni {
+ public:
+  HostJni();
+
+  HostJni(const HostJni &) = delete;
+  HostJni &operator=(const HostJni &) = delete;
+
+  JNIEnv *getEnv() { return &mEnv; }
+
+  // The Android context passed to Paddleboat_init
+  jobject getContext();
+
+  // Name returned by GameControllerManager.getDeviceNameById
+  void setDeviceName(const int32_t deviceId, const char *name) {
+    mDeviceNames[deviceId] = name;
+  }
+
+  void setApiLevel(const int32_t apiLevel) { mApiLevel = apiLevel; }
+
+  void setIntegratedSensorFlags(const int32_t flags) {
+    mIntegratedSensorFlags = flags;
+  }
+
+  // Calls of Java methods made by Paddleboat
+  int64_t getJavaCallCount() const { return mJavaCallCount; }
+
+ private:
+  static HostJni *fromEnv(JNIEnv *env) {
+    return reinterpret_cast<HostJni *>(env);
+  }
+
+  static jclass findClass(JNIEnv *env, const char *name);
+  static jobject newGlobalRef(JNIEnv *env, jobject object);
+  static void deleteRef(JNIEnv *env, jobject object);
+  static jobject newObjectV(JNIEnv *env, jclass clazz, jmethodID methodId,
+                            va_list args);
+  static jclass getObjectClass(JNIEnv *env, jobject object);
+  static jmethodID getMethodId(JNIEnv *env, jclass clazz, const char *name,
+                               const char *signature);
+  static jobject callObjectMethodV(JNIEnv *env, jobject object,
+                                   jmethodID methodId, va_list args);
+  static jint callIntMethodV(JNIEnv *env, jobject object, jmethodID methodId,
+                             va_list args);
+  static jfloat callFloatMethodV(JNIEnv *env, jobject object,
+                                 jmethodID methodId, va_list args);
+  static void callVoidMethodV(JNIEnv *env, jobject object, jmethodID methodId,
+                              va_list args);
+  static jstring newStringUtf(JNIEnv *env, const char *chars);
+  static const char *getStringUtfChars(JNIEnv *env, jstring string,
+                                       jboolean *isCopy);
+  static void releaseStringUtfChars(JNIEnv *env, jstring string,
+                                    const char *chars);
+  static jsize getArrayLength(JNIEnv *env, jarray array);
+  static void getIntArrayRegion(JNIEnv *env, jintArray array, jsize start,
+                                jsize length, jint *buffer);
+  static void getFloatArrayRegion(JNIEnv *env, jfloatArray array, jsize start,
+                                  jsize length, jfloat *buffer);
+  static jint registerNatives(JNIEnv *env, jclass clazz,
+                              const JNINativeMethod *methods, jint count);
+
+  // The name a jmethodID was looked up with
+  static const std::string &methodName(jmethodID methodId) {
+    return *reinterpret_cast<const std::string *>(methodId);
+  }
+
+  JNIEnv mEnv;
+  JNINativeInterface mFunctions;
+  // Method names by name, their addresses are the jmethodID values
+  std::map<std::string, std::string> mMethodNames;
+  std::map<int32_t, std::string> mDeviceNames;
+  int32_t mApiLevel = 33;
+  int32_t mIntegratedSensorFlags = 0;
+  int64_t mJavaCallCount = 0;
+};
+
+// A controller with two sticks, triggers, a hat and motion sensors
+paddleboat::InputRecordControllerConnected syntheticController();
+
+// Connects a controller through the native method the Java
+// GameControllerManager calls when an input device is added
+void connectController(
+    HostJni &hostJni,
+    const paddleboat::InputRecordControllerConnected &connected);
+
+}  // namespace paddleboat_host
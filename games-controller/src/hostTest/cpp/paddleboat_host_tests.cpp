@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Tests of the Paddleboat public API on the host, with HostJni playing the
+// Java GameControllerManager. Unlike the androidTest unit tests, these go
+// through Paddleboat_init and the native methods a device would call.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "paddleboat.h"
+#include "paddleboat_host.h"
+
+using paddleboat::InputRecordControllerConnected;
+using paddleboat::Paddleboat_GameActivityMotionEventV3;
+using paddleboat_host::HostJni;
+
+namespace {
+
+void statusCallback(const int32_t, const Paddleboat_ControllerStatus,
+                    void *) {}
+
+// Sends a GameActivity motion event with every stick axis set to value
+void sendStickEvent(const int32_t deviceId, const int64_t eventTime,
+                    const float value,
+                    Paddleboat_GameActivityMotionEventV3 &event) {
+  memset(&event, 0, sizeof(event));
+  event.deviceId = deviceId;
+  event.source = AINPUT_SOURCE_GAMEPAD | AINPUT_SOURCE_JOYSTICK;
+  event.action = AMOTION_EVENT_ACTION_MOVE;
+  event.eventTime = eventTime;
+  event.pointerCount = 1;
+  float *axisValues = event.pointers[0].axisValues;
+  axisValues[AMOTION_EVENT_AXIS_X] = value;
+  axisValues[AMOTION_EVENT_AXIS_Y] = value;
+  axisValues[AMOTION_EVENT_AXIS_Z] = value;
+  axisValues[AMOTION_EVENT_AXIS_RZ] = value;
+  Paddleboat_processGameActivityMotionInputEvent(&event, sizeof(event));
+}
+
+// The stick axes of a snapshot come from a single event, the mapping may
+// invert some of them
+bool sticksFromOneEvent(const Paddleboat_Controller_Data &data) {
+  const float value = fabsf(data.leftStick.stickX);
+  return fabsf(data.leftStick.stickY) == value &&
+         fabsf(data.rightStick.stickX) == value &&
+         fabsf(data.rightStick.stickY) == value;
+}
+
+class PaddleboatHostControllerData : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(Paddleboat_init(mHostJni.getEnv(), mHostJni.getContext()),
+              PADDLEBOAT_NO_ERROR);
+    // Connections are only processed once a status callback is set
+    Paddleboat_setControllerStatusCallback(statusCallback, nullptr);
+    Paddleboat_update(mHostJni.getEnv());
+    InputRecordControllerConnected controller =
+        paddleboat_host::syntheticController();
+    // Sticks without a flat region, so each event reaches the snapshot
+    memset(controller.axisFlat, 0, sizeof(controller.axisFlat));
+    mDeviceId = controller.info.mDeviceId;
+    paddleboat_host::connectController(mHostJni, controller);
+    Paddleboat_update(mHostJni.getEnv());
+    ASSERT_EQ(Paddleboat_getControllerStatus(0), PADDLEBOAT_CONTROLLER_ACTIVE);
+  }
+
+  void TearDown() override { Paddleboat_destroy(mHostJni.getEnv()); }
+
+  HostJni mHostJni;
+  int32_t mDeviceId = 0;
+  // Too large for the stack
+  std::unique_ptr<Paddleboat_GameActivityMotionEventV3> mEvent{
+      new Paddleboat_GameActivityMotionEventV3()};
+};
+
+// Test a motion event reaches Paddleboat_getControllerData
+TEST_F(PaddleboatHostControllerData, MotionEventPublished) {
+  Paddleboat_Controller_Data data;
+  ASSERT_EQ(Paddleboat_getControllerData(0, &data), PADDLEBOAT_NO_ERROR);
+  const uint64_t connectedTimestamp = data.timestamp;
+
+  sendStickEvent(mDeviceId, 1, 0.5f, *mEvent);
+  ASSERT_EQ(Paddleboat_getControllerData(0, &data), PADDLEBOAT_NO_ERROR);
+  EXPECT_FLOAT_EQ(fabsf(data.leftStick.stickX), 0.5f);
+  EXPECT_TRUE(sticksFromOneEvent(data));
+  EXPECT_GE(data.timestamp, connectedTimestamp);
+  EXPECT_EQ(Paddleboat_getControllerData(1, &data),
+            PADDLEBOAT_ERROR_NO_CONTROLLER);
+}
+
+// Test readers polling Paddleboat_getControllerData while motion events are
+// published from another thread only see whole snapshots, in event order
+TEST_F(PaddleboatHostControllerData, ConcurrentPublishAndRead) {
+  constexpr int32_t EVENT_COUNT = 100000;
+  constexpr int32_t READER_COUNT = 3;
+  // Distinct float values increasing with the event number
+  const auto eventValue = [](const int32_t event) {
+    return static_cast<float>(event + 1) / EVENT_COUNT;
+  };
+
+  std::atomic<bool> publishing{true};
+  std::atomic<int32_t> tornReads{0};
+  std::atomic<int32_t> reorderedReads{0};
+  std::atomic<int64_t> readCount{0};
+  std::vector<std::thread> readers;
+  for (int32_t i = 0; i < READER_COUNT; ++i) {
+    readers.emplace_back([&]() {
+      float lastValue = 0.0f;
+      uint64_t lastTimestamp = 0;
+      int64_t reads = 0;
+      Paddleboat_Controller_Data data;
+      while (publishing.load(std::memory_order_acquire)) {
+        if (Paddleboat_getControllerData(0, &data) != PADDLEBOAT_NO_ERROR) {
+          ++tornReads;
+          continue;
+        }
+        ++reads;
+        if (!sticksFromOneEvent(data)) {
+          ++tornReads;
+        }
+        const float value = fabsf(data.leftStick.stickX);
+        if (value < lastValue || data.timestamp < lastTimestamp) {
+          ++reorderedReads;
+        }
+        lastValue = value;
+        lastTimestamp = data.timestamp;
+      }
+      readCount += reads;
+    });
+  }
+
+  for (int32_t event = 0; event < EVENT_COUNT; ++event) {
+    sendStickEvent(mDeviceId, event, eventValue(event), *mEvent);
+  }
+  publishing.store(false, std::memory_order_release);
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+
+  EXPECT_EQ(tornReads.load(), 0);
+  EXPECT_EQ(reorderedReads.load(), 0);
+  EXPECT_GT(readCount.load(), 0);
+  Paddleboat_Controller_Data data;
+  ASSERT_EQ(Paddleboat_getControllerData(0, &data), PADDLEBOAT_NO_ERROR);
+  EXPECT_EQ(fabsf(data.leftStick.stickX), eventValue(EVENT_COUNT - 1));
+  EXPECT_TRUE(sticksFromOneEvent(data));
+}
+
+}  // namespace
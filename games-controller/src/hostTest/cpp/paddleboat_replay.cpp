@@ -0,0 +1,564 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// paddleboat_replay feeds an input recording, made with
+// Paddleboat_startInputRecording, back to the entry points it was captured
+// from, and reports the time Paddleboat spent in each of them along with the
+// final state of the controllers. This allows measuring input latency and
+// throughput, and checking that changes to the input path leave the
+// controller state unchanged, without a device.
+//
+//   paddleboat_replay [--repeat N] [--buffer-motion] recording
+//   paddleboat_replay --generate recording [--seconds S]
+//
+// --generate writes a recording of a synthetic session: a controller with
+// motion sensors is connected, moved and pressed at 60 frames per second,
+// through both the AInputEvent and GameActivity entry points.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "paddleboat.h"
+#include "paddleboat_host.h"
+
+using paddleboat::InputRecordControllerConnected;
+using paddleboat::InputRecordHeader;
+using paddleboat::InputRecordingHeader;
+using paddleboat::InputRecordKeyEvent;
+using paddleboat::InputRecordMotionData;
+using paddleboat::InputRecordMotionEvent;
+using paddleboat::Paddleboat_GameActivityKeyEvent;
+using paddleboat::Paddleboat_GameActivityMotionEventV3;
+using paddleboat_host::connectController;
+using paddleboat_host::HostJni;
+using paddleboat_host::syntheticController;
+
+namespace {
+
+constexpr int32_t AXIS_COUNT = PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+constexpr int64_t NANOSECONDS_PER_MILLISECOND = 1000000;
+constexpr size_t RECORD_TYPE_COUNT = paddleboat::INPUT_RECORD_UPDATE + 1;
+constexpr const char *RECORD_TYPE_NAMES[RECORD_TYPE_COUNT] = {
+    "", "connect", "disconnect", "key", "motion", "motion data", "update"};
+
+struct Record {
+  uint32_t type;
+  uint32_t payloadSize;
+  int64_t captureTime;
+  const uint8_t *payload;
+};
+
+struct Recording {
+  // uint64_t elements keep the payloads aligned for their structs
+  std::vector<uint64_t> storage;
+  std::vector<Record> records;
+};
+
+struct ReplayState {
+  int32_t statusChanges = 0;
+  int64_t motionDataSamples = 0;
+};
+
+struct ReplayOptions {
+  int32_t repeatCount = 1;
+  bool bufferMotionData = false;
+};
+
+// Durations of the calls made for each record type, in nanoseconds
+struct ReplayTimes {
+  std::vector<int64_t> durations[RECORD_TYPE_COUNT];
+  int64_t totalDuration = 0;
+};
+
+int64_t elapsedNanos(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+size_t motionEventPayloadSize(const InputRecordMotionEvent &motionEvent) {
+  return sizeof(InputRecordMotionEvent) +
+         static_cast<size_t>(motionEvent.historySize) *
+             (sizeof(int64_t) + sizeof(float) * AXIS_COUNT);
+}
+
+bool isValidRecord(const Record &record) {
+  switch (record.type) {
+    case paddleboat::INPUT_RECORD_CONTROLLER_CONNECTED:
+      return record.payloadSize == sizeof(InputRecordControllerConnected);
+    case paddleboat::INPUT_RECORD_CONTROLLER_DISCONNECTED:
+      return record.payloadSize == sizeof(int32_t);
+    case paddleboat::INPUT_RECORD_KEY_EVENT:
+      return record.payloadSize == sizeof(InputRecordKeyEvent);
+    case paddleboat::INPUT_RECORD_MOTION_EVENT: {
+      if (record.payloadSize < sizeof(InputRecordMotionEvent)) {
+        return false;
+      }
+      const InputRecordMotionEvent *motionEvent =
+          reinterpret_cast<const InputRecordMotionEvent *>(record.payload);
+      return motionEvent->historySize >= 0 &&
+             record.payloadSize == motionEventPayloadSize(*motionEvent);
+    }
+    case paddleboat::INPUT_RECORD_MOTION_DATA:
+      return record.payloadSize == sizeof(InputRecordMotionData);
+    case paddleboat::INPUT_RECORD_UPDATE:
+      return record.payloadSize == 0;
+    default:
+      return false;
+  }
+}
+
+bool readRecording(const char *path, Recording &recording) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "Failed to open %s\n", path);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  const size_t fileSize = static_cast<size_t>(ftell(file));
+  fseek(file, 0, SEEK_SET);
+  recording.storage.resize((fileSize + sizeof(uint64_t) - 1) /
+                           sizeof(uint64_t));
+  const size_t readSize = fread(recording.storage.data(), 1, fileSize, file);
+  fclose(file);
+  if (readSize != fileSize) {
+    fprintf(stderr, "Failed to read %s\n", path);
+    return false;
+  }
+
+  const uint8_t *data =
+      reinterpret_cast<const uint8_t *>(recording.storage.data());
+  InputRecordingHeader header;
+  if (fileSize < sizeof(header)) {
+    fprintf(stderr, "%s is not an input recording\n", path);
+    return false;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != paddleboat::INPUT_RECORDING_MAGIC ||
+      header.version != paddleboat::INPUT_RECORDING_VERSION) {
+    fprintf(stderr, "%s is not a version %u input recording\n", path,
+            paddleboat::INPUT_RECORDING_VERSION);
+    return false;
+  }
+
+  size_t offset = sizeof(header);
+  while (offset < fileSize) {
+    if (fileSize - offset < sizeof(InputRecordHeader)) {
+      fprintf(stderr, "Truncated record at offset %zu\n", offset);
+      return false;
+    }
+    const InputRecordHeader *recordHeader =
+        reinterpret_cast<const InputRecordHeader *>(data + offset);
+    offset += sizeof(InputRecordHeader);
+    if (fileSize - offset < recordHeader->payloadSize) {
+      fprintf(stderr, "Truncated record at offset %zu\n", offset);
+      return false;
+    }
+    const Record record = {recordHeader->type, recordHeader->payloadSize,
+                           recordHeader->captureTime, data + offset};
+    if (!isValidRecord(record)) {
+      fprintf(stderr, "Invalid record of type %u at offset %zu\n",
+              record.type, offset);
+      return false;
+    }
+    recording.records.push_back(record);
+    const size_t alignment = paddleboat::INPUT_RECORD_ALIGNMENT;
+    offset += (record.payloadSize + alignment - 1) / alignment * alignment;
+  }
+  return true;
+}
+
+void statusCallback(const int32_t, const Paddleboat_ControllerStatus,
+                    void *userData) {
+  ++static_cast<ReplayState *>(userData)->statusChanges;
+}
+
+void motionDataCallback(const int32_t, const Paddleboat_Motion_Data *,
+                        void *userData) {
+  ++static_cast<ReplayState *>(userData)->motionDataSamples;
+}
+
+void drainMotionData(ReplayState &state) {
+  Paddleboat_Motion_Data samples[PADDLEBOAT_MOTION_DATA_BUFFER_SIZE];
+  for (int32_t i = 0; i <= PADDLEBOAT_MAX_CONTROLLERS; ++i) {
+    const int32_t controllerIndex =
+        (i < PADDLEBOAT_MAX_CONTROLLERS) ? i
+                                         : PADDLEBOAT_INTEGRATED_SENSOR_INDEX;
+    int32_t sampleCount = 0;
+    if (Paddleboat_getMotionData(controllerIndex,
+                                 PADDLEBOAT_MOTION_DATA_BUFFER_SIZE, samples,
+                                 &sampleCount) == PADDLEBOAT_NO_ERROR) {
+      state.motionDataSamples += sampleCount;
+    }
+  }
+}
+
+void processKeyEvent(const InputRecordKeyEvent &keyEvent) {
+  if ((keyEvent.flags & paddleboat::INPUT_RECORD_FLAG_GAME_ACTIVITY) != 0) {
+    Paddleboat_GameActivityKeyEvent gameActivityEvent;
+    memset(&gameActivityEvent, 0, sizeof(gameActivityEvent));
+    gameActivityEvent.deviceId = keyEvent.deviceId;
+    gameActivityEvent.source = keyEvent.source;
+    gameActivityEvent.action = keyEvent.action;
+    gameActivityEvent.eventTime = keyEvent.eventTime;
+    gameActivityEvent.keyCode = keyEvent.keyCode;
+    Paddleboat_processGameActivityKeyInputEvent(&gameActivityEvent,
+                                                sizeof(gameActivityEvent));
+  } else {
+    const AInputEvent event = {AINPUT_EVENT_TYPE_KEY, &keyEvent, nullptr,
+                               nullptr, nullptr};
+    Paddleboat_processInputEvent(&event);
+  }
+}
+
+void processMotionEvent(const InputRecordMotionEvent &motionEvent) {
+  const int64_t *eventTimes =
+      reinterpret_cast<const int64_t *>(&motionEvent + 1);
+  const float *axisValues =
+      reinterpret_cast<const float *>(eventTimes + motionEvent.historySize);
+  if ((motionEvent.flags & paddleboat::INPUT_RECORD_FLAG_GAME_ACTIVITY) != 0) {
+    // Too large for the stack of a replay loop
+    static Paddleboat_GameActivityMotionEventV3 gameActivityEvent;
+    memset(&gameActivityEvent, 0, sizeof(gameActivityEvent));
+    gameActivityEvent.deviceId = motionEvent.deviceId;
+    gameActivityEvent.source = motionEvent.source;
+    gameActivityEvent.action = motionEvent.action;
+    gameActivityEvent.eventTime =
+        motionEvent.eventTime / NANOSECONDS_PER_MILLISECOND;
+    gameActivityEvent.buttonState = motionEvent.buttonState;
+    gameActivityEvent.pointerCount = 1;
+    memcpy(gameActivityEvent.pointers[0].axisValues, motionEvent.axisValues,
+           sizeof(motionEvent.axisValues));
+    gameActivityEvent.historySize = motionEvent.historySize;
+    gameActivityEvent.historicalEventTimesNanos =
+        const_cast<int64_t *>(eventTimes);
+    gameActivityEvent.historicalAxisValues = const_cast<float *>(axisValues);
+    Paddleboat_processGameActivityMotionInputEvent(&gameActivityEvent,
+                                                   sizeof(gameActivityEvent));
+  } else {
+    const AInputEvent event = {AINPUT_EVENT_TYPE_MOTION, nullptr, &motionEvent,
+                               eventTimes, axisValues};
+    Paddleboat_processInputEvent(&event);
+  }
+}
+
+void replayRecord(HostJni &hostJni, const Record &record,
+                  const ReplayOptions &options, ReplayState &state) {
+  JNIEnv *env = hostJni.getEnv();
+  switch (record.type) {
+    case paddleboat::INPUT_RECORD_CONTROLLER_CONNECTED:
+      connectController(hostJni,
+                        *reinterpret_cast<const InputRecordControllerConnected *>(
+                            record.payload));
+      break;
+    case paddleboat::INPUT_RECORD_CONTROLLER_DISCONNECTED: {
+      int32_t deviceId;
+      memcpy(&deviceId, record.payload, sizeof(deviceId));
+      Java_com_google_android_games_paddleboat_GameControllerManager_onControllerDisconnected(
+          env, nullptr, deviceId);
+      break;
+    }
+    case paddleboat::INPUT_RECORD_KEY_EVENT:
+      processKeyEvent(
+          *reinterpret_cast<const InputRecordKeyEvent *>(record.payload));
+      break;
+    case paddleboat::INPUT_RECORD_MOTION_EVENT:
+      processMotionEvent(
+          *reinterpret_cast<const InputRecordMotionEvent *>(record.payload));
+      break;
+    case paddleboat::INPUT_RECORD_MOTION_DATA: {
+      const InputRecordMotionData *motionData =
+          reinterpret_cast<const InputRecordMotionData *>(record.payload);
+      Java_com_google_android_games_paddleboat_GameControllerManager_onMotionData(
+          env, nullptr, motionData->deviceId, motionData->motionType,
+          static_cast<jlong>(motionData->timestamp), motionData->motionX,
+          motionData->motionY, motionData->motionZ);
+      break;
+    }
+    case paddleboat::INPUT_RECORD_UPDATE:
+      Paddleboat_update(env);
+      if (options.bufferMotionData) {
+        drainMotionData(state);
+      }
+      break;
+  }
+}
+
+bool initPaddleboat(HostJni &hostJni, const ReplayOptions &options,
+                    ReplayState &state) {
+  if (Paddleboat_init(hostJni.getEnv(), hostJni.getContext()) !=
+      PADDLEBOAT_NO_ERROR) {
+    fprintf(stderr, "Paddleboat_init failed\n");
+    return false;
+  }
+  // Connections are only processed once a status callback is set
+  Paddleboat_setControllerStatusCallback(statusCallback, &state);
+  if (options.bufferMotionData) {
+    Paddleboat_setMotionDataBufferingEnabled(
+        true, PADDLEBOAT_INTEGRATED_SENSOR_NONE, nullptr);
+  } else {
+    Paddleboat_setMotionDataCallback(motionDataCallback, &state);
+  }
+  return true;
+}
+
+bool replay(HostJni &hostJni, const Recording &recording,
+            const ReplayOptions &options, ReplayState &state,
+            ReplayTimes &times) {
+  if (!initPaddleboat(hostJni, options, state)) {
+    return false;
+  }
+  const auto replayStart = std::chrono::steady_clock::now();
+  for (const Record &record : recording.records) {
+    const auto callStart = std::chrono::steady_clock::now();
+    replayRecord(hostJni, record, options, state);
+    times.durations[record.type].push_back(elapsedNanos(callStart));
+  }
+  times.totalDuration += elapsedNanos(replayStart);
+  return true;
+}
+
+void printTimes(ReplayTimes &times, const Recording &recording) {
+  printf("%-12s %9s %10s %10s %10s %10s\n", "record", "count", "mean us",
+         "p50 us", "p99 us", "max us");
+  size_t callCount = 0;
+  for (size_t type = 1; type < RECORD_TYPE_COUNT; ++type) {
+    std::vector<int64_t> &durations = times.durations[type];
+    if (durations.empty()) {
+      continue;
+    }
+    callCount += durations.size();
+    std::sort(durations.begin(), durations.end());
+    int64_t sum = 0;
+    for (const int64_t duration : durations) {
+      sum += duration;
+    }
+    const auto percentile = [&durations](const size_t percent) {
+      return durations[(durations.size() - 1) * percent / 100] / 1000.0;
+    };
+    printf("%-12s %9zu %10.3f %10.3f %10.3f %10.3f\n", RECORD_TYPE_NAMES[type],
+           durations.size(), sum / 1000.0 / durations.size(), percentile(50),
+           percentile(99), durations.back() / 1000.0);
+  }
+  printf("%zu calls in %.3f ms, %.0f calls per second\n", callCount,
+         times.totalDuration / 1.0e6,
+         callCount / (times.totalDuration / 1.0e9));
+  if (!recording.records.empty()) {
+    const int64_t recordedDuration = recording.records.back().captureTime -
+                                     recording.records.front().captureTime;
+    printf("Recorded session: %.3f ms\n", recordedDuration / 1.0e6);
+  }
+}
+
+void printControllers() {
+  for (int32_t i = 0; i < PADDLEBOAT_MAX_CONTROLLERS; ++i) {
+    const Paddleboat_ControllerStatus status =
+        Paddleboat_getControllerStatus(i);
+    if (status == PADDLEBOAT_CONTROLLER_INACTIVE) {
+      continue;
+    }
+    char name[paddleboat::DEVICEINFO_MAX_NAME_LENGTH] = {};
+    Paddleboat_getControllerName(i, sizeof(name), name);
+    Paddleboat_Controller_Data data;
+    memset(&data, 0, sizeof(data));
+    Paddleboat_getControllerData(i, &data);
+    printf(
+        "Controller %d: status %d, %s, buttons 0x%08x, left (%.4f, %.4f), "
+        "right (%.4f, %.4f), triggers L1 %.4f L2 %.4f R1 %.4f R2 %.4f\n",
+        i, status, name, data.buttonsDown, data.leftStick.stickX,
+        data.leftStick.stickY, data.rightStick.stickX, data.rightStick.stickY,
+        data.triggerL1, data.triggerL2, data.triggerR1, data.triggerR2);
+  }
+}
+
+int runReplay(const char *path, const ReplayOptions &options) {
+  Recording recording;
+  if (!readRecording(path, recording)) {
+    return EXIT_FAILURE;
+  }
+  HostJni hostJni;
+  ReplayState state;
+  ReplayTimes times;
+  for (int32_t i = 0; i < options.repeatCount; ++i) {
+    if (i > 0) {
+      Paddleboat_destroy(hostJni.getEnv());
+    }
+    if (!replay(hostJni, recording, options, state, times)) {
+      return EXIT_FAILURE;
+    }
+  }
+  printf("Replayed %zu records %d times from %s\n", recording.records.size(),
+         options.repeatCount, path);
+  printTimes(times, recording);
+  printf("%d status changes, %lld motion data samples, %lld Java calls\n",
+         state.statusChanges, static_cast<long long>(state.motionDataSamples),
+         static_cast<long long>(hostJni.getJavaCallCount()));
+  printControllers();
+  Paddleboat_destroy(hostJni.getEnv());
+  return EXIT_SUCCESS;
+}
+
+void syntheticAxisValues(const int64_t time, float *axisValues) {
+  const float seconds = time / 1.0e9f;
+  memset(axisValues, 0, sizeof(float) * AXIS_COUNT);
+  axisValues[AMOTION_EVENT_AXIS_X] = sinf(seconds * 3.0f);
+  axisValues[AMOTION_EVENT_AXIS_Y] = cosf(seconds * 3.0f);
+  axisValues[AMOTION_EVENT_AXIS_Z] = sinf(seconds * 5.0f);
+  axisValues[AMOTION_EVENT_AXIS_RZ] = cosf(seconds * 5.0f);
+  axisValues[AMOTION_EVENT_AXIS_LTRIGGER] = 0.5f + 0.5f * sinf(seconds);
+  axisValues[AMOTION_EVENT_AXIS_RTRIGGER] = 0.5f + 0.5f * cosf(seconds);
+}
+
+int runGenerate(const char *path, const int32_t seconds) {
+  constexpr int32_t FRAMES_PER_SECOND = 60;
+  constexpr int64_t FRAME_NANOS = 1000000000 / FRAMES_PER_SECOND;
+  constexpr int32_t HISTORY_SIZE = 3;
+  constexpr int32_t MOTION_DATA_PER_FRAME = 4;
+  constexpr int32_t SOURCE = AINPUT_SOURCE_GAMEPAD | AINPUT_SOURCE_JOYSTICK;
+
+  const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Failed to create %s\n", path);
+    return EXIT_FAILURE;
+  }
+  HostJni hostJni;
+  ReplayState state;
+  JNIEnv *env = hostJni.getEnv();
+  if (!initPaddleboat(hostJni, ReplayOptions(), state) ||
+      Paddleboat_startInputRecording(fd) != PADDLEBOAT_NO_ERROR) {
+    close(fd);
+    return EXIT_FAILURE;
+  }
+  const InputRecordControllerConnected controller = syntheticController();
+  const int32_t deviceId = controller.info.mDeviceId;
+  Paddleboat_update(env);
+  connectController(hostJni, controller);
+  Paddleboat_update(env);
+
+  InputRecordMotionEvent motionEvent;
+  int64_t historyTimes[HISTORY_SIZE];
+  float historyValues[HISTORY_SIZE * AXIS_COUNT];
+  const int32_t frameCount = seconds * FRAMES_PER_SECOND;
+  for (int32_t frame = 0; frame < frameCount; ++frame) {
+    const int64_t frameTime = frame * FRAME_NANOS;
+    for (int32_t i = 0; i < MOTION_DATA_PER_FRAME; ++i) {
+      const int64_t sampleTime =
+          frameTime + i * (FRAME_NANOS / MOTION_DATA_PER_FRAME);
+      const float t = sampleTime / 1.0e9f;
+      Java_com_google_android_games_paddleboat_GameControllerManager_onMotionData(
+          env, nullptr, deviceId, i & 1, sampleTime, sinf(t), cosf(t), 9.8f);
+    }
+
+    // Alternate between the AInputEvent and GameActivity entry points
+    memset(&motionEvent, 0, sizeof(motionEvent));
+    motionEvent.eventTime = frameTime;
+    motionEvent.deviceId = deviceId;
+    motionEvent.source = SOURCE;
+    motionEvent.action = AMOTION_EVENT_ACTION_MOVE;
+    motionEvent.historySize = HISTORY_SIZE;
+    for (int32_t i = 0; i < HISTORY_SIZE; ++i) {
+      historyTimes[i] = frameTime - (HISTORY_SIZE - i) * FRAME_NANOS /
+                                        (HISTORY_SIZE + 1);
+      syntheticAxisValues(historyTimes[i], historyValues + i * AXIS_COUNT);
+    }
+    syntheticAxisValues(frameTime, motionEvent.axisValues);
+    InputRecordKeyEvent keyEvent = {frameTime, 0, deviceId, SOURCE,
+                                    AKEY_EVENT_ACTION_DOWN, AKEYCODE_BUTTON_A};
+    keyEvent.action = ((frame / 15) & 1) ? AKEY_EVENT_ACTION_DOWN
+                                         : AKEY_EVENT_ACTION_UP;
+    if ((frame & 1) == 0) {
+      keyEvent.flags = paddleboat::INPUT_RECORD_FLAG_GAME_ACTIVITY;
+      motionEvent.flags = paddleboat::INPUT_RECORD_FLAG_GAME_ACTIVITY;
+      static Paddleboat_GameActivityMotionEventV3 gameActivityEvent;
+      memset(&gameActivityEvent, 0, sizeof(gameActivityEvent));
+      gameActivityEvent.deviceId = deviceId;
+      gameActivityEvent.source = SOURCE;
+      gameActivityEvent.action = AMOTION_EVENT_ACTION_MOVE;
+      gameActivityEvent.eventTime = frameTime / NANOSECONDS_PER_MILLISECOND;
+      gameActivityEvent.pointerCount = 1;
+      memcpy(gameActivityEvent.pointers[0].axisValues, motionEvent.axisValues,
+             sizeof(motionEvent.axisValues));
+      gameActivityEvent.historySize = HISTORY_SIZE;
+      gameActivityEvent.historicalEventTimesNanos = historyTimes;
+      gameActivityEvent.historicalAxisValues = historyValues;
+      Paddleboat_processGameActivityMotionInputEvent(
+          &gameActivityEvent, sizeof(gameActivityEvent));
+    } else {
+      const AInputEvent event = {AINPUT_EVENT_TYPE_MOTION, nullptr,
+                                 &motionEvent, historyTimes, historyValues};
+      Paddleboat_processInputEvent(&event);
+    }
+    if ((frame % 15) == 0) {
+      processKeyEvent(keyEvent);
+    }
+    Paddleboat_update(env);
+  }
+
+  // The controller stays connected, so its final state is replayed
+  const Paddleboat_ErrorCode result = Paddleboat_stopInputRecording();
+  Paddleboat_destroy(env);
+  close(fd);
+  if (result != PADDLEBOAT_NO_ERROR) {
+    fprintf(stderr, "Failed to write %s\n", path);
+    return EXIT_FAILURE;
+  }
+  printf("Wrote %d frames of synthetic input to %s\n", frameCount, path);
+  return EXIT_SUCCESS;
+}
+
+int usage() {
+  fprintf(stderr,
+          "usage: paddleboat_replay [--repeat N] [--buffer-motion] "
+          "recording\n"
+          "       paddleboat_replay --generate recording [--seconds S]\n");
+  return EXIT_FAILURE;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ReplayOptions options;
+  const char *path = nullptr;
+  bool generate = false;
+  int32_t seconds = 10;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      options.repeatCount = std::max(1, atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--buffer-motion") == 0) {
+      options.bufferMotionData = true;
+    } else if (strcmp(argv[i], "--generate") == 0) {
+      generate = true;
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = std::max(1, atoi(argv[++i]));
+    } else if (argv[i][0] != '-' && path == nullptr) {
+      path = argv[i];
+    } else {
+      return usage();
+    }
+  }
+  if (path == nullptr) {
+    return usage();
+  }
+  return generate ? runGenerate(path, seconds) : runReplay(path, options);
+}
@@ -58,6 +58,13 @@ const ControllerButtonMap defaultButtonMap = {{
 // Axis must be at least this value to trigger a mapped button press
 constexpr float AXIS_BUTTON_THRESHOLD = 0.1f;
 
+// Four lanes of the axis transform, which the compiler maps to NEON or SSE
+// registers where available
+typedef float AxisLanes __attribute__((vector_size(16)));
+typedef int32_t AxisLaneMasks __attribute__((vector_size(16)));
+constexpr int32_t AXIS_LANES_PER_VECTOR =
+    static_cast<int32_t>(sizeof(AxisLanes) / sizeof(float));
+
 void resetData(Paddleboat_Controller_Data &pbData) {
     pbData.timestamp = 0;
     pbData.buttonsDown = 0;
@@ -97,12 +104,53 @@ GameController::GameController()
       mDeviceInfo(),
       mControllerDataDirty(true) {
     memset(mButtonKeycodes, 0, sizeof(mButtonKeycodes));
+    updateAxisTransform();
     resetControllerData();
 }
 
 void GameController::resetControllerData() {
     resetData(mControllerData);
     resetInfo(mControllerInfo);
+    publishControllerData();
+    if (mHistoryStorage) {
+        mHistoryStorage->restart();
+    }
+}
+
+void GameController::setHistoryRecording(const bool recording) {
+    if (recording && !mHistoryStorage) {
+        mHistoryStorage = std::make_unique<GameControllerHistory>();
+        mHistory.store(mHistoryStorage.get(), std::memory_order_release);
+    }
+    mHistoryRecording = recording;
+}
+
+int32_t GameController::drainHistory(
+    const int32_t maxEntries, Paddleboat_Controller_History_Entry *entries) {
+    GameControllerHistory *history = mHistory.load(std::memory_order_acquire);
+    if (history == nullptr) {
+        return -1;
+    }
+    return history->drain(maxEntries, entries);
+}
+
+void GameController::recordHistory(const uint64_t timestamp,
+                                   const uint32_t flags) {
+    if (!mHistoryRecording) {
+        return;
+    }
+    Paddleboat_Controller_History_Entry entry;
+    entry.timestamp = timestamp;
+    entry.buttonsDown = mControllerData.buttonsDown;
+    entry.buttonsChanged = 0;
+    entry.leftStick = mControllerData.leftStick;
+    entry.rightStick = mControllerData.rightStick;
+    entry.triggerL1 = mControllerData.triggerL1;
+    entry.triggerL2 = mControllerData.triggerL2;
+    entry.triggerR1 = mControllerData.triggerR1;
+    entry.triggerR2 = mControllerData.triggerR2;
+    entry.flags = flags;
+    mHistoryStorage->record(entry);
 }
 
 void GameController::setupController(
@@ -245,6 +293,61 @@ void GameController::adjustAxisConstants() {
                 fabs(mAxisInfo[GAMECONTROLLER_AXIS_RSTICK_Y].axisMultiplier);
         }
     }
+
+    updateAxisTransform();
+}
+
+void GameController::updateAxisTransform() {
+    static_assert(AXIS_LANE_COUNT >= GAMECONTROLLER_AXIS_COUNT &&
+                      AXIS_LANE_COUNT % AXIS_LANES_PER_VECTOR == 0,
+                  "Axis lanes must cover every axis with whole vectors");
+    // Unmapped lanes read a value that is valid in every sample, which is then
+    // discarded, so that the gather doesn't need to test each lane
+    int32_t unmappedIndex = -1;
+    for (int32_t axis = 0; axis < GAMECONTROLLER_AXIS_COUNT; ++axis) {
+        const int32_t axisIndex = mAxisInfo[axis].axisIndex;
+        const bool mapped =
+            axisIndex >= 0 &&
+            axisIndex < PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+        if (mapped && unmappedIndex < 0) {
+            unmappedIndex = axisIndex;
+        }
+    }
+    mAxisTransformActive = (unmappedIndex >= 0);
+
+    for (int32_t lane = 0; lane < AXIS_LANE_COUNT; ++lane) {
+        mAxisLaneIndex[lane] = mAxisTransformActive ? unmappedIndex : 0;
+        mAxisLaneScale[lane] = 0.0f;
+        mAxisLaneOffset[lane] = 0.0f;
+        mAxisLaneMapped[lane] = 0;
+        mAxisLaneButtonMask[lane] = 0;
+        mAxisLaneButtonNegativeMask[lane] = 0;
+        if (lane >= GAMECONTROLLER_AXIS_COUNT) {
+            continue;
+        }
+        const GameControllerAxisInfo &axisInfo = mAxisInfo[lane];
+        if (axisInfo.axisIndex < 0 ||
+            axisInfo.axisIndex >=
+                PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
+            continue;
+        }
+        // Fold the adjustment and the inversion into a single multiply-add:
+        // -(v * m + a) == v * -m + -a
+        const bool applyAdjustments =
+            ((axisInfo.axisFlags &
+              GAMECONTROLLER_AXIS_FLAG_APPLY_ADJUSTMENTS) != 0);
+        const float sign = axisInfo.axisInvert ? -1.0f : 1.0f;
+        mAxisLaneIndex[lane] = axisInfo.axisIndex;
+        mAxisLaneScale[lane] =
+            sign * (applyAdjustments ? axisInfo.axisMultiplier : 1.0f);
+        mAxisLaneOffset[lane] =
+            sign * (applyAdjustments ? axisInfo.axisAdjust : 0.0f);
+        mAxisLaneMapped[lane] = -1;
+        mAxisLaneButtonMask[lane] =
+            static_cast<int32_t>(axisInfo.axisButtonMask);
+        mAxisLaneButtonNegativeMask[lane] =
+            static_cast<int32_t>(axisInfo.axisButtonNegativeMask);
+    }
 }
 
 void GameController::setupAxis(const GameControllerAxis gcAxis,
@@ -316,21 +419,44 @@ void GameController::setupAxis(const GameControllerAxis gcAxis,
 
 int32_t GameController::processGameActivityKeyEvent(
     const Paddleboat_GameActivityKeyEvent *event, const size_t eventSize) {
-    return processKeyEventInternal(event->keyCode, event->action);
+    // GameActivity key event times are in nanoseconds
+    return processKeyEventInternal(
+        event->keyCode, event->action,
+        static_cast<uint64_t>(event->eventTime / NANOSECONDS_PER_MICROSECOND));
 }
 
-int32_t GameController::processGameActivityMotionEvent(const float *axisValues) {
-    return processMotionEventInternal(axisValues, nullptr);
+int32_t GameController::processGameActivityMotionEvent(
+    const float *axisValues, const int64_t eventTime,
+    const GameActivityMotionHistory *history) {
+    if (mHistoryRecording && history != nullptr) {
+        for (int32_t i = 0; i < history->historySize; ++i) {
+            const int64_t sampleTime =
+                history->eventTimesNanos != nullptr
+                    ? history->eventTimesNanos[i] / NANOSECONDS_PER_MICROSECOND
+                    : static_cast<int64_t>(history->eventTimesMillis[i]) *
+                          MICROSECONDS_PER_MILLISECOND;
+            processHistoricalSample(
+                history->axisValues + (i * history->sampleStride),
+                static_cast<uint64_t>(sampleTime));
+        }
+    }
+    return processMotionEventInternal(
+        axisValues,
+        static_cast<uint64_t>(eventTime * MICROSECONDS_PER_MILLISECOND));
 }
 
 int32_t GameController::processKeyEvent(const AInputEvent *event) {
     const int32_t eventKeyCode = AKeyEvent_getKeyCode(event);
     const int32_t eventKeyAction = AKeyEvent_getAction(event);
-    return processKeyEventInternal(eventKeyCode, eventKeyAction);
+    const int64_t eventTime = AKeyEvent_getEventTime(event);
+    return processKeyEventInternal(
+        eventKeyCode, eventKeyAction,
+        static_cast<uint64_t>(eventTime / NANOSECONDS_PER_MICROSECOND));
 }
 
 int32_t GameController::processKeyEventInternal(const int32_t eventKeyCode,
-                                                const int32_t eventKeyAction) {
+                                                const int32_t eventKeyAction,
+                                                const uint64_t timestamp) {
     int32_t handledEvent = IGNORED_EVENT;
     int32_t buttonMask = 0;
     const bool bDown = (eventKeyAction == AKEY_EVENT_ACTION_DOWN);
@@ -374,82 +500,141 @@ int32_t GameController::processKeyEventInternal(const int32_t eventKeyCode,
     if (buttonMask != 0) {
         if (bDown) {
             mControllerData.buttonsDown |= buttonMask;
-            setControllerDataDirty(true);
         } else {
             mControllerData.buttonsDown &= (~buttonMask);
-            setControllerDataDirty(true);
         }
+        recordHistory(timestamp, 0);
+        setControllerDataDirty(true);
         handledEvent = HANDLED_EVENT;
     }
     return handledEvent;
 }
 
 int32_t GameController::processMotionEvent(const AInputEvent *event) {
-    return processMotionEventInternal(nullptr, event);
-}
-
-int32_t GameController::processMotionEventInternal(const float *axisArray,
-                                                   const AInputEvent *event) {
-    int32_t handledEvent = IGNORED_EVENT;
-
+    // Gather the mapped axis of each sample into an array indexed by native
+    // axis id, like the GameActivity axis values
+    float axisValues[MAX_AXIS_COUNT];
+    if (mHistoryRecording) {
+        const size_t historySize = AMotionEvent_getHistorySize(event);
+        for (size_t i = 0; i < historySize; ++i) {
+            for (uint32_t axis = GAMECONTROLLER_AXIS_LSTICK_X;
+                 axis < GAMECONTROLLER_AXIS_COUNT; ++axis) {
+                const int32_t axisIndex = mAxisInfo[axis].axisIndex;
+                if (axisIndex >= 0 &&
+                    static_cast<size_t>(axisIndex) < MAX_AXIS_COUNT) {
+                    axisValues[axisIndex] = AMotionEvent_getHistoricalAxisValue(
+                        event, axisIndex, 0, i);
+                }
+            }
+            const int64_t sampleTime =
+                AMotionEvent_getHistoricalEventTime(event, i);
+            processHistoricalSample(
+                axisValues, static_cast<uint64_t>(
+                                sampleTime / NANOSECONDS_PER_MICROSECOND));
+        }
+    }
     for (uint32_t axis = GAMECONTROLLER_AXIS_LSTICK_X;
          axis < GAMECONTROLLER_AXIS_COUNT; ++axis) {
-        if (mAxisInfo[axis].axisIndex >= 0 &&
-            mAxisInfo[axis].axisIndex <
-                PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT) {
-            float axisValue = 0.0f;
-            if (axisArray != nullptr) {
-                axisValue = axisArray[mAxisInfo[axis].axisIndex];
-            } else if (event != nullptr) {
-                axisValue = AMotionEvent_getAxisValue(
-                    event, mAxisInfo[axis].axisIndex, 0);
-            }
-            if ((mAxisInfo[axis].axisFlags &
-                 GAMECONTROLLER_AXIS_FLAG_APPLY_ADJUSTMENTS) != 0) {
-                axisValue = ((axisValue * mAxisInfo[axis].axisMultiplier) +
-                             mAxisInfo[axis].axisAdjust);
-            }
-            if (mAxisInfo[axis].axisInvert) {
-                axisValue = -axisValue;
-            }
+        const int32_t axisIndex = mAxisInfo[axis].axisIndex;
+        if (axisIndex >= 0 &&
+            static_cast<size_t>(axisIndex) < MAX_AXIS_COUNT) {
+            axisValues[axisIndex] =
+                AMotionEvent_getAxisValue(event, axisIndex, 0);
+        }
+    }
+    const int64_t eventTime = AMotionEvent_getEventTime(event);
+    return processMotionEventInternal(
+        axisValues,
+        static_cast<uint64_t>(eventTime / NANOSECONDS_PER_MICROSECOND));
+}
 
-            // We take advantage of the GameControllerAxis matching the axis
-            // order in the Paddleboat_Controller_Data struct to use the current
-            // axis as an index into the axis entries in the
-            // Paddleboat_Controller_Data struct
-            if (axis < GAMECONTROLLER_AXIS_HAT_X) {
-                float *axisData = &mControllerData.leftStick.stickX;
-                axisData[axis] = axisValue;
-            }
+int32_t GameController::processMotionEventInternal(const float *axisValues,
+                                                   const uint64_t timestamp) {
+    const int32_t handledEvent = applyAxisValues(axisValues);
+    if (handledEvent == HANDLED_EVENT) {
+        recordHistory(timestamp, 0);
+        // Publish all the axis of the event at once
+        setControllerDataDirty(true);
+    }
+    return handledEvent;
+}
 
-            // If this axis has a button associated with it, set/clear the flags
-            // as appropriate
-            if (mAxisInfo[axis].axisButtonMask != 0 ||
-                mAxisInfo[axis].axisButtonNegativeMask) {
-                if (axisValue > -AXIS_BUTTON_THRESHOLD &&
-                    axisValue < AXIS_BUTTON_THRESHOLD) {
-                    const uint32_t buttonMask =
-                        mAxisInfo[axis].axisButtonMask |
-                        mAxisInfo[axis].axisButtonNegativeMask;
-                    mControllerData.buttonsDown &= (~buttonMask);
-                } else if (axisValue > AXIS_BUTTON_THRESHOLD) {
-                    mControllerData.buttonsDown |=
-                        mAxisInfo[axis].axisButtonMask;
-                } else if (axisValue < -AXIS_BUTTON_THRESHOLD) {
-                    mControllerData.buttonsDown |=
-                        mAxisInfo[axis].axisButtonNegativeMask;
-                }
-            }
+void GameController::processHistoricalSample(const float *axisValues,
+                                             const uint64_t timestamp) {
+    // Historical samples are only recorded, the published controller data is
+    // updated with the most recent sample of the event
+    if (applyAxisValues(axisValues) == HANDLED_EVENT) {
+        recordHistory(timestamp, PADDLEBOAT_HISTORY_FLAG_HISTORICAL);
+    }
+}
 
-            setControllerDataDirty(true);
-            handledEvent = HANDLED_EVENT;
-        }
+int32_t GameController::applyAxisValues(const float *axisValues) {
+    if (!mAxisTransformActive) {
+        return IGNORED_EVENT;
     }
-    return handledEvent;
+
+    // We take advantage of the GameControllerAxis matching the axis order in
+    // the Paddleboat_Controller_Data struct to load and store the axis entries
+    // of the Paddleboat_Controller_Data struct as the leading lanes. The
+    // hat lanes only drive buttons.
+    constexpr int32_t dataLaneCount = GAMECONTROLLER_AXIS_HAT_X;
+    float laneValues[AXIS_LANE_COUNT];
+    float laneData[AXIS_LANE_COUNT] = {};
+    for (int32_t lane = 0; lane < AXIS_LANE_COUNT; ++lane) {
+        laneValues[lane] = axisValues[mAxisLaneIndex[lane]];
+    }
+    memcpy(laneData, &mControllerData.leftStick.stickX,
+           dataLaneCount * sizeof(float));
+
+    const AxisLanes positiveThreshold = {
+        AXIS_BUTTON_THRESHOLD, AXIS_BUTTON_THRESHOLD, AXIS_BUTTON_THRESHOLD,
+        AXIS_BUTTON_THRESHOLD};
+    const AxisLanes negativeThreshold = -positiveThreshold;
+    AxisLaneMasks setButtons = {};
+    AxisLaneMasks clearButtons = {};
+    for (int32_t lane = 0; lane < AXIS_LANE_COUNT;
+         lane += AXIS_LANES_PER_VECTOR) {
+        AxisLanes value, scale, offset, data;
+        AxisLaneMasks mapped, positiveButton, negativeButton;
+        memcpy(&value, &laneValues[lane], sizeof(value));
+        memcpy(&scale, &mAxisLaneScale[lane], sizeof(scale));
+        memcpy(&offset, &mAxisLaneOffset[lane], sizeof(offset));
+        memcpy(&data, &laneData[lane], sizeof(data));
+        memcpy(&mapped, &mAxisLaneMapped[lane], sizeof(mapped));
+        memcpy(&positiveButton, &mAxisLaneButtonMask[lane],
+               sizeof(positiveButton));
+        memcpy(&negativeButton, &mAxisLaneButtonNegativeMask[lane],
+               sizeof(negativeButton));
+
+        const AxisLanes transformed = value * scale + offset;
+        // Unmapped lanes keep their current value
+        const AxisLaneMasks blended =
+            ((AxisLaneMasks)transformed & mapped) |
+            ((AxisLaneMasks)data & ~mapped);
+        memcpy(&laneData[lane], &blended, sizeof(blended));
+
+        // Comparisons yield all ones in the lanes where they hold. Values
+        // exactly at the threshold neither press nor release the buttons.
+        const AxisLaneMasks centered = (transformed > negativeThreshold) &
+                                       (transformed < positiveThreshold);
+        clearButtons |= centered & (positiveButton | negativeButton);
+        setButtons |= ((transformed > positiveThreshold) & positiveButton) |
+                      ((transformed < negativeThreshold) & negativeButton);
+    }
+    memcpy(&mControllerData.leftStick.stickX, laneData,
+           dataLaneCount * sizeof(float));
+
+    const uint32_t clearMask = static_cast<uint32_t>(
+        clearButtons[0] | clearButtons[1] | clearButtons[2] | clearButtons[3]);
+    const uint32_t setMask = static_cast<uint32_t>(
+        setButtons[0] | setButtons[1] | setButtons[2] | setButtons[3]);
+    mControllerData.buttonsDown =
+        (mControllerData.buttonsDown & ~clearMask) | setMask;
+    return HANDLED_EVENT;
 }
 
 void GameController::setControllerDataDirty(const bool dirty) {
-    mControllerDataDirty = dirty;
+    mControllerDataDirty.store(dirty, std::memory_order_relaxed);
     if (dirty) {
         // update the timestamp any time we mark dirty
         const auto timestamp =
@@ -457,6 +642,7 @@ void GameController::setControllerDataDirty(const bool dirty) {
                 std::chrono::steady_clock::now().time_since_epoch())
                 .count();
         mControllerData.timestamp = static_cast<uint64_t>(timestamp);
+        publishControllerData();
     }
 }
 
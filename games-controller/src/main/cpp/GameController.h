@@ -18,9 +18,14 @@
 
 #include <android/input.h>
 
+#include <atomic>
+#include <memory>
+
 #include "GameControllerDeviceInfo.h"
 #include "GameControllerGameActivityMirror.h"
+#include "GameControllerHistory.h"
 #include "GameControllerMappingFile.h"
+#include "SeqLock.h"
 #include "paddleboat.h"
 
 namespace paddleboat {
@@ -78,6 +83,18 @@ class GameController {
     }
   };
 
+  // Historical samples batched in a GameActivity motion event, oldest first.
+  // The layout of the samples depends on the GameActivity version.
+  struct GameActivityMotionHistory {
+    int32_t historySize = 0;
+    // Offset between the axis values of two consecutive samples
+    size_t sampleStride = 0;
+    const float *axisValues = nullptr;
+    // Only one of the sample time arrays is set
+    const int64_t *eventTimesNanos = nullptr;
+    const long *eventTimesMillis = nullptr;
+  };
+
   GameController();
 
   void setupController(
@@ -91,7 +108,10 @@ class GameController {
   int32_t processGameActivityKeyEvent(
       const Paddleboat_GameActivityKeyEvent *event, const size_t eventSize);
 
-  int32_t processGameActivityMotionEvent(const float *axisValues);
+  // eventTime is in milliseconds, as reported by GameActivity
+  int32_t processGameActivityMotionEvent(
+      const float *axisValues, const int64_t eventTime,
+      const GameActivityMotionHistory *history);
 
   int32_t processKeyEvent(const AInputEvent *event);
 
@@ -105,20 +125,34 @@ class GameController {
     mControllerStatus = controllerStatus;
   }
 
-  int32_t getConnectionIndex() const { return mConnectionIndex; }
+  int32_t getConnectionIndex() const {
+    return mConnectionIndex.load(std::memory_order_acquire);
+  }
 
   void setConnectionIndex(const int32_t connectionIndex) {
-    mConnectionIndex = connectionIndex;
+    mConnectionIndex.store(connectionIndex, std::memory_order_release);
   }
 
   uint64_t getControllerAxisMask() const { return mControllerAxisMask; }
 
+  // The working copy of the controller data, only accessed by the thread
+  // holding the manager update lock. Changes are made visible to
+  // readControllerData by setControllerDataDirty(true) or
+  // publishControllerData.
   Paddleboat_Controller_Data &getControllerData() { return mControllerData; }
 
   const Paddleboat_Controller_Data &getControllerData() const {
     return mControllerData;
   }
 
+  // Copies the last published controller data, can be called from any thread
+  // without locking
+  void readControllerData(Paddleboat_Controller_Data *controllerData) const {
+    mPublishedData.load(controllerData);
+  }
+
+  void publishControllerData() { mPublishedData.store(mControllerData); }
+
   Paddleboat_Controller_Info &getControllerInfo() { return mControllerInfo; }
 
   const Paddleboat_Controller_Info &getControllerInfo() const {
@@ -133,18 +167,38 @@ class GameController {
 
   const GameControllerAxisInfo *getAxisInfo() const { return mAxisInfo; }
 
-  bool getControllerDataDirty() const { return mControllerDataDirty; }
+  bool getControllerDataDirty() const {
+    return mControllerDataDirty.load(std::memory_order_relaxed);
+  }
 
   void setControllerDataDirty(const bool dirty);
 
   void resetControllerData();
 
+  // Must be called with the manager update lock held
+  void setHistoryRecording(const bool recording);
+
+  // Drains the input history, returns -1 if it was never recorded
+  int32_t drainHistory(const int32_t maxEntries,
+                       Paddleboat_Controller_History_Entry *entries);
+
  private:
+  // timestamp is in microseconds
   int32_t processKeyEventInternal(const int32_t eventKeyCode,
-                                  const int32_t eventKeyAction);
+                                  const int32_t eventKeyAction,
+                                  const uint64_t timestamp);
+
+  // Applies one sample of axis values, indexed by native axis id, to the
+  // controller data without publishing it
+  int32_t applyAxisValues(const float *axisValues);
 
-  int32_t processMotionEventInternal(const float *axisArray,
-                                     const AInputEvent *event);
+  int32_t processMotionEventInternal(const float *axisValues,
+                                     const uint64_t timestamp);
+
+  void processHistoricalSample(const float *axisValues,
+                               const uint64_t timestamp);
+
+  void recordHistory(const uint64_t timestamp, const uint32_t flags);
 
   void setupAxis(const GameControllerAxis gcAxis,
                  const int32_t preferredNativeAxisId,
@@ -153,17 +207,37 @@ class GameController {
 
   void adjustAxisConstants();
 
+  // Rebuilds the axis transform tables from mAxisInfo
+  void updateAxisTransform();
+
   uint64_t mControllerAxisMask = 0;
   Paddleboat_ControllerStatus mControllerStatus =
       PADDLEBOAT_CONTROLLER_INACTIVE;
-  int32_t mConnectionIndex = -1;
+  std::atomic<int32_t> mConnectionIndex{-1};
   uint32_t mAxisInversionBitmask = 0;
   Paddleboat_Controller_Data mControllerData;
+  SeqLock<Paddleboat_Controller_Data> mPublishedData;
   Paddleboat_Controller_Info mControllerInfo;
   int32_t mButtonKeycodes[PADDLEBOAT_BUTTON_COUNT];
   GameControllerAxisInfo mAxisInfo[GAMECONTROLLER_AXIS_COUNT];
+  // mAxisInfo flattened into one lane per GameControllerAxis, padded to a
+  // whole number of vectors, so that applyAxisValues transforms every axis
+  // with the same instructions. Unmapped lanes have a zero mapped mask and
+  // button masks.
+  static constexpr int32_t AXIS_LANE_COUNT = 12;
+  bool mAxisTransformActive = false;
+  int32_t mAxisLaneIndex[AXIS_LANE_COUNT];
+  float mAxisLaneScale[AXIS_LANE_COUNT];
+  float mAxisLaneOffset[AXIS_LANE_COUNT];
+  int32_t mAxisLaneMapped[AXIS_LANE_COUNT];
+  int32_t mAxisLaneButtonMask[AXIS_LANE_COUNT];
+  int32_t mAxisLaneButtonNegativeMask[AXIS_LANE_COUNT];
   GameControllerDeviceInfo mDeviceInfo;
   // Controller data has been updated since the last time it was read
-  bool mControllerDataDirty;
+  std::atomic<bool> mControllerDataDirty;
+  bool mHistoryRecording = false;
+  std::unique_ptr<GameControllerHistory> mHistoryStorage;
+  // mHistoryStorage, readable by drainHistory without the update lock
+  std::atomic<GameControllerHistory *> mHistory{nullptr};
 };
 }  // namespace paddleboat
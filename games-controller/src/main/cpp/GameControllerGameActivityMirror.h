@@ -101,4 +101,29 @@ typedef struct Paddleboat_GameActivityMotionEventV2 {
   float precisionY;
 } Paddleboat_GameActivityMotionEventV2;
 
+// Used in GameActivity versions that report historical event times in both
+// milliseconds and nanoseconds
+typedef struct Paddleboat_GameActivityMotionEventV3 {
+  int32_t deviceId;
+  int32_t source;
+  int32_t action;
+  int64_t eventTime;
+  int64_t downTime;
+  int32_t flags;
+  int32_t metaState;
+  int32_t actionButton;
+  int32_t buttonState;
+  int32_t classification;
+  int32_t edgeFlags;
+  uint32_t pointerCount;
+  Paddleboat_GameActivityPointerInfoV2
+      pointers[PADDLEBOAT_MAX_NUM_POINTERS_IN_MOTION_EVENT];
+  int historySize;
+  int64_t* historicalEventTimesMillis;
+  int64_t* historicalEventTimesNanos;
+  float* historicalAxisValues;
+  float precisionX;
+  float precisionY;
+} Paddleboat_GameActivityMotionEventV3;
+
 }  // namespace paddleboat
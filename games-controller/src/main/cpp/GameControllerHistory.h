@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "paddleboat.h"
+
+namespace paddleboat {
+
+// Input history of a controller: a single producer, single consumer ring
+// buffer of history entries. The producer is the thread processing input
+// events, which holds the GameControllerManager update lock, the consumer is
+// the game thread draining the history. Neither side ever waits for the
+// other; when the buffer is full, new entries are dropped and the next entry
+// that fits is flagged with PADDLEBOAT_HISTORY_FLAG_OVERFLOW.
+class GameControllerHistory {
+ public:
+  static constexpr uint32_t CAPACITY = PADDLEBOAT_CONTROLLER_HISTORY_SIZE;
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+                "History capacity must be a power of two");
+
+  // Producer side: restart button edge tracking for a new controller
+  void restart() {
+    mLastButtonsDown = 0;
+    mOverflow = false;
+  }
+
+  // Producer side: append an entry, setting its buttonsChanged field
+  // relative to the previous entry
+  void record(const Paddleboat_Controller_History_Entry &entry) {
+    const uint32_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+    const uint32_t readIndex = mReadIndex.load(std::memory_order_acquire);
+    if (writeIndex - readIndex >= CAPACITY) {
+      mOverflow = true;
+      return;
+    }
+    Paddleboat_Controller_History_Entry &slot =
+        mEntries[writeIndex & (CAPACITY - 1)];
+    slot = entry;
+    slot.buttonsChanged = entry.buttonsDown ^ mLastButtonsDown;
+    if (mOverflow) {
+      slot.flags |= PADDLEBOAT_HISTORY_FLAG_OVERFLOW;
+      mOverflow = false;
+    }
+    mLastButtonsDown = entry.buttonsDown;
+    mWriteIndex.store(writeIndex + 1, std::memory_order_release);
+  }
+
+  // Consumer side: remove up to maxEntries of the oldest entries, returns the
+  // number of entries copied
+  int32_t drain(const int32_t maxEntries,
+                Paddleboat_Controller_History_Entry *entries) {
+    const uint32_t readIndex = mReadIndex.load(std::memory_order_relaxed);
+    const uint32_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+    const uint32_t count = std::min(writeIndex - readIndex,
+                                    static_cast<uint32_t>(maxEntries));
+    // Copy in at most two runs, before and after the end of the buffer
+    const uint32_t first = readIndex & (CAPACITY - 1);
+    const uint32_t firstCount = std::min(count, CAPACITY - first);
+    memcpy(entries, &mEntries[first],
+           firstCount * sizeof(Paddleboat_Controller_History_Entry));
+    memcpy(entries + firstCount, &mEntries[0],
+           (count - firstCount) * sizeof(Paddleboat_Controller_History_Entry));
+    mReadIndex.store(readIndex + count, std::memory_order_release);
+    return static_cast<int32_t>(count);
+  }
+
+ private:
+  // Written by the producer
+  std::atomic<uint32_t> mWriteIndex{0};
+  uint32_t mLastButtonsDown = 0;
+  bool mOverflow = false;
+  Paddleboat_Controller_History_Entry mEntries[CAPACITY];
+  // Written by the consumer
+  std::atomic<uint32_t> mReadIndex{0};
+};
+}  // namespace paddleboat
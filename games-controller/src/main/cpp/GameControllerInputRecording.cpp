@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GameControllerInputRecording.h"
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "Log.h"
+
+#define LOG_TAG "GameControllerInputRecorder"
+
+namespace paddleboat {
+
+namespace {
+constexpr int64_t NANOSECONDS_PER_MILLISECOND =
+        NANOSECONDS_PER_MICROSECOND * MICROSECONDS_PER_MILLISECOND;
+constexpr size_t AXIS_ROW_SIZE =
+        sizeof(float) * PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+
+int64_t captureTimeNanos() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+}
+}  // namespace
+
+GameControllerInputRecorder::~GameControllerInputRecorder() { stop(); }
+
+Paddleboat_ErrorCode GameControllerInputRecorder::start(
+        const int fileDescriptor) {
+    if (fileDescriptor < 0) {
+        return PADDLEBOAT_ERROR_INVALID_PARAMETER;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFileDescriptor >= 0) {
+        return PADDLEBOAT_ERROR_ALREADY_INITIALIZED;
+    }
+    if (!mBuffer) {
+        mBuffer = std::make_unique<uint8_t[]>(BUFFER_SIZE);
+    }
+    mFileDescriptor = fileDescriptor;
+    mWriteFailed = false;
+    mBufferUsed = 0;
+    const InputRecordingHeader header = {INPUT_RECORDING_MAGIC,
+                                         INPUT_RECORDING_VERSION};
+    append(&header, sizeof(header));
+    mRecording.store(true, std::memory_order_relaxed);
+    return PADDLEBOAT_NO_ERROR;
+}
+
+Paddleboat_ErrorCode GameControllerInputRecorder::stop() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mFileDescriptor < 0) {
+        return PADDLEBOAT_NO_ERROR;
+    }
+    mRecording.store(false, std::memory_order_relaxed);
+    flush();
+    mFileDescriptor = -1;
+    return mWriteFailed ? PADDLEBOAT_ERROR_FILE_IO : PADDLEBOAT_NO_ERROR;
+}
+
+void GameControllerInputRecorder::recordControllerConnected(
+        const GameControllerDeviceInfo &deviceInfo) {
+    InputRecordControllerConnected connected;
+    memset(&connected, 0, sizeof(connected));
+    connected.info = deviceInfo.getInfo();
+    memcpy(connected.axisMin, deviceInfo.getMinArray(),
+           sizeof(connected.axisMin));
+    memcpy(connected.axisMax, deviceInfo.getMaxArray(),
+           sizeof(connected.axisMax));
+    memcpy(connected.axisFlat, deviceInfo.getFlatArray(),
+           sizeof(connected.axisFlat));
+    memcpy(connected.axisFuzz, deviceInfo.getFuzzArray(),
+           sizeof(connected.axisFuzz));
+    // The device name buffer is the size of the record name
+    memcpy(connected.name, deviceInfo.getName(), sizeof(connected.name));
+    connected.name[sizeof(connected.name) - 1] = '\0';
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (beginRecord(INPUT_RECORD_CONTROLLER_CONNECTED, sizeof(connected))) {
+        append(&connected, sizeof(connected));
+        endRecord();
+    }
+}
+
+void GameControllerInputRecorder::recordControllerDisconnected(
+        const int32_t deviceId) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (beginRecord(INPUT_RECORD_CONTROLLER_DISCONNECTED, sizeof(deviceId))) {
+        append(&deviceId, sizeof(deviceId));
+        endRecord();
+    }
+}
+
+void GameControllerInputRecorder::recordInputEvent(const AInputEvent *event) {
+    const int32_t eventType = AInputEvent_getType(event);
+    if (eventType == AINPUT_EVENT_TYPE_KEY) {
+        InputRecordKeyEvent keyEvent;
+        memset(&keyEvent, 0, sizeof(keyEvent));
+        keyEvent.eventTime = AKeyEvent_getEventTime(event);
+        keyEvent.deviceId = AInputEvent_getDeviceId(event);
+        keyEvent.source = AInputEvent_getSource(event);
+        keyEvent.action = AKeyEvent_getAction(event);
+        keyEvent.keyCode = AKeyEvent_getKeyCode(event);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (beginRecord(INPUT_RECORD_KEY_EVENT, sizeof(keyEvent))) {
+            append(&keyEvent, sizeof(keyEvent));
+            endRecord();
+        }
+    } else if (eventType == AINPUT_EVENT_TYPE_MOTION) {
+        InputRecordMotionEvent motionEvent;
+        memset(&motionEvent, 0, sizeof(motionEvent));
+        motionEvent.eventTime = AMotionEvent_getEventTime(event);
+        motionEvent.deviceId = AInputEvent_getDeviceId(event);
+        motionEvent.source = AInputEvent_getSource(event);
+        motionEvent.action = AMotionEvent_getAction(event);
+        motionEvent.buttonState = AMotionEvent_getButtonState(event);
+        const size_t historySize = AMotionEvent_getHistorySize(event);
+        motionEvent.historySize = static_cast<int32_t>(historySize);
+        for (int32_t axis = 0;
+             axis < PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT; ++axis) {
+            motionEvent.axisValues[axis] =
+                    AMotionEvent_getAxisValue(event, axis, 0);
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!beginRecord(INPUT_RECORD_MOTION_EVENT,
+                         sizeof(motionEvent) +
+                                 historySize *
+                                         (sizeof(int64_t) + AXIS_ROW_SIZE))) {
+            return;
+        }
+        append(&motionEvent, sizeof(motionEvent));
+        for (size_t i = 0; i < historySize; ++i) {
+            const int64_t sampleTime =
+                    AMotionEvent_getHistoricalEventTime(event, i);
+            append(&sampleTime, sizeof(sampleTime));
+        }
+        for (size_t i = 0; i < historySize; ++i) {
+            float axisValues[PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+            for (int32_t axis = 0;
+                 axis < PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+                 ++axis) {
+                axisValues[axis] =
+                        AMotionEvent_getHistoricalAxisValue(event, axis, 0, i);
+            }
+            append(axisValues, sizeof(axisValues));
+        }
+        endRecord();
+    }
+}
+
+void GameControllerInputRecorder::recordGameActivityKeyEvent(
+        const Paddleboat_GameActivityKeyEvent *event) {
+    InputRecordKeyEvent keyEvent;
+    memset(&keyEvent, 0, sizeof(keyEvent));
+    // GameActivity key event times are in nanoseconds
+    keyEvent.eventTime = event->eventTime;
+    keyEvent.flags = INPUT_RECORD_FLAG_GAME_ACTIVITY;
+    keyEvent.deviceId = event->deviceId;
+    keyEvent.source = event->source;
+    keyEvent.action = event->action;
+    keyEvent.keyCode = event->keyCode;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (beginRecord(INPUT_RECORD_KEY_EVENT, sizeof(keyEvent))) {
+        append(&keyEvent, sizeof(keyEvent));
+        endRecord();
+    }
+}
+
+void GameControllerInputRecorder::recordGameActivityMotionEvent(
+        const Paddleboat_GameActivityMotionEvent *event,
+        const float *axisValues,
+        const GameController::GameActivityMotionHistory &history) {
+    InputRecordMotionEvent motionEvent;
+    memset(&motionEvent, 0, sizeof(motionEvent));
+    motionEvent.eventTime = event->eventTime * NANOSECONDS_PER_MILLISECOND;
+    motionEvent.flags = INPUT_RECORD_FLAG_GAME_ACTIVITY;
+    motionEvent.deviceId = event->deviceId;
+    motionEvent.source = event->source;
+    motionEvent.action = event->action;
+    motionEvent.buttonState = event->buttonState;
+    motionEvent.historySize = history.historySize;
+    memcpy(motionEvent.axisValues, axisValues, AXIS_ROW_SIZE);
+
+    const size_t historySize = static_cast<size_t>(history.historySize);
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!beginRecord(INPUT_RECORD_MOTION_EVENT,
+                     sizeof(motionEvent) +
+                             historySize * (sizeof(int64_t) + AXIS_ROW_SIZE))) {
+        return;
+    }
+    append(&motionEvent, sizeof(motionEvent));
+    for (size_t i = 0; i < historySize; ++i) {
+        const int64_t sampleTime =
+                history.eventTimesNanos != nullptr
+                        ? history.eventTimesNanos[i]
+                        : static_cast<int64_t>(history.eventTimesMillis[i]) *
+                                  NANOSECONDS_PER_MILLISECOND;
+        append(&sampleTime, sizeof(sampleTime));
+    }
+    // Only the samples of the first pointer are recorded
+    for (size_t i = 0; i < historySize; ++i) {
+        append(history.axisValues + (i * history.sampleStride), AXIS_ROW_SIZE);
+    }
+    endRecord();
+}
+
+void GameControllerInputRecorder::recordMotionData(
+        const InputRecordMotionData &motionData) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (beginRecord(INPUT_RECORD_MOTION_DATA, sizeof(motionData))) {
+        append(&motionData, sizeof(motionData));
+        endRecord();
+    }
+}
+
+void GameControllerInputRecorder::recordUpdate() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    beginRecord(INPUT_RECORD_UPDATE, 0);
+}
+
+bool GameControllerInputRecorder::beginRecord(const InputRecordType type,
+                                              const size_t payloadSize) {
+    if (mFileDescriptor < 0) {
+        // Recording stopped after the caller checked isRecording
+        return false;
+    }
+    InputRecordHeader header;
+    header.type = type;
+    header.payloadSize = static_cast<uint32_t>(payloadSize);
+    header.captureTime = captureTimeNanos();
+    append(&header, sizeof(header));
+    mRecordPadding = (INPUT_RECORD_ALIGNMENT -
+                      (payloadSize % INPUT_RECORD_ALIGNMENT)) %
+                     INPUT_RECORD_ALIGNMENT;
+    return true;
+}
+
+void GameControllerInputRecorder::endRecord() {
+    const uint8_t padding[INPUT_RECORD_ALIGNMENT] = {};
+    append(padding, mRecordPadding);
+}
+
+void GameControllerInputRecorder::append(const void *data, const size_t size) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    size_t remaining = size;
+    while (remaining > 0) {
+        if (mBufferUsed == BUFFER_SIZE) {
+            flush();
+        }
+        const size_t copySize = std::min(remaining, BUFFER_SIZE - mBufferUsed);
+        memcpy(mBuffer.get() + mBufferUsed, bytes, copySize);
+        mBufferUsed += copySize;
+        bytes += copySize;
+        remaining -= copySize;
+    }
+}
+
+void GameControllerInputRecorder::flush() {
+    size_t written = 0;
+    while (written < mBufferUsed && !mWriteFailed) {
+        const ssize_t result = write(mFileDescriptor, mBuffer.get() + written,
+                                     mBufferUsed - written);
+        if (result > 0) {
+            written += static_cast<size_t>(result);
+        } else if (result == 0 || errno != EINTR) {
+            ALOGE("Failed to write input recording, errno %d", errno);
+            mWriteFailed = true;
+        }
+    }
+    mBufferUsed = 0;
+}
+
+}  // namespace paddleboat
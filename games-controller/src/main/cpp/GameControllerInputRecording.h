@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android/input.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "GameController.h"
+#include "GameControllerDeviceInfo.h"
+#include "GameControllerGameActivityMirror.h"
+#include "GameControllerInternalConstants.h"
+#include "paddleboat.h"
+
+namespace paddleboat {
+
+// An input recording is an InputRecordingHeader followed by records, each an
+// InputRecordHeader followed by payloadSize bytes of payload, then padding up
+// to the next multiple of INPUT_RECORD_ALIGNMENT bytes. Values are in the
+// byte order of the recording device. Feeding the records back to the
+// entry points they were captured from reproduces the input processing of the
+// recorded session, see src/hostTest/cpp/paddleboat_replay.cpp.
+inline constexpr uint32_t INPUT_RECORDING_MAGIC = 0x52494250;  // "PBIR"
+inline constexpr uint32_t INPUT_RECORDING_VERSION = 1;
+inline constexpr size_t INPUT_RECORD_ALIGNMENT = 8;
+
+enum InputRecordType : uint32_t {
+  // Payload: InputRecordControllerConnected
+  INPUT_RECORD_CONTROLLER_CONNECTED = 1,
+  // Payload: the int32_t device id
+  INPUT_RECORD_CONTROLLER_DISCONNECTED = 2,
+  // Payload: InputRecordKeyEvent
+  INPUT_RECORD_KEY_EVENT = 3,
+  // Payload: InputRecordMotionEvent, followed by historySize int64_t
+  // historical event times, then historySize rows of
+  // PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT historical axis values
+  INPUT_RECORD_MOTION_EVENT = 4,
+  // Payload: InputRecordMotionData
+  INPUT_RECORD_MOTION_DATA = 5,
+  // A call to Paddleboat_update, no payload
+  INPUT_RECORD_UPDATE = 6
+};
+
+enum InputRecordFlags : uint32_t {
+  // The event was passed to Paddleboat_processGameActivityKeyInputEvent or
+  // Paddleboat_processGameActivityMotionInputEvent, instead of
+  // Paddleboat_processInputEvent
+  INPUT_RECORD_FLAG_GAME_ACTIVITY = (1U << 0)
+};
+
+struct InputRecordingHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct InputRecordHeader {
+  uint32_t type;
+  uint32_t payloadSize;
+  // CLOCK_MONOTONIC time of the capture, in nanoseconds
+  int64_t captureTime;
+};
+
+struct InputRecordControllerConnected {
+  GameControllerDeviceInfo::InfoFields info;
+  float axisMin[MAX_AXIS_COUNT];
+  float axisMax[MAX_AXIS_COUNT];
+  float axisFlat[MAX_AXIS_COUNT];
+  float axisFuzz[MAX_AXIS_COUNT];
+  char name[DEVICEINFO_MAX_NAME_LENGTH];
+};
+
+struct InputRecordKeyEvent {
+  // Nanoseconds, whatever the unit of the source event
+  int64_t eventTime;
+  uint32_t flags;
+  int32_t deviceId;
+  int32_t source;
+  int32_t action;
+  int32_t keyCode;
+};
+
+struct InputRecordMotionEvent {
+  // Nanoseconds, whatever the unit of the source event
+  int64_t eventTime;
+  uint32_t flags;
+  int32_t deviceId;
+  int32_t source;
+  int32_t action;
+  int32_t buttonState;
+  int32_t historySize;
+  // Axis values of the first pointer, indexed by native axis id
+  float axisValues[PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT];
+};
+
+struct InputRecordMotionData {
+  uint64_t timestamp;
+  int32_t deviceId;
+  int32_t motionType;
+  float motionX;
+  float motionY;
+  float motionZ;
+};
+
+// Writes the input received by GameControllerManager to a file descriptor.
+// Records are serialized by an internal lock, since they come from the input,
+// sensor and game threads, and buffered to keep writes off most events.
+// Callers check isRecording first, so the cost is a relaxed load when not
+// recording.
+class GameControllerInputRecorder {
+ public:
+  ~GameControllerInputRecorder();
+
+  bool isRecording() const {
+    return mRecording.load(std::memory_order_relaxed);
+  }
+
+  // Starts writing a recording to a file descriptor, which is not closed
+  Paddleboat_ErrorCode start(const int fileDescriptor);
+
+  // Flushes the buffered records and stops recording
+  Paddleboat_ErrorCode stop();
+
+  void recordControllerConnected(const GameControllerDeviceInfo &deviceInfo);
+
+  void recordControllerDisconnected(const int32_t deviceId);
+
+  void recordInputEvent(const AInputEvent *event);
+
+  void recordGameActivityKeyEvent(const Paddleboat_GameActivityKeyEvent *event);
+
+  // eventTime is in milliseconds, as reported by GameActivity
+  void recordGameActivityMotionEvent(
+      const Paddleboat_GameActivityMotionEvent *event, const float *axisValues,
+      const GameController::GameActivityMotionHistory &history);
+
+  void recordMotionData(const InputRecordMotionData &motionData);
+
+  void recordUpdate();
+
+ private:
+  static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+  // Must be called with mMutex held. beginRecord returns false if not
+  // recording, otherwise the payload must be appended before endRecord.
+  bool beginRecord(const InputRecordType type, const size_t payloadSize);
+  void endRecord();
+  void append(const void *data, const size_t size);
+  void flush();
+
+  std::atomic<bool> mRecording{false};
+  std::mutex mMutex;
+  int mFileDescriptor = -1;
+  bool mWriteFailed = false;
+  std::unique_ptr<uint8_t[]> mBuffer;
+  size_t mBufferUsed = 0;
+  size_t mRecordPadding = 0;
+};
+
+}  // namespace paddleboat
@@ -26,6 +26,9 @@ inline constexpr size_t DEVICEINFO_ARRAY_BYTESIZE =
     sizeof(int32_t) * DEVICEINFO_ARRAY_SIZE;
 inline constexpr size_t DEVICEINFO_MAX_NAME_LENGTH = 128;
 
+inline constexpr int64_t NANOSECONDS_PER_MICROSECOND = 1000;
+inline constexpr int64_t MICROSECONDS_PER_MILLISECOND = 1000;
+
 inline constexpr int32_t IGNORED_EVENT = 0;
 inline constexpr int32_t HANDLED_EVENT = 1;
 }  // namespace paddleboat
@@ -18,16 +18,10 @@
 #include <android/api-level.h>
 
 #include <cstdlib>
-#include <fcntl.h>
 #include <memory>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <unistd.h>
 
 #include "GameControllerInternalConstants.h"
 #include "GameControllerLog.h"
-#include "GameControllerMappingUtils.h"
-#include "InternalControllerTable.h"
 #include "Log.h"
 
 #define ARRAY_COUNTOF(array) (sizeof(array) / sizeof(array[0]))
@@ -98,6 +92,7 @@ void Java_com_google_android_games_paddleboat_GameControllerManager_onController
             }
             env->ReleaseStringUTFChars(deviceNameJstring, deviceName);
         }
+        paddleboat::GameControllerManager::onConnectionInfoReady(*deviceInfo);
     }
 }
 
@@ -205,6 +200,8 @@ const JNINativeMethod GCM_NATIVE_METHODS[] = {
 
 std::mutex GameControllerManager::sInstanceMutex;
 std::unique_ptr<GameControllerManager> GameControllerManager::sInstance;
+std::atomic<GameControllerManager *> GameControllerManager::sInstancePointer{
+    nullptr};
 
 Paddleboat_ErrorCode GameControllerManager::init(JNIEnv *env,
                                                  jobject jcontext) {
@@ -216,6 +213,7 @@ Paddleboat_ErrorCode GameControllerManager::init(JNIEnv *env,
 
     sInstance = std::make_unique<GameControllerManager>(env, jcontext,
                                                         ConstructorTag{});
+    sInstancePointer.store(sInstance.get(), std::memory_order_release);
     if (!sInstance->mInitialized) {
         ALOGE("Failed to initialize Paddleboat");
         return PADDLEBOAT_ERROR_INIT_GCM_FAILURE;
@@ -284,6 +282,7 @@ Paddleboat_ErrorCode GameControllerManager::init(JNIEnv *env,
 
 void GameControllerManager::destroyInstance(JNIEnv *env) {
     std::lock_guard<std::mutex> lock(sInstanceMutex);
+    sInstancePointer.store(nullptr, std::memory_order_release);
     sInstance.get()->releaseGlobals(env);
     sInstance.reset();
 }
@@ -300,8 +299,9 @@ void GameControllerManager::releaseGlobals(JNIEnv *env) {
 }
 
 GameControllerManager *GameControllerManager::getInstance() {
-    std::lock_guard<std::mutex> lock(sInstanceMutex);
-    return sInstance.get();
+    // As before, callers must not race Paddleboat_destroy, so the pointer
+    // does not need to be read under sInstanceMutex.
+    return sInstancePointer.load(std::memory_order_acquire);
 }
 
 bool GameControllerManager::isInitialized() {
@@ -363,24 +363,6 @@ GameControllerManager::GameControllerManager(JNIEnv *env, jobject jcontext,
     mMouseData.mouseY = 0.0f;
     mInitialized = true;
 
-    const Paddleboat_Internal_Mapping_Header *mappingHeader = GetInternalMappingHeader();
-    mMappingInfo.mAxisTableEntryCount = mappingHeader->axisTableEntryCount;
-    mMappingInfo.mButtonTableEntryCount = mappingHeader->buttonTableEntryCount;
-    mMappingInfo.mControllerTableEntryCount = mappingHeader->controllerTableEntryCount;
-    mMappingInfo.mStringTableEntryCount = mappingHeader->stringTableEntryCount;
-    memcpy(mMappingInfo.mAxisTable, mappingHeader->axisTable,
-           sizeof(Paddleboat_Controller_Mapping_File_Axis_Entry) *
-                   mMappingInfo.mAxisTableEntryCount);
-    memcpy(mMappingInfo.mButtonTable, mappingHeader->buttonTable,
-           sizeof(Paddleboat_Controller_Mapping_File_Button_Entry) *
-                   mMappingInfo.mButtonTableEntryCount);
-    memcpy(mMappingInfo.mControllerTable, mappingHeader->controllerTable,
-           sizeof(Paddleboat_Controller_Mapping_File_Controller_Entry) *
-                   mMappingInfo.mControllerTableEntryCount);
-    memcpy(mMappingInfo.mStringTable, mappingHeader->stringTable,
-           sizeof(Paddleboat_Controller_Mapping_File_String_Entry) *
-                   mMappingInfo.mStringTableEntryCount);
-
     // Our minimum supported API level, we will retrieve the actual runtime API
     // level later on calling getApiLevel
     mApiLevel = 16;
@@ -394,6 +376,9 @@ int32_t GameControllerManager::processInputEvent(const AInputEvent *event) {
         GameControllerManager *gcm = getInstance();
         if (gcm) {
             std::lock_guard<std::mutex> lock(gcm->mUpdateMutex);
+            if (gcm->mInputRecorder.isRecording()) {
+                gcm->mInputRecorder.recordInputEvent(event);
+            }
             const int32_t eventSource = AInputEvent_getSource(event);
             const int32_t dpadSource = eventSource & AINPUT_SOURCE_DPAD;
             const int32_t gamepadSource = eventSource & AINPUT_SOURCE_GAMEPAD;
@@ -449,6 +434,9 @@ int32_t GameControllerManager::processGameActivityKeyInputEvent(
             const Paddleboat_GameActivityKeyEvent *keyEvent =
                 reinterpret_cast<const Paddleboat_GameActivityKeyEvent *>(
                     event);
+            if (gcm->mInputRecorder.isRecording()) {
+                gcm->mInputRecorder.recordGameActivityKeyEvent(keyEvent);
+            }
             const int32_t eventSource = keyEvent->source;
             const int32_t eventDeviceId = keyEvent->deviceId;
             const int32_t dpadSource = eventSource & AINPUT_SOURCE_DPAD;
@@ -495,6 +483,13 @@ int32_t GameControllerManager::processGameActivityMotionInputEvent(
             const float *axisValues = gcm->getAxisValuesFromGameActivityMotionEvent(event,
                                                                                     eventSize, 0);
             if (axisValues != nullptr) {
+                if (gcm->mInputRecorder.isRecording()) {
+                    GameController::GameActivityMotionHistory history;
+                    gcm->getHistoryFromGameActivityMotionEvent(event, eventSize,
+                                                               history);
+                    gcm->mInputRecorder.recordGameActivityMotionEvent(
+                            motionEvent, axisValues, history);
+                }
                 const int32_t eventSource = motionEvent->source;
                 const int32_t eventDeviceId = motionEvent->deviceId;
                 const int32_t dpadSource = eventSource & AINPUT_SOURCE_DPAD;
@@ -512,10 +507,16 @@ int32_t GameControllerManager::processGameActivityMotionInputEvent(
                                         gcm->mGameControllers[i].getDeviceInfo();
                                 if (deviceInfo.getInfo().mDeviceId ==
                                     eventDeviceId) {
+                                    GameController::GameActivityMotionHistory
+                                        history;
+                                    gcm->getHistoryFromGameActivityMotionEvent(
+                                        event, eventSize, history);
                                     handledEvent =
                                             gcm->mGameControllers[i]
                                                     .processGameActivityMotionEvent(
-                                                            axisValues);
+                                                            axisValues,
+                                                            motionEvent->eventTime,
+                                                            &history);
                                     break;
                                 }
                             }
@@ -678,6 +679,32 @@ const float *GameControllerManager::getAxisValuesFromGameActivityMotionEvent(
     return nullptr;
 }
 
+void GameControllerManager::getHistoryFromGameActivityMotionEvent(
+        const void *event, const size_t eventSize,
+        GameController::GameActivityMotionHistory &history) {
+    // The original struct has no history
+    if (eventSize == sizeof(Paddleboat_GameActivityMotionEventV3)) {
+        const Paddleboat_GameActivityMotionEventV3 *motionEventV3 =
+                reinterpret_cast<const Paddleboat_GameActivityMotionEventV3 *>(event);
+        history.historySize = motionEventV3->historySize;
+        history.sampleStride = motionEventV3->pointerCount *
+                               PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+        history.axisValues = motionEventV3->historicalAxisValues;
+        history.eventTimesNanos = motionEventV3->historicalEventTimesNanos;
+    } else if (eventSize == sizeof(Paddleboat_GameActivityMotionEventV2)) {
+        const Paddleboat_GameActivityMotionEventV2 *motionEventV2 =
+                reinterpret_cast<const Paddleboat_GameActivityMotionEventV2 *>(event);
+        history.historySize = motionEventV2->historySize;
+        history.sampleStride = motionEventV2->pointerCount *
+                               PADDLEBOAT_GAME_ACTIVITY_POINTER_INFO_AXIS_COUNT;
+        history.axisValues = motionEventV2->historicalAxisValues;
+        history.eventTimesMillis = motionEventV2->historicalEventTimes;
+    }
+    if (history.axisValues == nullptr) {
+        history.historySize = 0;
+    }
+}
+
 int32_t GameControllerManager::processGameActivityMouseEvent(
     const void *event, const size_t eventSize, const int32_t eventDeviceId) {
     int32_t handledEvent = IGNORED_EVENT;
@@ -776,6 +803,9 @@ void GameControllerManager::update(JNIEnv *env) {
     if (!gcm) {
         return;
     }
+    if (gcm->mInputRecorder.isRecording()) {
+        gcm->mInputRecorder.recordUpdate();
+    }
     if (!gcm->mGCMClassInitialized && gcm->mGameControllerObject != NULL) {
         gcm->mApiLevel = env->CallIntMethod(gcm->mGameControllerObject,
                                             gcm->mGetApiLevelMethodId);
@@ -796,10 +826,10 @@ void GameControllerManager::update(JNIEnv *env) {
         gcm->mSetNativeReadyMethodId = NULL;
     }
 
-    if (gcm->mMotionDataCallback != nullptr &&
+    if ((gcm->mMotionDataCallback != nullptr || gcm->mMotionDataBuffering.load()) &&
         gcm->mMotionEventReporting == false) {
-        // If a motion data callback is registered, tell the managed side to
-        // start reporting motion event data
+        // If a motion data callback is registered, or motion data is
+        // buffered, tell the managed side to start reporting motion event data
         env->CallVoidMethod(gcm->mGameControllerObject,
                             gcm->mSetReportMotionEventsMethodId);
         gcm->mMotionEventReporting = true;
@@ -810,7 +840,8 @@ void GameControllerManager::update(JNIEnv *env) {
         // to enable or disable listening to an integrated sensor
         env->CallVoidMethod(
                 gcm->mGameControllerObject, gcm->mSetActiveIntegratedSensorsMethodId,
-                static_cast<jint>(gcm->mMotionDataCallbackFlags));
+                static_cast<jint>(gcm->mMotionDataCallbackFlags |
+                                  gcm->mMotionDataBufferFlags));
         gcm->mActiveSensorFlagsDirty = false;
     }
 
@@ -827,8 +858,13 @@ void GameControllerManager::update(JNIEnv *env) {
                     // device, if one does not exist, nullptr is passed and
                     // GameController will fallback to default axis and button
                     // mapping.
+                    const Paddleboat_Controller_Mapping_File_Axis_Entry *axisData =
+                        nullptr;
+                    const Paddleboat_Controller_Mapping_File_Button_Entry *buttonData =
+                        nullptr;
                     const Paddleboat_Controller_Mapping_File_Controller_Entry *mapData =
-                        gcm->getMapForController(gcm->mGameControllers[i]);
+                        gcm->getMapForController(gcm->mGameControllers[i],
+                                                 &axisData, &buttonData);
 #if defined LOG_INPUT_EVENTS
                     if (mapData != nullptr) {
                         ALOGI("Found controller map for vId/pId: %x %x",
@@ -854,11 +890,8 @@ void GameControllerManager::update(JNIEnv *env) {
                                 ->mProductId);
                     }
 #endif
-                    const uint32_t axisIndex = mapData != nullptr ? mapData->axisTableIndex : 0;
-                    const uint32_t buttonIndex = mapData != nullptr ? mapData->buttonTableIndex : 0;
-                    gcm->mGameControllers[i].setupController(mapData,
-                        &gcm->mMappingInfo.mAxisTable[axisIndex],
-                        &gcm->mMappingInfo.mButtonTable[buttonIndex]);
+                    gcm->mGameControllers[i].setupController(mapData, axisData,
+                                                             buttonData);
                     // Update the active axis mask to include any new axis used
                     // by the new controller
                     gcm->mActiveAxisMask |=
@@ -910,17 +943,16 @@ Paddleboat_ErrorCode GameControllerManager::getControllerData(
             controllerIndex < PADDLEBOAT_MAX_CONTROLLERS) {
             GameControllerManager *gcm = getInstance();
             if (gcm) {
-                if (gcm->mGameControllers[controllerIndex]
-                        .getConnectionIndex() == controllerIndex) {
-                    if (gcm->mGameControllers[controllerIndex]
-                            .getControllerDataDirty()) {
+                // Read the published copy instead of locking mUpdateMutex,
+                // so polling never waits for the input thread
+                const GameController &gameController =
+                    gcm->mGameControllers[controllerIndex];
+                if (gameController.getConnectionIndex() == controllerIndex) {
+                    if (gameController.getControllerDataDirty()) {
                         gcm->mGameControllers[controllerIndex]
                             .setControllerDataDirty(false);
                     }
-                    memcpy(controllerData,
-                           &gcm->mGameControllers[controllerIndex]
-                                .getControllerData(),
-                           sizeof(Paddleboat_Controller_Data));
+                    gameController.readControllerData(controllerData);
                 } else {
                     errorCode = PADDLEBOAT_ERROR_NO_CONTROLLER;
                 }
@@ -936,6 +968,53 @@ Paddleboat_ErrorCode GameControllerManager::getControllerData(
     return errorCode;
 }
 
+Paddleboat_ErrorCode GameControllerManager::setControllerHistoryEnabled(
+    const bool enabled) {
+    Paddleboat_ErrorCode errorCode = PADDLEBOAT_NO_ERROR;
+    GameControllerManager *gcm = getInstance();
+    if (gcm) {
+        std::lock_guard<std::mutex> lock(gcm->mUpdateMutex);
+        for (size_t i = 0; i < PADDLEBOAT_MAX_CONTROLLERS; ++i) {
+            gcm->mGameControllers[i].setHistoryRecording(enabled);
+        }
+    } else {
+        errorCode = PADDLEBOAT_ERROR_NOT_INITIALIZED;
+    }
+    return errorCode;
+}
+
+Paddleboat_ErrorCode GameControllerManager::getControllerHistory(
+    const int32_t controllerIndex, const int32_t maxEntries,
+    Paddleboat_Controller_History_Entry *entries, int32_t *entryCount) {
+    Paddleboat_ErrorCode errorCode = PADDLEBOAT_NO_ERROR;
+    if (entries != nullptr && entryCount != nullptr && maxEntries >= 0) {
+        *entryCount = 0;
+        if (controllerIndex >= 0 &&
+            controllerIndex < PADDLEBOAT_MAX_CONTROLLERS) {
+            GameControllerManager *gcm = getInstance();
+            if (gcm) {
+                // Like getControllerData, this does not lock mUpdateMutex,
+                // the history is a single producer, single consumer queue
+                const int32_t drained =
+                    gcm->mGameControllers[controllerIndex].drainHistory(
+                        maxEntries, entries);
+                if (drained >= 0) {
+                    *entryCount = drained;
+                } else {
+                    errorCode = PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED;
+                }
+            } else {
+                errorCode = PADDLEBOAT_ERROR_NOT_INITIALIZED;
+            }
+        } else {
+            errorCode = PADDLEBOAT_ERROR_INVALID_CONTROLLER_INDEX;
+        }
+    } else {
+        errorCode = PADDLEBOAT_ERROR_INVALID_PARAMETER;
+    }
+    return errorCode;
+}
+
 Paddleboat_ErrorCode GameControllerManager::getControllerInfo(
     const int32_t controllerIndex, Paddleboat_Controller_Info *controllerInfo) {
     Paddleboat_ErrorCode errorCode = PADDLEBOAT_NO_ERROR;
@@ -1144,10 +1223,21 @@ GameControllerDeviceInfo *GameControllerManager::onConnection() {
     return deviceInfo;
 }
 
+void GameControllerManager::onConnectionInfoReady(
+    const GameControllerDeviceInfo &deviceInfo) {
+    GameControllerManager *gcm = getInstance();
+    if (gcm && gcm->mInputRecorder.isRecording()) {
+        gcm->mInputRecorder.recordControllerConnected(deviceInfo);
+    }
+}
+
 void GameControllerManager::onDisconnection(const int32_t deviceId) {
     GameControllerManager *gcm = getInstance();
     if (gcm) {
         std::lock_guard<std::mutex> lock(gcm->mUpdateMutex);
+        if (gcm->mInputRecorder.isRecording()) {
+            gcm->mInputRecorder.recordControllerDisconnected(deviceId);
+        }
         for (size_t i = 0; i < PADDLEBOAT_MAX_CONTROLLERS; ++i) {
             if (gcm->mGameControllers[i].getConnectionIndex() >= 0) {
                 const GameControllerDeviceInfo &deviceInfo =
@@ -1206,7 +1296,19 @@ void GameControllerManager::onMotionData(const int32_t deviceId,
                                          const float dataZ) {
     GameControllerManager *gcm = getInstance();
     if (gcm) {
-        if (gcm->mMotionDataCallback != nullptr) {
+        if (gcm->mInputRecorder.isRecording()) {
+            const InputRecordMotionData motionData = {
+                    timestamp, deviceId, motionType, dataX, dataY, dataZ};
+            gcm->mInputRecorder.recordMotionData(motionData);
+        }
+        const bool buffering =
+                gcm->mMotionDataBuffering.load(std::memory_order_acquire);
+        if (buffering || gcm->mMotionDataCallback != nullptr) {
+            const int32_t controllerIndex =
+                    gcm->getMotionDataControllerIndex(deviceId);
+            if (controllerIndex < 0) {
+                return;
+            }
             Paddleboat_Motion_Data motionData;
             motionData.motionType =
                     static_cast<Paddleboat_Motion_Type>(motionType);
@@ -1215,24 +1317,47 @@ void GameControllerManager::onMotionData(const int32_t deviceId,
             motionData.motionY = dataY;
             motionData.motionZ = dataZ;
 
-            if (deviceId == PADDLEBOAT_INTEGRATED_SENSOR_INDEX) {
-                gcm->mMotionDataCallback(PADDLEBOAT_INTEGRATED_SENSOR_INDEX, &motionData,
-                                         gcm->mMotionDataCallbackUserData);
+            if (buffering) {
+                gcm->bufferMotionData(controllerIndex, deviceId, motionData);
             } else {
-                for (size_t i = 0; i < PADDLEBOAT_MAX_CONTROLLERS; ++i) {
-                    if (gcm->mGameControllers[i].getConnectionIndex() >= 0) {
-                        const GameControllerDeviceInfo &deviceInfo =
-                                gcm->mGameControllers[i].getDeviceInfo();
-                        if (deviceInfo.getInfo().mDeviceId == deviceId) {
-                            gcm->mMotionDataCallback(
-                                    i, &motionData, gcm->mMotionDataCallbackUserData);
-                            return;
-                        }
-                    }
-                }
+                gcm->mMotionDataCallback(controllerIndex, &motionData,
+                                         gcm->mMotionDataCallbackUserData);
+            }
+        }
+    }
+}
+
+int32_t GameControllerManager::getMotionDataControllerIndex(
+        const int32_t deviceId) {
+    if (deviceId == PADDLEBOAT_INTEGRATED_SENSOR_INDEX) {
+        return PADDLEBOAT_INTEGRATED_SENSOR_INDEX;
+    }
+    for (int32_t i = 0; i < PADDLEBOAT_MAX_CONTROLLERS; ++i) {
+        if (mGameControllers[i].getConnectionIndex() >= 0) {
+            const GameControllerDeviceInfo &deviceInfo =
+                    mGameControllers[i].getDeviceInfo();
+            if (deviceInfo.getInfo().mDeviceId == deviceId) {
+                return i;
             }
         }
     }
+    return -1;
+}
+
+void GameControllerManager::bufferMotionData(
+        const int32_t controllerIndex, const int32_t deviceId,
+        const Paddleboat_Motion_Data &motionData) {
+    GameControllerMotionBuffer *buffers =
+            mMotionBuffers.load(std::memory_order_acquire);
+    if (buffers != nullptr) {
+        Paddleboat_Motion_Data_Filter filter;
+        mMotionDataFilter.load(&filter);
+        const int32_t bufferIndex =
+                controllerIndex == PADDLEBOAT_INTEGRATED_SENSOR_INDEX
+                        ? PADDLEBOAT_MAX_CONTROLLERS
+                        : controllerIndex;
+        buffers[bufferIndex].add(deviceId, filter, motionData);
+    }
 }
 
 bool GameControllerManager::getPhysicalKeyboardStatus() {
@@ -1361,6 +1486,101 @@ Paddleboat_ErrorCode GameControllerManager::setMotionDataCallback(
     return PADDLEBOAT_NO_ERROR;
 }
 
+Paddleboat_ErrorCode GameControllerManager::startInputRecording(
+    const int fileDescriptor) {
+    GameControllerManager *gcm = getInstance();
+    if (!gcm) {
+        return PADDLEBOAT_ERROR_NOT_INITIALIZED;
+    }
+    return gcm->mInputRecorder.start(fileDescriptor);
+}
+
+Paddleboat_ErrorCode GameControllerManager::stopInputRecording() {
+    GameControllerManager *gcm = getInstance();
+    if (!gcm) {
+        return PADDLEBOAT_ERROR_NOT_INITIALIZED;
+    }
+    return gcm->mInputRecorder.stop();
+}
+
+Paddleboat_ErrorCode GameControllerManager::setMotionDataBufferingEnabled(
+    const bool enabled,
+    Paddleboat_Integrated_Motion_Sensor_Flags integratedFlags,
+    const Paddleboat_Motion_Data_Filter *filter) {
+    Paddleboat_ErrorCode errorCode = PADDLEBOAT_NO_ERROR;
+    GameControllerManager *gcm = getInstance();
+    if (gcm) {
+        Paddleboat_Motion_Data_Filter bufferFilter = {1, 0.0f};
+        if (filter != nullptr) {
+            bufferFilter = *filter;
+        }
+        if ((integratedFlags & gcm->mIntegratedSensorFlags) != integratedFlags) {
+            // Return an error if requesting an unavailable integrated sensor
+            errorCode = PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED;
+        } else if (bufferFilter.downsampleFactor < 1 ||
+                   !(bufferFilter.lowPassWeight >= 0.0f &&
+                     bufferFilter.lowPassWeight < 1.0f)) {
+            errorCode = PADDLEBOAT_ERROR_INVALID_PARAMETER;
+        } else {
+            std::lock_guard<std::mutex> lock(gcm->mUpdateMutex);
+            if (enabled && !gcm->mMotionBufferStorage) {
+                gcm->mMotionBufferStorage =
+                        std::make_unique<GameControllerMotionBuffer[]>(
+                                MOTION_BUFFER_COUNT);
+                gcm->mMotionBuffers.store(gcm->mMotionBufferStorage.get(),
+                                          std::memory_order_release);
+            }
+            gcm->mMotionDataFilter.store(bufferFilter);
+            gcm->mMotionDataBufferFlags =
+                    enabled ? integratedFlags : PADDLEBOAT_INTEGRATED_SENSOR_NONE;
+            gcm->mMotionDataBuffering.store(enabled, std::memory_order_release);
+            // Mark to call the managed side with the updated flags on the next
+            // update
+            gcm->mActiveSensorFlagsDirty = true;
+        }
+    } else {
+        errorCode = PADDLEBOAT_ERROR_NOT_INITIALIZED;
+    }
+    return errorCode;
+}
+
+Paddleboat_ErrorCode GameControllerManager::getMotionData(
+    const int32_t controllerIndex, const int32_t maxSamples,
+    Paddleboat_Motion_Data *samples, int32_t *sampleCount) {
+    Paddleboat_ErrorCode errorCode = PADDLEBOAT_NO_ERROR;
+    if (samples != nullptr && sampleCount != nullptr && maxSamples >= 0) {
+        *sampleCount = 0;
+        if ((controllerIndex >= 0 &&
+             controllerIndex < PADDLEBOAT_MAX_CONTROLLERS) ||
+            controllerIndex == PADDLEBOAT_INTEGRATED_SENSOR_INDEX) {
+            GameControllerManager *gcm = getInstance();
+            if (gcm) {
+                // Like getControllerHistory, this does not lock mUpdateMutex,
+                // the buffers are single producer, single consumer queues
+                GameControllerMotionBuffer *buffers =
+                        gcm->mMotionBuffers.load(std::memory_order_acquire);
+                if (buffers != nullptr) {
+                    const int32_t bufferIndex =
+                            controllerIndex == PADDLEBOAT_INTEGRATED_SENSOR_INDEX
+                                    ? PADDLEBOAT_MAX_CONTROLLERS
+                                    : controllerIndex;
+                    *sampleCount =
+                            buffers[bufferIndex].drain(maxSamples, samples);
+                } else {
+                    errorCode = PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED;
+                }
+            } else {
+                errorCode = PADDLEBOAT_ERROR_NOT_INITIALIZED;
+            }
+        } else {
+            errorCode = PADDLEBOAT_ERROR_INVALID_CONTROLLER_INDEX;
+        }
+    } else {
+        errorCode = PADDLEBOAT_ERROR_INVALID_PARAMETER;
+    }
+    return errorCode;
+}
+
 void GameControllerManager::setMouseStatusCallback(
     Paddleboat_MouseStatusCallback statusCallback, void *userData) {
     GameControllerManager *gcm = getInstance();
@@ -1492,6 +1712,7 @@ void GameControllerManager::updateBattery(JNIEnv *env) {
                     controllerData.battery.batteryStatus =
                         static_cast<Paddleboat_BatteryStatus>(batteryStatus -
                                                               1);
+                    mGameControllers[i].publishControllerData();
                 }
             }
         }
@@ -1513,22 +1734,10 @@ Paddleboat_ErrorCode GameControllerManager::addControllerRemapDataFromFd(
     Paddleboat_ErrorCode result = PADDLEBOAT_ERROR_NOT_INITIALIZED;
     GameControllerManager *gcm = getInstance();
     if (gcm) {
-        struct stat fileStat;
-        // assume file i/o failed unless we reach addControllerRemapDataFromFileBuffer, which
-        // returns its own error code result
-        result = PADDLEBOAT_ERROR_FILE_IO;
-        if (fstat(fileDescriptor, &fileStat) == 0) {
-            const size_t fileSize = static_cast<size_t>(fileStat.st_size);
-            void *fileBuffer = malloc(fileStat.st_size);
-            if (fileBuffer != nullptr) {
-                if (read(fileDescriptor, fileBuffer, fileSize) == static_cast<ssize_t>(fileSize)) {
-                    result = GameControllerManager::addControllerRemapDataFromFileBuffer(addMode,
-                        reinterpret_cast<const Paddleboat_Controller_Mapping_File_Header *>
-                        (fileBuffer), fileSize);
-                }
-                free(fileBuffer);
-            }
-        }
+        // The file is mapped and its entries are read in place, rather than
+        // reading it into a buffer to merge into the internal tables
+        std::lock_guard<std::mutex> lock(gcm->mUpdateMutex);
+        result = gcm->mMappingDatabase.addMappingFileDescriptor(addMode, fileDescriptor);
     }
     return result;
 }
@@ -1540,20 +1749,9 @@ Paddleboat_ErrorCode GameControllerManager::addControllerRemapDataFromFileBuffer
     Paddleboat_ErrorCode result = PADDLEBOAT_ERROR_NOT_INITIALIZED;
     GameControllerManager *gcm = getInstance();
     if (gcm) {
-        result = GameControllerMappingUtils::validateMapFile(mappingFileHeader,
-                                                             mappingFileBufferSize);
-        if (result == PADDLEBOAT_NO_ERROR) {
-            switch (addMode) {
-                case PADDLEBOAT_REMAP_ADD_MODE_DEFAULT:
-                    result = GameControllerMappingUtils::mergeControllerRemapData(
-                            mappingFileHeader, mappingFileBufferSize, gcm->mMappingInfo);
-                    break;
-                case PADDLEBOAT_REMAP_ADD_MODE_REPLACE_ALL:
-                    result = GameControllerMappingUtils::overwriteControllerRemapData(
-                            mappingFileHeader, mappingFileBufferSize, gcm->mMappingInfo);
-                    break;
-            }
-        }
+        std::lock_guard<std::mutex> lock(gcm->mUpdateMutex);
+        result = gcm->mMappingDatabase.addMappingFileBuffer(addMode, mappingFileHeader,
+                                                            mappingFileBufferSize);
     }
     return result;
 }
@@ -1576,19 +1774,14 @@ int32_t GameControllerManager::getControllerRemapTableData(
 }
 
 const Paddleboat_Controller_Mapping_File_Controller_Entry *
-GameControllerManager::getMapForController(const GameController &gameController) {
-    const Paddleboat_Controller_Mapping_File_Controller_Entry *returnEntry = nullptr;
+GameControllerManager::getMapForController(
+    const GameController &gameController,
+    const Paddleboat_Controller_Mapping_File_Axis_Entry **axisEntry,
+    const Paddleboat_Controller_Mapping_File_Button_Entry **buttonEntry) {
     const GameControllerDeviceInfo &deviceInfo = gameController.getDeviceInfo();
-    MappingTableSearch mapSearch(&mMappingInfo.mControllerTable[0],
-                                 mMappingInfo.mControllerTableEntryCount);
-    mapSearch.initSearchParameters(deviceInfo.getInfo().mVendorId,
-                                   deviceInfo.getInfo().mProductId, mApiLevel,
-                                   mApiLevel);
-    bool success = GameControllerMappingUtils::findMatchingMapEntry(&mapSearch);
-    if (success) {
-        returnEntry = &mapSearch.mappingRoot[mapSearch.tableIndex];
-    }
-    return returnEntry;
+    return mMappingDatabase.findMapping(deviceInfo.getInfo().mVendorId,
+                                        deviceInfo.getInfo().mProductId, mApiLevel,
+                                        axisEntry, buttonEntry);
 }
 
 }  // namespace paddleboat
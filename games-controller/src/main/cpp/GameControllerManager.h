@@ -19,10 +19,15 @@
 #include <android/input.h>
 #include <jni.h>
 
+#include <atomic>
+#include <memory>
 #include <mutex>
 
 #include "GameController.h"
-#include "GameControllerMappingInfo.h"
+#include "GameControllerInputRecording.h"
+#include "GameControllerMappingDatabase.h"
+#include "GameControllerMotionBuffer.h"
+#include "SeqLock.h"
 #include "ThreadUtil.h"
 
 namespace paddleboat {
@@ -36,6 +41,9 @@ class GameControllerManager {
 
   static constexpr int32_t MAX_MOUSE_DEVICES = 2;
   static constexpr int32_t INVALID_MOUSE_ID = -1;
+  // A motion data buffer for each controller, followed by the buffer of the
+  // integrated sensors
+  static constexpr int32_t MOTION_BUFFER_COUNT = PADDLEBOAT_MAX_CONTROLLERS + 1;
 
   // Assuming update is getting called at 60Hz, wait one minute in between
   // checking battery status
@@ -93,6 +101,26 @@ class GameControllerManager {
       const int32_t controllerIndex,
       Paddleboat_Controller_Data *controllerData);
 
+  static Paddleboat_ErrorCode setControllerHistoryEnabled(const bool enabled);
+
+  static Paddleboat_ErrorCode getControllerHistory(
+      const int32_t controllerIndex, const int32_t maxEntries,
+      Paddleboat_Controller_History_Entry *entries, int32_t *entryCount);
+
+  static Paddleboat_ErrorCode startInputRecording(const int fileDescriptor);
+
+  static Paddleboat_ErrorCode stopInputRecording();
+
+  static Paddleboat_ErrorCode setMotionDataBufferingEnabled(
+      const bool enabled,
+      Paddleboat_Integrated_Motion_Sensor_Flags integratedFlags,
+      const Paddleboat_Motion_Data_Filter *filter);
+
+  static Paddleboat_ErrorCode getMotionData(const int32_t controllerIndex,
+                                            const int32_t maxSamples,
+                                            Paddleboat_Motion_Data *samples,
+                                            int32_t *sampleCount);
+
   static Paddleboat_ErrorCode getControllerInfo(
       const int32_t controllerIndex, Paddleboat_Controller_Info *deviceInfo);
 
@@ -141,6 +169,9 @@ class GameControllerManager {
   // Called from the JNI bridge functions
   static GameControllerDeviceInfo *onConnection();
 
+  // Called once the device info returned by onConnection is filled in
+  static void onConnectionInfoReady(const GameControllerDeviceInfo &deviceInfo);
+
   static void onDisconnection(const int32_t deviceId);
 
   static void onKeyboardConnection(const int32_t deviceId);
@@ -168,6 +199,10 @@ class GameControllerManager {
   const float *getAxisValuesFromGameActivityMotionEvent(
       const void *event, const size_t eventSize, const uint32_t pointerIndex);
 
+  void getHistoryFromGameActivityMotionEvent(
+      const void *event, const size_t eventSize,
+      GameController::GameActivityMotionHistory &history);
+
   Paddleboat_ErrorCode initMethods(JNIEnv *env);
 
   bool isLightTypeSupported(const Paddleboat_Controller_Info &controllerInfo,
@@ -194,8 +229,18 @@ class GameControllerManager {
 
   void releaseGlobals(JNIEnv *env);
 
+  // Returns the controller index, or PADDLEBOAT_INTEGRATED_SENSOR_INDEX, of
+  // the device reporting motion data, -1 if it is not a connected controller
+  int32_t getMotionDataControllerIndex(const int32_t deviceId);
+
+  void bufferMotionData(const int32_t controllerIndex, const int32_t deviceId,
+                        const Paddleboat_Motion_Data &motionData);
+
   const Paddleboat_Controller_Mapping_File_Controller_Entry *
-  getMapForController(const GameController &gameController);
+  getMapForController(
+      const GameController &gameController,
+      const Paddleboat_Controller_Mapping_File_Axis_Entry **axisEntry,
+      const Paddleboat_Controller_Mapping_File_Button_Entry **buttonEntry);
 
   bool mInitialized = false;
   bool mGCMClassInitialized = false;
@@ -223,13 +268,23 @@ class GameControllerManager {
 
   uint64_t mActiveAxisMask = 0;
 
-  GameControllerMappingInfo mMappingInfo;
+  // Written under mUpdateMutex
+  GameControllerMappingDatabase mMappingDatabase;
 
   Paddleboat_MotionDataCallback mMotionDataCallback = nullptr;
   void *mMotionDataCallbackUserData = nullptr;
   Paddleboat_Integrated_Motion_Sensor_Flags mMotionDataCallbackFlags =
       PADDLEBOAT_INTEGRATED_SENSOR_NONE;
 
+  // Motion data buffering, read by the thread delivering sensor events
+  std::atomic<bool> mMotionDataBuffering{false};
+  SeqLock<Paddleboat_Motion_Data_Filter> mMotionDataFilter;
+  Paddleboat_Integrated_Motion_Sensor_Flags mMotionDataBufferFlags =
+      PADDLEBOAT_INTEGRATED_SENSOR_NONE;
+  std::unique_ptr<GameControllerMotionBuffer[]> mMotionBufferStorage;
+  // mMotionBufferStorage, readable by getMotionData without the update lock
+  std::atomic<GameControllerMotionBuffer *> mMotionBuffers{nullptr};
+
   GameController mGameControllers[PADDLEBOAT_MAX_CONTROLLERS];
   Paddleboat_ControllerStatusCallback mStatusCallback = nullptr;
   void *mStatusCallbackUserData = nullptr;
@@ -248,8 +303,13 @@ class GameControllerManager {
   void *mMouseCallbackUserData = nullptr;
 
   std::mutex mUpdateMutex;
+
+  GameControllerInputRecorder mInputRecorder;
   static std::mutex sInstanceMutex;
   static std::unique_ptr<GameControllerManager> sInstance
       GUARDED_BY(sInstanceMutex);
+  // sInstance, readable without locking sInstanceMutex on the input and
+  // controller data paths
+  static std::atomic<GameControllerManager *> sInstancePointer;
 };
 }  // namespace paddleboat
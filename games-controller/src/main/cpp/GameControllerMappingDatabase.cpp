@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GameControllerMappingDatabase.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "GameControllerMappingUtils.h"
+#include "InternalControllerTable.h"
+
+namespace paddleboat {
+
+struct GameControllerMappingDatabase::MappingLayer {
+    ~MappingLayer() {
+        if (mappedAddress != nullptr) {
+            munmap(mappedAddress, mappedSize);
+        }
+    }
+
+    void setTables(const Paddleboat_Controller_Mapping_File_Header
+                           *mappingFileHeader) {
+        const uint8_t *fileStart =
+                reinterpret_cast<const uint8_t *>(mappingFileHeader);
+        axisTable = reinterpret_cast<
+                const Paddleboat_Controller_Mapping_File_Axis_Entry *>(
+                fileStart + mappingFileHeader->axisTableOffset);
+        buttonTable = reinterpret_cast<
+                const Paddleboat_Controller_Mapping_File_Button_Entry *>(
+                fileStart + mappingFileHeader->buttonTableOffset);
+        controllerTable = reinterpret_cast<
+                const Paddleboat_Controller_Mapping_File_Controller_Entry *>(
+                fileStart + mappingFileHeader->controllerTableOffset);
+        controllerTableEntryCount =
+                mappingFileHeader->controllerTableEntryCount;
+    }
+
+    const Paddleboat_Controller_Mapping_File_Axis_Entry *axisTable = nullptr;
+    const Paddleboat_Controller_Mapping_File_Button_Entry *buttonTable =
+            nullptr;
+    const Paddleboat_Controller_Mapping_File_Controller_Entry *controllerTable =
+            nullptr;
+    uint32_t controllerTableEntryCount = 0;
+    // The memory holding a mapping file, either mapped or copied. Neither is
+    // set for the built-in tables.
+    void *mappedAddress = nullptr;
+    size_t mappedSize = 0;
+    std::unique_ptr<uint8_t[]> fileCopy;
+    // Searched when this layer has no entry for a device
+    std::unique_ptr<MappingLayer> lowerLayer;
+};
+
+GameControllerMappingDatabase::GameControllerMappingDatabase()
+        : mTopLayer(std::make_unique<MappingLayer>()) {
+    const Paddleboat_Internal_Mapping_Header *mappingHeader =
+            GetInternalMappingHeader();
+    mTopLayer->axisTable = mappingHeader->axisTable;
+    mTopLayer->buttonTable = mappingHeader->buttonTable;
+    mTopLayer->controllerTable = mappingHeader->controllerTable;
+    mTopLayer->controllerTableEntryCount =
+            mappingHeader->controllerTableEntryCount;
+}
+
+GameControllerMappingDatabase::~GameControllerMappingDatabase() {
+    // Release the layers iteratively rather than by recursive destruction
+    while (mTopLayer) {
+        mTopLayer = std::move(mTopLayer->lowerLayer);
+    }
+}
+
+Paddleboat_ErrorCode GameControllerMappingDatabase::addMappingFileDescriptor(
+        const Paddleboat_Remap_Addition_Mode addMode,
+        const int fileDescriptor) {
+    struct stat fileStat;
+    if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size <= 0) {
+        return PADDLEBOAT_ERROR_FILE_IO;
+    }
+    const size_t fileSize = static_cast<size_t>(fileStat.st_size);
+    void *mappedAddress = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE,
+                               fileDescriptor, 0);
+    if (mappedAddress == MAP_FAILED) {
+        return PADDLEBOAT_ERROR_FILE_IO;
+    }
+    std::unique_ptr<MappingLayer> layer = std::make_unique<MappingLayer>();
+    layer->mappedAddress = mappedAddress;
+    layer->mappedSize = fileSize;
+    return addLayer(
+            addMode,
+            reinterpret_cast<const Paddleboat_Controller_Mapping_File_Header *>(
+                    mappedAddress),
+            fileSize, std::move(layer));
+}
+
+Paddleboat_ErrorCode GameControllerMappingDatabase::addMappingFileBuffer(
+        const Paddleboat_Remap_Addition_Mode addMode,
+        const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader,
+        const size_t mappingFileBufferSize) {
+    std::unique_ptr<MappingLayer> layer = std::make_unique<MappingLayer>();
+    layer->fileCopy = std::make_unique<uint8_t[]>(mappingFileBufferSize);
+    memcpy(layer->fileCopy.get(), mappingFileHeader, mappingFileBufferSize);
+    const uint8_t *fileCopy = layer->fileCopy.get();
+    return addLayer(
+            addMode,
+            reinterpret_cast<const Paddleboat_Controller_Mapping_File_Header *>(
+                    fileCopy),
+            mappingFileBufferSize, std::move(layer));
+}
+
+Paddleboat_ErrorCode GameControllerMappingDatabase::addLayer(
+        const Paddleboat_Remap_Addition_Mode addMode,
+        const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader,
+        const size_t mappingFileBufferSize,
+        std::unique_ptr<MappingLayer> layer) {
+    Paddleboat_ErrorCode result = GameControllerMappingUtils::validateMapFile(
+            mappingFileHeader, mappingFileBufferSize);
+    if (result == PADDLEBOAT_NO_ERROR) {
+        result = GameControllerMappingUtils::validateMapFileEntries(
+                mappingFileHeader);
+    }
+    if (result != PADDLEBOAT_NO_ERROR) {
+        return result;
+    }
+    layer->setTables(mappingFileHeader);
+
+    switch (addMode) {
+        case PADDLEBOAT_REMAP_ADD_MODE_DEFAULT:
+            layer->lowerLayer = std::move(mTopLayer);
+            break;
+        case PADDLEBOAT_REMAP_ADD_MODE_REPLACE_ALL:
+            while (mTopLayer) {
+                mTopLayer = std::move(mTopLayer->lowerLayer);
+            }
+            break;
+        default:
+            return PADDLEBOAT_ERROR_INVALID_PARAMETER;
+    }
+    mTopLayer = std::move(layer);
+    return PADDLEBOAT_NO_ERROR;
+}
+
+const Paddleboat_Controller_Mapping_File_Controller_Entry *
+GameControllerMappingDatabase::findMapping(
+        const int32_t vendorId, const int32_t productId, const int32_t apiLevel,
+        const Paddleboat_Controller_Mapping_File_Axis_Entry **axisEntry,
+        const Paddleboat_Controller_Mapping_File_Button_Entry **buttonEntry)
+        const {
+    for (const MappingLayer *layer = mTopLayer.get(); layer != nullptr;
+         layer = layer->lowerLayer.get()) {
+        // findMatchingMapEntry only reads the table
+        Paddleboat_Controller_Mapping_File_Controller_Entry *controllerTable =
+                const_cast<Paddleboat_Controller_Mapping_File_Controller_Entry
+                                   *>(layer->controllerTable);
+        MappingTableSearch mapSearch(
+                controllerTable,
+                static_cast<int32_t>(layer->controllerTableEntryCount));
+        mapSearch.initSearchParameters(vendorId, productId, apiLevel,
+                                       apiLevel);
+        if (GameControllerMappingUtils::findMatchingMapEntry(&mapSearch)) {
+            const Paddleboat_Controller_Mapping_File_Controller_Entry
+                    *controllerEntry =
+                            &layer->controllerTable[mapSearch.tableIndex];
+            *axisEntry = &layer->axisTable[controllerEntry->axisTableIndex];
+            *buttonEntry =
+                    &layer->buttonTable[controllerEntry->buttonTableIndex];
+            return controllerEntry;
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace paddleboat
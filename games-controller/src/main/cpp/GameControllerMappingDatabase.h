@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "GameControllerMappingFile.h"
+#include "paddleboat.h"
+
+namespace paddleboat {
+
+// The controller mapping tables, kept as a stack of layers whose entries are
+// read in place: the built-in InternalControllerTable at the bottom, then the
+// mapping files added by the game, newest on top. A file is validated once
+// when it is added, so lookups neither copy nor check its entries, and the
+// built-in entries are never copied.
+class GameControllerMappingDatabase {
+ public:
+  GameControllerMappingDatabase();
+  ~GameControllerMappingDatabase();
+
+  GameControllerMappingDatabase(const GameControllerMappingDatabase &) =
+      delete;
+  GameControllerMappingDatabase &operator=(
+      const GameControllerMappingDatabase &) = delete;
+
+  // Memory maps a mapping file read-only and adds it. The file descriptor
+  // can be closed once this returns.
+  Paddleboat_ErrorCode addMappingFileDescriptor(
+      const Paddleboat_Remap_Addition_Mode addMode, const int fileDescriptor);
+
+  // Copies a mapping file buffer and adds it, the buffer is not retained
+  Paddleboat_ErrorCode addMappingFileBuffer(
+      const Paddleboat_Remap_Addition_Mode addMode,
+      const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader,
+      const size_t mappingFileBufferSize);
+
+  // Returns the controller entry for a device at an API level, or nullptr,
+  // along with its axis and button entries. The entries of the newest layer
+  // with a match are used. Entries stay valid until a file is added.
+  const Paddleboat_Controller_Mapping_File_Controller_Entry *findMapping(
+      const int32_t vendorId, const int32_t productId, const int32_t apiLevel,
+      const Paddleboat_Controller_Mapping_File_Axis_Entry **axisEntry,
+      const Paddleboat_Controller_Mapping_File_Button_Entry **buttonEntry)
+      const;
+
+ private:
+  struct MappingLayer;
+
+  // Validates the file held by a layer and pushes the layer, or discards it
+  Paddleboat_ErrorCode addLayer(
+      const Paddleboat_Remap_Addition_Mode addMode,
+      const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader,
+      const size_t mappingFileBufferSize, std::unique_ptr<MappingLayer> layer);
+
+  std::unique_ptr<MappingLayer> mTopLayer;
+};
+
+}  // namespace paddleboat
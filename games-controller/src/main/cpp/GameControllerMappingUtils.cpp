@@ -16,6 +16,9 @@
 
 #include "GameControllerMappingUtils.h"
 
+#include <algorithm>
+#include <memory>
+
 #include "GameControllerManager.h"
 
 extern "C" {
@@ -24,6 +27,89 @@ uint32_t Paddleboat_getVersion();
 
 namespace paddleboat {
 
+// Open addressing hash index of the entries of a mapping table, so merging
+// a table finds the existing entry matching each new entry in constant time
+// instead of comparing it with every existing entry.
+class MappingTableIndex {
+public:
+    explicit MappingTableIndex(const uint32_t entryCount) {
+        // Keep the load factor at or below one half
+        uint32_t slotCount = 16;
+        while (slotCount < entryCount * 2) {
+            slotCount <<= 1;
+        }
+        mSlotMask = slotCount - 1;
+        mSlotEntries = std::make_unique<uint32_t[]>(slotCount);
+        mSlotHashes = std::make_unique<uint32_t[]>(slotCount);
+    }
+
+    void addEntry(const uint32_t hash, const uint32_t entryIndex) {
+        uint32_t slot = hash & mSlotMask;
+        while (mSlotEntries[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & mSlotMask;
+        }
+        mSlotEntries[slot] = entryIndex + 1;
+        mSlotHashes[slot] = hash;
+    }
+
+    // Returns the lowest index added with this hash for which entryMatches
+    // is true, or -1. Linear probing keeps the entries with the same hash in
+    // the order they were added.
+    template <typename EntryMatches>
+    int32_t findEntry(const uint32_t hash, EntryMatches entryMatches) const {
+        for (uint32_t slot = hash & mSlotMask;
+             mSlotEntries[slot] != EMPTY_SLOT;
+             slot = (slot + 1) & mSlotMask) {
+            const uint32_t entryIndex = mSlotEntries[slot] - 1;
+            if (mSlotHashes[slot] == hash && entryMatches(entryIndex)) {
+                return static_cast<int32_t>(entryIndex);
+            }
+        }
+        return -1;
+    }
+
+    static uint32_t hashString(
+            const Paddleboat_Controller_Mapping_File_String_Entry &entry) {
+        // FNV-1a over the characters compared by strncmp
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < PADDLEBOAT_STRING_TABLE_ENTRY_MAX_SIZE &&
+                           entry.stringTableEntry[i] != '\0'; ++i) {
+            hash = (hash ^ static_cast<uint8_t>(entry.stringTableEntry[i])) *
+                   16777619u;
+        }
+        return hash;
+    }
+
+    static uint32_t hashIndex(const uint32_t index) {
+        return index * 2654435761u;
+    }
+
+private:
+    static constexpr uint32_t EMPTY_SLOT = 0;
+
+    uint32_t mSlotMask = 0;
+    // Index + 1 of the entry in each slot, EMPTY_SLOT if unused
+    std::unique_ptr<uint32_t[]> mSlotEntries;
+    std::unique_ptr<uint32_t[]> mSlotHashes;
+};
+
+// Orders controller entries by vendorId, then productId
+static bool controllerDeviceLess(
+        const Paddleboat_Controller_Mapping_File_Controller_Entry &entry,
+        const int32_t vendorId, const int32_t productId) {
+    return entry.vendorId < vendorId ||
+           (entry.vendorId == vendorId && entry.productId < productId);
+}
+
+// Checks a table of a mapping file lies within the file buffer
+static bool mapFileTableFits(const uint64_t tableOffset,
+                             const uint32_t tableEntryCount,
+                             const size_t entrySize,
+                             const size_t mappingFileBufferSize) {
+    return tableOffset <= mappingFileBufferSize &&
+           tableEntryCount <= (mappingFileBufferSize - tableOffset) / entrySize;
+}
+
 MappingTableSearch::MappingTableSearch()
         : mappingRoot(nullptr),
           vendorId(0),
@@ -60,45 +146,38 @@ void MappingTableSearch::initSearchParameters(const int32_t newVendorId,
 
 bool GameControllerMappingUtils::findMatchingMapEntry(
         MappingTableSearch *searchEntry) {
-    int32_t currentIndex = 0;
-
-    // Starting out with a linear search. Updating the map table is something
-    // that should only ever be done once at startup, if it actually takes an
-    // appreciable time to execute when working with a big remap dictionary,
-    // this is low-hanging fruit to optimize.
+    // The table is sorted by vendorId and productId, binary search for the
+    // first entry of the device, then check the API ranges of its entries.
     const Paddleboat_Controller_Mapping_File_Controller_Entry *mapRoot =
             searchEntry->mappingRoot;
-    while (currentIndex < searchEntry->tableEntryCount) {
-        const Paddleboat_Controller_Mapping_File_Controller_Entry &mapEntry =
-                mapRoot[currentIndex];
-        if (mapEntry.vendorId > searchEntry->vendorId) {
-            // Passed by the search vendorId value, so we don't already exist in
-            // the table, set the current index as the insert point and bail
-            searchEntry->tableIndex = currentIndex;
-            return false;
-        } else if (searchEntry->vendorId == mapEntry.vendorId) {
-            if (mapEntry.productId > searchEntry->productId) {
-                // Passed by the search productId value, so we don't already
-                // exist in the table, set the current index as the insert point
-                // and bail
-                searchEntry->tableIndex = currentIndex;
-                return false;
-            } else if (searchEntry->productId == mapEntry.productId) {
-                // Any overlap of the min/max API range is treated as matching
-                // an existing entry
-                if ((searchEntry->minApi >= mapEntry.minimumEffectiveApiLevel &&
-                     searchEntry->minApi <=
-                     mapEntry.maximumEffectiveApiLevel) ||
-                    (searchEntry->minApi >= mapEntry.minimumEffectiveApiLevel &&
-                     mapEntry.maximumEffectiveApiLevel == 0)) {
-                    searchEntry->tableIndex = currentIndex;
-                    return true;
-                }
-            }
+    const Paddleboat_Controller_Mapping_File_Controller_Entry *mapEnd =
+            mapRoot + std::max(searchEntry->tableEntryCount, 0);
+    const Paddleboat_Controller_Mapping_File_Controller_Entry *deviceEntry =
+            std::lower_bound(
+                    mapRoot, mapEnd, searchEntry,
+                    [](const Paddleboat_Controller_Mapping_File_Controller_Entry
+                               &mapEntry,
+                       const MappingTableSearch *search) {
+                        return controllerDeviceLess(mapEntry, search->vendorId,
+                                                    search->productId);
+                    });
+    while (deviceEntry != mapEnd &&
+           deviceEntry->vendorId == searchEntry->vendorId &&
+           deviceEntry->productId == searchEntry->productId) {
+        // Any overlap of the min/max API range is treated as matching
+        // an existing entry
+        if ((searchEntry->minApi >= deviceEntry->minimumEffectiveApiLevel &&
+             searchEntry->minApi <= deviceEntry->maximumEffectiveApiLevel) ||
+            (searchEntry->minApi >= deviceEntry->minimumEffectiveApiLevel &&
+             deviceEntry->maximumEffectiveApiLevel == 0)) {
+            searchEntry->tableIndex =
+                    static_cast<int32_t>(deviceEntry - mapRoot);
+            return true;
         }
-        ++currentIndex;
+        ++deviceEntry;
     }
-    searchEntry->tableIndex = currentIndex;
+    // Not in the table, the insert point is after any entries of the device
+    searchEntry->tableIndex = static_cast<int32_t>(deviceEntry - mapRoot);
     return false;
 }
 
@@ -146,6 +225,7 @@ Paddleboat_ErrorCode GameControllerMappingUtils::insertMapEntry(
                     &searchEntry->mappingRoot[searchEntry->tableIndex],
                     copySize);
         }
+        searchEntry->tableEntryCount += 1;
         doCopy = true;
     }
     if (doCopy) {
@@ -175,42 +255,31 @@ const Paddleboat_Controller_Mapping_File_Controller_Entry *
     //    vendorId
     //   productId
     //      minApi
-    int32_t currentIndex = 0;
-    int32_t previousVendorId = -1;
-    while (currentIndex < tableEntryCount) {
-        if (mappingRoot[currentIndex].vendorId < previousVendorId) {
+    // Each entry only needs to be checked against the previous one.
+    for (int32_t currentIndex = 1; currentIndex < tableEntryCount;
+         ++currentIndex) {
+        const Paddleboat_Controller_Mapping_File_Controller_Entry &previous =
+                mappingRoot[currentIndex - 1];
+        const Paddleboat_Controller_Mapping_File_Controller_Entry &current =
+                mappingRoot[currentIndex];
+        if (current.vendorId < previous.vendorId) {
             // failure in vendorId order, return the offending entry
-            return &mappingRoot[currentIndex];
+            return &current;
         }
-
-        int32_t previousProductId = mappingRoot[currentIndex].productId;
-        int32_t previousMinApi =
-                mappingRoot[currentIndex].minimumEffectiveApiLevel;
-        int32_t previousMaxApi =
-                mappingRoot[currentIndex].maximumEffectiveApiLevel;
-        previousVendorId = mappingRoot[currentIndex++].vendorId;
-
-        while (currentIndex < tableEntryCount &&
-               mappingRoot[currentIndex].vendorId == previousVendorId) {
-            while (currentIndex < tableEntryCount &&
-                   mappingRoot[currentIndex].productId == previousProductId) {
-                if (mappingRoot[currentIndex].minimumEffectiveApiLevel <
-                    previousMinApi ||
-                    mappingRoot[currentIndex].minimumEffectiveApiLevel <
-                    previousMaxApi) {
-                    // failure in API order, return the offending entry
-                    return &mappingRoot[currentIndex];
-                }
-                previousMinApi =
-                        mappingRoot[currentIndex].minimumEffectiveApiLevel;
-                previousMaxApi =
-                        mappingRoot[currentIndex++].maximumEffectiveApiLevel;
-            }
-            if (mappingRoot[currentIndex].productId < previousProductId) {
-                // failure in productId order, return the offending entry
-                return &mappingRoot[currentIndex];
-            }
-            previousProductId = mappingRoot[currentIndex++].productId;
+        if (current.vendorId != previous.vendorId) {
+            continue;
+        }
+        if (current.productId < previous.productId) {
+            // failure in productId order, return the offending entry
+            return &current;
+        }
+        if (current.productId == previous.productId &&
+            (current.minimumEffectiveApiLevel <
+                     previous.minimumEffectiveApiLevel ||
+             current.minimumEffectiveApiLevel <
+                     previous.maximumEffectiveApiLevel)) {
+            // failure in API order, return the offending entry
+            return &current;
         }
     }
 
@@ -221,6 +290,9 @@ const Paddleboat_Controller_Mapping_File_Controller_Entry *
 Paddleboat_ErrorCode GameControllerMappingUtils::validateMapFile(
             const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader,
             const size_t mappingFileBufferSize) {
+    if (mappingFileBufferSize < sizeof(Paddleboat_Controller_Mapping_File_Header)) {
+        return PADDLEBOAT_INVALID_MAPPING_DATA;
+    }
     if (mappingFileHeader->fileIdentifier != PADDLEBOAT_MAPPING_FILE_IDENTIFIER) {
         return PADDLEBOAT_INVALID_MAPPING_DATA;
     }
@@ -237,32 +309,65 @@ Paddleboat_ErrorCode GameControllerMappingUtils::validateMapFile(
     }
     // Bounds check against specified buffer size, ensure all internal data
     // ranges fit in the buffer
-    if (mappingFileBufferSize < sizeof(Paddleboat_Controller_Mapping_File_Header)) {
+    if (!mapFileTableFits(mappingFileHeader->axisTableOffset,
+                          mappingFileHeader->axisTableEntryCount,
+                          sizeof(Paddleboat_Controller_Mapping_File_Axis_Entry),
+                          mappingFileBufferSize) ||
+        !mapFileTableFits(mappingFileHeader->buttonTableOffset,
+                          mappingFileHeader->buttonTableEntryCount,
+                          sizeof(Paddleboat_Controller_Mapping_File_Button_Entry),
+                          mappingFileBufferSize) ||
+        !mapFileTableFits(mappingFileHeader->controllerTableOffset,
+                          mappingFileHeader->controllerTableEntryCount,
+                          sizeof(Paddleboat_Controller_Mapping_File_Controller_Entry),
+                          mappingFileBufferSize) ||
+        !mapFileTableFits(mappingFileHeader->stringTableOffset,
+                          mappingFileHeader->stringTableEntryCount,
+                          sizeof(Paddleboat_Controller_Mapping_File_String_Entry),
+                          mappingFileBufferSize)) {
         return PADDLEBOAT_INVALID_MAPPING_DATA;
     }
+    return PADDLEBOAT_NO_ERROR;
+}
 
-    const uint8_t* fileStart = reinterpret_cast<const uint8_t*>(mappingFileHeader);
-    const ptrdiff_t maxSize = mappingFileBufferSize;
+Paddleboat_ErrorCode GameControllerMappingUtils::validateMapFileEntries(
+        const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader) {
+    const uint8_t *fileStart = reinterpret_cast<const uint8_t*>(mappingFileHeader);
+    const Paddleboat_Controller_Mapping_File_Controller_Entry *fileControllerTable =
+            reinterpret_cast<const Paddleboat_Controller_Mapping_File_Controller_Entry *>(
+                    fileStart + mappingFileHeader->controllerTableOffset);
+    const Paddleboat_Controller_Mapping_File_Axis_Entry *fileAxisTable =
+            reinterpret_cast<const Paddleboat_Controller_Mapping_File_Axis_Entry *>(
+                    fileStart + mappingFileHeader->axisTableOffset);
+    const Paddleboat_Controller_Mapping_File_Button_Entry *fileButtonTable =
+            reinterpret_cast<const Paddleboat_Controller_Mapping_File_Button_Entry *>(
+                    fileStart + mappingFileHeader->buttonTableOffset);
 
-    const uint8_t *endAxis = fileStart + mappingFileHeader->axisTableOffset +
-        (mappingFileHeader->axisTableEntryCount *
-        sizeof(Paddleboat_Controller_Mapping_File_Axis_Entry));
-    if ((endAxis - fileStart) > maxSize) {
+    // Lookups binary search the controller table
+    if (validateMapTable(fileControllerTable,
+                         static_cast<int32_t>(
+                                 mappingFileHeader->controllerTableEntryCount)) != nullptr) {
         return PADDLEBOAT_INVALID_MAPPING_DATA;
     }
-
-    const uint8_t *endButton = fileStart + mappingFileHeader->buttonTableOffset +
-        (mappingFileHeader->buttonTableEntryCount *
-        sizeof(Paddleboat_Controller_Mapping_File_Button_Entry));
-    if ((endButton - fileStart) > maxSize) {
-        return PADDLEBOAT_INVALID_MAPPING_DATA;
+    for (uint32_t i = 0; i < mappingFileHeader->controllerTableEntryCount; ++i) {
+        if (fileControllerTable[i].axisTableIndex >=
+                    mappingFileHeader->axisTableEntryCount ||
+            fileControllerTable[i].buttonTableIndex >=
+                    mappingFileHeader->buttonTableEntryCount) {
+            return PADDLEBOAT_INVALID_MAPPING_DATA;
+        }
     }
-
-    const uint8_t *endString = fileStart + mappingFileHeader->stringTableOffset +
-        (mappingFileHeader->stringTableEntryCount *
-        sizeof(Paddleboat_Controller_Mapping_File_String_Entry));
-    if ((endString - fileStart) > maxSize) {
-        return PADDLEBOAT_INVALID_MAPPING_DATA;
+    for (uint32_t i = 0; i < mappingFileHeader->axisTableEntryCount; ++i) {
+        if (fileAxisTable[i].axisNameStringTableIndex >=
+                mappingFileHeader->stringTableEntryCount) {
+            return PADDLEBOAT_INVALID_MAPPING_DATA;
+        }
+    }
+    for (uint32_t i = 0; i < mappingFileHeader->buttonTableEntryCount; ++i) {
+        if (fileButtonTable[i].buttonNameStringTableIndex >=
+                mappingFileHeader->stringTableEntryCount) {
+            return PADDLEBOAT_INVALID_MAPPING_DATA;
+        }
     }
     return PADDLEBOAT_NO_ERROR;
 }
@@ -280,18 +385,24 @@ Paddleboat_ErrorCode GameControllerMappingUtils::mergeStringTable(
     // existing table or if it needs to be added
     const uint32_t existingStringCount = *stringEntryCount;
     uint32_t currentStringCount = existingStringCount;
+    MappingTableIndex existingStrings(existingStringCount);
+    for (uint32_t existingIndex = 0; existingIndex < existingStringCount;
+         ++existingIndex) {
+        existingStrings.addEntry(
+                MappingTableIndex::hashString(stringEntries[existingIndex]),
+                existingIndex);
+    }
     for (uint32_t newIndex = 0; newIndex < newStringCount; ++newIndex) {
-        bool foundExistingMatch = false;
-        for (uint32_t existingIndex = 0; existingIndex < existingStringCount; ++existingIndex) {
-            if (strncmp(newStrings[newIndex].stringTableEntry,
-                        stringEntries[existingIndex].stringTableEntry,
-                        PADDLEBOAT_STRING_TABLE_ENTRY_MAX_SIZE) == 0) {
-                remapTable[newIndex].newIndex = existingIndex;
-                foundExistingMatch = true;
-                break;
-            }
-        }
-        if (!foundExistingMatch) {
+        const int32_t existingIndex = existingStrings.findEntry(
+                MappingTableIndex::hashString(newStrings[newIndex]),
+                [&](const uint32_t entryIndex) {
+                    return strncmp(newStrings[newIndex].stringTableEntry,
+                                   stringEntries[entryIndex].stringTableEntry,
+                                   PADDLEBOAT_STRING_TABLE_ENTRY_MAX_SIZE) == 0;
+                });
+        if (existingIndex >= 0) {
+            remapTable[newIndex].newIndex = existingIndex;
+        } else {
             if (currentStringCount >= maxStringEntryCount) {
                 // Return error if out of room in string table
                 result = PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED;
@@ -321,19 +432,27 @@ Paddleboat_ErrorCode GameControllerMappingUtils::mergeAxisTable(
     // Matching is done by name, so we have to use the string table via the remapped string index
     const uint32_t existingAxisCount = *axisEntryCount;
     uint32_t currentAxisCount = existingAxisCount;
+    MappingTableIndex existingAxis(existingAxisCount);
+    for (uint32_t existingIndex = 0; existingIndex < existingAxisCount;
+         ++existingIndex) {
+        existingAxis.addEntry(
+                MappingTableIndex::hashIndex(
+                        axisEntries[existingIndex].axisNameStringTableIndex),
+                existingIndex);
+    }
 
     for (uint32_t newIndex = 0; newIndex < newAxisCount; ++newIndex) {
-        bool foundExistingMatch = false;
         const uint32_t newAxisStringTableIndex =
                 stringRemapTable[newAxis[newIndex].axisNameStringTableIndex].newIndex;
-        for (uint32_t existingIndex = 0; existingIndex < existingAxisCount; ++existingIndex) {
-            if (axisEntries[existingIndex].axisNameStringTableIndex == newAxisStringTableIndex) {
-                axisRemapTable[newIndex].newIndex = existingIndex;
-                foundExistingMatch = true;
-                break;
-            }
-        }
-        if (!foundExistingMatch) {
+        const int32_t existingIndex = existingAxis.findEntry(
+                MappingTableIndex::hashIndex(newAxisStringTableIndex),
+                [&](const uint32_t entryIndex) {
+                    return axisEntries[entryIndex].axisNameStringTableIndex ==
+                           newAxisStringTableIndex;
+                });
+        if (existingIndex >= 0) {
+            axisRemapTable[newIndex].newIndex = existingIndex;
+        } else {
             if (currentAxisCount >= maxAxisEntryCount) {
                 // Return error if out of room in axis table
                 result = PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED;
@@ -364,27 +483,34 @@ Paddleboat_ErrorCode GameControllerMappingUtils::mergeButtonTable(
     // Matching is done by name, so we have to use the string table via the remapped string index
     const uint32_t existingButtonCount = *buttonEntryCount;
     uint32_t currentButtonCount = existingButtonCount;
+    MappingTableIndex existingButtons(existingButtonCount);
+    for (uint32_t existingIndex = 0; existingIndex < existingButtonCount;
+         ++existingIndex) {
+        existingButtons.addEntry(
+                MappingTableIndex::hashIndex(
+                        buttonEntries[existingIndex].buttonNameStringTableIndex),
+                existingIndex);
+    }
 
     for (uint32_t newIndex = 0; newIndex < newButtonCount; ++newIndex) {
-        bool foundExistingMatch = false;
         const uint32_t newButtonStringTableIndex =
                 stringRemapTable[newButton[newIndex].buttonNameStringTableIndex].newIndex;
-        for (uint32_t existingIndex = 0; existingIndex < existingButtonCount; ++existingIndex) {
-            if (buttonEntries[existingIndex].buttonNameStringTableIndex ==
-                    newButtonStringTableIndex) {
-                buttonRemapTable[newIndex].newIndex = existingIndex;
-                foundExistingMatch = true;
-                break;
-            }
-        }
-        if (!foundExistingMatch) {
+        const int32_t existingIndex = existingButtons.findEntry(
+                MappingTableIndex::hashIndex(newButtonStringTableIndex),
+                [&](const uint32_t entryIndex) {
+                    return buttonEntries[entryIndex].buttonNameStringTableIndex ==
+                           newButtonStringTableIndex;
+                });
+        if (existingIndex >= 0) {
+            buttonRemapTable[newIndex].newIndex = existingIndex;
+        } else {
             if (currentButtonCount >= maxButtonEntryCount) {
                 // Return error if out of room in axis table
                 result = PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED;
                 break;
             }
             memcpy(&buttonEntries[currentButtonCount], &newButton[newIndex],
-                   sizeof(Paddleboat_Controller_Mapping_File_Axis_Entry));
+                   sizeof(Paddleboat_Controller_Mapping_File_Button_Entry));
             buttonEntries[currentButtonCount].buttonNameStringTableIndex =
                     newButtonStringTableIndex;
             buttonRemapTable[newIndex].newIndex = currentButtonCount;
@@ -395,6 +521,95 @@ Paddleboat_ErrorCode GameControllerMappingUtils::mergeButtonTable(
     return result;
 }
 
+Paddleboat_ErrorCode GameControllerMappingUtils::mergeControllerTable(
+        const Paddleboat_Controller_Mapping_File_Controller_Entry *newControllers,
+        const uint32_t newControllerCount,
+        Paddleboat_Controller_Mapping_File_Controller_Entry *controllerEntries,
+        uint32_t *controllerEntryCount,
+        const uint32_t maxControllerEntryCount,
+        const IndexTableRemap *axisRemapTable,
+        const IndexTableRemap *buttonRemapTable) {
+    // Visit the new entries in device order, keeping the order of the entries
+    // of each device, so that both tables can be merged in a single pass.
+    std::unique_ptr<uint32_t[]> newOrder =
+            std::make_unique<uint32_t[]>(newControllerCount);
+    for (uint32_t i = 0; i < newControllerCount; ++i) {
+        newOrder[i] = i;
+    }
+    std::stable_sort(newOrder.get(), newOrder.get() + newControllerCount,
+                     [newControllers](const uint32_t a, const uint32_t b) {
+                         return controllerDeviceLess(newControllers[a],
+                                                     newControllers[b].vendorId,
+                                                     newControllers[b].productId);
+                     });
+
+    // Merge into a scratch table, so the existing table is left untouched if
+    // the result doesn't fit. The scratch table is zeroed, and has a spare
+    // entry, as insertMapEntry reads the entry at its insert point.
+    const uint32_t existingCount = *controllerEntryCount;
+    const uint32_t maxMergedCount = existingCount + newControllerCount;
+    std::unique_ptr<Paddleboat_Controller_Mapping_File_Controller_Entry[]>
+            mergedEntries = std::make_unique<
+                    Paddleboat_Controller_Mapping_File_Controller_Entry[]>(
+                    maxMergedCount + 1);
+    uint32_t mergedCount = 0;
+    uint32_t existingIndex = 0;
+    uint32_t newIndex = 0;
+    while (newIndex < newControllerCount) {
+        const Paddleboat_Controller_Mapping_File_Controller_Entry &deviceEntry =
+                newControllers[newOrder[newIndex]];
+        // Existing entries of the devices before this one are unchanged
+        while (existingIndex < existingCount &&
+               controllerDeviceLess(controllerEntries[existingIndex],
+                                    deviceEntry.vendorId,
+                                    deviceEntry.productId)) {
+            mergedEntries[mergedCount++] = controllerEntries[existingIndex++];
+        }
+        // Resolve the API ranges of the device's entries with the same insert
+        // rules as adding them one at a time
+        const uint32_t deviceStart = mergedCount;
+        while (existingIndex < existingCount &&
+               controllerEntries[existingIndex].vendorId ==
+                       deviceEntry.vendorId &&
+               controllerEntries[existingIndex].productId ==
+                       deviceEntry.productId) {
+            mergedEntries[mergedCount++] = controllerEntries[existingIndex++];
+        }
+        MappingTableSearch deviceSearch(&mergedEntries[deviceStart],
+                                        mergedCount - deviceStart);
+        deviceSearch.tableMaxEntryCount = maxMergedCount;
+        while (newIndex < newControllerCount &&
+               newControllers[newOrder[newIndex]].vendorId ==
+                       deviceEntry.vendorId &&
+               newControllers[newOrder[newIndex]].productId ==
+                       deviceEntry.productId) {
+            const Paddleboat_Controller_Mapping_File_Controller_Entry &newEntry =
+                    newControllers[newOrder[newIndex++]];
+            deviceSearch.initSearchParameters(
+                    newEntry.vendorId, newEntry.productId,
+                    newEntry.minimumEffectiveApiLevel,
+                    newEntry.maximumEffectiveApiLevel);
+            findMatchingMapEntry(&deviceSearch);
+            insertMapEntry(&newEntry, &deviceSearch, axisRemapTable,
+                           buttonRemapTable);
+        }
+        mergedCount = deviceStart + deviceSearch.tableEntryCount;
+    }
+    while (existingIndex < existingCount) {
+        mergedEntries[mergedCount++] = controllerEntries[existingIndex++];
+    }
+
+    if (mergedCount > maxControllerEntryCount) {
+        // Return error if out of room in controller table
+        return PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED;
+    }
+    memcpy(controllerEntries, mergedEntries.get(),
+           mergedCount *
+           sizeof(Paddleboat_Controller_Mapping_File_Controller_Entry));
+    *controllerEntryCount = mergedCount;
+    return PADDLEBOAT_NO_ERROR;
+}
+
 Paddleboat_ErrorCode GameControllerMappingUtils::mergeControllerRemapData(
         const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader,
         const size_t mappingFileBufferSize,
@@ -453,28 +668,15 @@ Paddleboat_ErrorCode GameControllerMappingUtils::mergeControllerRemapData(
         return mergeResult;
     }
 
-    // Loop through the controller list in the file and merge them into the internal
-    // table.
-    for (uint32_t i = 0; i < mappingFileHeader->controllerTableEntryCount; ++i) {
-        const Paddleboat_Controller_Mapping_File_Controller_Entry *fileControllerTable =
-                reinterpret_cast<const Paddleboat_Controller_Mapping_File_Controller_Entry *>(
-                        fileStart + mappingFileHeader->controllerTableOffset);
-        MappingTableSearch mapSearch(mappingInfo.mControllerTable,
-                                     mappingInfo.mControllerTableEntryCount);
-        mapSearch.initSearchParameters(fileControllerTable[i].vendorId,
-                                       fileControllerTable[i].productId,
-                                       fileControllerTable[i].minimumEffectiveApiLevel,
-                                       fileControllerTable[i].maximumEffectiveApiLevel);
-        GameControllerMappingUtils::findMatchingMapEntry(&mapSearch);
-        mergeResult = GameControllerMappingUtils::insertMapEntry(&fileControllerTable[i],
-                                                                 &mapSearch,
-                                                                 axisIndexTableRemap,
-                                                                 buttonIndexTableRemap);
-        if (mergeResult != PADDLEBOAT_NO_ERROR) {
-            break;
-        }
-        mappingInfo.mControllerTableEntryCount += 1;
-    }
+    // Controller table
+    const Paddleboat_Controller_Mapping_File_Controller_Entry *fileControllerTable =
+            reinterpret_cast<const Paddleboat_Controller_Mapping_File_Controller_Entry *>(
+                    fileStart + mappingFileHeader->controllerTableOffset);
+    mergeResult = GameControllerMappingUtils::mergeControllerTable(
+            fileControllerTable, mappingFileHeader->controllerTableEntryCount,
+            mappingInfo.mControllerTable, &mappingInfo.mControllerTableEntryCount,
+            GameControllerMappingInfo::MAX_CONTROLLER_TABLE_SIZE, axisIndexTableRemap,
+            buttonIndexTableRemap);
     return mergeResult;
 }
 
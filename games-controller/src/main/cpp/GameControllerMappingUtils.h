@@ -60,6 +60,8 @@ class GameControllerMappingUtils {
  public:
   static bool findMatchingMapEntry(MappingTableSearch *searchEntry);
 
+  // Inserts or replaces the entry at the insert point found by
+  // findMatchingMapEntry, an insert increments searchEntry->tableEntryCount
   static Paddleboat_ErrorCode insertMapEntry(
       const Paddleboat_Controller_Mapping_File_Controller_Entry *mappingData,
       MappingTableSearch *searchEntry, const IndexTableRemap *axisRemapTable,
@@ -74,6 +76,11 @@ class GameControllerMappingUtils {
       const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader,
       const size_t mappingFileBufferSize);
 
+  // Checks the entries of a file that passed validateMapFile can be used in
+  // place: the controller table is sorted and every table index is in range
+  static Paddleboat_ErrorCode validateMapFileEntries(
+      const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader);
+
   static Paddleboat_ErrorCode mergeStringTable(
       const Paddleboat_Controller_Mapping_File_String_Entry *newStrings,
       const uint32_t newStringCount,
@@ -96,6 +103,17 @@ class GameControllerMappingUtils {
       const IndexTableRemap *stringRemapTable,
       IndexTableRemap *buttonRemapTable);
 
+  // Merges new controller entries into a table sorted by device, the new
+  // entries can be in any order. The table is unchanged if the merged
+  // entries don't fit in maxControllerEntryCount.
+  static Paddleboat_ErrorCode mergeControllerTable(
+      const Paddleboat_Controller_Mapping_File_Controller_Entry *newControllers,
+      const uint32_t newControllerCount,
+      Paddleboat_Controller_Mapping_File_Controller_Entry *controllerEntries,
+      uint32_t *controllerEntryCount, const uint32_t maxControllerEntryCount,
+      const IndexTableRemap *axisRemapTable,
+      const IndexTableRemap *buttonRemapTable);
+
   static Paddleboat_ErrorCode mergeControllerRemapData(
       const Paddleboat_Controller_Mapping_File_Header *mappingFileHeader,
       const size_t mappingFileBufferSize,
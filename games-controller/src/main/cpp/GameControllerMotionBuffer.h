@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "paddleboat.h"
+
+namespace paddleboat {
+
+// Buffered motion data of a controller, or of the integrated sensors: a
+// single producer, single consumer ring buffer of filtered samples. The
+// producer is the thread delivering sensor events, the consumer is the game
+// thread draining the samples once per frame. When the buffer is full, new
+// samples are dropped.
+class GameControllerMotionBuffer {
+ public:
+  static constexpr uint32_t CAPACITY = PADDLEBOAT_MOTION_DATA_BUFFER_SIZE;
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0,
+                "Motion data buffer capacity must be a power of two");
+
+  // Producer side: filter a sample from a sensor of deviceId, and append a
+  // sample to the buffer when the filter outputs one. The filter state is
+  // restarted when the device or the filter settings change.
+  void add(const int32_t deviceId, const Paddleboat_Motion_Data_Filter &filter,
+           const Paddleboat_Motion_Data &sample) {
+    if (deviceId != mDeviceId ||
+        filter.downsampleFactor != mFilter.downsampleFactor ||
+        filter.lowPassWeight != mFilter.lowPassWeight) {
+      mDeviceId = deviceId;
+      mFilter = filter;
+      memset(mFilterStates, 0, sizeof(mFilterStates));
+    }
+    const uint32_t motionType = static_cast<uint32_t>(sample.motionType);
+    if (motionType >= MOTION_TYPE_COUNT) {
+      append(sample);
+      return;
+    }
+
+    FilterState &state = mFilterStates[motionType];
+    float values[3] = {sample.motionX, sample.motionY, sample.motionZ};
+    if (mFilter.lowPassWeight > 0.0f) {
+      // Exponential moving average, starting from the first sample
+      if (!state.primed) {
+        memcpy(state.lowPass, values, sizeof(values));
+        state.primed = true;
+      }
+      for (int i = 0; i < 3; ++i) {
+        state.lowPass[i] +=
+            (1.0f - mFilter.lowPassWeight) * (values[i] - state.lowPass[i]);
+        values[i] = state.lowPass[i];
+      }
+    }
+    if (mFilter.downsampleFactor > 1) {
+      // Output the average of each run of downsampleFactor samples
+      for (int i = 0; i < 3; ++i) {
+        state.sum[i] += values[i];
+      }
+      if (++state.sampleCount < mFilter.downsampleFactor) {
+        return;
+      }
+      const float scale = 1.0f / static_cast<float>(state.sampleCount);
+      for (int i = 0; i < 3; ++i) {
+        values[i] = state.sum[i] * scale;
+        state.sum[i] = 0.0f;
+      }
+      state.sampleCount = 0;
+    }
+
+    Paddleboat_Motion_Data filtered = sample;
+    filtered.motionX = values[0];
+    filtered.motionY = values[1];
+    filtered.motionZ = values[2];
+    append(filtered);
+  }
+
+  // Consumer side: remove up to maxSamples of the oldest samples, returns the
+  // number of samples copied
+  int32_t drain(const int32_t maxSamples, Paddleboat_Motion_Data *samples) {
+    const uint32_t readIndex = mReadIndex.load(std::memory_order_relaxed);
+    const uint32_t writeIndex = mWriteIndex.load(std::memory_order_acquire);
+    const uint32_t count = std::min(writeIndex - readIndex,
+                                    static_cast<uint32_t>(maxSamples));
+    // Copy in at most two runs, before and after the end of the buffer
+    const uint32_t first = readIndex & (CAPACITY - 1);
+    const uint32_t firstCount = std::min(count, CAPACITY - first);
+    memcpy(samples, &mSamples[first],
+           firstCount * sizeof(Paddleboat_Motion_Data));
+    memcpy(samples + firstCount, &mSamples[0],
+           (count - firstCount) * sizeof(Paddleboat_Motion_Data));
+    mReadIndex.store(readIndex + count, std::memory_order_release);
+    return static_cast<int32_t>(count);
+  }
+
+ private:
+  static constexpr uint32_t MOTION_TYPE_COUNT = 2;
+
+  struct FilterState {
+    float lowPass[3];
+    float sum[3];
+    int32_t sampleCount;
+    bool primed;
+  };
+
+  void append(const Paddleboat_Motion_Data &sample) {
+    const uint32_t writeIndex = mWriteIndex.load(std::memory_order_relaxed);
+    const uint32_t readIndex = mReadIndex.load(std::memory_order_acquire);
+    if (writeIndex - readIndex >= CAPACITY) {
+      return;
+    }
+    mSamples[writeIndex & (CAPACITY - 1)] = sample;
+    mWriteIndex.store(writeIndex + 1, std::memory_order_release);
+  }
+
+  // Written by the producer
+  std::atomic<uint32_t> mWriteIndex{0};
+  int32_t mDeviceId = -1;
+  Paddleboat_Motion_Data_Filter mFilter = {1, 0.0f};
+  FilterState mFilterStates[MOTION_TYPE_COUNT] = {};
+  Paddleboat_Motion_Data mSamples[CAPACITY];
+  // Written by the consumer
+  std::atomic<uint32_t> mReadIndex{0};
+};
+}  // namespace paddleboat
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace paddleboat {
+
+// Publishes copies of a small trivially copyable struct from a writer thread
+// to any number of reader threads without locking. The writer never waits;
+// a reader retries its copy if a store happened while it was reading, so it
+// always gets a consistent value. Stores must be serialized by the caller.
+template <typename T>
+class SeqLock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLock values must be trivially copyable");
+
+ public:
+  SeqLock() {
+    for (size_t i = 0; i < WORD_COUNT; ++i) {
+      mWords[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void store(const T &value) {
+    uint32_t words[WORD_COUNT] = {};
+    memcpy(words, &value, sizeof(T));
+    // An odd sequence number marks a store in progress
+    const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORD_COUNT; ++i) {
+      mWords[i].store(words[i], std::memory_order_relaxed);
+    }
+    mSequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  void load(T *value) const {
+    uint32_t words[WORD_COUNT];
+    uint32_t sequenceBefore = 0;
+    uint32_t sequenceAfter = 0;
+    do {
+      sequenceBefore = mSequence.load(std::memory_order_acquire);
+      for (size_t i = 0; i < WORD_COUNT; ++i) {
+        words[i] = mWords[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      sequenceAfter = mSequence.load(std::memory_order_relaxed);
+    } while ((sequenceBefore & 1) != 0 || sequenceBefore != sequenceAfter);
+    memcpy(value, words, sizeof(T));
+  }
+
+ private:
+  static constexpr size_t WORD_COUNT =
+      (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  std::atomic<uint32_t> mSequence{0};
+  std::atomic<uint32_t> mWords[WORD_COUNT];
+};
+}  // namespace paddleboat
@@ -56,6 +56,19 @@ extern "C" {
  */
 #define PADDLEBOAT_MAX_CONTROLLERS 8
 
+/**
+ * @brief Number of entries kept in the input history of each controller when
+ * it is enabled by ::Paddleboat_setControllerHistoryEnabled.
+ */
+#define PADDLEBOAT_CONTROLLER_HISTORY_SIZE 128
+
+/**
+ * @brief Number of motion data samples buffered for each controller, and for
+ * the integrated sensors, when motion data buffering is enabled by
+ * ::Paddleboat_setMotionDataBufferingEnabled.
+ */
+#define PADDLEBOAT_MOTION_DATA_BUFFER_SIZE 256
+
 /**
  * @brief The maximum number of characters, including the terminating
  * character, allowed in a string table entry
@@ -588,6 +601,19 @@ enum Paddleboat_Remap_Addition_Mode : uint32_t {
                                          ///< the current session.
 };
 
+/**
+ * @brief Flags set in `Paddleboat_Controller_History_Entry.flags`
+ */
+enum Paddleboat_Controller_History_Flags : uint32_t {
+  PADDLEBOAT_HISTORY_FLAG_HISTORICAL =
+      (1U << 0),  ///< The entry is a historical sample that was batched in
+                  ///< a motion event with a more recent sample.
+  PADDLEBOAT_HISTORY_FLAG_OVERFLOW =
+      (1U << 1)  ///< Entries were dropped before this one because the
+                 ///< history was full. `buttonsChanged` still reports all
+                 ///< the buttons that changed since the previous entry.
+};
+
 /**
  * @brief A structure that describes the current battery state of a controller.
  * This structure will only be populated if a controller has
@@ -679,6 +705,37 @@ typedef struct Paddleboat_Controller_Data {
   Paddleboat_Controller_Battery battery;
 } Paddleboat_Controller_Data;
 
+/**
+ * @brief A structure that contains one input sample recorded in the history
+ * of a controller. See ::Paddleboat_getControllerHistory
+ */
+typedef struct Paddleboat_Controller_History_Entry {
+  /** @brief Time of the input event, in microseconds elapsed since the clock
+   * epoch of `Paddleboat_Controller_Data.timestamp`. */
+  uint64_t timestamp;
+  /** @brief Bit-per-button bitfield array of the buttons down after this
+   * sample */
+  uint32_t buttonsDown;
+  /** @brief Bit-per-button bitfield array of the buttons that were pressed or
+   * released since the previous entry. Pressed buttons are
+   * `buttonsChanged & buttonsDown`. */
+  uint32_t buttonsChanged;
+  /** @brief Left analog thumbstick axis data */
+  Paddleboat_Controller_Thumbstick leftStick;
+  /** @brief Right analog thumbstick axis data */
+  Paddleboat_Controller_Thumbstick rightStick;
+  /** @brief L1 trigger axis data. Axis range is 0.0 to 1.0. */
+  float triggerL1;
+  /** @brief L2 trigger axis data. Axis range is 0.0 to 1.0. */
+  float triggerL2;
+  /** @brief R1 trigger axis data. Axis range is 0.0 to 1.0. */
+  float triggerR1;
+  /** @brief R2 trigger axis data. Axis range is 0.0 to 1.0. */
+  float triggerR2;
+  /** @brief See `Paddleboat_Controller_History_Flags` */
+  uint32_t flags;
+} Paddleboat_Controller_History_Entry;
+
 /**
  * @brief A structure that contains information
  * about a particular controller device. Several fields
@@ -718,6 +775,23 @@ typedef struct Paddleboat_Motion_Data {
   float motionZ;
 } Paddleboat_Motion_Data;
 
+/**
+ * @brief A structure that describes the filtering applied to motion data
+ * samples before they are buffered, see
+ * ::Paddleboat_setMotionDataBufferingEnabled. Each sensor of a device is
+ * filtered separately.
+ */
+typedef struct Paddleboat_Motion_Data_Filter {
+  /** @brief Number of consecutive samples averaged into each buffered
+   * sample, which has the timestamp of the last one. 1 buffers every
+   * sample. */
+  int32_t downsampleFactor;
+  /** @brief Weight of the previous output of an exponential low-pass filter
+   * applied to each sample, from 0.0 to less than 1.0. Higher values smooth
+   * more. 0.0 disables the filter. */
+  float lowPassWeight;
+} Paddleboat_Motion_Data_Filter;
+
 /**
  * @brief A structure that contains input data for the mouse device.
  */
@@ -1077,6 +1151,113 @@ void Paddleboat_setPhysicalKeyboardStatusCallback(
 Paddleboat_ErrorCode Paddleboat_getControllerData(
     const int32_t controllerIndex, Paddleboat_Controller_Data *controllerData);
 
+/**
+ * @brief Enable or disable recording the input history of all controllers.
+ * While enabled, every button change and every stick or trigger sample,
+ * including historical samples batched in motion events, is added to a
+ * history of up to PADDLEBOAT_CONTROLLER_HISTORY_SIZE entries per controller.
+ * Draining the history once per frame with ::Paddleboat_getControllerHistory
+ * returns all the input received since the previous frame, where
+ * ::Paddleboat_getControllerData only returns the latest state. History
+ * recording is disabled by default.
+ * @param enabled true to start recording, false to stop. Entries already
+ * recorded can still be retrieved after recording is stopped.
+ * @return `PADDLEBOAT_NO_ERROR` if successful, otherwise an error code.
+ */
+Paddleboat_ErrorCode Paddleboat_setControllerHistoryEnabled(bool enabled);
+
+/**
+ * @brief Retrieve and remove the oldest entries of the input history of the
+ * controller with the specified index. This function does not block the
+ * thread processing input events, but it must only be called from one
+ * thread at a time.
+ * @param controllerIndex The index of the controller to read from, must be
+ * between 0 and PADDLEBOAT_MAX_CONTROLLERS - 1
+ * @param maxEntries The capacity of the entries array.
+ * @param[out] entries an array of at least maxEntries entries, populated with
+ * the history entries, oldest first.
+ * @param[out] entryCount the number of entries written to the entries array.
+ * @return `PADDLEBOAT_NO_ERROR` if the history was read,
+ * `PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED` if history recording was never
+ * enabled.
+ */
+Paddleboat_ErrorCode Paddleboat_getControllerHistory(
+    const int32_t controllerIndex, const int32_t maxEntries,
+    Paddleboat_Controller_History_Entry *entries, int32_t *entryCount);
+
+/**
+ * @brief Start recording the input received by Paddleboat to a file, to
+ * measure and debug input processing off the device. Controller connections
+ * and disconnections, key and motion events, motion data and calls to
+ * ::Paddleboat_update are recorded in the order they are received. The
+ * `paddleboat_replay` host tool in games-controller/src/hostTest replays a
+ * recording through the same functions and reports the processing time of
+ * each event. Recording adds a copy of each event to the input path, it is
+ * not meant to be left enabled in release builds.
+ * @param fileDescriptor a file descriptor open for writing. Paddleboat does
+ * not close it, it must stay open until ::Paddleboat_stopInputRecording.
+ * @return `PADDLEBOAT_NO_ERROR` if recording started,
+ * `PADDLEBOAT_ERROR_ALREADY_INITIALIZED` if a recording is already in
+ * progress, otherwise an error code.
+ */
+Paddleboat_ErrorCode Paddleboat_startInputRecording(int fileDescriptor);
+
+/**
+ * @brief Stop recording the input received by Paddleboat, and write the
+ * remaining records to the file passed to ::Paddleboat_startInputRecording.
+ * @return `PADDLEBOAT_NO_ERROR` if the recording was written,
+ * `PADDLEBOAT_ERROR_FILE_IO` if writing the file failed.
+ */
+Paddleboat_ErrorCode Paddleboat_stopInputRecording();
+
+/**
+ * @brief Enable or disable buffering motion data. While enabled, motion data
+ * samples are filtered and added to a buffer of up to
+ * PADDLEBOAT_MOTION_DATA_BUFFER_SIZE samples per controller, instead of being
+ * passed to the motion data callback one at a time. Draining the buffers once
+ * per frame with ::Paddleboat_getMotionData returns all the samples received
+ * since the previous frame. When a buffer is full, new samples are dropped.
+ * Motion data buffering is disabled by default.
+ * @param enabled true to start buffering, false to go back to reporting
+ * samples to the motion data callback. Samples already buffered can still
+ * be retrieved after buffering is stopped.
+ * @param integratedSensorFlags specifies which integrated device sensors are
+ * buffered, in addition to controller sensors, see
+ * ::Paddleboat_setMotionDataCallbackWithIntegratedFlags
+ * @param filter optional pointer (may be NULL or nullptr) to the filtering
+ * applied to the samples, passing NULL or nullptr buffers the samples
+ * unchanged.
+ * @return `PADDLEBOAT_NO_ERROR` if successful, otherwise an error code.
+ * Requesting an integrated sensor which is not present results in a
+ * `PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED` error code, invalid filter values
+ * in a `PADDLEBOAT_ERROR_INVALID_PARAMETER` error code.
+ */
+Paddleboat_ErrorCode Paddleboat_setMotionDataBufferingEnabled(
+    bool enabled,
+    Paddleboat_Integrated_Motion_Sensor_Flags integratedSensorFlags,
+    const Paddleboat_Motion_Data_Filter *filter);
+
+/**
+ * @brief Retrieve and remove the oldest buffered motion data samples of the
+ * controller with the specified index. This function does not block the
+ * thread delivering sensor events, but it must only be called from one
+ * thread at a time.
+ * @param controllerIndex The index of the controller to read from, must be
+ * between 0 and PADDLEBOAT_MAX_CONTROLLERS - 1, or
+ * `PADDLEBOAT_INTEGRATED_SENSOR_INDEX` to read the integrated sensors.
+ * @param maxSamples The capacity of the samples array.
+ * @param[out] samples an array of at least maxSamples samples, populated with
+ * the buffered samples of all the sensors of the controller, oldest first.
+ * @param[out] sampleCount the number of samples written to the samples array.
+ * @return `PADDLEBOAT_NO_ERROR` if the samples were read,
+ * `PADDLEBOAT_ERROR_FEATURE_NOT_SUPPORTED` if motion data buffering was
+ * never enabled.
+ */
+Paddleboat_ErrorCode Paddleboat_getMotionData(const int32_t controllerIndex,
+                                              const int32_t maxSamples,
+                                              Paddleboat_Motion_Data *samples,
+                                              int32_t *sampleCount);
+
 /**
  * @brief Retrieve the current controller device info from the controller with
  * the specified index.
@@ -127,6 +127,41 @@ Paddleboat_ErrorCode Paddleboat_getControllerData(
                                                     controllerData);
 }
 
+Paddleboat_ErrorCode Paddleboat_setControllerHistoryEnabled(bool enabled) {
+    return GameControllerManager::setControllerHistoryEnabled(enabled);
+}
+
+Paddleboat_ErrorCode Paddleboat_getControllerHistory(
+    const int32_t controllerIndex, const int32_t maxEntries,
+    Paddleboat_Controller_History_Entry *entries, int32_t *entryCount) {
+    return GameControllerManager::getControllerHistory(
+        controllerIndex, maxEntries, entries, entryCount);
+}
+
+Paddleboat_ErrorCode Paddleboat_startInputRecording(int fileDescriptor) {
+    return GameControllerManager::startInputRecording(fileDescriptor);
+}
+
+Paddleboat_ErrorCode Paddleboat_stopInputRecording() {
+    return GameControllerManager::stopInputRecording();
+}
+
+Paddleboat_ErrorCode Paddleboat_setMotionDataBufferingEnabled(
+    bool enabled,
+    Paddleboat_Integrated_Motion_Sensor_Flags integratedSensorFlags,
+    const Paddleboat_Motion_Data_Filter *filter) {
+    return GameControllerManager::setMotionDataBufferingEnabled(
+        enabled, integratedSensorFlags, filter);
+}
+
+Paddleboat_ErrorCode Paddleboat_getMotionData(const int32_t controllerIndex,
+                                              const int32_t maxSamples,
+                                              Paddleboat_Motion_Data *samples,
+                                              int32_t *sampleCount) {
+    return GameControllerManager::getMotionData(controllerIndex, maxSamples,
+                                                samples, sampleCount);
+}
+
 Paddleboat_ErrorCode Paddleboat_getControllerInfo(
     const int32_t controllerIndex, Paddleboat_Controller_Info *controllerInfo) {
     return GameControllerManager::getControllerInfo(controllerIndex,
@@ -18,193 +18,132 @@
 
 #define LOG_TAG "ChoreographerFilter"
 
-#include <sched.h>
-#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
 
-#include <deque>
-#include <string>
-#include <thread>
+#include <algorithm>
 
 #include "Settings.h"
 #include "SwappyLog.h"
 #include "Thread.h"
 #include "Trace.h"
+#include "VsyncModel.h"
 
 using namespace std::chrono_literals;
+using std::chrono::nanoseconds;
 using time_point = std::chrono::steady_clock::time_point;
 
 namespace {
 
-class Timer {
-   public:
-    Timer(std::chrono::nanoseconds refreshPeriod,
-          std::chrono::nanoseconds appToSfDelay)
-        : mRefreshPeriod(refreshPeriod), mAppToSfDelay(appToSfDelay) {}
-
-    // Returns false if we have detected that we have received the same
-    // timestamp multiple times so that the caller can wait for fresh timestamps
-    bool addTimestamp(time_point point) {
-        // Keep track of the previous timestamp and how many times we've seen it
-        // to determine if we've stopped receiving Choreographer callbacks,
-        // which would indicate that we should probably stop until we see them
-        // again (e.g., if the app has been moved to the background)
-        if (point == mLastTimestamp) {
-            if (mRepeatCount++ > 5) {
-                return false;
-            }
-        } else {
-            mRepeatCount = 0;
-        }
-        mLastTimestamp = point;
-
-        point += mAppToSfDelay;
-
-        bool moreThanOneRefreshPeriodElapsed =
-            mBaseTime + mRefreshPeriod * 1.5 < point;
-        if (moreThanOneRefreshPeriodElapsed) {
-            do {
-                mBaseTime += mRefreshPeriod;
-            } while (mBaseTime + mRefreshPeriod * 1.5 < point);
-            mBaseTime += mRefreshPeriod;
-            // Long waits pollute the filter so don't adjust refreshPeriod.
-            return true;
-        }
-
-        std::chrono::nanoseconds delta = (point - (mBaseTime + mRefreshPeriod));
-        if (delta < -mRefreshPeriod / 2) {
-            // Also ignore short intervals
-            return true;
-        }
-
-        // Exponential smoothing factor = 0.04 avoids roughness.
-        mRefreshPeriod += delta / 25;
-        mBaseTime += mRefreshPeriod;
-
-        return true;
-    }
-
-    void sleep(std::chrono::nanoseconds offset) {
-        if (offset < -(mRefreshPeriod / 2) || offset > mRefreshPeriod / 2) {
-            offset = 0ms;
-        }
-
-        const auto now = std::chrono::steady_clock::now();
-        auto targetTime = mBaseTime + mRefreshPeriod + offset;
-        while (targetTime < now) {
-            targetTime += mRefreshPeriod;
-        }
-
-        std::this_thread::sleep_until(targetTime);
+// std::chrono::steady_clock is CLOCK_MONOTONIC, so we can sleep on an absolute
+// deadline of that clock and avoid drifting by the time spent computing it.
+void sleepUntil(time_point deadline) {
+    const int64_t ns =
+        std::chrono::duration_cast<nanoseconds>(deadline.time_since_epoch())
+            .count();
+    timespec ts;
+    ts.tv_sec = ns / 1'000'000'000;
+    ts.tv_nsec = ns % 1'000'000'000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+           EINTR) {
     }
-
-   private:
-    std::chrono::nanoseconds mRefreshPeriod;
-    const std::chrono::nanoseconds mAppToSfDelay;
-    time_point mBaseTime = std::chrono::steady_clock::now();
-
-    time_point mLastTimestamp = std::chrono::steady_clock::now();
-    std::optional<std::chrono::nanoseconds> mSfToVsyncDelay;
-    int32_t mRepeatCount = 0;
-};
+}
 
 }  // anonymous namespace
 
 namespace swappy {
 
-ChoreographerFilter::ChoreographerFilter(std::chrono::nanoseconds refreshPeriod,
-                                         std::chrono::nanoseconds appToSfDelay,
+ChoreographerFilter::ChoreographerFilter(nanoseconds refreshPeriod,
+                                         nanoseconds appToSfDelay,
                                          Worker doWork)
-    : mRefreshPeriod(refreshPeriod),
+    : mLastTimestamp(std::chrono::steady_clock::now()),
+      mRefreshPeriod(refreshPeriod),
       mAppToSfDelay(appToSfDelay),
       mDoWork(doWork) {
-    Settings::getInstance()->addListener([this]() { onSettingsChanged(); });
+    mSettingsListener = Settings::getInstance()->addListener(
+        [this]() { onSettingsChanged(); });
 
-    std::lock_guard<std::mutex> lock(mThreadPoolMutex);
-    mUseAffinity = Settings::getInstance()->getUseAffinity();
-    launchThreadsLocked();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mUseAffinity = Settings::getInstance()->getUseAffinity();
+    }
+    mThread = Thread([this]() { threadMain(); });
 }
 
 ChoreographerFilter::~ChoreographerFilter() {
-    std::lock_guard<std::mutex> lock(mThreadPoolMutex);
-    terminateThreadsLocked();
+    Settings::getInstance()->removeListener(mSettingsListener);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsRunning = false;
+        mCondition.notify_all();
+    }
+    mThread.join();
 }
 
 void ChoreographerFilter::onChoreographer(
-    std::optional<std::chrono::nanoseconds> sfToVsyncDelay) {
+    std::optional<nanoseconds> sfToVsyncDelay) {
     std::lock_guard<std::mutex> lock(mMutex);
     mLastTimestamp = std::chrono::steady_clock::now();
     mSfToVsyncDelay = sfToVsyncDelay;
-    ++mSequenceNumber;
     mCondition.notify_all();
 }
 
-void ChoreographerFilter::launchThreadsLocked() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mIsRunning = true;
-    }
-
-    const int32_t numThreads = getNumCpus() > 2 ? 2 : 1;
-    for (int32_t thread = 0; thread < numThreads; ++thread) {
-        mThreadPool.push_back(
-            Thread([this, thread]() { threadMain(mUseAffinity, thread); }));
-    }
-}
-
-void ChoreographerFilter::terminateThreadsLocked() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mIsRunning = false;
-        mCondition.notify_all();
-    }
-
-    for (auto& thread : mThreadPool) {
-        thread.join();
+ChoreographerFilter::WakeupJitter ChoreographerFilter::getWakeupJitter() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    WakeupJitter jitter;
+    jitter.samples = mJitterSamples;
+    jitter.max = mJitterMax;
+    if (mJitterSamples > 0) {
+        jitter.mean = mJitterSum / mJitterSamples;
     }
-    mThreadPool.clear();
+    return jitter;
 }
 
 void ChoreographerFilter::onSettingsChanged() {
     const bool useAffinity = Settings::getInstance()->getUseAffinity();
     const Settings::DisplayTimings& displayTimings =
         Settings::getInstance()->getDisplayTimings();
-    std::lock_guard<std::mutex> lock(mThreadPoolMutex);
+    std::lock_guard<std::mutex> lock(mMutex);
     if (useAffinity == mUseAffinity &&
         mRefreshPeriod == displayTimings.refreshPeriod) {
         return;
     }
 
-    terminateThreadsLocked();
     mUseAffinity = useAffinity;
     mRefreshPeriod = displayTimings.refreshPeriod;
     mAppToSfDelay = displayTimings.sfOffset - displayTimings.appOffset;
+    ++mSettingsGeneration;
     SWAPPY_LOGV(
         "onSettingsChanged(): refreshPeriod=%lld, appOffset=%lld, "
         "sfOffset=%lld",
         (long long)displayTimings.refreshPeriod.count(),
         (long long)displayTimings.appOffset.count(),
         (long long)displayTimings.sfOffset.count());
-    launchThreadsLocked();
+    mCondition.notify_all();
 }
 
-void ChoreographerFilter::threadMain(bool useAffinity, int32_t thread) {
-    Timer timer(mRefreshPeriod, mAppToSfDelay);
-
-    {
-        int cpu = getNumCpus() - 1 - thread;
-        if (cpu >= 0) {
-            setAffinity(cpu);
-        }
-    }
-
-    std::string threadName = "Filter";
-    threadName += swappy::to_string(thread);
-    pthread_setname_np(pthread_self(), threadName.c_str());
+void ChoreographerFilter::threadMain() {
+    pthread_setname_np(pthread_self(), "SwappyFilter");
 
     std::unique_lock<std::mutex> lock(mMutex);
-    while (true) {
+    VsyncModel model(mRefreshPeriod, mAppToSfDelay,
+                     std::chrono::steady_clock::now());
+    // Start one generation behind so that the affinity is applied up front.
+    uint32_t settingsGeneration = mSettingsGeneration - 1;
+    time_point previousDeadline;
+    nanoseconds workDuration = 0ns;
+    while (mIsRunning) {
+        if (settingsGeneration != mSettingsGeneration) {
+            settingsGeneration = mSettingsGeneration;
+            model.setTimings(mRefreshPeriod, mAppToSfDelay);
+            if (mUseAffinity && getNumCpus() > 0) {
+                setAffinity(getNumCpus() - 1);
+            } else {
+                setAffinity(Affinity::None);
+            }
+        }
         auto timestamp = mLastTimestamp;
-        auto workDuration = mWorkDuration;
         lock.unlock();
 
         // If we have received the same timestamp multiple times, it probably
@@ -212,28 +151,35 @@ void ChoreographerFilter::threadMain(bool useAffinity, int32_t thread) {
         // indicate that it's no longer running. If we detect that, we stop
         // until we see a fresh timestamp to avoid spinning forever in the
         // background.
-        if (!timer.addTimestamp(timestamp)) {
+        if (!model.addTimestamp(timestamp)) {
             lock.lock();
-            mCondition.wait(lock, [=]() {
+            mCondition.wait(lock, [&]() {
                 return !mIsRunning || (mLastTimestamp != timestamp);
             });
+            if (!mIsRunning) break;
             timestamp = mLastTimestamp;
             lock.unlock();
-            timer.addTimestamp(timestamp);
+            model.addTimestamp(timestamp);
         }
 
+        const auto deadline = model.nextDeadline(
+            -workDuration, std::chrono::steady_clock::now(), previousDeadline);
+        sleepUntil(deadline);
+        const nanoseconds jitter = std::chrono::steady_clock::now() - deadline;
+        previousDeadline = deadline;
+
+        lock.lock();
+        mJitterSum += jitter;
+        mJitterMax = std::max(mJitterMax, jitter);
+        ++mJitterSamples;
         if (!mIsRunning) break;
+        const auto sfToVsyncDelay = mSfToVsyncDelay;
+        lock.unlock();
 
-        timer.sleep(-workDuration);
+        TRACE_INT("FilterWakeupJitter", jitter.count());
         {
-            std::unique_lock<std::mutex> workLock(mWorkMutex);
-            const auto now = std::chrono::steady_clock::now();
-            if (now - mLastWorkRun > mRefreshPeriod / 2) {
-                // Assume we got here first and there's work to do
-                gamesdk::ScopedTrace trace("doWork");
-                mWorkDuration = mDoWork(mSfToVsyncDelay);
-                mLastWorkRun = now;
-            }
+            gamesdk::ScopedTrace trace("doWork");
+            workDuration = mDoWork(sfToVsyncDelay);
         }
         lock.lock();
     }
@@ -16,21 +16,31 @@
 
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <optional>
-#include <vector>
 
 #include "Settings.h"
 #include "Thread.h"
 
 namespace swappy {
 
+// Runs the Swappy worker once per vsync, on a single thread that sleeps on
+// absolute deadlines predicted from the Choreographer ticks.
 class ChoreographerFilter {
  public:
   using Worker = std::function<std::chrono::nanoseconds(
       std::optional<std::chrono::nanoseconds>)>;
 
+  // How late the filter thread woke up compared to the predicted deadline.
+  struct WakeupJitter {
+    std::chrono::nanoseconds mean{0};
+    std::chrono::nanoseconds max{0};
+    uint64_t samples = 0;
+  };
+
   explicit ChoreographerFilter(std::chrono::nanoseconds refreshPeriod,
                                std::chrono::nanoseconds appToSfDelay,
                                Worker doWork);
@@ -38,32 +48,34 @@ class ChoreographerFilter {
 
   void onChoreographer(std::optional<std::chrono::nanoseconds> sfToVsyncDelay);
 
- private:
-  void launchThreadsLocked();
-  void terminateThreadsLocked();
+  WakeupJitter getWakeupJitter();
 
+ private:
   void onSettingsChanged();
 
-  void threadMain(bool useAffinity, int32_t thread);
+  void threadMain();
 
-  std::mutex mThreadPoolMutex;
-  bool mUseAffinity = true;
-  std::vector<Thread> mThreadPool;
+  Thread mThread;
 
   std::mutex mMutex;
   std::condition_variable mCondition;
-  bool mIsRunning = true;
-  int64_t mSequenceNumber = 0;
-  std::chrono::steady_clock::time_point mLastTimestamp;
-  std::optional<std::chrono::nanoseconds> mSfToVsyncDelay;
+  bool mIsRunning GUARDED_BY(mMutex) = true;
+  std::chrono::steady_clock::time_point mLastTimestamp GUARDED_BY(mMutex);
+  std::optional<std::chrono::nanoseconds> mSfToVsyncDelay GUARDED_BY(mMutex);
+
+  // Display timings are picked up by the running thread, which re-locks its
+  // vsync model on the next tick instead of being restarted.
+  std::chrono::nanoseconds mRefreshPeriod GUARDED_BY(mMutex);
+  std::chrono::nanoseconds mAppToSfDelay GUARDED_BY(mMutex);
+  bool mUseAffinity GUARDED_BY(mMutex) = true;
+  uint32_t mSettingsGeneration GUARDED_BY(mMutex) = 0;
 
-  std::mutex mWorkMutex;
-  std::chrono::steady_clock::time_point mLastWorkRun;
-  std::chrono::nanoseconds mWorkDuration;
+  std::chrono::nanoseconds mJitterSum GUARDED_BY(mMutex){0};
+  std::chrono::nanoseconds mJitterMax GUARDED_BY(mMutex){0};
+  uint64_t mJitterSamples GUARDED_BY(mMutex) = 0;
 
-  std::chrono::nanoseconds mRefreshPeriod;
-  std::chrono::nanoseconds mAppToSfDelay;
   const Worker mDoWork;
+  Settings::ListenerId mSettingsListener;
 };
 
 }  // namespace swappy
@@ -24,12 +24,15 @@
 #include <sched.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <condition_variable>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "ChoreographerShim.h"
 #include "CpuInfo.h"
@@ -441,13 +444,15 @@ class NoChoreographerThread : public ChoreographerThread {
     bool mThreadRunning GUARDED_BY(mWaitingMutex);
     std::condition_variable_any mWaitingCondition GUARDED_BY(mWaitingMutex);
     std::chrono::nanoseconds mRefreshPeriod GUARDED_BY(mWaitingMutex);
+    Settings::ListenerId mSettingsListener;
 };
 
 NoChoreographerThread::NoChoreographerThread(
     ChoreographerCallback onChoreographer)
     : ChoreographerThread(onChoreographer) {
     std::lock_guard<std::mutex> lock(mWaitingMutex);
-    Settings::getInstance()->addListener([this]() { onSettingsChanged(); });
+    mSettingsListener = Settings::getInstance()->addListener(
+        [this]() { onSettingsChanged(); });
     mThreadRunning = true;
     mThread = Thread([this]() { looperThread(); });
     mInitialized = true;
@@ -455,6 +460,7 @@ NoChoreographerThread::NoChoreographerThread(
 
 NoChoreographerThread::~NoChoreographerThread() {
     SWAPPY_LOGI("Destroying NoChoreographerThread");
+    Settings::getInstance()->removeListener(mSettingsListener);
     {
         std::lock_guard<std::mutex> lock(mWaitingMutex);
         mThreadRunning = false;
@@ -569,15 +575,15 @@ void ChoreographerThread::onChoreographer(
     mCallback(sfToVsyncDelay);
 }
 
-std::unique_ptr<ChoreographerThread>
-ChoreographerThread::createChoreographerThread(
-    Type type, JavaVM *vm, jobject jactivity,
-    ChoreographerCallback onChoreographer,
-    RefreshRateChangedCallback onRefreshRateChanged, SdkVersion sdkVersion) {
-    if (type == Type::App) {
-        SWAPPY_LOGI("Using Application's Choreographer");
-        return std::make_unique<NoChoreographerThread>(onChoreographer);
-    }
+namespace {
+
+std::unique_ptr<ChoreographerThread> createSwappyChoreographerThread(
+    JavaVM *vm, jobject jactivity,
+    ChoreographerThread::ChoreographerCallback onChoreographer,
+    ChoreographerThread::RefreshRateChangedCallback onRefreshRateChanged,
+    SdkVersion sdkVersion) {
+    using RefreshRateChangedCallback =
+        ChoreographerThread::RefreshRateChangedCallback;
 
     if (vm == nullptr ||
         sdkVersion.sdkInt >= NDKChoreographerThread::MIN_SDK_VERSION) {
@@ -605,4 +611,137 @@ ChoreographerThread::createChoreographerThread(
     return std::make_unique<NoChoreographerThread>(onChoreographer);
 }
 
+}  // anonymous namespace
+
+class SharedChoreographerThread;
+
+// Choreographer registered once for all the Swappy instances of the process,
+// e.g. one per Vulkan swapchain. Its ticks are forwarded to each of them.
+class ChoreographerHub {
+   public:
+    static std::shared_ptr<ChoreographerHub> get(JavaVM *vm, jobject jactivity,
+                                                 SdkVersion sdkVersion);
+
+    ChoreographerHub(JavaVM *vm, jobject jactivity, SdkVersion sdkVersion);
+
+    void subscribe(SharedChoreographerThread *subscriber);
+    void unsubscribe(SharedChoreographerThread *subscriber);
+
+    void postFrameCallbacks() { mThread->postFrameCallbacks(); }
+    bool isInitialized() { return mThread->isInitialized(); }
+
+   private:
+    void onChoreographer(
+        std::optional<std::chrono::nanoseconds> sfToVsyncDelay);
+    void onRefreshRateChanged();
+
+    // Held while forwarding a tick, so that a subscriber can't be called
+    // anymore once unsubscribed.
+    std::mutex mMutex;
+    std::vector<SharedChoreographerThread *> mSubscribers GUARDED_BY(mMutex);
+    // Destroyed first, so that no tick is forwarded during destruction.
+    std::unique_ptr<ChoreographerThread> mThread;
+};
+
+class SharedChoreographerThread : public ChoreographerThread {
+   public:
+    SharedChoreographerThread(std::shared_ptr<ChoreographerHub> hub,
+                              ChoreographerCallback onChoreographer,
+                              RefreshRateChangedCallback onRefreshRateChanged);
+    ~SharedChoreographerThread() override;
+
+    void postFrameCallbacks() override { mHub->postFrameCallbacks(); }
+
+   private:
+    friend class ChoreographerHub;
+
+    void scheduleNextFrameCallback() override REQUIRES(mWaitingMutex) {}
+
+    const std::shared_ptr<ChoreographerHub> mHub;
+    const RefreshRateChangedCallback mOnRefreshRateChanged;
+};
+
+std::shared_ptr<ChoreographerHub> ChoreographerHub::get(JavaVM *vm,
+                                                        jobject jactivity,
+                                                        SdkVersion sdkVersion) {
+    static std::mutex sMutex;
+    static std::weak_ptr<ChoreographerHub> sHub;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto hub = sHub.lock();
+    if (!hub) {
+        hub = std::make_shared<ChoreographerHub>(vm, jactivity, sdkVersion);
+        sHub = hub;
+    }
+    return hub;
+}
+
+ChoreographerHub::ChoreographerHub(JavaVM *vm, jobject jactivity,
+                                   SdkVersion sdkVersion) {
+    mThread = createSwappyChoreographerThread(
+        vm, jactivity,
+        [this](std::optional<std::chrono::nanoseconds> sfToVsyncDelay) {
+            onChoreographer(sfToVsyncDelay);
+        },
+        [this] { onRefreshRateChanged(); }, sdkVersion);
+}
+
+void ChoreographerHub::subscribe(SharedChoreographerThread *subscriber) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSubscribers.push_back(subscriber);
+}
+
+void ChoreographerHub::unsubscribe(SharedChoreographerThread *subscriber) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSubscribers.erase(
+        std::remove(mSubscribers.begin(), mSubscribers.end(), subscriber),
+        mSubscribers.end());
+}
+
+void ChoreographerHub::onChoreographer(
+    std::optional<std::chrono::nanoseconds> sfToVsyncDelay) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto subscriber : mSubscribers) {
+        subscriber->mCallback(sfToVsyncDelay);
+    }
+}
+
+void ChoreographerHub::onRefreshRateChanged() {
+    // The display timings are global, a single subscriber updates them.
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mSubscribers.empty() && mSubscribers.front()->mOnRefreshRateChanged) {
+        mSubscribers.front()->mOnRefreshRateChanged();
+    }
+}
+
+SharedChoreographerThread::SharedChoreographerThread(
+    std::shared_ptr<ChoreographerHub> hub,
+    ChoreographerCallback onChoreographer,
+    RefreshRateChangedCallback onRefreshRateChanged)
+    : ChoreographerThread(onChoreographer),
+      mHub(std::move(hub)),
+      mOnRefreshRateChanged(onRefreshRateChanged) {
+    mInitialized = mHub->isInitialized();
+    mHub->subscribe(this);
+}
+
+SharedChoreographerThread::~SharedChoreographerThread() {
+    mHub->unsubscribe(this);
+}
+
+std::unique_ptr<ChoreographerThread>
+ChoreographerThread::createChoreographerThread(
+    Type type, JavaVM *vm, jobject jactivity,
+    ChoreographerCallback onChoreographer,
+    RefreshRateChangedCallback onRefreshRateChanged, SdkVersion sdkVersion) {
+    if (type == Type::App) {
+        SWAPPY_LOGI("Using Application's Choreographer");
+        return std::make_unique<NoChoreographerThread>(onChoreographer);
+    }
+
+    return std::make_unique<SharedChoreographerThread>(
+        ChoreographerHub::get(vm, jactivity, sdkVersion), onChoreographer,
+        onRefreshRateChanged);
+}
+
 }  // namespace swappy
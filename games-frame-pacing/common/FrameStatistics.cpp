@@ -16,6 +16,12 @@
 
 #include "FrameStatistics.h"
 
+#include <inttypes.h>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+
 #include "SwappyCommon.h"
 
 #define LOG_TAG "FrameStatistics"
@@ -25,6 +31,36 @@ namespace swappy {
 
 // NB This is only needed for C++14
 constexpr std::chrono::nanoseconds FrameStatistics::LOG_EVERY_N_NS;
+constexpr std::chrono::nanoseconds FrameStatistics::DEFAULT_BUCKET_RESOLUTION;
+
+namespace {
+
+template <typename A, typename B, typename F>
+void forEachBucket(A& a, B& b, F f) {
+    for (size_t i = 0; i < std::size(a.idleFrames); i++) {
+        f(a.idleFrames[i], b.idleFrames[i]);
+        f(a.lateFrames[i], b.lateFrames[i]);
+        f(a.offsetFromPreviousFrame[i], b.offsetFromPreviousFrame[i]);
+        f(a.latencyFrames[i], b.latencyFrames[i]);
+    }
+}
+
+// Calls f on each pair of matching counters of a and b
+template <typename A, typename B, typename F>
+void forEachCounter(A& a, B& b, F f) {
+    f(a.totalFrames, b.totalFrames);
+    forEachBucket(a.periods, b.periods, f);
+    forEachBucket(a.detailed, b.detailed, f);
+}
+
+// The counters are only written by the producer, so there is no need for an
+// atomic read-modify-write.
+void increment(std::atomic<uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+}
+
+}  // anonymous namespace
 
 int32_t FrameStatistics::getFrameDelta(int64_t deltaTimeNS,
                                        uint64_t refreshPeriod) {
@@ -34,101 +70,176 @@ int32_t FrameStatistics::getFrameDelta(int64_t deltaTimeNS,
     return numFrames;
 }
 
+int32_t FrameStatistics::getDetailedBucket(int64_t deltaTimeNS,
+                                           int64_t resolution) {
+    if (deltaTimeNS <= 0) {
+        return 0;
+    }
+    return std::min<int64_t>(deltaTimeNS / resolution,
+                             SWAPPY_MAX_DETAILED_BUCKETS - 1);
+}
+
+FrameStatistics::Counters<uint64_t> FrameStatistics::readCounters() {
+    Counters<uint64_t> counters;
+    uint32_t sequenceBefore;
+    uint32_t sequenceAfter;
+    do {
+        sequenceBefore = mSequence.load(std::memory_order_acquire);
+        forEachCounter(counters, mCounters,
+                       [](uint64_t& value, std::atomic<uint64_t>& counter) {
+                           value = counter.load(std::memory_order_relaxed);
+                       });
+        std::atomic_thread_fence(std::memory_order_acquire);
+        sequenceAfter = mSequence.load(std::memory_order_relaxed);
+        // Retry if the producer was updating the counters meanwhile
+    } while ((sequenceBefore & 1) || sequenceBefore != sequenceAfter);
+
+    forEachCounter(
+        counters, mBaseline,
+        [](uint64_t& value, uint64_t baseline) { value -= baseline; });
+    return counters;
+}
+
 void FrameStatistics::clearStats() {
-    std::lock_guard<std::mutex> lock(mMutex);
-    mStats.totalFrames = 0;
+    std::lock_guard<std::mutex> lock(mReadMutex);
+    // The producer never waits for readers, so the counters are not reset:
+    // the ones at this point are subtracted from later reads instead.
+    Counters<uint64_t> counters = readCounters();
+    forEachCounter(
+        mBaseline, counters,
+        [](uint64_t& baseline, uint64_t value) { baseline += value; });
+}
 
-    for (int i = 0; i < MAX_FRAME_BUCKETS; i++) {
-        mStats.idleFrames[i] = 0;
-        mStats.lateFrames[i] = 0;
-        mStats.offsetFromPreviousFrame[i] = 0;
-        mStats.latencyFrames[i] = 0;
+void FrameStatistics::setBucketResolution(std::chrono::nanoseconds resolution) {
+    if (resolution <= 0ns) {
+        SWAPPY_LOGE("Invalid bucket resolution %lld",
+                    (long long)resolution.count());
+        return;
     }
+    mBucketResolution = resolution;
+    clearStats();
 }
 
 void FrameStatistics::invalidateLastFrame() { mLast = {0, 0, 0, 0}; }
 
 void FrameStatistics::updateFrameStats(FrameTimings current,
                                        uint64_t refreshPeriod) {
-    std::lock_guard<std::mutex> lock(mMutex);
     // Latency is always collected
-    int latency = getFrameDelta(
-        current.actualPresentTime - current.startFrameTime, refreshPeriod);
+    const int64_t latencyNS =
+        current.actualPresentTime - current.startFrameTime;
+    int latency = getFrameDelta(latencyNS, refreshPeriod);
 
     // Use incoming frame timings to build the histogram.
     if (mFullStatsEnabled) {
-        int idle = getFrameDelta(current.presentMargin, refreshPeriod);
-        int late = getFrameDelta(
-            current.actualPresentTime - current.desiredPresentTime,
-            refreshPeriod);
-
-        mStats.totalFrames++;
-        mStats.idleFrames[idle]++;
-        mStats.lateFrames[late]++;
-        mStats.latencyFrames[latency]++;
+        const int64_t resolution = mBucketResolution.load().count();
+        const int64_t idleNS = current.presentMargin;
+        const int64_t lateNS =
+            current.actualPresentTime - current.desiredPresentTime;
+
+        const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+        mSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        increment(mCounters.totalFrames);
+        increment(mCounters.periods.idleFrames[getFrameDelta(idleNS,
+                                                             refreshPeriod)]);
+        increment(mCounters.periods.lateFrames[getFrameDelta(lateNS,
+                                                             refreshPeriod)]);
+        increment(mCounters.periods.latencyFrames[latency]);
+        increment(mCounters.detailed
+                      .idleFrames[getDetailedBucket(idleNS, resolution)]);
+        increment(mCounters.detailed
+                      .lateFrames[getDetailedBucket(lateNS, resolution)]);
+        increment(mCounters.detailed
+                      .latencyFrames[getDetailedBucket(latencyNS, resolution)]);
 
         // Update the previous frame only if last frame has valid data
         if (mLast.actualPresentTime) {
-            int offset = getFrameDelta(
-                current.actualPresentTime - mLast.actualPresentTime,
-                refreshPeriod);
-
-            mStats.offsetFromPreviousFrame[offset]++;
+            const int64_t offsetNS =
+                current.actualPresentTime - mLast.actualPresentTime;
+            increment(
+                mCounters.periods.offsetFromPreviousFrame[getFrameDelta(
+                    offsetNS, refreshPeriod)]);
+            increment(mCounters.detailed.offsetFromPreviousFrame
+                          [getDetailedBucket(offsetNS, resolution)]);
         }
 
+        mSequence.store(sequence + 2, std::memory_order_release);
+
         logFrames();
     }
 
     mLastLatency = latency;
     mLast = current;
 }
-void FrameStatistics::logFrames() {
-    static auto previousLogTime = std::chrono::steady_clock::now();
 
-    if (std::chrono::steady_clock::now() - previousLogTime < LOG_EVERY_N_NS) {
+void FrameStatistics::logFrames() {
+    if (std::chrono::steady_clock::now() - mPreviousLogTime < LOG_EVERY_N_NS) {
         return;
     }
 
+    // The producer can read its own counters without the sequence lock. They
+    // are logged since stats were enabled, regardless of clearStats().
+    auto log = [](const char* name, const std::atomic<uint64_t>* buckets) {
+        std::string message = name;
+        for (int i = 0; i < MAX_FRAME_BUCKETS; i++)
+            message +=
+                "\t " + swappy::to_string(buckets[i].load(
+                             std::memory_order_relaxed));
+        SWAPPY_LOGI("%s", message.c_str());
+    };
+
     std::string message;
     SWAPPY_LOGI("== Frame statistics ==");
-    SWAPPY_LOGI("total frames: %" PRIu64, mStats.totalFrames);
+    SWAPPY_LOGI("total frames: %" PRIu64,
+                mCounters.totalFrames.load(std::memory_order_relaxed));
     message += "Buckets:                    ";
     for (int i = 0; i < MAX_FRAME_BUCKETS; i++)
         message += "\t[" + swappy::to_string(i) + "]";
     SWAPPY_LOGI("%s", message.c_str());
 
-    message = "";
-    message += "idle frames:                ";
-    for (int i = 0; i < MAX_FRAME_BUCKETS; i++)
-        message += "\t " + swappy::to_string(mStats.idleFrames[i]);
-    SWAPPY_LOGI("%s", message.c_str());
+    log("idle frames:                ", mCounters.periods.idleFrames);
+    log("late frames:                ", mCounters.periods.lateFrames);
+    log("offset from previous frame: ",
+        mCounters.periods.offsetFromPreviousFrame);
+    log("frame latency:              ", mCounters.periods.latencyFrames);
 
-    message = "";
-    message += "late frames:                ";
-    for (int i = 0; i < MAX_FRAME_BUCKETS; i++)
-        message += "\t " + swappy::to_string(mStats.lateFrames[i]);
-    SWAPPY_LOGI("%s", message.c_str());
-
-    message = "";
-    message += "offset from previous frame: ";
-    for (int i = 0; i < MAX_FRAME_BUCKETS; i++)
-        message += "\t " + swappy::to_string(mStats.offsetFromPreviousFrame[i]);
-    SWAPPY_LOGI("%s", message.c_str());
-
-    message = "";
-    message += "frame latency:              ";
-    for (int i = 0; i < MAX_FRAME_BUCKETS; i++)
-        message += "\t " + swappy::to_string(mStats.latencyFrames[i]);
-    SWAPPY_LOGI("%s", message.c_str());
-
-    previousLogTime = std::chrono::steady_clock::now();
+    mPreviousLogTime = std::chrono::steady_clock::now();
 }
 
 void FrameStatistics::enableStats(bool enabled) { mFullStatsEnabled = enabled; }
 
 SwappyStats FrameStatistics::getStats() {
-    std::lock_guard<std::mutex> lock(mMutex);
-    return mStats;
+    std::lock_guard<std::mutex> lock(mReadMutex);
+    const Counters<uint64_t> counters = readCounters();
+
+    SwappyStats stats;
+    stats.totalFrames = counters.totalFrames;
+    for (int i = 0; i < MAX_FRAME_BUCKETS; i++) {
+        stats.idleFrames[i] = counters.periods.idleFrames[i];
+        stats.lateFrames[i] = counters.periods.lateFrames[i];
+        stats.offsetFromPreviousFrame[i] =
+            counters.periods.offsetFromPreviousFrame[i];
+        stats.latencyFrames[i] = counters.periods.latencyFrames[i];
+    }
+    return stats;
+}
+
+SwappyDetailedStats FrameStatistics::getDetailedStats() {
+    std::lock_guard<std::mutex> lock(mReadMutex);
+    const Counters<uint64_t> counters = readCounters();
+
+    SwappyDetailedStats stats;
+    stats.bucketResolutionNS = mBucketResolution.load().count();
+    stats.totalFrames = counters.totalFrames;
+    for (int i = 0; i < SWAPPY_MAX_DETAILED_BUCKETS; i++) {
+        stats.idleFrames[i] = counters.detailed.idleFrames[i];
+        stats.lateFrames[i] = counters.detailed.lateFrames[i];
+        stats.offsetFromPreviousFrame[i] =
+            counters.detailed.offsetFromPreviousFrame[i];
+        stats.latencyFrames[i] = counters.detailed.latencyFrames[i];
+    }
+    return stats;
 }
 
 }  // namespace swappy
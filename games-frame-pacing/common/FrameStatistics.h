@@ -39,6 +39,12 @@ typedef struct {
   uint64_t presentMargin;
 } FrameTimings;
 
+// Histograms of the presented frames.
+//
+// updateFrameStats() and invalidateLastFrame() must be called from a single
+// thread, the producer, which never takes a lock: it updates atomic counters
+// inside a sequence lock. The other methods may be called from any thread;
+// readers retry until they get a consistent snapshot of the counters.
 class FrameStatistics {
  public:
   ~FrameStatistics() = default;
@@ -47,24 +53,60 @@ class FrameStatistics {
   void updateFrameStats(FrameTimings currentFrameTimings,
                         uint64_t refreshPeriod);
   SwappyStats getStats();
+  SwappyDetailedStats getDetailedStats();
+  // Also clears the statistics.
+  void setBucketResolution(std::chrono::nanoseconds resolution);
   void clearStats();
   void invalidateLastFrame();
 
   int32_t lastLatencyRecorded() { return mLastLatency; }
 
  private:
+  template <typename T, int N>
+  struct Histograms {
+    T idleFrames[N];
+    T lateFrames[N];
+    T offsetFromPreviousFrame[N];
+    T latencyFrames[N];
+  };
+
+  template <typename T>
+  struct Counters {
+    T totalFrames;
+    // In refresh periods, see SwappyStats
+    Histograms<T, MAX_FRAME_BUCKETS> periods;
+    // In mBucketResolution
+    Histograms<T, SWAPPY_MAX_DETAILED_BUCKETS> detailed;
+  };
+
   static constexpr std::chrono::nanoseconds LOG_EVERY_N_NS = 1s;
-  void logFrames() REQUIRES(mMutex);
+  static constexpr std::chrono::nanoseconds DEFAULT_BUCKET_RESOLUTION = 1ms;
+
+  void logFrames();
 
   int32_t getFrameDelta(int64_t deltaTimeNS, uint64_t refreshPeriod);
+  int32_t getDetailedBucket(int64_t deltaTimeNS, int64_t resolution);
 
-  std::mutex mMutex;
-  SwappyStats mStats GUARDED_BY(mMutex) = {};
+  // Returns the counters minus the baseline set by the last clearStats().
+  Counters<uint64_t> readCounters() REQUIRES(mReadMutex);
+
+  // Odd while the producer updates mCounters.
+  std::atomic<uint32_t> mSequence = {0};
+  Counters<std::atomic<uint64_t>> mCounters = {};
   std::atomic<int32_t> mLastLatency = {0};
-  FrameTimings mLast;
+  std::atomic<std::chrono::nanoseconds> mBucketResolution = {
+      DEFAULT_BUCKET_RESOLUTION};
+
+  // Only used by the producer
+  FrameTimings mLast = {};
+  std::chrono::steady_clock::time_point mPreviousLogTime =
+      std::chrono::steady_clock::now();
+
+  std::mutex mReadMutex;
+  Counters<uint64_t> mBaseline GUARDED_BY(mReadMutex) = {};
 
   // A flag to enable or disable frame stats histogram update.
-  bool mFullStatsEnabled = false;
+  std::atomic<bool> mFullStatsEnabled = {false};
 };
 
 }  // namespace swappy
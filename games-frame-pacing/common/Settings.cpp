@@ -16,6 +16,8 @@
 
 #include "Settings.h"
 
+#include <algorithm>
+
 namespace swappy {
 
 std::unique_ptr<Settings> Settings::instance;
@@ -29,9 +31,20 @@ Settings* Settings::getInstance() {
 
 void Settings::reset() { instance.reset(); }
 
-void Settings::addListener(Listener listener) {
+Settings::ListenerId Settings::addListener(Listener listener) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    const ListenerId id = mNextListenerId++;
+    mListeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void Settings::removeListener(ListenerId id) {
     std::lock_guard<std::mutex> lock(mMutex);
-    mListeners.emplace_back(std::move(listener));
+    mListeners.erase(std::remove_if(mListeners.begin(), mListeners.end(),
+                                    [id](const auto& listener) {
+                                        return listener.first == id;
+                                    }),
+                     mListeners.end());
 }
 
 void Settings::removeAllListeners() {
@@ -82,7 +95,7 @@ bool Settings::getUseAffinity() const {
 
 void Settings::notifyListeners() {
     // Grab a local copy of the listeners
-    std::vector<Listener> listeners;
+    std::vector<std::pair<ListenerId, Listener>> listeners;
     {
         std::lock_guard<std::mutex> lock(mMutex);
         listeners = mListeners;
@@ -90,7 +103,7 @@ void Settings::notifyListeners() {
 
     // Call the listeners without the lock held
     for (const auto& listener : listeners) {
-        listener();
+        listener.second();
     }
 }
 
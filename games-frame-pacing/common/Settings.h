@@ -18,9 +18,11 @@
 
 #include <chrono>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Thread.h"
@@ -48,7 +50,11 @@ class Settings {
   static void reset();
 
   using Listener = std::function<void()>;
-  void addListener(Listener listener);
+  using ListenerId = uint64_t;
+  ListenerId addListener(Listener listener);
+  // Several Swappy instances (e.g. one per Vulkan swapchain) may share the
+  // settings, so each of them removes its own listeners.
+  void removeListener(ListenerId id);
   void removeAllListeners();
 
   void setDisplayTimings(const DisplayTimings& displayTimings);
@@ -65,7 +71,8 @@ class Settings {
   static std::unique_ptr<Settings> instance;
 
   mutable std::mutex mMutex;
-  std::vector<Listener> mListeners GUARDED_BY(mMutex);
+  std::vector<std::pair<ListenerId, Listener>> mListeners GUARDED_BY(mMutex);
+  ListenerId mNextListenerId GUARDED_BY(mMutex) = 0;
 
   DisplayTimings mDisplayTimings GUARDED_BY(mMutex);
   std::chrono::nanoseconds mSwapDuration GUARDED_BY(mMutex) =
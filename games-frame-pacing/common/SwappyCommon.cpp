@@ -42,6 +42,14 @@ constexpr int SwappyCommon::FRAME_DROP_THRESHOLD;
 constexpr std::chrono::nanoseconds
     SwappyCommon::FrameDurations::FRAME_DURATION_SAMPLE_SECONDS;
 
+namespace {
+
+// Settings are shared by all the instances and only reset once the last one
+// is destroyed.
+std::atomic<int> sInstanceCount{0};
+
+}  // anonymous namespace
+
 #if __ANDROID_API__ < 30
 // Define ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_* to allow compilation on older
 // versions
@@ -135,6 +143,8 @@ SwappyCommon::SwappyCommon(JNIEnv* env, jobject jactivity)
       mMeasuredSwapDuration(nanoseconds(0)),
       mAutoSwapInterval(1),
       mValid(false) {
+    ++sInstanceCount;
+
     mLibAndroid = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
     if (mLibAndroid == nullptr) {
         SWAPPY_LOGE("FATAL: cannot open libandroid.so: %s", strerror(errno));
@@ -187,7 +197,8 @@ SwappyCommon::SwappyCommon(JNIEnv* env, jobject jactivity)
         }
     }
 
-    Settings::getInstance()->addListener([this]() { onSettingsChanged(); });
+    mSettingsListener = Settings::getInstance()->addListener(
+        [this]() { onSettingsChanged(); });
     Settings::getInstance()->setDisplayTimings({mCommonSettings.refreshPeriod,
                                                 mCommonSettings.appVsyncOffset,
                                                 mCommonSettings.sfVsyncOffset});
@@ -209,6 +220,8 @@ SwappyCommon::SwappyCommon(const SwappyCommonSettings& settings)
       mMeasuredSwapDuration(nanoseconds(0)),
       mAutoSwapInterval(1),
       mValid(true) {
+    ++sInstanceCount;
+
     mChoreographerFilter = std::make_unique<ChoreographerFilter>(
         mCommonSettings.refreshPeriod,
         mCommonSettings.sfVsyncOffset - mCommonSettings.appVsyncOffset,
@@ -223,7 +236,8 @@ SwappyCommon::SwappyCommon(const SwappyCommonSettings& settings)
         },
         [] {}, mCommonSettings.sdkVersion);
 
-    Settings::getInstance()->addListener([this]() { onSettingsChanged(); });
+    mSettingsListener = Settings::getInstance()->addListener(
+        [this]() { onSettingsChanged(); });
     Settings::getInstance()->setDisplayTimings({mCommonSettings.refreshPeriod,
                                                 mCommonSettings.appVsyncOffset,
                                                 mCommonSettings.sfVsyncOffset});
@@ -238,14 +252,17 @@ SwappyCommon::SwappyCommon(const SwappyCommonSettings& settings)
 }
 
 SwappyCommon::~SwappyCommon() {
-    // Remove the settings' listeners before destroying Choreographer objects
-    // because the listeners may contain references to the objects
-    Settings::getInstance()->removeAllListeners();
+    // Remove the settings' listener before destroying Choreographer objects
+    // because the listener contains a reference to this object. The
+    // Choreographer objects remove their own listeners.
+    Settings::getInstance()->removeListener(mSettingsListener);
     // destroy all threads first before the other members of this class
     mChoreographerThread.reset();
     mChoreographerFilter.reset();
 
-    Settings::reset();
+    if (--sInstanceCount == 0) {
+        Settings::reset();
+    }
 
     if (mJactivity != nullptr) {
         JNIEnv* env;
@@ -498,6 +515,15 @@ void SwappyCommon::updateMeasuredSwapDuration(nanoseconds duration) {
     }
 }
 
+void SwappyCommon::setSwapDuration(nanoseconds swapDuration) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSwapDurationOverride = swapDuration;
+    if (mNextTimingSettings.swapDuration != swapDuration) {
+        mNextTimingSettings.swapDuration = swapDuration;
+        mTimingSettingsNeedUpdate = true;
+    }
+}
+
 nanoseconds SwappyCommon::getSwapDuration() {
     std::lock_guard<std::mutex> lock(mMutex);
     return mAutoSwapInterval * mCommonSettings.refreshPeriod;
@@ -698,80 +724,50 @@ bool SwappyCommon::updateSwapInterval() {
     return configChanged;
 }
 
-template <typename Tracers, typename Func>
-void addToTracers(Tracers& tracers, Func func, void* userData) {
-    if (func != nullptr) {
-        tracers.push_back({func, userData});
-    }
-}
-
-template <typename Tracers, typename Func>
-void removeFromTracers(Tracers& tracers, Func func) {
-    if (func != nullptr) {
-        for (auto it = tracers.begin(); it != tracers.end();) {
-            auto jt = it;
-            it++;
-            if (jt->function == func) {
-                tracers.erase(jt);
-            }
-        }
-    }
-}
-
 void SwappyCommon::addTracerCallbacks(const SwappyTracer& tracer) {
-    addToTracers(mInjectedTracers.preWait, tracer.preWait, tracer.userData);
-    addToTracers(mInjectedTracers.postWait, tracer.postWait, tracer.userData);
-    addToTracers(mInjectedTracers.preSwapBuffers, tracer.preSwapBuffers,
-                 tracer.userData);
-    addToTracers(mInjectedTracers.postSwapBuffers, tracer.postSwapBuffers,
-                 tracer.userData);
-    addToTracers(mInjectedTracers.startFrame, tracer.startFrame,
-                 tracer.userData);
-    addToTracers(mInjectedTracers.swapIntervalChanged,
-                 tracer.swapIntervalChanged, tracer.userData);
+    mInjectedTracers.add(tracer);
 }
 
 void SwappyCommon::removeTracerCallbacks(const SwappyTracer& tracer) {
-    removeFromTracers(mInjectedTracers.preWait, tracer.preWait);
-    removeFromTracers(mInjectedTracers.postWait, tracer.postWait);
-    removeFromTracers(mInjectedTracers.preSwapBuffers, tracer.preSwapBuffers);
-    removeFromTracers(mInjectedTracers.postSwapBuffers, tracer.postSwapBuffers);
-    removeFromTracers(mInjectedTracers.startFrame, tracer.startFrame);
-    removeFromTracers(mInjectedTracers.swapIntervalChanged,
-                      tracer.swapIntervalChanged);
+    mInjectedTracers.remove(tracer);
 }
 
-template <typename T, typename... Args>
-void executeTracers(T& tracers, Args... args) {
-    for (const auto& tracer : tracers) {
+template <typename Tracers, typename... Args>
+void executeTracers(const TracerRegistry& registry,
+                    Tracers SwappyTracerCallbacks::*tracers, Args... args) {
+    TracerRegistry::Reader reader(registry);
+    for (const auto& tracer : reader.callbacks().*tracers) {
         tracer.function(tracer.userData, std::forward<Args>(args)...);
     }
 }
 
 void SwappyCommon::preSwapBuffersCallbacks() {
-    executeTracers(mInjectedTracers.preSwapBuffers);
+    executeTracers(mInjectedTracers, &SwappyTracerCallbacks::preSwapBuffers);
 }
 
 void SwappyCommon::postSwapBuffersCallbacks() {
-    executeTracers(mInjectedTracers.postSwapBuffers,
+    executeTracers(mInjectedTracers, &SwappyTracerCallbacks::postSwapBuffers,
                    (int64_t)mPresentationTime.time_since_epoch().count());
 }
 
 void SwappyCommon::preWaitCallbacks() {
-    executeTracers(mInjectedTracers.preWait);
+    executeTracers(mInjectedTracers, &SwappyTracerCallbacks::preWait);
 }
 
 void SwappyCommon::postWaitCallbacks(nanoseconds cpuTime, nanoseconds gpuTime) {
-    executeTracers(mInjectedTracers.postWait, cpuTime.count(), gpuTime.count());
+    executeTracers(mInjectedTracers, &SwappyTracerCallbacks::postWait,
+                   cpuTime.count(), gpuTime.count());
 }
 
 void SwappyCommon::startFrameCallbacks() {
-    executeTracers(mInjectedTracers.startFrame, mCurrentFrame,
+    executeTracers(mInjectedTracers, &SwappyTracerCallbacks::startFrame,
+                   mCurrentFrame,
                    (int64_t)mPresentationTime.time_since_epoch().count());
 }
 
 void SwappyCommon::swapIntervalChangedCallbacks() {
-    executeTracers(mInjectedTracers.swapIntervalChanged);
+    executeTracers(mInjectedTracers,
+                   &SwappyTracerCallbacks::swapIntervalChanged);
 }
 
 void SwappyCommon::setAutoSwapInterval(bool enabled) {
@@ -880,6 +876,9 @@ void SwappyCommon::onSettingsChanged() {
 
     TimingSettings timingSettings =
         TimingSettings::from(*Settings::getInstance());
+    if (mSwapDurationOverride) {
+        timingSettings.swapDuration = *mSwapDurationOverride;
+    }
 
     // If display timings has changed, cache the update and apply them on the
     // next frame
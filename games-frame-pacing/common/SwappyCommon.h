@@ -21,7 +21,6 @@
 #include <atomic>
 #include <chrono>
 #include <deque>
-#include <list>
 #include <memory>
 #include <mutex>
 
@@ -30,6 +29,7 @@
 #include "ChoreographerThread.h"
 #include "SwappyDisplayManager.h"
 #include "Thread.h"
+#include "TracerRegistry.h"
 #include "swappy/swappyGL.h"
 #include "swappy/swappyGL_extra.h"
 
@@ -84,12 +84,6 @@ class SwappyCommon {
 
   PipelineMode getCurrentPipelineMode() { return mPipelineMode; }
 
-  template <typename... T>
-  struct Tracer {
-    void (*function)(void*, T...);
-    void* userData;
-  };
-
   void addTracerCallbacks(const SwappyTracer& tracer);
 
   void removeTracerCallbacks(const SwappyTracer& tracer);
@@ -101,6 +95,10 @@ class SwappyCommon {
     mAutoSwapIntervalThreshold = swapDuration;
   }
 
+  // Sets the swap duration of this instance only, overriding the one in
+  // Settings. Used to pace several Vulkan swapchains independently.
+  void setSwapDuration(std::chrono::nanoseconds swapDuration);
+
   std::chrono::steady_clock::time_point getPresentationTime() {
     return mPresentationTime;
   }
@@ -298,16 +296,7 @@ class SwappyCommon {
 
   std::chrono::steady_clock::time_point mStartFrameTime;
 
-  struct SwappyTracerCallbacks {
-    std::list<Tracer<>> preWait;
-    std::list<Tracer<int64_t, int64_t>> postWait;
-    std::list<Tracer<>> preSwapBuffers;
-    std::list<Tracer<int64_t>> postSwapBuffers;
-    std::list<Tracer<int32_t, int64_t>> startFrame;
-    std::list<Tracer<>> swapIntervalChanged;
-  };
-
-  SwappyTracerCallbacks mInjectedTracers;
+  TracerRegistry mInjectedTracers;
 
   int32_t mTargetFrame = 0;
   std::chrono::steady_clock::time_point mPresentationTime =
@@ -349,6 +338,9 @@ class SwappyCommon {
   };
   TimingSettings mNextTimingSettings GUARDED_BY(mMutex) = {};
   bool mTimingSettingsNeedUpdate GUARDED_BY(mMutex) = false;
+  std::optional<std::chrono::nanoseconds> mSwapDurationOverride
+      GUARDED_BY(mMutex);
+  Settings::ListenerId mSettingsListener;
 
   CPUTracer mCPUTracer;
 
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TracerRegistry.h"
+
+#include <algorithm>
+
+namespace swappy {
+
+namespace {
+
+template <typename Tracers, typename Func>
+void addToTracers(Tracers& tracers, Func func, void* userData) {
+    if (func != nullptr) {
+        tracers.push_back({func, userData});
+    }
+}
+
+template <typename Tracers, typename Func>
+void removeFromTracers(Tracers& tracers, Func func) {
+    if (func != nullptr) {
+        tracers.erase(std::remove_if(tracers.begin(), tracers.end(),
+                                     [func](const auto& tracer) {
+                                         return tracer.function == func;
+                                     }),
+                      tracers.end());
+    }
+}
+
+}  // anonymous namespace
+
+TracerRegistry::Reader::Reader(const TracerRegistry& registry)
+    : mRegistry(registry) {
+    // The increment must be visible before the snapshot is loaded, so that a
+    // writer seeing no active reader knows that later readers will load its
+    // newly published snapshot.
+    mRegistry.mActiveReaders.fetch_add(1, std::memory_order_seq_cst);
+    mCallbacks = mRegistry.mCurrent.load(std::memory_order_seq_cst);
+}
+
+TracerRegistry::Reader::~Reader() {
+    mRegistry.mActiveReaders.fetch_sub(1, std::memory_order_release);
+}
+
+TracerRegistry::TracerRegistry() {
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    publishLocked(std::make_unique<SwappyTracerCallbacks>());
+}
+
+TracerRegistry::~TracerRegistry() = default;
+
+void TracerRegistry::add(const SwappyTracer& tracer) {
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    auto callbacks = std::make_unique<SwappyTracerCallbacks>(*mOwned);
+    addToTracers(callbacks->preWait, tracer.preWait, tracer.userData);
+    addToTracers(callbacks->postWait, tracer.postWait, tracer.userData);
+    addToTracers(callbacks->preSwapBuffers, tracer.preSwapBuffers,
+                 tracer.userData);
+    addToTracers(callbacks->postSwapBuffers, tracer.postSwapBuffers,
+                 tracer.userData);
+    addToTracers(callbacks->startFrame, tracer.startFrame, tracer.userData);
+    addToTracers(callbacks->swapIntervalChanged, tracer.swapIntervalChanged,
+                 tracer.userData);
+    publishLocked(std::move(callbacks));
+}
+
+void TracerRegistry::remove(const SwappyTracer& tracer) {
+    std::lock_guard<std::mutex> lock(mWriteMutex);
+    auto callbacks = std::make_unique<SwappyTracerCallbacks>(*mOwned);
+    removeFromTracers(callbacks->preWait, tracer.preWait);
+    removeFromTracers(callbacks->postWait, tracer.postWait);
+    removeFromTracers(callbacks->preSwapBuffers, tracer.preSwapBuffers);
+    removeFromTracers(callbacks->postSwapBuffers, tracer.postSwapBuffers);
+    removeFromTracers(callbacks->startFrame, tracer.startFrame);
+    removeFromTracers(callbacks->swapIntervalChanged,
+                      tracer.swapIntervalChanged);
+    publishLocked(std::move(callbacks));
+}
+
+void TracerRegistry::publishLocked(
+    std::unique_ptr<SwappyTracerCallbacks> callbacks) {
+    mCurrent.store(callbacks.get(), std::memory_order_seq_cst);
+    if (mOwned) {
+        mRetired.push_back(std::move(mOwned));
+    }
+    mOwned = std::move(callbacks);
+
+    // Readers that started before the store above may still hold a retired
+    // snapshot. Once none is active, no one can see those snapshots anymore.
+    // Otherwise they are kept until a later update (or the destructor) and
+    // a tracer can safely unregister itself from inside a callback.
+    if (mActiveReaders.load(std::memory_order_seq_cst) == 0) {
+        mRetired.clear();
+    }
+}
+
+}  // namespace swappy
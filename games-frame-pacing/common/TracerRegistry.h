@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Thread.h"
+#include "swappy/swappy_common.h"
+
+namespace swappy {
+
+template <typename... T>
+struct Tracer {
+  void (*function)(void*, T...);
+  void* userData;
+};
+
+struct SwappyTracerCallbacks {
+  std::vector<Tracer<>> preWait;
+  std::vector<Tracer<int64_t, int64_t>> postWait;
+  std::vector<Tracer<>> preSwapBuffers;
+  std::vector<Tracer<int64_t>> postSwapBuffers;
+  std::vector<Tracer<int32_t, int64_t>> startFrame;
+  std::vector<Tracer<>> swapIntervalChanged;
+};
+
+// Copy-on-write registry of the injected tracers.
+//
+// The swap thread reads an immutable snapshot of the callbacks without taking
+// a lock, while add()/remove() may be called from any thread: they copy the
+// current snapshot, modify the copy and publish it atomically. Replaced
+// snapshots are only freed once no reader is active.
+class TracerRegistry {
+ public:
+  // Keeps the current snapshot alive while it is being iterated.
+  class Reader {
+   public:
+    explicit Reader(const TracerRegistry& registry);
+    ~Reader();
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    const SwappyTracerCallbacks& callbacks() const { return *mCallbacks; }
+
+   private:
+    const TracerRegistry& mRegistry;
+    const SwappyTracerCallbacks* mCallbacks;
+  };
+
+  TracerRegistry();
+  ~TracerRegistry();
+
+  void add(const SwappyTracer& tracer);
+  void remove(const SwappyTracer& tracer);
+
+ private:
+  void publishLocked(std::unique_ptr<SwappyTracerCallbacks> callbacks)
+      REQUIRES(mWriteMutex);
+
+  mutable std::atomic<int32_t> mActiveReaders{0};
+  std::atomic<const SwappyTracerCallbacks*> mCurrent{nullptr};
+
+  std::mutex mWriteMutex;
+  std::unique_ptr<SwappyTracerCallbacks> mOwned GUARDED_BY(mWriteMutex);
+  std::vector<std::unique_ptr<SwappyTracerCallbacks>> mRetired
+      GUARDED_BY(mWriteMutex);
+};
+
+}  // namespace swappy
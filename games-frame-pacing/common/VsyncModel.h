@@ -0,0 +1,122 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace swappy {
+
+// Phase-locked model of the display vsync. The phase is anchored on the
+// Choreographer timestamps and the period is refined by exponential smoothing.
+// A change of nominal refresh period swaps the period and re-anchors the phase
+// on the last timestamp, so the model survives refresh rate switches.
+//
+// The model never reads the clock itself: all times are passed in, which lets
+// ChoreographerFilter use the steady clock and the tests use a fake one.
+class VsyncModel {
+ public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  VsyncModel(std::chrono::nanoseconds refreshPeriod,
+             std::chrono::nanoseconds appToSfDelay, time_point now)
+      : mRefreshPeriod(refreshPeriod),
+        mAppToSfDelay(appToSfDelay),
+        mBaseTime(now),
+        mLastTimestamp(now) {}
+
+  void setTimings(std::chrono::nanoseconds refreshPeriod,
+                  std::chrono::nanoseconds appToSfDelay) {
+    mRefreshPeriod = refreshPeriod;
+    mAppToSfDelay = appToSfDelay;
+    mBaseTime = mLastTimestamp + mAppToSfDelay;
+  }
+
+  std::chrono::nanoseconds getRefreshPeriod() const { return mRefreshPeriod; }
+
+  // Returns false if we have detected that we have received the same
+  // timestamp multiple times so that the caller can wait for fresh timestamps
+  bool addTimestamp(time_point point) {
+    // Keep track of the previous timestamp and how many times we've seen it
+    // to determine if we've stopped receiving Choreographer callbacks,
+    // which would indicate that we should probably stop until we see them
+    // again (e.g., if the app has been moved to the background)
+    if (point == mLastTimestamp) {
+      if (mRepeatCount++ > 5) {
+        return false;
+      }
+    } else {
+      mRepeatCount = 0;
+    }
+    mLastTimestamp = point;
+
+    point += mAppToSfDelay;
+
+    bool moreThanOneRefreshPeriodElapsed =
+        mBaseTime + mRefreshPeriod * 1.5 < point;
+    if (moreThanOneRefreshPeriodElapsed) {
+      do {
+        mBaseTime += mRefreshPeriod;
+      } while (mBaseTime + mRefreshPeriod * 1.5 < point);
+      mBaseTime += mRefreshPeriod;
+      // Long waits pollute the filter so don't adjust refreshPeriod.
+      return true;
+    }
+
+    std::chrono::nanoseconds delta = (point - (mBaseTime + mRefreshPeriod));
+    if (delta < -mRefreshPeriod / 2) {
+      // Also ignore short intervals
+      return true;
+    }
+
+    // Exponential smoothing factor = 0.04 avoids roughness.
+    mRefreshPeriod += delta / 25;
+    mBaseTime += mRefreshPeriod;
+
+    return true;
+  }
+
+  // Returns the first predicted vsync (shifted by offset) that is in the
+  // future and at least half a period after the previous deadline, so the
+  // worker never runs twice for the same vsync.
+  time_point nextDeadline(std::chrono::nanoseconds offset, time_point now,
+                          time_point previousDeadline) const {
+    if (offset < -(mRefreshPeriod / 2) || offset > mRefreshPeriod / 2) {
+      offset = std::chrono::nanoseconds(0);
+    }
+
+    auto deadline = mBaseTime + mRefreshPeriod + offset;
+    if (deadline < now) {
+      const auto missed = (now - deadline) / mRefreshPeriod + 1;
+      deadline += mRefreshPeriod * missed;
+    }
+    if (deadline - previousDeadline < mRefreshPeriod / 2) {
+      deadline += mRefreshPeriod;
+    }
+    return deadline;
+  }
+
+ private:
+  std::chrono::nanoseconds mRefreshPeriod;
+  std::chrono::nanoseconds mAppToSfDelay;
+  time_point mBaseTime;
+
+  time_point mLastTimestamp;
+  int32_t mRepeatCount = 0;
+};
+
+}  // namespace swappy
@@ -94,6 +94,15 @@ SwappyStats FrameStatisticsGL::getStats() {
     return mFrameStatsCommon.getStats();
 }
 
+SwappyDetailedStats FrameStatisticsGL::getDetailedStats() {
+    return mFrameStatsCommon.getDetailedStats();
+}
+
+void FrameStatisticsGL::setBucketResolution(
+    std::chrono::nanoseconds resolution) {
+    mFrameStatsCommon.setBucketResolution(resolution);
+}
+
 void FrameStatisticsGL::clearStats() { mFrameStatsCommon.clearStats(); }
 
 int32_t FrameStatisticsGL::lastLatencyRecorded() {
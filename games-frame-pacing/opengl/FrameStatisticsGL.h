@@ -39,6 +39,8 @@ class FrameStatisticsGL {
   void enableStats(bool enabled);
   void capture(EGLDisplay dpy, EGLSurface surface);
   SwappyStats getStats();
+  SwappyDetailedStats getDetailedStats();
+  void setBucketResolution(std::chrono::nanoseconds resolution);
   void clearStats();
 
   int32_t lastLatencyRecorded();
@@ -209,6 +209,26 @@ void SwappyGL::getStats(SwappyStats *stats) {
     }
 }
 
+void SwappyGL::getDetailedStats(SwappyDetailedStats *stats) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return;
+    }
+    if (swappy->mFrameStatistics) {
+        *stats = swappy->mFrameStatistics->getDetailedStats();
+    }
+}
+
+void SwappyGL::setStatsBucketResolution(std::chrono::nanoseconds resolution) {
+    SwappyGL *swappy = getInstance();
+    if (!swappy) {
+        return;
+    }
+    if (swappy->mFrameStatistics) {
+        swappy->mFrameStatistics->setBucketResolution(resolution);
+    }
+}
+
 void SwappyGL::clearStats() {
     SwappyGL *swappy = getInstance();
     if (!swappy) {
@@ -67,6 +67,8 @@ class SwappyGL {
   static void enableStats(bool enabled);
   static void recordFrameStart(EGLDisplay display, EGLSurface surface);
   static void getStats(SwappyStats *stats);
+  static void getDetailedStats(SwappyDetailedStats *stats);
+  static void setStatsBucketResolution(std::chrono::nanoseconds resolution);
   static void clearStats();
 
   static bool isEnabled();
@@ -101,6 +101,14 @@ void SwappyGL_recordFrameStart(EGLDisplay display, EGLSurface surface) {
 
 void SwappyGL_getStats(SwappyStats *stats) { SwappyGL::getStats(stats); }
 
+void SwappyGL_getDetailedStats(SwappyDetailedStats *stats) {
+    SwappyGL::getDetailedStats(stats);
+}
+
+void SwappyGL_setStatsBucketResolutionNS(uint64_t resolution_ns) {
+    SwappyGL::setStatsBucketResolution(std::chrono::nanoseconds(resolution_ns));
+}
+
 void SwappyGL_clearStats() { SwappyGL::clearStats(); }
 
 bool SwappyGL_isEnabled() { return SwappyGL::isEnabled(); }
@@ -379,6 +379,20 @@ void SwappyVk::getStats(VkSwapchainKHR swapchain, SwappyStats* swappyStats) {
         it->second->getStats(swappyStats);
 }
 
+void SwappyVk::getDetailedStats(VkSwapchainKHR swapchain,
+                                SwappyDetailedStats* swappyStats) {
+    auto it = perSwapchainImplementation.find(swapchain);
+    if (it != perSwapchainImplementation.end())
+        it->second->getDetailedStats(swappyStats);
+}
+
+void SwappyVk::setStatsBucketResolution(VkSwapchainKHR swapchain,
+                                        std::chrono::nanoseconds resolution) {
+    auto it = perSwapchainImplementation.find(swapchain);
+    if (it != perSwapchainImplementation.end())
+        it->second->setStatsBucketResolution(resolution);
+}
+
 void SwappyVk::recordFrameStart(VkQueue queue, VkSwapchainKHR swapchain,
                                 uint32_t image) {
     auto it = perSwapchainImplementation.find(swapchain);
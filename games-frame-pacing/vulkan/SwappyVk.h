@@ -94,6 +94,10 @@ class SwappyVk {
   // Frame statistics.
   void enableStats(VkSwapchainKHR swapchain, bool enabled);
   void getStats(VkSwapchainKHR swapchain, SwappyStats* swappyStats);
+  void getDetailedStats(VkSwapchainKHR swapchain,
+                        SwappyDetailedStats* swappyStats);
+  void setStatsBucketResolution(VkSwapchainKHR swapchain,
+                                std::chrono::nanoseconds resolution);
   void recordFrameStart(VkQueue queue, VkSwapchainKHR swapchain,
                         uint32_t image);
   void clearStats(VkSwapchainKHR swapchain);
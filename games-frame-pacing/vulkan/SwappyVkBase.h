@@ -52,13 +52,14 @@
 #include <condition_variable>
 #include <cstdlib>
 #include <cstring>
-#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 
 #include "ChoreographerShim.h"
 #include "Settings.h"
 #include "SwappyCommon.h"
+#include "SwappyVkSyncPool.h"
 #include "Trace.h"
 
 namespace swappy {
@@ -91,6 +92,7 @@ extern PFN_vkDestroyCommandPool vkDestroyCommandPool;
 extern PFN_vkCreateFence vkCreateFence;
 extern PFN_vkDestroyFence vkDestroyFence;
 extern PFN_vkWaitForFences vkWaitForFences;
+extern PFN_vkGetFenceStatus vkGetFenceStatus;
 extern PFN_vkResetFences vkResetFences;
 extern PFN_vkCreateSemaphore vkCreateSemaphore;
 extern PFN_vkDestroySemaphore vkDestroySemaphore;
@@ -146,6 +148,9 @@ class SwappyVkBase {
 
   virtual void enableStats(bool enabled) = 0;
   virtual void getStats(SwappyStats* swappyStats) = 0;
+  virtual void getDetailedStats(SwappyDetailedStats* swappyStats) = 0;
+  virtual void setStatsBucketResolution(
+      std::chrono::nanoseconds resolution) = 0;
   virtual void recordFrameStart(VkQueue queue, uint32_t image) = 0;
   virtual void clearStats() = 0;
 
@@ -154,24 +159,6 @@ class SwappyVkBase {
   void enableBlockingWait(bool enable);
 
  protected:
-  struct VkSync {
-    VkFence fence;
-    VkSemaphore semaphore;
-    VkCommandBuffer command;
-    VkEvent event;
-  };
-
-  struct ThreadContext {
-    ThreadContext(VkQueue queue) : queue(queue) {}
-
-    Thread thread;
-    bool running GUARDED_BY(lock) = true;
-    bool hasPendingWork GUARDED_BY(lock);
-    std::mutex lock;
-    std::condition_variable_any condition;
-    VkQueue queue GUARDED_BY(lock);
-  };
-
   SwappyCommon mCommonBase;
   VkPhysicalDevice mPhysicalDevice;
   VkDevice mDevice;
@@ -190,29 +177,14 @@ class SwappyVkBase {
   PFN_vkGetPastPresentationTimingGOOGLE mpfnGetPastPresentationTimingGOOGLE =
       nullptr;
 #endif
-  // Holds VKSync objects ready to be used
-  std::map<VkQueue, std::list<VkSync>> mFreeSyncPool;
-
-  // Holds VKSync objects queued and but signaled yet
-  std::map<VkQueue, std::list<VkSync>> mWaitingSyncs;
-
-  // Holds VKSync objects that were signaled
-  std::map<VkQueue, std::list<VkSync>> mSignaledSyncs;
-
-  std::map<VkQueue, VkCommandPool> mCommandPool;
-  std::map<VkQueue, std::unique_ptr<ThreadContext>> mThreads;
-
-  static constexpr int MAX_PENDING_FENCES = 2;
-
-  std::atomic<std::chrono::nanoseconds> mLastFenceTime = {};
+  // VkSync objects are shared by all the swapchains of the device
+  std::shared_ptr<SwappyVkSyncPool> mSyncPool;
+  SwappyVkSyncPool::Tracker mSyncTracker;
 
   void initGoogExtension();
   VkResult initializeVkSyncObjects(VkQueue queue, uint32_t queueFamilyIndex);
-  void destroyVkSyncObjects();
-  void reclaimSignaledFences(VkQueue queue);
   bool lastFrameIsCompleted(VkQueue queue);
   std::chrono::nanoseconds getLastFenceTime(VkQueue queue);
-  void waitForFenceThreadMain(ThreadContext& thread);
 };
 
 }  // namespace swappy
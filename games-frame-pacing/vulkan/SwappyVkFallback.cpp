@@ -109,6 +109,15 @@ void SwappyVkFallback::getStats(SwappyStats* swappyStats) {
     SWAPPY_LOGE("Frame Statistics Unsupported - API ignored");
 }
 
+void SwappyVkFallback::getDetailedStats(SwappyDetailedStats* swappyStats) {
+    SWAPPY_LOGE("Frame Statistics Unsupported - API ignored");
+}
+
+void SwappyVkFallback::setStatsBucketResolution(
+    std::chrono::nanoseconds resolution) {
+    SWAPPY_LOGE("Frame Statistics Unsupported - API ignored");
+}
+
 void SwappyVkFallback::recordFrameStart(VkQueue queue, uint32_t image) {
     SWAPPY_LOGE("Frame Statistics Unsupported - API ignored");
 }
@@ -210,6 +210,16 @@ void SwappyVkGoogleDisplayTiming::getStats(SwappyStats* swappyStats) {
     *swappyStats = mFrameStatisticsCommon.getStats();
 }
 
+void SwappyVkGoogleDisplayTiming::getDetailedStats(
+    SwappyDetailedStats* swappyStats) {
+    *swappyStats = mFrameStatisticsCommon.getDetailedStats();
+}
+
+void SwappyVkGoogleDisplayTiming::setStatsBucketResolution(
+    std::chrono::nanoseconds resolution) {
+    mFrameStatisticsCommon.setBucketResolution(resolution);
+}
+
 void SwappyVkGoogleDisplayTiming::clearStats() {
     mFrameStatisticsCommon.clearStats();
 }
@@ -79,6 +79,9 @@ class SwappyVkGoogleDisplayTiming : public SwappyVkBase {
   void enableStats(bool enabled) override final;
   void recordFrameStart(VkQueue queue, uint32_t image) override final;
   void getStats(SwappyStats* swappyStats) override final;
+  void getDetailedStats(SwappyDetailedStats* swappyStats) override final;
+  void setStatsBucketResolution(
+      std::chrono::nanoseconds resolution) override final;
   void clearStats() override final;
 
  private:
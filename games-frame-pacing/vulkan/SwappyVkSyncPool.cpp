@@ -0,0 +1,380 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SwappyVkSyncPool.h"
+
+#include <algorithm>
+
+#include "SwappyVkBase.h"
+#include "Trace.h"
+
+#define LOG_TAG "SwappyVkSyncPool"
+#include "SwappyLog.h"
+
+namespace swappy {
+
+using namespace std::chrono_literals;
+
+// How long the waiter thread waits before looking for fences submitted to
+// other queues in the meantime.
+constexpr std::chrono::nanoseconds MULTIPLE_QUEUES_WAIT_SLICE = 1ms;
+
+std::shared_ptr<SwappyVkSyncPool> SwappyVkSyncPool::getForDevice(
+    VkDevice device) {
+    static std::mutex sPoolsMutex;
+    static std::map<VkDevice, std::weak_ptr<SwappyVkSyncPool>> sPools;
+
+    std::lock_guard<std::mutex> lock(sPoolsMutex);
+    auto pool = sPools[device].lock();
+    if (!pool) {
+        pool = std::make_shared<SwappyVkSyncPool>(device);
+        sPools[device] = pool;
+    }
+    return pool;
+}
+
+SwappyVkSyncPool::SwappyVkSyncPool(VkDevice device) : mDevice(device) {}
+
+SwappyVkSyncPool::~SwappyVkSyncPool() {
+    // Stop the waiter thread
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+        mCondition.notify_all();
+    }
+    mThread.join();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Wait for all unsignaled fences to get signaled
+    for (const auto& pending : mPendingSyncs) {
+        vkWaitForFences(mDevice, 1, &pending.sync.fence, VK_TRUE, UINT64_MAX);
+    }
+    mPendingSyncs.clear();
+
+    // Free all sync objects and the command pools
+    for (auto& [queueFamilyIndex, family] : mFamilies) {
+        for (auto& sync : family.allSyncs) {
+            vkFreeCommandBuffers(mDevice, family.commandPool, 1,
+                                 &sync.command);
+            vkDestroyEvent(mDevice, sync.event, NULL);
+            vkDestroySemaphore(mDevice, sync.semaphore, NULL);
+            vkResetFences(mDevice, 1, &sync.fence);
+            vkDestroyFence(mDevice, sync.fence, NULL);
+        }
+        vkDestroyCommandPool(mDevice, family.commandPool, NULL);
+    }
+}
+
+VkResult SwappyVkSyncPool::addQueue(Tracker& tracker, VkQueue queue,
+                                    uint32_t queueFamilyIndex) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (tracker.mPendingFences.find(queue) != tracker.mPendingFences.end()) {
+        return VK_SUCCESS;
+    }
+
+    auto& family = mFamilies[queueFamilyIndex];
+    if (family.commandPool == VK_NULL_HANDLE) {
+        const VkCommandPoolCreateInfo cmd_pool_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .queueFamilyIndex = queueFamilyIndex,
+        };
+
+        VkResult res = vkCreateCommandPool(mDevice, &cmd_pool_info, NULL,
+                                           &family.commandPool);
+        if (res) {
+            SWAPPY_LOGE("vkCreateCommandPool failed %d", res);
+            return res;
+        }
+    }
+
+    while (family.allSyncs.size() < family.reserved + MAX_PENDING_FENCES) {
+        VkResult res = allocateSync(family, queueFamilyIndex);
+        if (res) {
+            return res;
+        }
+    }
+    family.reserved += MAX_PENDING_FENCES;
+    auto& queueInfo = mQueues[queue];
+    queueInfo.familyIndex = queueFamilyIndex;
+    ++queueInfo.trackers;
+    tracker.mPendingFences[queue] = 0;
+
+    // Start the thread waiting for the fences of all queues
+    if (!mThread.joinable()) {
+        mThread = Thread([this]() { waitForFenceThreadMain(); });
+    }
+    return VK_SUCCESS;
+}
+
+VkResult SwappyVkSyncPool::allocateSync(QueueFamily& family,
+                                        uint32_t queueFamilyIndex) {
+    VkSync sync;
+    sync.queueFamilyIndex = queueFamilyIndex;
+
+    const VkCommandBufferAllocateInfo present_cmd_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = family.commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    VkFenceCreateInfo fence_ci = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                                  .pNext = NULL,
+                                  .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+    VkResult res = vkCreateFence(mDevice, &fence_ci, NULL, &sync.fence);
+    if (res) {
+        SWAPPY_LOGE("failed to create fence: %d", res);
+        return res;
+    }
+
+    VkSemaphoreCreateInfo semaphore_ci = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0};
+    res = vkCreateSemaphore(mDevice, &semaphore_ci, NULL, &sync.semaphore);
+    if (res) {
+        SWAPPY_LOGE("failed to create semaphore: %d", res);
+        return res;
+    }
+
+    res = vkAllocateCommandBuffers(mDevice, &present_cmd_info, &sync.command);
+    if (res) {
+        SWAPPY_LOGE("vkAllocateCommandBuffers failed %d", res);
+        return res;
+    }
+
+    const VkCommandBufferBeginInfo cmd_buf_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+        .pInheritanceInfo = NULL,
+    };
+    res = vkBeginCommandBuffer(sync.command, &cmd_buf_info);
+    if (res) {
+        SWAPPY_LOGE("vkBeginCommandBuffer failed %d", res);
+        return res;
+    }
+
+    VkEventCreateInfo event_info = {
+        .sType = VK_STRUCTURE_TYPE_EVENT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+    };
+    res = vkCreateEvent(mDevice, &event_info, NULL, &sync.event);
+    if (res) {
+        SWAPPY_LOGE("vkCreateEvent failed %d", res);
+        return res;
+    }
+
+    vkCmdSetEvent(sync.command, sync.event,
+                  VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+    res = vkEndCommandBuffer(sync.command);
+    if (res) {
+        SWAPPY_LOGE("vkEndCommandBuffer failed %d", res);
+        return res;
+    }
+
+    family.allSyncs.push_back(sync);
+    family.freeSyncs.push_back(sync);
+    return VK_SUCCESS;
+}
+
+void SwappyVkSyncPool::removeTracker(Tracker& tracker) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [&]() REQUIRES(mMutex) {
+        return std::all_of(tracker.mPendingFences.begin(),
+                           tracker.mPendingFences.end(),
+                           [](const auto& pendingFences) {
+                               return pendingFences.second == 0;
+                           });
+    });
+
+    for (const auto& pendingFences : tracker.mPendingFences) {
+        auto queue = mQueues.find(pendingFences.first);
+        mFamilies[queue->second.familyIndex].reserved -= MAX_PENDING_FENCES;
+        // Forget the queue with its last tracker, so that the waiter thread
+        // stops polling for it.
+        if (--queue->second.trackers == 0) {
+            mLastSignalTime.erase(queue->first);
+            mQueues.erase(queue);
+        }
+    }
+    tracker.mPendingFences.clear();
+}
+
+VkResult SwappyVkSyncPool::injectFence(Tracker& tracker, VkQueue queue,
+                                       const VkPresentInfoKHR* pPresentInfo,
+                                       std::chrono::nanoseconds fenceTimeout,
+                                       VkSemaphore* pSemaphore) {
+    *pSemaphore = VK_NULL_HANDLE;
+
+    VkSync sync;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto pendingFences = tracker.mPendingFences.find(queue);
+        if (pendingFences == tracker.mPendingFences.end()) {
+            SWAPPY_LOGE("Unknown queue %p", queue);
+            return VK_SUCCESS;
+        }
+
+        // If we cross the swap interval threshold, we don't pace at all.
+        // In this case we might not have a free fence, so just don't use the
+        // fence.
+        auto& freeSyncs = mFamilies[mQueues[queue].familyIndex].freeSyncs;
+        if (pendingFences->second >= MAX_PENDING_FENCES || freeSyncs.empty() ||
+            vkGetFenceStatus(mDevice, freeSyncs.back().fence) != VK_SUCCESS) {
+            return VK_SUCCESS;
+        }
+
+        sync = freeSyncs.back();
+        freeSyncs.pop_back();
+    }
+
+    vkResetFences(mDevice, 1, &sync.fence);
+
+    VkPipelineStageFlags pipe_stage_flags;
+    VkSubmitInfo submit_info;
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = NULL;
+    submit_info.pWaitDstStageMask = &pipe_stage_flags;
+    pipe_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    submit_info.waitSemaphoreCount = pPresentInfo->waitSemaphoreCount;
+    submit_info.pWaitSemaphores = pPresentInfo->pWaitSemaphores;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &sync.command;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &sync.semaphore;
+    VkResult res = vkQueueSubmit(queue, 1, &submit_info, sync.fence);
+    *pSemaphore = sync.semaphore;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mPendingSyncs.push_back({sync, queue, &tracker,
+                             std::chrono::steady_clock::now(), fenceTimeout});
+    ++tracker.mPendingFences[queue];
+    mCondition.notify_all();
+
+    return res;
+}
+
+uint32_t SwappyVkSyncPool::getPendingFences(const Tracker& tracker,
+                                            VkQueue queue) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto pendingFences = tracker.mPendingFences.find(queue);
+    if (pendingFences == tracker.mPendingFences.end()) {
+        return 0;
+    }
+    return pendingFences->second;
+}
+
+void SwappyVkSyncPool::retireLocked(
+    const PendingSync& pending,
+    std::chrono::steady_clock::time_point signalTime) {
+    // The GPU starts on this frame at the earliest when it was submitted and
+    // when the previous frame on the same queue was done.
+    auto& lastSignalTime = mLastSignalTime[pending.queue];
+    const auto startTime = std::max(pending.submitTime, lastSignalTime);
+    pending.tracker->mLastFenceTime = signalTime - startTime;
+    lastSignalTime = signalTime;
+
+    --pending.tracker->mPendingFences[pending.queue];
+    mFamilies[pending.sync.queueFamilyIndex].freeSyncs.push_back(pending.sync);
+}
+
+void SwappyVkSyncPool::waitForFenceThreadMain() {
+    std::vector<VkFence> fences;
+    std::vector<bool> signaled;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        // Wait for new fence objects
+        mCondition.wait(lock, [&]() REQUIRES(mMutex) {
+            return !mPendingSyncs.empty() || !mRunning;
+        });
+
+        if (!mRunning) {
+            break;
+        }
+
+        // Only this thread removes pending syncs, so the ones collected here
+        // stay at the front of the queue while the lock is released.
+        fences.clear();
+        size_t oldest = 0;
+        auto deadline = std::chrono::steady_clock::time_point::max();
+        for (const auto& pending : mPendingSyncs) {
+            const auto pendingDeadline =
+                pending.submitTime + pending.fenceTimeout;
+            if (pendingDeadline < deadline) {
+                deadline = pendingDeadline;
+                oldest = fences.size();
+            }
+            fences.push_back(pending.sync.fence);
+        }
+        // Fences of a queue signal in submission order, but a fence submitted
+        // to another queue while we wait could signal before the ones we wait
+        // on. Wake up regularly to pick it up.
+        const bool multipleQueues = mQueues.size() > 1;
+        lock.unlock();
+
+        auto timeout = std::max(deadline - std::chrono::steady_clock::now(),
+                                std::chrono::steady_clock::duration(0));
+        if (multipleQueues) {
+            timeout = std::min<std::chrono::steady_clock::duration>(
+                timeout, MULTIPLE_QUEUES_WAIT_SLICE);
+        }
+
+        VkResult result;
+        {
+            gamesdk::ScopedTrace tracer("Swappy: GPU frame time");
+            result = vkWaitForFences(
+                mDevice, fences.size(), fences.data(), VK_FALSE,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(timeout)
+                    .count());
+        }
+        const auto signalTime = std::chrono::steady_clock::now();
+
+        signaled.assign(fences.size(), false);
+        if (result == VK_SUCCESS) {
+            for (size_t i = 0; i < fences.size(); ++i) {
+                signaled[i] =
+                    vkGetFenceStatus(mDevice, fences[i]) == VK_SUCCESS;
+            }
+        } else if (result != VK_TIMEOUT || signalTime >= deadline) {
+            SWAPPY_LOGW_ONCE("Failed to wait for fence %d", result);
+            // Don't wait on the oldest fence anymore. Its VkSync object will
+            // only be reused once the fence is signaled.
+            signaled[oldest] = true;
+        }
+
+        lock.lock();
+        auto it = mPendingSyncs.begin();
+        for (size_t i = 0; i < signaled.size(); ++i) {
+            if (signaled[i]) {
+                retireLocked(*it, signalTime);
+                it = mPendingSyncs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        mCondition.notify_all();
+    }
+}
+
+}  // namespace swappy
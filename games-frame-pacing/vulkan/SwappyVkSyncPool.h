@@ -0,0 +1,146 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Pool of the sync objects used to track when presented frames are rendered.
+ *
+ * One pool exists per VkDevice and is shared by all the swapchains of that
+ * device:
+ *  - VkSync objects are preallocated per queue family (they hold a command
+ *    buffer, which is bound to a family) and recycled across frames, queues
+ *    and swapchains.
+ *  - A single thread waits on the in-flight fences of all queues at once
+ *    (vkWaitForFences with waitAll = VK_FALSE) and returns the signaled
+ *    VkSync objects to the pool.
+ *  - Each swapchain tracks its own in-flight fences through a Tracker, so that
+ *    swapchains sharing the pool are paced independently.
+ */
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Thread.h"
+
+namespace swappy {
+
+class SwappyVkSyncPool {
+ public:
+  // In-flight fences of one client of the pool.
+  class Tracker {
+   public:
+    std::chrono::nanoseconds getLastFenceTime() const {
+      return mLastFenceTime;
+    }
+
+   private:
+    friend class SwappyVkSyncPool;
+    // Number of in-flight fences, per queue added to the pool.
+    std::map<VkQueue, uint32_t> mPendingFences;
+    std::atomic<std::chrono::nanoseconds> mLastFenceTime = {};
+  };
+
+  // Returns the pool of the device, creating it if needed.
+  static std::shared_ptr<SwappyVkSyncPool> getForDevice(VkDevice device);
+
+  explicit SwappyVkSyncPool(VkDevice device);
+  ~SwappyVkSyncPool();
+
+  // Preallocates the VkSync objects needed for the tracker to present from
+  // the queue. Does nothing if the queue was already added for the tracker.
+  VkResult addQueue(Tracker& tracker, VkQueue queue,
+                    uint32_t queueFamilyIndex);
+
+  // Waits until all the fences of the tracker are signaled and releases the
+  // VkSync objects reserved for it.
+  void removeTracker(Tracker& tracker);
+
+  // Submits a command signaling a fence and a semaphore once the present's
+  // wait semaphores are signaled. Sets *pSemaphore to VK_NULL_HANDLE when no
+  // VkSync object is available.
+  VkResult injectFence(Tracker& tracker, VkQueue queue,
+                       const VkPresentInfoKHR* pPresentInfo,
+                       std::chrono::nanoseconds fenceTimeout,
+                       VkSemaphore* pSemaphore);
+
+  uint32_t getPendingFences(const Tracker& tracker, VkQueue queue);
+
+  static constexpr int MAX_PENDING_FENCES = 2;
+
+ private:
+  struct VkSync {
+    VkFence fence;
+    VkSemaphore semaphore;
+    VkCommandBuffer command;
+    VkEvent event;
+    uint32_t queueFamilyIndex;
+  };
+
+  struct PendingSync {
+    VkSync sync;
+    VkQueue queue;
+    Tracker* tracker;
+    std::chrono::steady_clock::time_point submitTime;
+    std::chrono::nanoseconds fenceTimeout;
+  };
+
+  struct Queue {
+    uint32_t familyIndex;
+    // Number of trackers presenting from this queue.
+    size_t trackers = 0;
+  };
+
+  struct QueueFamily {
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    std::vector<VkSync> allSyncs;
+    std::vector<VkSync> freeSyncs;
+    // Number of VkSync objects needed by the trackers using this family.
+    size_t reserved = 0;
+  };
+
+  VkResult allocateSync(QueueFamily& family, uint32_t queueFamilyIndex)
+      REQUIRES(mMutex);
+  void retireLocked(const PendingSync& pending,
+                    std::chrono::steady_clock::time_point signalTime)
+      REQUIRES(mMutex);
+  void waitForFenceThreadMain();
+
+  const VkDevice mDevice;
+
+  std::mutex mMutex;
+  std::condition_variable mCondition;
+  bool mRunning GUARDED_BY(mMutex) = true;
+  // Queues used by the trackers, removed with their last tracker.
+  std::map<VkQueue, Queue> mQueues GUARDED_BY(mMutex);
+  std::map<uint32_t, QueueFamily> mFamilies GUARDED_BY(mMutex);
+  // In-flight VkSync objects of all queues, in submission order.
+  std::deque<PendingSync> mPendingSyncs GUARDED_BY(mMutex);
+  std::map<VkQueue, std::chrono::steady_clock::time_point> mLastSignalTime
+      GUARDED_BY(mMutex);
+
+  Thread mThread;
+};
+
+}  // namespace swappy
@@ -169,6 +169,21 @@ void SwappyVk_getStats(VkSwapchainKHR swapchain, SwappyStats* swappyStats) {
     swappy.getStats(swapchain, swappyStats);
 }
 
+void SwappyVk_getDetailedStats(VkSwapchainKHR swapchain,
+                               SwappyDetailedStats* swappyStats) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    swappy.getDetailedStats(swapchain, swappyStats);
+}
+
+void SwappyVk_setStatsBucketResolutionNS(VkSwapchainKHR swapchain,
+                                         uint64_t resolution_ns) {
+    TRACE_CALL();
+    swappy::SwappyVk& swappy = swappy::SwappyVk::getInstance();
+    swappy.setStatsBucketResolution(swapchain,
+                                    std::chrono::nanoseconds(resolution_ns));
+}
+
 void SwappyVk_recordFrameStart(VkQueue queue, VkSwapchainKHR swapchain,
                                uint32_t image) {
     TRACE_CALL();
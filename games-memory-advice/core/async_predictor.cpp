@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "async_predictor.h"
+
+namespace memory_advice {
+
+AsyncPredictor::AsyncPredictor(IPredictor* predictor)
+    : predictor_(predictor) {}
+
+AsyncPredictor::~AsyncPredictor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    condition_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+std::shared_ptr<const Prediction> AsyncPredictor::Latest() const {
+    return std::atomic_load(&latest_);
+}
+
+std::shared_ptr<const Prediction> AsyncPredictor::Predict(
+    const std::vector<float>& features, Clock::time_point time) {
+    std::lock_guard<std::mutex> lock(predict_mutex_);
+    auto prediction = std::make_shared<const Prediction>(
+        Prediction{predictor_->Predict(features), time});
+    // Only the thread holding predict_mutex_ publishes, so latest_ can't
+    // change between the check and the store.
+    auto latest = std::atomic_load(&latest_);
+    if (latest == nullptr || latest->time <= time) {
+        std::atomic_store(&latest_, prediction);
+    }
+    return prediction;
+}
+
+void AsyncPredictor::Submit(const std::vector<float>& features,
+                            Clock::time_point time) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_features_.assign(features.begin(), features.end());
+    pending_time_ = time;
+    pending_ = true;
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&AsyncPredictor::Looper, this);
+    } else {
+        condition_.notify_one();
+    }
+}
+
+void AsyncPredictor::Looper() {
+    std::vector<float> features;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (!pending_) {
+            condition_.wait(lock);
+            continue;
+        }
+        // Keep both buffers allocated across iterations.
+        features.swap(pending_features_);
+        Clock::time_point time = pending_time_;
+        pending_ = false;
+        lock.unlock();
+        Predict(features, time);
+        lock.lock();
+    }
+}
+
+}  // namespace memory_advice
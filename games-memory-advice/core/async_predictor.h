@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "predictor.h"
+
+namespace memory_advice {
+
+/** @brief A prediction of the available memory model. */
+struct Prediction {
+  float value;
+  /** @brief When the metrics the prediction was made from were sampled. */
+  std::chrono::steady_clock::time_point time;
+};
+
+/**
+ * @brief Runs a predictor on a background thread.
+ *
+ * The latest prediction is published through an atomically updated pointer,
+ * so that callers can reuse it while it is recent enough without waiting for
+ * the model. Features submitted while the thread is busy replace any that are
+ * still pending, so the thread only runs the model on the latest sample.
+ */
+class AsyncPredictor {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit AsyncPredictor(IPredictor* predictor);
+  ~AsyncPredictor();
+
+  /** @brief Returns the latest prediction, or null if there is none. */
+  std::shared_ptr<const Prediction> Latest() const;
+
+  /** @brief Runs the predictor on the calling thread, and publishes the
+   * prediction unless a more recent one was published meanwhile. */
+  std::shared_ptr<const Prediction> Predict(const std::vector<float>& features,
+                                            Clock::time_point time);
+
+  /** @brief Queues the features for the background thread to run the
+   * predictor on them. */
+  void Submit(const std::vector<float>& features, Clock::time_point time);
+
+ private:
+  void Looper();
+
+  IPredictor* predictor_;
+  /** @brief Serializes the calls to predictor_, which isn't thread-safe. */
+  std::mutex predict_mutex_;
+  /** @brief Only accessed through std::atomic_load and std::atomic_store. */
+  std::shared_ptr<const Prediction> latest_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool running_ = true;
+  bool pending_ = false;
+  std::vector<float> pending_features_;
+  Clock::time_point pending_time_;
+  std::thread thread_;
+};
+
+}  // namespace memory_advice
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "budget_tracker.h"
+
+namespace memory_advice {
+
+constexpr int BudgetTracker::MAX_CATEGORIES;
+
+thread_local BudgetTracker::ThreadCache BudgetTracker::thread_counters_;
+std::atomic<uint64_t> BudgetTracker::next_generation_{1};
+
+BudgetTracker::BudgetTracker() : generation_(next_generation_++) {}
+
+MemoryAdvice_ErrorCode BudgetTracker::Register(const std::string& name,
+                                               float weight, int32_t* id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < categories_.size(); ++i) {
+        if (categories_[i].name == name) {
+            *id = static_cast<int32_t>(i);
+            return MEMORYADVICE_ERROR_OK;
+        }
+    }
+    if (!(weight > 0) || categories_.size() == MAX_CATEGORIES) {
+        return MEMORYADVICE_ERROR_BUDGET_INVALID;
+    }
+    categories_.push_back({name, weight});
+    *id = static_cast<int32_t>(categories_.size() - 1);
+    size_.store(*id + 1, std::memory_order_release);
+    return MEMORYADVICE_ERROR_OK;
+}
+
+void BudgetTracker::Usage(std::vector<Category>* categories,
+                          std::vector<int64_t>* used) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    *categories = categories_;
+    used->assign(categories_.size(), 0);
+    for (const auto& thread : threads_) {
+        for (size_t i = 0; i < categories_.size(); ++i) {
+            (*used)[i] += thread->bytes[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+BudgetTracker::ThreadCounters* BudgetTracker::AddThread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The thread can already have counters, if it reported to another
+    // tracker meanwhile.
+    auto id = std::this_thread::get_id();
+    ThreadCounters* counters = nullptr;
+    for (const auto& thread : threads_) {
+        if (thread->owner == id) counters = thread.get();
+    }
+    if (counters == nullptr) {
+        threads_.push_back(std::make_unique<ThreadCounters>());
+        counters = threads_.back().get();
+        counters->owner = id;
+    }
+    thread_counters_.generation = generation_;
+    thread_counters_.counters = counters;
+    return counters;
+}
+
+}  // namespace memory_advice
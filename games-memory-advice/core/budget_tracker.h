@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "memory_advice/memory_advice.h"
+
+namespace memory_advice {
+
+/**
+ * @brief Tracks the memory used by the app in named budget categories.
+ *
+ * Each thread reporting allocations gets its own block of counters, which
+ * only that thread writes to, so that reports are lock-free and threads don't
+ * contend on the counters. Reading the usage of a category sums its
+ * counters over all the blocks. Blocks are kept until the tracker is
+ * destroyed, so that the allocations of exited threads are still counted.
+ */
+class BudgetTracker {
+ public:
+  static constexpr int MAX_CATEGORIES = 32;
+
+  struct Category {
+    std::string name;
+    float weight;
+  };
+
+  BudgetTracker();
+
+  /**
+   * @brief Registers a category, or finds the one registered with the same
+   * name.
+   *
+   * @param weight the share of the memory budget given to the category,
+   * relative to the weights of the other categories.
+   * @param id set to the identifier of the category.
+   * @return MEMORYADVICE_ERROR_BUDGET_INVALID if the weight is not positive or
+   * there are already MAX_CATEGORIES categories.
+   */
+  MemoryAdvice_ErrorCode Register(const std::string& name, float weight,
+                                  int32_t* id);
+
+  /** @brief Adds bytes (negative for frees) to the usage of a category. */
+  MemoryAdvice_ErrorCode Report(int32_t id, int64_t bytes) {
+    if (id < 0 || id >= size_.load(std::memory_order_acquire)) {
+      return MEMORYADVICE_ERROR_BUDGET_INVALID;
+    }
+    std::atomic<int64_t>& counter = Counters()->bytes[id];
+    // Only this thread writes to its counters.
+    counter.store(counter.load(std::memory_order_relaxed) + bytes,
+                  std::memory_order_relaxed);
+    return MEMORYADVICE_ERROR_OK;
+  }
+
+  /** @brief Returns the bytes used by each category, and their properties.
+   */
+  void Usage(std::vector<Category>* categories,
+             std::vector<int64_t>* used) const;
+
+ private:
+  struct ThreadCounters {
+    std::thread::id owner;
+    std::array<std::atomic<int64_t>, MAX_CATEGORIES> bytes{};
+  };
+
+  /** @brief Returns the counters of the calling thread. */
+  ThreadCounters* Counters() {
+    if (thread_counters_.generation != generation_) {
+      return AddThread();
+    }
+    return thread_counters_.counters;
+  }
+  ThreadCounters* AddThread();
+
+  /** @brief The counters of the thread for the tracker of a generation, so
+   * that a new tracker at the address of a destroyed one isn't confused with
+   * it. */
+  struct ThreadCache {
+    uint64_t generation = 0;
+    ThreadCounters* counters = nullptr;
+  };
+  static thread_local ThreadCache thread_counters_;
+  static std::atomic<uint64_t> next_generation_;
+
+  const uint64_t generation_;
+  std::atomic<int32_t> size_{0};
+  mutable std::mutex mutex_;
+  std::vector<Category> categories_;
+  std::vector<std::unique_ptr<ThreadCounters>> threads_;
+};
+
+}  // namespace memory_advice
@@ -0,0 +1,289 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "formula.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cctype>
+
+namespace memory_advice {
+
+namespace {
+
+// Recursive descent parser emitting the program in postfix order:
+//   formula    := expression [ comparison-operator expression ]
+//   expression := term { ( '+' | '-' ) term }
+//   term       := unary { ( '*' | '/' ) unary }
+//   unary      := '-' unary | primary
+//   primary    := number | metric-name | '(' expression ')'
+class Parser {
+   public:
+    Parser(const std::string& text, std::vector<std::string>* metric_names,
+           std::vector<Formula::Instruction>* program)
+        : text_(text), metric_names_(metric_names), program_(program) {}
+
+    bool ParseFormula(bool* is_comparison) {
+        if (!ParseExpression()) return false;
+        Formula::Op op;
+        *is_comparison = ParseComparisonOperator(&op);
+        if (*is_comparison) {
+            if (!ParseExpression()) return false;
+            Emit(op);
+        }
+        SkipSpaces();
+        if (pos_ != text_.size()) return Fail("unexpected character");
+        return true;
+    }
+
+    const std::string& Error() const { return error_; }
+
+   private:
+    bool ParseExpression() {
+        if (!ParseTerm()) return false;
+        while (true) {
+            SkipSpaces();
+            if (Accept('+')) {
+                if (!ParseTerm()) return false;
+                Emit(Formula::Op::ADD);
+            } else if (Accept('-')) {
+                if (!ParseTerm()) return false;
+                Emit(Formula::Op::SUBTRACT);
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool ParseTerm() {
+        if (!ParseUnary()) return false;
+        while (true) {
+            SkipSpaces();
+            if (Accept('*')) {
+                if (!ParseUnary()) return false;
+                Emit(Formula::Op::MULTIPLY);
+            } else if (Accept('/')) {
+                if (!ParseUnary()) return false;
+                Emit(Formula::Op::DIVIDE);
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool ParseUnary() {
+        SkipSpaces();
+        if (Accept('-')) {
+            if (!ParseUnary()) return false;
+            Emit(Formula::Op::NEGATE);
+            return true;
+        }
+        return ParsePrimary();
+    }
+
+    bool ParsePrimary() {
+        SkipSpaces();
+        if (pos_ == text_.size()) return Fail("expected a value");
+        char c = text_[pos_];
+        if (c == '(') {
+            ++pos_;
+            if (!ParseExpression()) return false;
+            SkipSpaces();
+            if (!Accept(')')) return Fail("expected ')'");
+            return true;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            const char* start = text_.c_str() + pos_;
+            char* end = nullptr;
+            double value = strtod(start, &end);
+            if (end == start) return Fail("invalid number");
+            pos_ += end - start;
+            EmitConstant(value);
+            return true;
+        }
+        if (IsNameCharacter(c)) {
+            size_t start = pos_;
+            while (pos_ < text_.size() && IsNameCharacter(text_[pos_])) {
+                ++pos_;
+            }
+            EmitMetric(text_.substr(start, pos_ - start));
+            return true;
+        }
+        return Fail("expected a value");
+    }
+
+    bool ParseComparisonOperator(Formula::Op* op) {
+        SkipSpaces();
+        if (Accept('<')) {
+            *op = Accept('=') ? Formula::Op::LESS_EQUAL : Formula::Op::LESS;
+            return true;
+        }
+        if (Accept('>')) {
+            *op = Accept('=') ? Formula::Op::GREATER_EQUAL
+                              : Formula::Op::GREATER;
+            return true;
+        }
+        return false;
+    }
+
+    static bool IsNameCharacter(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+    }
+
+    void SkipSpaces() {
+        while (pos_ < text_.size() &&
+               std::isspace(static_cast<unsigned char>(text_[pos_]))) {
+            ++pos_;
+        }
+    }
+
+    bool Accept(char c) {
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool Fail(const char* message) {
+        if (error_.empty()) {
+            error_ = std::string(message) + " at position " +
+                     std::to_string(pos_) + " in '" + text_ + "'";
+        }
+        return false;
+    }
+
+    void Emit(Formula::Op op) { program_->push_back({op, 0, 0.0}); }
+
+    void EmitConstant(double value) {
+        program_->push_back({Formula::Op::CONSTANT, 0, value});
+    }
+
+    void EmitMetric(const std::string& name) {
+        auto it =
+            std::find(metric_names_->begin(), metric_names_->end(), name);
+        if (it == metric_names_->end()) {
+            it = metric_names_->insert(metric_names_->end(), name);
+        }
+        program_->push_back(
+            {Formula::Op::METRIC,
+             static_cast<uint32_t>(it - metric_names_->begin()), 0.0});
+    }
+
+    const std::string& text_;
+    std::vector<std::string>* metric_names_;
+    std::vector<Formula::Instruction>* program_;
+    size_t pos_ = 0;
+    std::string error_;
+};
+
+// Returns the maximum depth of the stack when running the program.
+int StackDepth(const std::vector<Formula::Instruction>& program) {
+    int depth = 0;
+    int max_depth = 0;
+    for (const auto& instruction : program) {
+        switch (instruction.op) {
+            case Formula::Op::CONSTANT:
+            case Formula::Op::METRIC:
+                max_depth = std::max(max_depth, ++depth);
+                break;
+            case Formula::Op::NEGATE:
+                break;
+            default:
+                --depth;
+                break;
+        }
+    }
+    return max_depth;
+}
+
+}  // namespace
+
+bool Formula::Compile(const std::string& text,
+                      std::vector<std::string>* metric_names,
+                      std::string* error) {
+    program_.clear();
+    is_comparison_ = false;
+    std::vector<std::string> names = *metric_names;
+    Parser parser(text, &names, &program_);
+    if (!parser.ParseFormula(&is_comparison_)) {
+        *error = parser.Error();
+        program_.clear();
+        return false;
+    }
+    if (StackDepth(program_) > MAX_STACK_DEPTH) {
+        *error = "formula is nested too deeply: '" + text + "'";
+        program_.clear();
+        return false;
+    }
+    *metric_names = std::move(names);
+    return true;
+}
+
+double Formula::Evaluate(const double* metric_values) const {
+    if (program_.empty()) return 0.0;
+    double stack[MAX_STACK_DEPTH];
+    int top = -1;
+    for (const Instruction& instruction : program_) {
+        switch (instruction.op) {
+            case Op::CONSTANT:
+                stack[++top] = instruction.value;
+                break;
+            case Op::METRIC:
+                stack[++top] = metric_values[instruction.index];
+                break;
+            case Op::NEGATE:
+                stack[top] = -stack[top];
+                break;
+            case Op::ADD:
+                --top;
+                stack[top] += stack[top + 1];
+                break;
+            case Op::SUBTRACT:
+                --top;
+                stack[top] -= stack[top + 1];
+                break;
+            case Op::MULTIPLY:
+                --top;
+                stack[top] *= stack[top + 1];
+                break;
+            case Op::DIVIDE:
+                --top;
+                stack[top] /= stack[top + 1];
+                break;
+            case Op::LESS:
+                --top;
+                stack[top] = stack[top] < stack[top + 1] ? 1.0 : 0.0;
+                break;
+            case Op::LESS_EQUAL:
+                --top;
+                stack[top] = stack[top] <= stack[top + 1] ? 1.0 : 0.0;
+                break;
+            case Op::GREATER:
+                --top;
+                stack[top] = stack[top] > stack[top + 1] ? 1.0 : 0.0;
+                break;
+            case Op::GREATER_EQUAL:
+                --top;
+                stack[top] = stack[top] >= stack[top + 1] ? 1.0 : 0.0;
+                break;
+        }
+    }
+    return stack[0];
+}
+
+}  // namespace memory_advice
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace memory_advice {
+
+/**
+ * @brief A heuristic formula, compiled into a program for a small stack
+ * machine.
+ *
+ * A formula is an arithmetic expression, optionally compared to another one
+ * with <, >, <= or >=. Expressions can contain numbers, metric names, the four
+ * basic arithmetic operators with the usual precedence, unary minus and
+ * parentheses. Metric names are resolved to indices when compiling, so that
+ * evaluating a formula only reads a flat array of metric values.
+ */
+class Formula {
+ public:
+  /** @brief Maximum depth of the evaluation stack of a formula. */
+  static constexpr int MAX_STACK_DEPTH = 32;
+
+  enum class Op : uint8_t {
+    CONSTANT,
+    METRIC,
+    NEGATE,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL
+  };
+
+  struct Instruction {
+    Op op;
+    /** @brief Index of the metric value, for METRIC. */
+    uint32_t index;
+    /** @brief Value of the constant, for CONSTANT. */
+    double value;
+  };
+
+  /**
+   * @brief Compiles a formula, replacing any previously compiled program.
+   *
+   * @param text the formula to compile.
+   * @param metric_names the metrics referenced by previously compiled
+   * formulas. The metrics first referenced by this formula are appended; the
+   * position of a name is the index of its value when evaluating.
+   * @param error set to a description of the problem when compilation fails.
+   * @return true if the formula compiled.
+   */
+  bool Compile(const std::string& text, std::vector<std::string>* metric_names,
+               std::string* error);
+
+  /**
+   * @brief Evaluates the formula.
+   *
+   * @param metric_values the values of the metrics, indexed as the names
+   * returned by Compile.
+   * @return the value of the expression, or 1.0 / 0.0 if the formula is a
+   * comparison.
+   */
+  double Evaluate(const double* metric_values) const;
+
+  /** @brief Whether the formula compares two expressions. */
+  bool IsComparison() const { return is_comparison_; }
+
+  const std::vector<Instruction>& Program() const { return program_; }
+
+ private:
+  std::vector<Instruction> program_;
+  bool is_comparison_ = false;
+};
+
+}  // namespace memory_advice
@@ -88,6 +88,28 @@ int64_t GetTotalMemory() {
     return s_impl->GetTotalMemory();
 }
 
+MemoryAdvice_ErrorCode GetForecast(MemoryAdvice_Forecast* forecast) {
+    if (s_impl == nullptr) return MEMORYADVICE_ERROR_NOT_INITIALIZED;
+    return s_impl->GetForecast(forecast);
+}
+
+MemoryAdvice_ErrorCode RegisterBudget(const char* name, float weight,
+                                      int32_t* category) {
+    if (s_impl == nullptr) return MEMORYADVICE_ERROR_NOT_INITIALIZED;
+    return s_impl->RegisterBudget(name, weight, category);
+}
+
+MemoryAdvice_ErrorCode ReportAllocation(int32_t category, int64_t bytes) {
+    if (s_impl == nullptr) return MEMORYADVICE_ERROR_NOT_INITIALIZED;
+    return s_impl->ReportAllocation(category, bytes);
+}
+
+MemoryAdvice_ErrorCode GetBudget(int32_t category,
+                                 MemoryAdvice_Budget* budget) {
+    if (s_impl == nullptr) return MEMORYADVICE_ERROR_NOT_INITIALIZED;
+    return s_impl->GetBudget(category, budget);
+}
+
 MemoryAdvice_ErrorCode RegisterWatcher(uint64_t intervalMillis,
                                        MemoryAdvice_WatcherCallback callback,
                                        void* user_data) {
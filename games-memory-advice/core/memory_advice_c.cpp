@@ -68,6 +68,32 @@ int64_t MemoryAdvice_getTotalMemory() {
     return memory_advice::GetTotalMemory();
 }
 
+MemoryAdvice_ErrorCode MemoryAdvice_getForecast(
+    MemoryAdvice_Forecast *forecast) {
+    return memory_advice::GetForecast(forecast);
+}
+
+MemoryAdvice_ErrorCode MemoryAdvice_registerBudget(const char *name,
+                                                   float weight,
+                                                   int32_t *category) {
+    return memory_advice::RegisterBudget(name, weight, category);
+}
+
+MemoryAdvice_ErrorCode MemoryAdvice_reportAllocation(int32_t category,
+                                                     int64_t bytes) {
+    return memory_advice::ReportAllocation(category, bytes);
+}
+
+MemoryAdvice_ErrorCode MemoryAdvice_reportFree(int32_t category,
+                                               int64_t bytes) {
+    return memory_advice::ReportAllocation(category, -bytes);
+}
+
+MemoryAdvice_ErrorCode MemoryAdvice_getBudget(int32_t category,
+                                              MemoryAdvice_Budget *budget) {
+    return memory_advice::GetBudget(category, budget);
+}
+
 void MemoryAdvice_JsonSerialization_free(MemoryAdvice_JsonSerialization *ser) {
     if (ser->dealloc) {
         ser->dealloc(ser);
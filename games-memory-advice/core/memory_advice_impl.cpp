@@ -18,7 +18,10 @@
 #include "memory_advice_impl.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <chrono>
+#include <cstdint>
 
 #include "memory_advice_utils.h"
 #include "system_utils.h"
@@ -32,8 +35,27 @@ namespace {
     template <typename T> T Clamp(T val, T min, T max) {
         return (val < min ? min : (val > max ? max : val));
     }
+
+    // Returns the value at a '/' separated path in data, or null.
+    Json FindPath(const Json::object& data, const std::string& path) {
+        const Json::object* search = &data;
+        size_t start = 0;
+        size_t end;
+        while ((end = path.find('/', start)) != std::string::npos) {
+            auto it = search->find(path.substr(start, end - start));
+            if (it == search->end()) return Json();
+            search = &it->second.object_items();
+            start = end + 1;
+        }
+        auto it = search->find(path.substr(start));
+        return it != search->end() ? it->second : Json();
+    }
 }
 
+constexpr int MemoryAdviceImpl::PREDICTED_AVAILABLE;
+constexpr std::chrono::milliseconds MemoryAdviceImpl::FORECAST_INTERVAL;
+constexpr double MemoryAdviceImpl::FORECAST_TOLERANCE;
+
 MemoryAdviceImpl::MemoryAdviceImpl(const char* params,
                                    IMetricsProvider* metrics_provider,
                                    IPredictor* realtime_predictor,
@@ -44,10 +66,12 @@ MemoryAdviceImpl::MemoryAdviceImpl(const char* params,
         default_metrics_provider_ = std::make_unique<DefaultMetricsProvider>();
         metrics_provider_ = default_metrics_provider_.get();
     }
+    metrics_collector_ = std::make_unique<MetricsCollector>(metrics_provider_);
     if (available_predictor_ == nullptr) {
         default_available_predictor_ = std::make_unique<DefaultPredictor>();
         available_predictor_ = default_available_predictor_.get();
     }
+    async_predictor_ = std::make_unique<AsyncPredictor>(available_predictor_);
 
     initialization_error_code_ = available_predictor_->Init(
         "available.tflite", "available_features.json");
@@ -61,6 +85,7 @@ MemoryAdviceImpl::MemoryAdviceImpl(const char* params,
     baseline_ = GenerateBaselineMetrics();
     baseline_["constant"] = GenerateConstantMetrics();
     build_ = utils::GetBuildInfo();
+    ResolveMetrics();
 }
 
 MemoryAdvice_ErrorCode MemoryAdviceImpl::ProcessAdvisorParameters(
@@ -71,21 +96,231 @@ MemoryAdvice_ErrorCode MemoryAdviceImpl::ProcessAdvisorParameters(
         ALOGE("Error while parsing advisor parameters: %s", err.c_str());
         return MEMORYADVICE_ERROR_ADVISOR_PARAMETERS_INVALID;
     }
+    prediction_max_age_ = std::chrono::milliseconds(static_cast<int64_t>(
+        advisor_parameters_["predictor"]["maxAge"].number_value()));
+    return CompileHeuristics();
+}
+
+MemoryAdvice_ErrorCode MemoryAdviceImpl::CompileHeuristics() {
+    heuristics_.clear();
+    heuristic_metrics_.clear();
+    auto heuristics = advisor_parameters_.find("heuristics");
+    if (heuristics == advisor_parameters_.end()) {
+        return MEMORYADVICE_ERROR_OK;
+    }
+    for (auto& entry : heuristics->second["formulas"].object_items()) {
+        for (auto& formula_object : entry.second.array_items()) {
+            Heuristic heuristic;
+            heuristic.level = entry.first;
+            heuristic.critical = entry.first == "red";
+            heuristic.text = formula_object.string_value();
+            heuristic.text.erase(
+                std::remove_if(heuristic.text.begin(), heuristic.text.end(),
+                               (int (*)(int))std::isspace),
+                heuristic.text.end());
+            std::string err;
+            if (!heuristic.formula.Compile(heuristic.text,
+                                           &heuristic_metrics_, &err)) {
+                ALOGE("Error while compiling heuristic: %s", err.c_str());
+                return MEMORYADVICE_ERROR_ADVISOR_PARAMETERS_INVALID;
+            }
+            if (!heuristic.formula.IsComparison()) {
+                ALOGE("Heuristic is not a comparison: %s",
+                      heuristic.text.c_str());
+                return MEMORYADVICE_ERROR_ADVISOR_PARAMETERS_INVALID;
+            }
+            heuristics_.push_back(std::move(heuristic));
+        }
+    }
+    heuristic_metric_values_.resize(heuristic_metrics_.size());
     return MEMORYADVICE_ERROR_OK;
 }
 
-MemoryAdvice_MemoryState MemoryAdviceImpl::GetMemoryState() {
-    Json::object advice = GetAdvice();
-    if (advice.find("warnings") != advice.end()) {
-        Json::array warnings = advice["warnings"].array_items();
-        for (auto& it : warnings) {
-            if (it.object_items().at("level").string_value() == "red") {
-                return MEMORYADVICE_STATE_CRITICAL;
+void MemoryAdviceImpl::ResolveMetrics() {
+    Json::object variable_spec = advisor_parameters_.at("metrics")
+                                     .object_items()
+                                     .at("variable")
+                                     .object_items();
+    predict_available_ =
+        variable_spec.find("availableRealtime") != variable_spec.end() &&
+        variable_spec.at("availableRealtime").bool_value();
+    features_.clear();
+    if (predict_available_) {
+        Json::object constants = {{"baseline", baseline_}, {"build", build_}};
+        double total_memory =
+            FindPath(constants, "baseline/constant/MemoryInfo/totalMem")
+                .number_value();
+        for (const std::string& path : available_predictor_->Features()) {
+            features_.push_back(ResolveFeature(path, total_memory, constants));
+        }
+    }
+    feature_values_.resize(features_.size());
+
+    heuristic_metric_indices_.clear();
+    for (const std::string& name : heuristic_metrics_) {
+        size_t dot = name.find('.');
+        if (name == "predictedAvailable") {
+            heuristic_metric_indices_.push_back(PREDICTED_AVAILABLE);
+        } else if (dot != std::string::npos &&
+                   metrics_provider_->metrics_categories_.count(
+                       name.substr(0, dot)) != 0) {
+            heuristic_metric_indices_.push_back(
+                schema_.Add(name.substr(0, dot), name.substr(dot + 1)));
+        } else {
+            ALOGW("Unknown metric in heuristics: %s", name.c_str());
+            heuristic_metric_indices_.push_back(MetricsSchema::NOT_FOUND);
+        }
+    }
+    if (!predict_available_) {
+        avail_mem_index_ = schema_.Add("MemoryInfo", "availMem");
+    }
+    schema_.Allocate(&snapshot_);
+}
+
+MemoryAdviceImpl::Feature MemoryAdviceImpl::ResolveFeature(
+    std::string path, double total_memory, const Json::object& constants) {
+    Feature feature = {MetricsSchema::NOT_FOUND, 0.0, 1.0};
+    const std::string norm = "Norm";
+    if (path.length() > norm.length() &&
+        path.compare(path.length() - norm.length(), norm.length(), norm) ==
+            0) {
+        path.resize(path.length() - norm.length());
+        feature.scale = total_memory != 0 ? 1.0 / total_memory : 0.0;
+    }
+    const std::string sample = "sample/";
+    if (path.compare(0, sample.length(), sample) == 0) {
+        size_t slash = path.find('/', sample.length());
+        std::string category =
+            path.substr(sample.length(), slash - sample.length());
+        if (slash != std::string::npos &&
+            metrics_provider_->metrics_categories_.count(category) != 0) {
+            feature.index = schema_.Add(category, path.substr(slash + 1));
+            return feature;
+        }
+    } else {
+        Json value = FindPath(constants, path);
+        if (value.is_number()) {
+            feature.value = value.number_value();
+            return feature;
+        } else if (value.is_bool()) {
+            feature.value = value.bool_value() ? 1.0 : 0.0;
+            return feature;
+        }
+    }
+    ALOGW("Model feature not available: %s", path.c_str());
+    return feature;
+}
+
+void MemoryAdviceImpl::Sample(const Json::object* collected) {
+    schema_.Collect(metrics_collector_.get(), collected, &snapshot_);
+    if (!predict_available_) return;
+    for (size_t i = 0; i < features_.size(); ++i) {
+        const Feature& feature = features_[i];
+        double value = feature.index != MetricsSchema::NOT_FOUND
+                           ? snapshot_.values[feature.index]
+                           : feature.value;
+        feature_values_[i] = static_cast<float>(value * feature.scale);
+    }
+    auto now = AsyncPredictor::Clock::now();
+    auto prediction = async_predictor_->Latest();
+    if (prediction != nullptr &&
+        now - prediction->time <= prediction_max_age_) {
+        async_predictor_->Submit(feature_values_, now);
+    } else {
+        prediction = async_predictor_->Predict(feature_values_, now);
+    }
+    predicted_available_ = Clamp(prediction->value, 0.0f, 1.0f);
+    if (prediction->time - last_forecast_time_ >= FORECAST_INTERVAL) {
+        last_forecast_time_ = prediction->time;
+        forecast_.Add(std::chrono::duration<double>(
+                          prediction->time.time_since_epoch())
+                          .count(),
+                      predicted_available_);
+    }
+}
+
+void MemoryAdviceImpl::LoadHeuristicMetrics() {
+    for (size_t i = 0; i < heuristic_metric_indices_.size(); ++i) {
+        int index = heuristic_metric_indices_[i];
+        if (index >= 0) {
+            heuristic_metric_values_[i] = snapshot_.values[index];
+        } else if (index == PREDICTED_AVAILABLE && predict_available_) {
+            heuristic_metric_values_[i] = predicted_available_;
+        } else {
+            heuristic_metric_values_[i] = 0.0;
+        }
+    }
+}
+
+double MemoryAdviceImpl::CriticalAvailable() {
+    LoadHeuristicMetrics();
+    auto critical = [this](double available) {
+        for (size_t i = 0; i < heuristic_metric_indices_.size(); ++i) {
+            if (heuristic_metric_indices_[i] == PREDICTED_AVAILABLE) {
+                heuristic_metric_values_[i] = available;
+            }
+        }
+        for (const Heuristic& heuristic : heuristics_) {
+            if (heuristic.critical &&
+                heuristic.formula.Evaluate(heuristic_metric_values_.data()) !=
+                    0.0) {
+                return true;
             }
         }
-        return MEMORYADVICE_STATE_APPROACHING_LIMIT;
+        return false;
+    };
+    if (!critical(0.0)) return -1.0;
+    // Bisect the boundary, assuming that less available memory is worse.
+    double low = 0.0;
+    double high = 1.0;
+    if (critical(high)) return high;
+    for (int i = 0; i < 24; ++i) {
+        double middle = (low + high) / 2;
+        if (critical(middle)) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+double MemoryAdviceImpl::AvailableBytes() {
+    if (predict_available_) return predicted_available_ * GetTotalMemory();
+    return avail_mem_index_ != MetricsSchema::NOT_FOUND
+               ? snapshot_.values[avail_mem_index_]
+               : 0.0;
+}
+
+MemoryAdvice_MemoryState MemoryAdviceImpl::EvaluateHeuristics(
+    Json::array* warnings) {
+    LoadHeuristicMetrics();
+    MemoryAdvice_MemoryState state = MEMORYADVICE_STATE_OK;
+    for (const Heuristic& heuristic : heuristics_) {
+        if (heuristic.formula.Evaluate(heuristic_metric_values_.data()) ==
+            0.0) {
+            continue;
+        }
+        if (heuristic.critical) {
+            state = MEMORYADVICE_STATE_CRITICAL;
+        } else if (state == MEMORYADVICE_STATE_OK) {
+            state = MEMORYADVICE_STATE_APPROACHING_LIMIT;
+        }
+        if (warnings != nullptr) {
+            Json::object warning;
+            warning["formula"] = heuristic.text;
+            warning["level"] = heuristic.level;
+            warnings->push_back(warning);
+        }
     }
-    return MEMORYADVICE_STATE_OK;
+    return state;
+}
+
+MemoryAdvice_MemoryState MemoryAdviceImpl::GetMemoryState() {
+    std::lock_guard<std::mutex> lock(advice_mutex_);
+    gamesdk::jni::Ctx::Instance()->Env();
+    Sample(nullptr);
+    return EvaluateHeuristics(nullptr);
 }
 
 int64_t MemoryAdviceImpl::GetAvailableMemory() {
@@ -93,15 +328,89 @@ int64_t MemoryAdviceImpl::GetAvailableMemory() {
 }
 
 float MemoryAdviceImpl::GetPercentageAvailableMemory() {
-    Json::object advice = GetAdvice();
-    if (advice.find("metrics") != advice.end()) {
-        Json::object metrics = advice["metrics"].object_items();
-        if (metrics.find("predictedAvailable") != metrics.end()) {
-            return static_cast<float>(
-                metrics["predictedAvailable"].number_value()) * 100.0f;
+    std::lock_guard<std::mutex> lock(advice_mutex_);
+    gamesdk::jni::Ctx::Instance()->Env();
+    Sample(nullptr);
+    return predict_available_ ? predicted_available_ * 100.0f : 0.0f;
+}
+
+MemoryAdvice_ErrorCode MemoryAdviceImpl::GetForecast(
+    MemoryAdvice_Forecast* forecast) {
+    std::lock_guard<std::mutex> lock(advice_mutex_);
+    gamesdk::jni::Ctx::Instance()->Env();
+    Sample(nullptr);
+    if (!predict_available_ || !forecast_.Valid()) {
+        return MEMORYADVICE_ERROR_FORECAST_UNAVAILABLE;
+    }
+    // The trend is in fractions of the total memory per second.
+    double slope = forecast_.Slope();
+    forecast->allocationRate = -slope * GetTotalMemory();
+    double critical_available = CriticalAvailable();
+    if (EvaluateHeuristics(nullptr) == MEMORYADVICE_STATE_CRITICAL) {
+        forecast->timeToCritical = 0.0;
+    } else if (critical_available < 0.0 || slope >= 0.0) {
+        forecast->timeToCritical = -1.0;
+    } else {
+        forecast->timeToCritical =
+            std::max(predicted_available_ - critical_available, 0.0) / -slope;
+    }
+    return MEMORYADVICE_ERROR_OK;
+}
+
+MemoryAdvice_ErrorCode MemoryAdviceImpl::RegisterBudget(const char* name,
+                                                       float weight,
+                                                       int32_t* category) {
+    if (name == nullptr || category == nullptr) {
+        return MEMORYADVICE_ERROR_BUDGET_INVALID;
+    }
+    return budget_tracker_.Register(name, weight, category);
+}
+
+MemoryAdvice_ErrorCode MemoryAdviceImpl::GetBudget(
+    int32_t category, MemoryAdvice_Budget* budget) {
+    std::vector<BudgetTracker::Category> categories;
+    std::vector<int64_t> used;
+    budget_tracker_.Usage(&categories, &used);
+    if (category < 0 || category >= static_cast<int32_t>(categories.size())) {
+        return MEMORYADVICE_ERROR_BUDGET_INVALID;
+    }
+    double total_used = 0.0;
+    double total_weight = 0.0;
+    for (size_t i = 0; i < categories.size(); ++i) {
+        total_used += std::max<int64_t>(used[i], 0);
+        total_weight += categories[i].weight;
+    }
+    double category_used = std::max<int64_t>(used[category], 0);
+
+    std::lock_guard<std::mutex> lock(advice_mutex_);
+    gamesdk::jni::Ctx::Instance()->Env();
+    Sample(nullptr);
+    double available = AvailableBytes();
+    MemoryAdvice_MemoryState state = EvaluateHeuristics(nullptr);
+
+    // The memory of the app is what the categories use and what is still
+    // available, shared according to the weights of the categories.
+    double share = categories[category].weight / total_weight *
+                   (total_used + available);
+    double headroom = share - category_used;
+    double evict = 0.0;
+    if (state != MEMORYADVICE_STATE_OK) {
+        evict = std::max(-headroom, 0.0);
+    }
+    if (state == MEMORYADVICE_STATE_CRITICAL && predict_available_ &&
+        total_used > 0.0) {
+        // Free enough memory to leave the critical state, in proportion to
+        // the usage of each category.
+        double critical_available = CriticalAvailable();
+        if (critical_available >= 0.0) {
+            double deficit = critical_available * GetTotalMemory() - available;
+            evict = std::max(evict, deficit * category_used / total_used);
         }
     }
-    return 0.0f;
+    budget->used = used[category];
+    budget->headroom = static_cast<int64_t>(headroom);
+    budget->evict = static_cast<int64_t>(std::ceil(evict));
+    return MEMORYADVICE_ERROR_OK;
 }
 
 int64_t MemoryAdviceImpl::GetTotalMemory() {
@@ -114,53 +423,21 @@ int64_t MemoryAdviceImpl::GetTotalMemory() {
 }
 
 Json::object MemoryAdviceImpl::GetAdvice() {
-    CheckCancelledWatchers();
-
     std::lock_guard<std::mutex> lock(advice_mutex_);
 
     // Make sure current thread is attached to the JVM.
     // This is important because we perform many JNI calls here to get system metrics.
     gamesdk::jni::Ctx::Instance()->Env();
 
-    double start_time = MillisecondsSinceEpoch();
-    Json::object advice;
-    Json::object data;
-    Json::object variable_spec = advisor_parameters_.at("metrics")
-                                     .object_items()
-                                     .at("variable")
-                                     .object_items();
     Json::object variable_metrics = GenerateVariableMetrics();
-
-    data["baseline"] = baseline_;
-    data["sample"] = variable_metrics;
-    data["build"] = build_;
-
-    if (variable_spec.find("availableRealtime") != variable_spec.end() &&
-        variable_spec.at("availableRealtime").bool_value()) {
-        variable_metrics["predictedAvailable"] =
-            Json(Clamp(available_predictor_->Predict(data), 0.0f, 1.0f));
+    Sample(&variable_metrics);
+    if (predict_available_) {
+        variable_metrics["predictedAvailable"] = Json(predicted_available_);
     }
     Json::array warnings;
-    Json::object heuristics =
-        advisor_parameters_.at("heuristics").object_items();
-
-    if (heuristics.find("formulas") != heuristics.end()) {
-        for (auto& entry : heuristics["formulas"].object_items()) {
-            for (auto& formula_object : entry.second.array_items()) {
-                std::string formula = formula_object.string_value();
-                formula.erase(std::remove_if(formula.begin(), formula.end(),
-                                             (int (*)(int))std::isspace),
-                              formula.end());
-                if (utils::EvaluateBoolean(formula, variable_metrics)) {
-                    Json::object warning;
-                    warning["formula"] = formula;
-                    warning["level"] = entry.first;
-                    warnings.push_back(warning);
-                }
-            }
-        }
-    }
+    EvaluateHeuristics(&warnings);
 
+    Json::object advice;
     if (!warnings.empty()) {
         advice["warnings"] = warnings;
     }
@@ -182,21 +459,24 @@ Json MemoryAdviceImpl::GetValue(Json::object object, std::string key) {
     return Json();
 }
 
-Json::object MemoryAdviceImpl::GenerateMetricsFromFields(Json::object fields) {
+Json::object MemoryAdviceImpl::GenerateMetricsFromFields(Json::object fields,
+                                                         bool cached) {
     Json::object metrics;
     for (auto& it : metrics_provider_->metrics_categories_) {
         if (fields.find(it.first) != fields.end()) {
-            metrics[it.first] = ExtractValues(it.second, fields[it.first]);
+            metrics[it.first] =
+                ExtractValues(it.first, fields[it.first], cached);
         }
     }
     metrics["meta"] = (Json::object){{"time", MillisecondsSinceEpoch()}};
     return metrics;
 }
 
-Json::object MemoryAdviceImpl::ExtractValues(
-    IMetricsProvider::MetricsFunction metrics_function, Json fields) {
+Json::object MemoryAdviceImpl::ExtractValues(const std::string& category,
+                                             Json fields, bool cached) {
     double start_time = MillisecondsSinceEpoch();
-    Json::object metrics = (metrics_provider_->*metrics_function)();
+    Json::object metrics = cached ? metrics_collector_->Get(category)
+                                  : metrics_collector_->Read(category);
     Json::object extracted_metrics;
     if (fields.bool_value()) {
         extracted_metrics = metrics;
@@ -224,70 +504,41 @@ Json::object MemoryAdviceImpl::GenerateVariableMetrics() {
     return GenerateMetricsFromFields(advisor_parameters_.at("metrics")
                                          .object_items()
                                          .at("variable")
-                                         .object_items());
+                                         .object_items(),
+                                     true);
 }
 
 Json::object MemoryAdviceImpl::GenerateBaselineMetrics() {
     return GenerateMetricsFromFields(advisor_parameters_.at("metrics")
                                          .object_items()
                                          .at("baseline")
-                                         .object_items());
+                                         .object_items(),
+                                     false);
 }
 
 Json::object MemoryAdviceImpl::GenerateConstantMetrics() {
     return GenerateMetricsFromFields(advisor_parameters_.at("metrics")
                                          .object_items()
                                          .at("constant")
-                                         .object_items());
+                                         .object_items(),
+                                     false);
 }
 
 MemoryAdvice_ErrorCode MemoryAdviceImpl::RegisterWatcher(
     uint64_t intervalMillis, MemoryAdvice_WatcherCallback callback,
     void* user_data) {
-    std::lock_guard<std::mutex> guard(active_watchers_mutex_);
-    active_watchers_.push_back(std::make_unique<StateWatcher>(
-        this, callback, user_data, intervalMillis));
+    state_watcher_.Register(
+        callback, user_data,
+        std::chrono::milliseconds(
+            std::min<uint64_t>(intervalMillis, INT64_MAX)));
     return MEMORYADVICE_ERROR_OK;
 }
 
 MemoryAdvice_ErrorCode MemoryAdviceImpl::UnregisterWatcher(
     MemoryAdvice_WatcherCallback callback) {
-    // We can't simply erase the watcher because the callback thread might still
-    // be running which would mean blocking here for it to finish. So signal to
-    // the thread to exit and put the StateWatcher object on a cancelled list
-    // that is checked periodically.
-    std::lock_guard<std::mutex> guard(active_watchers_mutex_);
-    std::vector<WatcherContainer::iterator> to_move;
-    // Search for watchers with the same callback.
-    for (auto it = active_watchers_.begin(); it != active_watchers_.end();
-         ++it) {
-        if ((*it)->Callback() == callback) {
-            to_move.push_back(it);
-        }
-    }
-
-    if (to_move.empty()) return MEMORYADVICE_ERROR_WATCHER_NOT_FOUND;
-
-    std::lock_guard<std::mutex> guard2(cancelled_watchers_mutex_);
-    for (auto it : to_move) {
-        (*it)->Cancel();
-        cancelled_watchers_.push_back(
-            std::move(*it));  // Put StateWatcher on cancelled list.
-        active_watchers_.erase(it);
-    }
-    return MEMORYADVICE_ERROR_OK;
-}
-
-void MemoryAdviceImpl::CheckCancelledWatchers() {
-    std::lock_guard<std::mutex> guard(cancelled_watchers_mutex_);
-    auto it = cancelled_watchers_.begin();
-    while (it != cancelled_watchers_.end()) {
-        if (!(*it)->ThreadRunning())
-            it = cancelled_watchers_.erase(
-                it);  // Calls destructor on StateWatcher
-        else
-            ++it;
-    }
+    return state_watcher_.Unregister(callback)
+               ? MEMORYADVICE_ERROR_OK
+               : MEMORYADVICE_ERROR_WATCHER_NOT_FOUND;
 }
 
 }  // namespace memory_advice
@@ -16,10 +16,19 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
+#include "async_predictor.h"
+#include "budget_tracker.h"
+#include "formula.h"
+#include "memory_forecast.h"
+#include "metrics_collector.h"
 #include "metrics_provider.h"
+#include "metrics_snapshot.h"
 #include "predictor.h"
 #include "state_watcher.h"
 
@@ -38,45 +47,138 @@ class MemoryAdviceImpl {
   Json::object build_;
   std::mutex advice_mutex_;
 
+  /** @brief A heuristic formula, compiled from the advisor parameters. */
+  struct Heuristic {
+    /** @brief The warning level reported when the formula is true. */
+    std::string level;
+    /** @brief Whether the level is "red", i.e. the memory state critical. */
+    bool critical;
+    /** @brief The formula as reported in warnings, without whitespace. */
+    std::string text;
+    Formula formula;
+  };
+  std::vector<Heuristic> heuristics_;
+  /** @brief Names of the variable metrics referenced by heuristics_: either
+   * predictedAvailable or "<category>.<metric>", e.g. "proc.oom_score". */
+  std::vector<std::string> heuristic_metrics_;
+  /** @brief Where each of heuristic_metrics_ is read from: an index in
+   * snapshot_, PREDICTED_AVAILABLE or MetricsSchema::NOT_FOUND. */
+  std::vector<int> heuristic_metric_indices_;
+  /** @brief Values of heuristic_metrics_ for the current sample. */
+  std::vector<double> heuristic_metric_values_;
+  static constexpr int PREDICTED_AVAILABLE = -2;
+
+  /** @brief A feature of the available memory model. */
+  struct Feature {
+    /** @brief Index of the metric in snapshot_, or MetricsSchema::NOT_FOUND
+     * if the feature is constant. */
+    int index;
+    /** @brief Value of a constant feature. */
+    double value;
+    /** @brief Factor applied to the value, for normalized features. */
+    double scale;
+  };
+  std::vector<Feature> features_;
+  std::vector<float> feature_values_;
+  bool predict_available_ = false;
+  /** @brief How old a prediction of the available memory can be reused,
+   * while a new one is computed in the background. Set by the "maxAge" of
+   * the "predictor" advisor parameters, in milliseconds. */
+  std::chrono::milliseconds prediction_max_age_{0};
+
+  /** @brief The variable metrics read on each sample, and the last sample. */
+  MetricsSchema schema_;
+  MetricsSnapshot snapshot_;
+  float predicted_available_ = 0.0f;
+
+  /** @brief Trend of predicted_available_ over the recent predictions. */
+  MemoryForecast forecast_{FORECAST_TOLERANCE};
+  AsyncPredictor::Clock::time_point last_forecast_time_;
+  /** @brief Minimum time between the predictions added to forecast_, so
+   * that its history spans several seconds however often Memory Advice is
+   * sampled. */
+  static constexpr std::chrono::milliseconds FORECAST_INTERVAL{100};
+  /** @brief Predictions are only clipped as outliers when further than this
+   * fraction of the total memory from the trend. */
+  static constexpr double FORECAST_TOLERANCE = 0.01;
+
+  BudgetTracker budget_tracker_;
+  /** @brief Index of MemoryInfo.availMem in snapshot_, read as the available
+   * memory when it isn't predicted. */
+  int avail_mem_index_ = MetricsSchema::NOT_FOUND;
+
   std::unique_ptr<IMetricsProvider> default_metrics_provider_;
   std::unique_ptr<IPredictor> default_realtime_predictor_,
       default_available_predictor_;
-
-  typedef std::vector<std::unique_ptr<StateWatcher>> WatcherContainer;
-  WatcherContainer active_watchers_;
-  std::mutex active_watchers_mutex_;
-  WatcherContainer cancelled_watchers_;
-  std::mutex cancelled_watchers_mutex_;
+  /** @brief Reads metrics_provider_, caching its expensive categories.
+   * Declared after the default providers so that it is destroyed first. */
+  std::unique_ptr<MetricsCollector> metrics_collector_;
+  /** @brief Runs available_predictor_, in the background when possible. */
+  std::unique_ptr<AsyncPredictor> async_predictor_;
 
   MemoryAdvice_ErrorCode initialization_error_code_ = MEMORYADVICE_ERROR_OK;
 
+  /** @brief Notifies all the registered watchers. Declared last so that its
+   * thread is stopped before anything it uses is destroyed. */
+  StateWatcher state_watcher_{this};
+
   MemoryAdvice_ErrorCode ProcessAdvisorParameters(const char* parameters);
+  /** @brief Compiles the heuristic formulas of advisor_parameters_ into
+   * heuristics_. */
+  MemoryAdvice_ErrorCode CompileHeuristics();
+  /** @brief Resolves the metrics read by the heuristics and the model to
+   * indices in schema_. Requires the baseline metrics. */
+  void ResolveMetrics();
+  Feature ResolveFeature(std::string path, double total_memory,
+                         const Json::object& constants);
+  /**
+   * @brief Collects the variable metrics in snapshot_ and updates the
+   * prediction of the available memory. A prediction younger than
+   * prediction_max_age_ is reused, and the model runs on the new sample in
+   * the background. Requires advice_mutex_.
+   *
+   * @param collected variable metrics already generated, if any.
+   */
+  void Sample(const Json::object* collected);
+  /** @brief Reads the metrics of the heuristics from the last sample into
+   * heuristic_metric_values_. */
+  void LoadHeuristicMetrics();
+  /** @brief Returns the highest predicted available memory, as a fraction of
+   * the total memory, at which a critical heuristic is triggered given the
+   * other metrics of the last sample, or -1 if there is none. */
+  double CriticalAvailable();
+  /** @brief Returns the memory available to the app in the last sample, in
+   * bytes: predicted if possible, and otherwise as reported by
+   * ActivityManager. */
+  double AvailableBytes();
+  /** @brief Evaluates the heuristics on the last sample and returns the
+   * memory state. Adds the triggered heuristics to warnings, if not null. */
+  MemoryAdvice_MemoryState EvaluateHeuristics(Json::array* warnings);
   /** @brief Given a list of fields, extracts metrics by calling the matching
-   * metrics functions and gathers them in a single Json object. */
-  Json::object GenerateMetricsFromFields(Json::object fields);
+   * metrics functions and gathers them in a single Json object. Expensive
+   * categories are served from metrics_collector_'s cache if cached is set.
+   */
+  Json::object GenerateMetricsFromFields(Json::object fields, bool cached);
   /**
-   * Calls the provided metrics function, and extracts a subset of the metrics
+   * Reads the provided metrics category, and extracts a subset of the metrics
    * using the fields parameter. fields can either be a single boolean
-   * evaluating to true, which implies all the metrics provided by the metrics
-   * function should be extracted, or fields can be a Json object whose keys
-   * are metrics that need to be extracted from the metrics provided by the
-   * metrics function.
+   * evaluating to true, which implies all the metrics of the category should
+   * be extracted, or fields can be a Json object whose keys are metrics that
+   * need to be extracted from the metrics of the category.
    *
-   * @param metrics_function The metrics function to call, which provides a
-   * json object of metrics.
+   * @param category The metrics category to read.
    * @param fields the list of fields to extract
-   * @return A subset of the Json object returned by the metrics function. The
+   * @param cached whether the values of an expensive category can be served
+   * from metrics_collector_'s cache.
+   * @return A subset of the Json object of the metrics category. The
    * returned object also includes how long it took to gather the metrics.
    */
-  Json::object ExtractValues(IMetricsProvider::MetricsFunction metrics_function,
-                             Json fields);
+  Json::object ExtractValues(const std::string& category, Json fields,
+                             bool cached);
   double MillisecondsSinceEpoch();
   /** @brief Find a value in a JSON object, even when it is nested in
    * sub-dictionaries in the object. */
   Json GetValue(Json::object object, std::string key);
-  /** @brief Delete any watchers that have finished their thread of execution
-   */
-  void CheckCancelledWatchers();
 
  public:
   MemoryAdviceImpl(const char* params, IMetricsProvider* metrics_provider,
@@ -99,6 +201,20 @@ class MemoryAdviceImpl {
    * total memory.
    */
   float GetPercentageAvailableMemory();
+  /** @brief Estimates the rate at which the available memory is consumed
+   * and the time left until the memory state becomes critical. */
+  MemoryAdvice_ErrorCode GetForecast(MemoryAdvice_Forecast* forecast);
+  /** @brief Registers a memory budget category, see BudgetTracker. */
+  MemoryAdvice_ErrorCode RegisterBudget(const char* name, float weight,
+                                        int32_t* category);
+  /** @brief Adds bytes, negative for frees, to the usage of a category. */
+  MemoryAdvice_ErrorCode ReportAllocation(int32_t category, int64_t bytes) {
+    return budget_tracker_.Report(category, bytes);
+  }
+  /** @brief Splits the memory available to the app between the budget
+   * categories, and advises how much a category should free. */
+  MemoryAdvice_ErrorCode GetBudget(int32_t category,
+                                   MemoryAdvice_Budget* budget);
   /** @brief Returns the total memory of the device, as reported by
    * ActivityManager#getMemoryInfo()
    */
@@ -48,6 +48,12 @@ MemoryAdvice_MemoryState GetMemoryState();
 int64_t GetAvailableMemory();
 float GetPercentageAvailableMemory();
 int64_t GetTotalMemory();
+MemoryAdvice_ErrorCode GetForecast(MemoryAdvice_Forecast* forecast);
+MemoryAdvice_ErrorCode RegisterBudget(const char* name, float weight,
+                                      int32_t* category);
+MemoryAdvice_ErrorCode ReportAllocation(int32_t category, int64_t bytes);
+MemoryAdvice_ErrorCode GetBudget(int32_t category,
+                                 MemoryAdvice_Budget* budget);
 MemoryAdvice_ErrorCode RegisterWatcher(uint64_t intervalMillis,
                                        MemoryAdvice_WatcherCallback callback,
                                        void* user_data);
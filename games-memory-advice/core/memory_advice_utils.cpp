@@ -40,38 +40,6 @@ namespace memory_advice {
 
 namespace utils {
 
-bool EvaluateBoolean(std::string formula, Json::object metrics) {
-    if (formula.find('>') != std::string::npos) {
-        return EvaluateNumber(formula.substr(0, formula.find('>')), metrics) >
-               EvaluateNumber(formula.substr(formula.find('>') + 1), metrics);
-    } else if (formula.find('<') != std::string::npos) {
-        return EvaluateNumber(formula.substr(0, formula.find('<')), metrics) <
-               EvaluateNumber(formula.substr(formula.find('<') + 1), metrics);
-    } else {
-        return false;
-    }
-}
-
-double EvaluateNumber(std::string formula, Json::object metrics) {
-    if (formula.find('/') != std::string::npos) {
-        return EvaluateNumber(formula.substr(0, formula.find('/')), metrics) /
-               EvaluateNumber(formula.substr(formula.find('/') + 1), metrics);
-    } else if (formula.find('*') != std::string::npos) {
-        return EvaluateNumber(formula.substr(0, formula.find('*')), metrics) *
-               EvaluateNumber(formula.substr(formula.find('*') + 1), metrics);
-    } else if (formula.find('+') != std::string::npos) {
-        return EvaluateNumber(formula.substr(0, formula.find('+')), metrics) +
-               EvaluateNumber(formula.substr(formula.find('+') + 1), metrics);
-    } else if (formula.find('-') != std::string::npos) {
-        return EvaluateNumber(formula.substr(0, formula.find('-')), metrics) -
-               EvaluateNumber(formula.substr(formula.find('-') + 1), metrics);
-    } else if (std::isdigit(formula[0])) {
-        return std::stod(formula);
-    } else {
-        return metrics[formula].number_value();
-    }
-}
-
 Json::object GetBuildInfo() {
     // The current version of default.json only uses the sdk version from the
     // build parameters; so having this function only return that value saves
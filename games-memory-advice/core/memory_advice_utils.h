@@ -28,21 +28,6 @@ namespace memory_advice {
 
 namespace utils {
 
-/*
- * A function that evaluates a given boolean expression and return the result.
- * The formula should contain a single greater than or less than operator. The
- * two sides of the operator can contain numbers, the four basic arithmetic
- * operators, and literals. The value for the literals are evaluated by checking
- * for them in the provided metrics.
- */
-bool EvaluateBoolean(std::string formula, Json::object metrics);
-/*
- * A function that evaluates a given arithmetic expression and returns the
- * result. The formula can contain numbers, the four basic arithmetic operators,
- * and literals. The value for the literals are evaluated by checking for them
- * in the provided metrics.
- */
-double EvaluateNumber(std::string formula, Json::object metrics);
 Json::object GetBuildInfo();
 
 }  // namespace utils
@@ -0,0 +1,115 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory_forecast.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace memory_advice {
+
+constexpr size_t MemoryForecast::CAPACITY;
+constexpr size_t MemoryForecast::MIN_SAMPLES;
+constexpr double MemoryForecast::OUTLIER_THRESHOLD;
+
+MemoryForecast::MemoryForecast(double min_tolerance)
+    : min_tolerance_(min_tolerance) {}
+
+void MemoryForecast::Add(double time, double value) {
+    if (size_ == 0) origin_ = time;
+    if (Valid()) {
+        Fit fit = Compute();
+        double expected = fit.intercept + fit.slope * (time - origin_);
+        double tolerance =
+            std::max(OUTLIER_THRESHOLD * std::sqrt(fit.residual_variance),
+                     min_tolerance_);
+        int side = value > expected + tolerance
+                       ? 1
+                       : (value < expected - tolerance ? -1 : 0);
+        if (side != 0 && side != outlier_side_) {
+            value = std::min(std::max(value, expected - tolerance),
+                             expected + tolerance);
+        }
+        outlier_side_ = side;
+    }
+    if (size_ == CAPACITY) {
+        Accumulate(samples_[first_], -1);
+        first_ = (first_ + 1) % CAPACITY;
+        --size_;
+    }
+    Sample& sample = samples_[(first_ + size_) % CAPACITY];
+    sample = {time, value};
+    ++size_;
+    Accumulate(sample, 1);
+    if (++additions_since_recompute_ == CAPACITY) Recompute();
+}
+
+void MemoryForecast::Clear() {
+    first_ = 0;
+    size_ = 0;
+    outlier_side_ = 0;
+    Recompute();
+}
+
+bool MemoryForecast::Valid() const {
+    if (size_ < MIN_SAMPLES) return false;
+    double mean_t = sum_t_ / size_;
+    return sum_tt_ - size_ * mean_t * mean_t > 0;
+}
+
+double MemoryForecast::Slope() const { return Compute().slope; }
+
+double MemoryForecast::ValueAt(double time) const {
+    Fit fit = Compute();
+    return fit.intercept + fit.slope * (time - origin_);
+}
+
+MemoryForecast::Fit MemoryForecast::Compute() const {
+    double n = size_;
+    double mean_t = sum_t_ / n;
+    double mean_v = sum_v_ / n;
+    double var_t = sum_tt_ - n * mean_t * mean_t;
+    double cov_tv = sum_tv_ - n * mean_t * mean_v;
+    double var_v = sum_vv_ - n * mean_v * mean_v;
+    Fit fit;
+    fit.slope = cov_tv / var_t;
+    fit.intercept = mean_v - fit.slope * mean_t;
+    fit.residual_variance =
+        n > 2 ? std::max(var_v - fit.slope * cov_tv, 0.0) / (n - 2) : 0.0;
+    return fit;
+}
+
+void MemoryForecast::Accumulate(const Sample& sample, double sign) {
+    double t = sample.time - origin_;
+    double v = sample.value;
+    sum_t_ += sign * t;
+    sum_v_ += sign * v;
+    sum_tt_ += sign * t * t;
+    sum_tv_ += sign * t * v;
+    sum_vv_ += sign * v * v;
+}
+
+void MemoryForecast::Recompute() {
+    additions_since_recompute_ = 0;
+    sum_t_ = sum_v_ = sum_tt_ = sum_tv_ = sum_vv_ = 0;
+    if (size_ == 0) return;
+    origin_ = samples_[first_].time;
+    for (size_t i = 0; i < size_; ++i) {
+        Accumulate(samples_[(first_ + i) % CAPACITY], 1);
+    }
+}
+
+}  // namespace memory_advice
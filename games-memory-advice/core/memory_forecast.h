@@ -0,0 +1,97 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace memory_advice {
+
+/**
+ * @brief Fits a linear trend to a bounded history of samples of a value.
+ *
+ * The least squares fit is maintained incrementally from running sums, so
+ * adding a sample and reading the trend cost O(1), amortizing the periodic
+ * recomputation of the sums. To be robust to spikes, such as a short-lived
+ * allocation, a sample further from the trend than OUTLIER_THRESHOLD standard
+ * deviations of the residuals is clipped to that distance before being
+ * added. Consecutive samples on the same side of the trend are not clipped,
+ * as they show that the trend changed.
+ */
+class MemoryForecast {
+ public:
+  static constexpr size_t CAPACITY = 64;
+  /** @brief Samples needed before the trend is estimated. */
+  static constexpr size_t MIN_SAMPLES = 4;
+  static constexpr double OUTLIER_THRESHOLD = 3.0;
+
+  /** @param min_tolerance the smallest distance from the trend at which
+   * samples are clipped, so that a perfect fit doesn't clip everything. */
+  explicit MemoryForecast(double min_tolerance);
+
+  /** @brief Adds a sample, evicting the oldest one when full. Times must be
+   * increasing. */
+  void Add(double time, double value);
+  void Clear();
+  size_t Size() const { return size_; }
+
+  /** @brief Whether there are enough samples to estimate the trend. */
+  bool Valid() const;
+  /** @brief Change of the value per unit of time. Requires Valid(). */
+  double Slope() const;
+  /** @brief Value of the trend at the given time. Requires Valid(). */
+  double ValueAt(double time) const;
+
+ private:
+  struct Sample {
+    double time;
+    double value;
+  };
+  struct Fit {
+    double slope;
+    /** @brief Value of the trend at origin_. */
+    double intercept;
+    double residual_variance;
+  };
+
+  Fit Compute() const;
+  /** @brief Adds the sample to the running sums, or removes it if sign is
+   * negative. */
+  void Accumulate(const Sample& sample, double sign);
+  /** @brief Recomputes the running sums from the samples, so that rounding
+   * errors from removing samples don't accumulate. */
+  void Recompute();
+
+  double min_tolerance_;
+  std::array<Sample, CAPACITY> samples_;
+  /** @brief Index of the oldest sample. */
+  size_t first_ = 0;
+  size_t size_ = 0;
+  size_t additions_since_recompute_ = 0;
+  /** @brief Side of the trend of the last sample, if it was an outlier: 1
+   * above, -1 below, or 0. */
+  int outlier_side_ = 0;
+  /** @brief Times are accumulated relative to origin_, for precision. */
+  double origin_ = 0;
+  double sum_t_ = 0;
+  double sum_v_ = 0;
+  double sum_tt_ = 0;
+  double sum_tv_ = 0;
+  double sum_vv_ = 0;
+};
+
+}  // namespace memory_advice
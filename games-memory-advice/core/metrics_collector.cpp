@@ -0,0 +1,148 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics_collector.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "jni/jnictx.h"
+
+namespace memory_advice {
+
+using namespace json11;
+
+constexpr int MetricsCollector::IDLE_PERIODS;
+
+MetricsCollector::MetricsCollector(IMetricsProvider* provider)
+    : provider_(provider) {}
+
+MetricsCollector::~MetricsCollector() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    condition_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+Json::object MetricsCollector::Read(const std::string& category) {
+    auto it = provider_->metrics_categories_.find(category);
+    if (it == provider_->metrics_categories_.end()) return Json::object();
+    return (provider_->*(it->second.function))();
+}
+
+Json::object MetricsCollector::Get(const std::string& category,
+                                   Clock::time_point* time) {
+    auto it = provider_->metrics_categories_.find(category);
+    if (it == provider_->metrics_categories_.end()) return Json::object();
+    const IMetricsProvider::MetricsSource& source = it->second;
+    if (source.cost == IMetricsProvider::Cost::CHEAP) {
+        if (time != nullptr) *time = Clock::now();
+        return (provider_->*(source.function))();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    CachedCategory& cached = cache_[category];
+    if (cached.function == nullptr) {
+        cached.function = source.function;
+        cached.max_age = source.max_age;
+    }
+    cached.last_get = Clock::now();
+    if (!cached.valid || cached.last_get - cached.time > cached.max_age) {
+        lock.unlock();
+        Refresh(cached, true);
+        lock.lock();
+        // Keep refreshing the category in the background.
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&MetricsCollector::RefreshLoop, this);
+        } else {
+            condition_.notify_one();
+        }
+    }
+    if (time != nullptr) *time = cached.time;
+    return cached.values;
+}
+
+void MetricsCollector::Refresh(CachedCategory& cached, bool only_if_stale) {
+    std::lock_guard<std::mutex> read_lock(cached.read_mutex);
+    auto start = Clock::now();
+    if (only_if_stale) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cached.valid && start - cached.time <= cached.max_age) return;
+    }
+    Json::object values = (provider_->*(cached.function))();
+    auto end = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    cached.values = std::move(values);
+    cached.time = start;
+    cached.read_duration = end - start;
+    cached.valid = true;
+}
+
+MetricsCollector::Clock::time_point MetricsCollector::RefreshTime(
+    const CachedCategory& cached) {
+    // Start early enough for the read to complete before the values get
+    // older than max_age, allowing for the read taking twice as long as the
+    // last one, but not more often than every max_age / 2.
+    auto period = std::max<Clock::duration>(
+        cached.max_age - 2 * cached.read_duration, cached.max_age / 2);
+    return cached.time + period;
+}
+
+void MetricsCollector::RefreshLoop() {
+    // The provider can make JNI calls.
+    const gamesdk::jni::Ctx* ctx = gamesdk::jni::Ctx::Instance();
+    if (ctx != nullptr) ctx->Env();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        auto now = Clock::now();
+        auto next = Clock::time_point::max();
+        std::vector<CachedCategory*> due;
+        for (auto& entry : cache_) {
+            CachedCategory& cached = entry.second;
+            if (!cached.valid ||
+                now - cached.last_get > IDLE_PERIODS * cached.max_age) {
+                continue;
+            }
+            auto refresh_time = RefreshTime(cached);
+            if (refresh_time <= now) {
+                due.push_back(&cached);
+            } else {
+                next = std::min(next, refresh_time);
+            }
+        }
+        if (due.empty()) {
+            if (next == Clock::time_point::max()) {
+                condition_.wait(lock);
+            } else {
+                condition_.wait_until(lock, next);
+            }
+            continue;
+        }
+        lock.unlock();
+        for (CachedCategory* cached : due) {
+            Refresh(*cached, false);
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    if (ctx != nullptr) ctx->DetachThread();
+}
+
+}  // namespace memory_advice
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "json11/json11.hpp"
+#include "metrics_provider.h"
+
+namespace memory_advice {
+
+using namespace json11;
+
+/**
+ * @brief Reads metrics categories from a provider according to their cost.
+ *
+ * Cheap categories are read from the provider on every call. Expensive
+ * categories are served from a cache while their values are not older than
+ * the max_age of their source. While a category keeps being read, a
+ * background thread refreshes it ahead of that deadline, so that frequent
+ * callers never wait for the provider. Values found older than max_age, on
+ * the first read or by callers polling less often, are read synchronously.
+ */
+class MetricsCollector {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  /** @brief Number of max_age periods without reads after which a category
+   * stops being refreshed in the background. */
+  static constexpr int IDLE_PERIODS = 4;
+
+  explicit MetricsCollector(IMetricsProvider* provider);
+  ~MetricsCollector();
+
+  /**
+   * @brief Returns the latest values of a metrics category.
+   *
+   * @param category a key of IMetricsProvider::metrics_categories_.
+   * @param time if not null, set to when the values were read from the
+   * provider.
+   */
+  Json::object Get(const std::string& category,
+                   Clock::time_point* time = nullptr);
+
+  /** @brief Reads a metrics category from the provider, bypassing the
+   * cache. */
+  Json::object Read(const std::string& category);
+
+ private:
+  struct CachedCategory {
+    IMetricsProvider::MetricsFunction function = nullptr;
+    std::chrono::nanoseconds max_age{0};
+    Json::object values;
+    /** @brief When the provider started reading values. */
+    Clock::time_point time;
+    /** @brief How long the last read from the provider took. */
+    Clock::duration read_duration{0};
+    Clock::time_point last_get;
+    bool valid = false;
+    /** @brief Serializes the reads of the category from the provider. */
+    std::mutex read_mutex;
+  };
+
+  /** @brief Reads the category from the provider into the cache. If
+   * only_if_stale, does nothing when another thread refreshed it first. */
+  void Refresh(CachedCategory& cached, bool only_if_stale);
+  /** @brief When the background thread should refresh the category. */
+  static Clock::time_point RefreshTime(const CachedCategory& cached);
+  void RefreshLoop();
+
+  IMetricsProvider* provider_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool running_ = true;
+  std::map<std::string, CachedCategory> cache_;
+  std::thread thread_;
+};
+
+}  // namespace memory_advice
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <regex>
@@ -39,14 +40,40 @@ using namespace json11;
 class IMetricsProvider {
  public:
   typedef Json::object (IMetricsProvider::*MetricsFunction)();
-  /** @brief A map matching metrics category names to their functions */
-  std::map<std::string, MetricsFunction> metrics_categories_ = {
-      {"meminfo", &IMetricsProvider::GetMeminfoValues},
-      {"status", &IMetricsProvider::GetStatusValues},
-      {"proc", &IMetricsProvider::GetProcValues},
-      {"debug", &IMetricsProvider::GetDebugValues},
-      {"MemoryInfo", &IMetricsProvider::GetActivityManagerMemoryInfo},
-      {"ActivityManager", &IMetricsProvider::GetActivityManagerValues}};
+  /** @brief How long it takes to read a metrics category */
+  enum class Cost {
+    /** @brief Read from /proc; can be read on every sample */
+    CHEAP,
+    /** @brief Read through JNI; takes milliseconds */
+    EXPENSIVE
+  };
+  struct MetricsSource {
+    MetricsFunction function;
+    Cost cost;
+    /** @brief How old the values of an expensive category can be when
+     * served from a cache */
+    std::chrono::milliseconds max_age;
+  };
+  /** @brief A map matching metrics category names to their sources */
+  std::map<std::string, MetricsSource> metrics_categories_ = {
+      {"meminfo",
+       {&IMetricsProvider::GetMeminfoValues, Cost::CHEAP,
+        std::chrono::milliseconds(0)}},
+      {"status",
+       {&IMetricsProvider::GetStatusValues, Cost::CHEAP,
+        std::chrono::milliseconds(0)}},
+      {"proc",
+       {&IMetricsProvider::GetProcValues, Cost::CHEAP,
+        std::chrono::milliseconds(0)}},
+      {"debug",
+       {&IMetricsProvider::GetDebugValues, Cost::EXPENSIVE,
+        std::chrono::milliseconds(100)}},
+      {"MemoryInfo",
+       {&IMetricsProvider::GetActivityManagerMemoryInfo, Cost::EXPENSIVE,
+        std::chrono::milliseconds(100)}},
+      {"ActivityManager",
+       {&IMetricsProvider::GetActivityManagerValues, Cost::EXPENSIVE,
+        std::chrono::milliseconds(1000)}}};
   /** @brief Get a list of memory metrics stored in /proc/meminfo */
   virtual Json::object GetMeminfoValues() = 0;
   /** @brief Get a list of memory metrics stored in /proc/{pid}/status */
@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics_snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace memory_advice {
+
+using namespace json11;
+
+namespace {
+
+double ToNumber(const Json& value) {
+    if (value.is_bool()) return value.bool_value() ? 1.0 : 0.0;
+    return value.number_value();
+}
+
+}  // namespace
+
+constexpr int MetricsSchema::NOT_FOUND;
+
+int MetricsSchema::Add(const std::string& category,
+                       const std::string& metric) {
+    int index = Find(category, metric);
+    if (index != NOT_FOUND) return index;
+    auto it = std::find_if(
+        categories_.begin(), categories_.end(),
+        [&category](const Category& c) { return c.name == category; });
+    if (it == categories_.end()) {
+        it = categories_.insert(categories_.end(), Category{category, {}});
+    }
+    it->metrics.emplace_back(metric, size_);
+    return size_++;
+}
+
+int MetricsSchema::Find(const std::string& category,
+                        const std::string& metric) const {
+    for (const Category& c : categories_) {
+        if (c.name != category) continue;
+        for (const auto& m : c.metrics) {
+            if (m.first == metric) return m.second;
+        }
+    }
+    return NOT_FOUND;
+}
+
+void MetricsSchema::Allocate(MetricsSnapshot* snapshot) const {
+    snapshot->values.assign(size_, 0.0);
+    snapshot->time = 0;
+    snapshot->max_age = std::chrono::nanoseconds(0);
+}
+
+void MetricsSchema::Collect(MetricsCollector* collector,
+                            const Json::object* collected,
+                            MetricsSnapshot* snapshot) const {
+    auto now = MetricsCollector::Clock::now();
+    snapshot->max_age = std::chrono::nanoseconds(0);
+    for (const Category& category : categories_) {
+        Json::object requested;
+        const Json::object* values = nullptr;
+        if (collected != nullptr) {
+            auto it = collected->find(category.name);
+            if (it != collected->end()) values = &it->second.object_items();
+        }
+        if (values == nullptr) {
+            MetricsCollector::Clock::time_point time;
+            requested = collector->Get(category.name, &time);
+            snapshot->max_age = std::max<std::chrono::nanoseconds>(
+                snapshot->max_age, now - time);
+            values = &requested;
+        }
+        for (const auto& metric : category.metrics) {
+            auto it = values->find(metric.first);
+            snapshot->values[metric.second] =
+                it != values->end() ? ToNumber(it->second) : 0.0;
+        }
+    }
+    using namespace std::chrono;
+    snapshot->time =
+        duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+            .count();
+}
+
+}  // namespace memory_advice
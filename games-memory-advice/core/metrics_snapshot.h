@@ -0,0 +1,87 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "json11/json11.hpp"
+#include "metrics_collector.h"
+
+namespace memory_advice {
+
+using namespace json11;
+
+/**
+ * @brief A sample of variable metrics, stored in flat arrays indexed as the
+ * metrics of the MetricsSchema that collected it.
+ */
+struct MetricsSnapshot {
+  /** @brief Value of each metric; booleans are stored as 1.0 or 0.0 and
+   * missing metrics as 0.0. */
+  std::vector<double> values;
+  /** @brief Milliseconds since epoch at which the sample was collected. */
+  double time = 0;
+  /** @brief Age of the oldest values of the sample, which can be served
+   * from a cache. */
+  std::chrono::nanoseconds max_age{0};
+};
+
+/**
+ * @brief The variable metrics read by Memory Advice on each sample.
+ *
+ * Metrics are resolved to indices once, when initializing, so that a sample
+ * only requests the categories it needs from the metrics collector and stores
+ * their values in flat arrays instead of nested Json objects.
+ */
+class MetricsSchema {
+ public:
+  static constexpr int NOT_FOUND = -1;
+
+  /** @brief Returns the index of a metric, adding it to the schema if
+   * needed. */
+  int Add(const std::string& category, const std::string& metric);
+  int Find(const std::string& category, const std::string& metric) const;
+  size_t Size() const { return size_; }
+
+  /** @brief Sizes the arrays of a snapshot for this schema. */
+  void Allocate(MetricsSnapshot* snapshot) const;
+
+  /**
+   * @brief Fills a snapshot with the metrics of the schema.
+   *
+   * @param collector the collector to request categories from.
+   * @param collected categories that were already collected, keyed by name,
+   * or nullptr. They are read from there instead of the provider.
+   * @param snapshot a snapshot allocated for this schema.
+   */
+  void Collect(MetricsCollector* collector, const Json::object* collected,
+               MetricsSnapshot* snapshot) const;
+
+ private:
+  struct Category {
+    std::string name;
+    /** @brief Names and indices of the metrics read from this category. */
+    std::vector<std::pair<std::string, int>> metrics;
+  };
+  std::vector<Category> categories_;
+  int size_ = 0;
+};
+
+}  // namespace memory_advice
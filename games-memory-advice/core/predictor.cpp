@@ -111,46 +111,11 @@ DefaultPredictor::~DefaultPredictor() {
     TfLiteModelDelete(model);
 }
 
-float IPredictor::GetFromPath(std::string feature, Json::object data) {
-    int pos = 0;
-    const Json::object* search = &data;
-    while ((pos = feature.find_first_of("/")) != std::string::npos) {
-        search = &(search->at(feature.substr(0, pos)).object_items());
-        feature = feature.substr(pos + 1);
-    }
-
-    if (feature.length() > 4 && feature.substr(feature.length() - 4) == "Norm") {
-        Json result = search->at(feature.substr(0, feature.length() - 4));
-
-        if (result.is_number()) {
-            return static_cast<float>(result.number_value()) /
-                GetFromPath("baseline/constant/MemoryInfo/totalMem", data);
-        } else {
-            return 0.0f;
-        }
-    } else {
-        Json result = search->at(feature);
-
-        if (result.is_number()) {
-            return static_cast<float>(result.number_value());
-        } else if (result.is_bool()) {
-            return result.bool_value() ? 1.0f : 0.0f;
-        } else {
-            return 0.0f;
-        }
-    }
-}
-
-float DefaultPredictor::Predict(Json::object data) {
-    float input_data[features.size()];
-
-    for (int idx = 0; idx != features.size(); idx++) {
-        input_data[idx] = GetFromPath(features[idx], data);
-    }
+float DefaultPredictor::Predict(const std::vector<float>& input_data) {
     TfLiteTensor* input_tensor =
         TfLiteInterpreterGetInputTensor(interpreter, 0);
-    TfLiteTensorCopyFromBuffer(input_tensor, input_data,
-                               features.size() * sizeof(float));
+    TfLiteTensorCopyFromBuffer(input_tensor, input_data.data(),
+                               input_data.size() * sizeof(float));
 
     TfLiteInterpreterInvoke(interpreter);
 
@@ -54,17 +54,21 @@ class IPredictor {
                                       std::string features_file) = 0;
 
   /**
-   * Runs the tensorflow model with the provided data.
+   * Returns the features the model expects, as paths in the memory data, e.g.
+   * "sample/proc/oom_score". Paths ending with "Norm" denote the value divided
+   * by the total memory of the device.
+   */
+  virtual const std::vector<std::string>& Features() const = 0;
+
+  /**
+   * Runs the tensorflow model with the provided features.
    *
-   * @param data the memory data from the device.
+   * @param features the value of each feature, in the order of Features().
    * @return the result from the model.
    */
-  virtual float Predict(Json::object data) = 0;
+  virtual float Predict(const std::vector<float>& features) = 0;
 
   virtual ~IPredictor() {}
-
- protected:
-  float GetFromPath(std::string feature, Json::object data);
 };
 
 class DefaultPredictor : public IPredictor {
@@ -78,7 +82,10 @@ class DefaultPredictor : public IPredictor {
  public:
   MemoryAdvice_ErrorCode Init(std::string model_file,
                               std::string features_file) override;
-  float Predict(Json::object data) override;
+  const std::vector<std::string>& Features() const override {
+    return features;
+  }
+  float Predict(const std::vector<float>& features) override;
   ~DefaultPredictor() override;
 };
 
@@ -16,32 +16,223 @@
 
 #include "state_watcher.h"
 
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "jni/jnictx.h"
 #include "memory_advice_impl.h"
 
 namespace memory_advice {
 
-void StateWatcher::Looper() {
-    thread_running_ = true;
-    while (!do_cancel_) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(interval_));
-        if (!do_cancel_) {
-            MemoryAdvice_MemoryState state = impl_->GetMemoryState();
-            if (state != MEMORYADVICE_STATE_OK && !do_cancel_) {
-                callback_(state, user_data_);
-            }
+constexpr const char* StateWatcher::PRESSURE_PATH;
+constexpr const char* StateWatcher::PRESSURE_TRIGGER;
+constexpr int StateWatcher::MAX_BACKOFF;
+constexpr int StateWatcher::MAX_PRESSURE_BACKOFF;
+constexpr std::chrono::milliseconds StateWatcher::MIN_POLL_PERIOD;
+
+StateWatcher::StateWatcher(MemoryAdviceImpl* impl, const char* pressure_path)
+    : impl_(impl), pressure_path_(pressure_path) {}
+
+StateWatcher::~StateWatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    Wake();
+    if (thread_.joinable()) thread_.join();
+    if (wake_fd_ >= 0) close(wake_fd_);
+    if (pressure_fd_ >= 0) close(pressure_fd_);
+}
+
+void StateWatcher::Register(MemoryAdvice_WatcherCallback callback,
+                            void* user_data,
+                            std::chrono::milliseconds interval) {
+    // Keep deadlines representable.
+    interval = std::min<std::chrono::milliseconds>(interval,
+                                                   std::chrono::hours(24));
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    watchers_.push_back(
+        {callback, user_data, interval, MEMORYADVICE_STATE_OK, now + interval});
+    // The first evaluation for the watcher is due after its interval, as
+    // for subsequent ones.
+    next_evaluation_ = std::min(
+        next_evaluation_,
+        now + std::max<Clock::duration>(interval, MIN_POLL_PERIOD));
+    if (!thread_.joinable()) {
+        Start();
+    } else {
+        Wake();
+    }
+}
+
+bool StateWatcher::Unregister(MemoryAdvice_WatcherCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::remove_if(
+        watchers_.begin(), watchers_.end(),
+        [callback](const Watcher& w) { return w.callback == callback; });
+    if (it == watchers_.end()) return false;
+    watchers_.erase(it, watchers_.end());
+    if (watchers_.empty()) next_evaluation_ = Clock::time_point::max();
+    return true;
+}
+
+bool StateWatcher::PressureEventsEnabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pressure_fd_ >= 0;
+}
+
+int StateWatcher::Evaluations() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return evaluations_;
+}
+
+void StateWatcher::Start() {
+    wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd_ < 0) {
+        ALOGE("Could not create the watcher eventfd: %s", strerror(errno));
+    }
+    if (pressure_path_ != nullptr) {
+        int fd = open(pressure_path_, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        // The trigger is written with its terminating null character.
+        if (fd >= 0 &&
+            write(fd, PRESSURE_TRIGGER, strlen(PRESSURE_TRIGGER) + 1) < 0) {
+            close(fd);
+            fd = -1;
+        }
+        if (fd < 0) {
+            ALOGI("Memory pressure events are not available (%s), polling",
+                  strerror(errno));
         }
+        pressure_fd_ = fd;
     }
-    thread_running_ = false;
+    thread_ = std::thread(&StateWatcher::Looper, this);
 }
 
-StateWatcher::~StateWatcher() {
-    if (!do_cancel_) {
-        ALOGV(
-            "memory_advice::StateWatcher::Cancel not called before delete? "
-            "This can cause blocking on the main thread.");
-        do_cancel_ = true;
+void StateWatcher::Wake() {
+    if (wake_fd_ < 0) return;
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        ALOGE("Could not wake the watcher thread: %s", strerror(errno));
+    }
+}
+
+bool StateWatcher::Wait(std::unique_lock<std::mutex>& lock,
+                        Clock::time_point deadline) {
+    using namespace std::chrono;
+    int64_t timeout = -1;
+    if (deadline != Clock::time_point::max()) {
+        // Round up, so as not to wake before the deadline.
+        timeout = std::max<int64_t>(
+            duration_cast<milliseconds>(deadline - Clock::now()).count() + 1,
+            0);
+    }
+    // Without an eventfd, nothing interrupts the wait: check for
+    // cancellation regularly instead.
+    if (wake_fd_ < 0 && (timeout < 0 || timeout > 100)) timeout = 100;
+    if (timeout > INT_MAX) timeout = INT_MAX;
+    struct pollfd fds[2] = {{wake_fd_, POLLIN, 0},
+                            {pressure_fd_, POLLPRI, 0}};
+    nfds_t nfds = pressure_fd_ >= 0 ? 2 : 1;
+    lock.unlock();
+    int result = poll(fds, nfds, static_cast<int>(timeout));
+    lock.lock();
+    if (result <= 0) return false;
+    if (fds[0].revents & POLLIN) {
+        uint64_t count;
+        read(wake_fd_, &count, sizeof(count));
+    }
+    if (nfds < 2 || fds[1].revents == 0) return false;
+    if (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        ALOGW("Memory pressure events stopped, polling");
+        close(pressure_fd_);
+        pressure_fd_ = -1;
+        return false;
+    }
+    return true;
+}
+
+StateWatcher::Clock::time_point StateWatcher::NextEvaluation(
+    Clock::time_point now) const {
+    Clock::duration period = Clock::duration::max();
+    for (const Watcher& watcher : watchers_) {
+        period = std::min(period, watcher.interval);
+    }
+    if (period == Clock::duration::max()) return Clock::time_point::max();
+    switch (state_) {
+        case MEMORYADVICE_STATE_OK: {
+            // Double the period on each healthy evaluation, up to the
+            // maximum backoff, which is higher when pressure events can
+            // wake the thread earlier.
+            int max_backoff =
+                pressure_fd_ >= 0 ? MAX_PRESSURE_BACKOFF : MAX_BACKOFF;
+            int shift = std::min(healthy_evaluations_ - 1, 30);
+            period *= std::min(1 << std::max(shift, 0), max_backoff);
+            break;
+        }
+        case MEMORYADVICE_STATE_APPROACHING_LIMIT:
+            // Catch the state going critical early.
+            period /= 2;
+            break;
+        default:
+            break;
     }
-    thread_->join();
+    return now + std::max<Clock::duration>(period, MIN_POLL_PERIOD);
+}
+
+void StateWatcher::Looper() {
+    // Memory Advice reads metrics through JNI.
+    const gamesdk::jni::Ctx* ctx = gamesdk::jni::Ctx::Instance();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        if (watchers_.empty() || Clock::now() < next_evaluation_) {
+            if (Wait(lock, next_evaluation_)) {
+                // Memory is stalling: evaluate now and poll from scratch.
+                healthy_evaluations_ = 0;
+                if (!watchers_.empty()) next_evaluation_ = Clock::now();
+            }
+            continue;
+        }
+
+        lock.unlock();
+        MemoryAdvice_MemoryState state = impl_->GetMemoryState();
+        lock.lock();
+        auto now = Clock::now();
+        ++evaluations_;
+        state_ = state;
+        healthy_evaluations_ =
+            state == MEMORYADVICE_STATE_OK ? healthy_evaluations_ + 1 : 0;
+
+        std::vector<Watcher> notified;
+        for (Watcher& watcher : watchers_) {
+            if (state == MEMORYADVICE_STATE_OK) {
+                watcher.notified_state = state;
+            } else if (state > watcher.notified_state ||
+                       now >= watcher.next_notification) {
+                watcher.notified_state = state;
+                watcher.next_notification = now + watcher.interval;
+                notified.push_back(watcher);
+            }
+        }
+        next_evaluation_ = NextEvaluation(now);
+
+        // Callbacks can register or unregister watchers.
+        lock.unlock();
+        for (const Watcher& watcher : notified) {
+            watcher.callback(state, watcher.user_data);
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    if (ctx != nullptr) ctx->DetachThread();
 }
 
 }  // namespace memory_advice
@@ -16,9 +16,10 @@
 
 #pragma once
 
-#include <atomic>
-#include <memory>
+#include <chrono>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include "memory_advice/memory_advice.h"
 
@@ -26,31 +27,92 @@ namespace memory_advice {
 
 class MemoryAdviceImpl;
 
+/**
+ * @brief Evaluates the memory state on behalf of all the registered watchers,
+ * on a single thread.
+ *
+ * Where the kernel supports pressure stall information triggers, the thread
+ * sleeps until memory stalls are reported and only polls as a safety net.
+ * Otherwise it polls adaptively: at the shortest interval of the watchers,
+ * faster when approaching the limit and backing off while memory is healthy.
+ *
+ * Each evaluation is shared by all the watchers. A watcher is notified when
+ * the state gets worse than what it was last notified of, and otherwise at
+ * most once per interval while the state is not OK.
+ */
 class StateWatcher {
  public:
-  StateWatcher(MemoryAdviceImpl* impl, MemoryAdvice_WatcherCallback callback,
-               void* user_data, uint64_t interval)
-      : callback_(callback),
-        user_data_(user_data),
-        interval_(interval),
-        do_cancel_(false),
-        thread_running_(true),
-        impl_(impl),
-        thread_(std::make_unique<std::thread>(&StateWatcher::Looper, this)) {}
-  virtual ~StateWatcher();
-  void Cancel() { do_cancel_ = true; }
-  bool ThreadRunning() const { return thread_running_; }
-  const MemoryAdvice_WatcherCallback Callback() const { return callback_; }
+  typedef std::chrono::steady_clock Clock;
+
+  static constexpr const char* PRESSURE_PATH = "/proc/pressure/memory";
+  /** @brief The PSI trigger: 150ms of partial stall in a 2s window, the
+   * shortest window allowed to unprivileged processes. */
+  static constexpr const char* PRESSURE_TRIGGER = "some 150000 2000000";
+  /** @brief Factor by which polling backs off while memory is healthy,
+   * relative to the shortest interval of the watchers. */
+  static constexpr int MAX_BACKOFF = 4;
+  /** @brief Backoff when pressure events wake the thread. */
+  static constexpr int MAX_PRESSURE_BACKOFF = 16;
+  static constexpr std::chrono::milliseconds MIN_POLL_PERIOD{10};
+
+  /**
+   * @param impl the Memory Advice instance whose state is watched.
+   * @param pressure_path the PSI file to set a trigger on, or nullptr to
+   * always poll.
+   */
+  explicit StateWatcher(MemoryAdviceImpl* impl,
+                        const char* pressure_path = PRESSURE_PATH);
+  ~StateWatcher();
+
+  void Register(MemoryAdvice_WatcherCallback callback, void* user_data,
+                std::chrono::milliseconds interval);
+  /** @brief Removes all the watchers with the given callback. Returns false
+   * if there were none. A callback running concurrently is not waited for.
+   */
+  bool Unregister(MemoryAdvice_WatcherCallback callback);
+
+  /** @brief Whether memory pressure events are being waited for. */
+  bool PressureEventsEnabled() const;
+  /** @brief Number of times the memory state was evaluated. */
+  int Evaluations() const;
 
  private:
-  MemoryAdviceImpl* impl_;
-  std::atomic<bool> do_cancel_;
-  std::atomic<bool> thread_running_;
-  std::unique_ptr<std::thread> thread_;
-  MemoryAdvice_WatcherCallback callback_;
-  void* user_data_;
-  uint64_t interval_;
+  struct Watcher {
+    MemoryAdvice_WatcherCallback callback;
+    void* user_data;
+    Clock::duration interval;
+    /** @brief The state the watcher was last notified of, or OK. */
+    MemoryAdvice_MemoryState notified_state;
+    /** @brief When the watcher can be notified again of the same state. */
+    Clock::time_point next_notification;
+  };
+
+  /** @brief Opens the file descriptors waited on and starts the thread.
+   * Requires mutex_. */
+  void Start();
+  /** @brief Wakes the thread from its wait. */
+  void Wake();
+  /** @brief Waits until the deadline, a pressure event or Wake(), releasing
+   * the lock meanwhile. Returns true on a pressure event. */
+  bool Wait(std::unique_lock<std::mutex>& lock, Clock::time_point deadline);
+  /** @brief When to evaluate the state next, after an evaluation at now.
+   * Requires mutex_. */
+  Clock::time_point NextEvaluation(Clock::time_point now) const;
   void Looper();
+
+  MemoryAdviceImpl* impl_;
+  mutable std::mutex mutex_;
+  std::vector<Watcher> watchers_;
+  const char* pressure_path_;
+  bool running_ = true;
+  MemoryAdvice_MemoryState state_ = MEMORYADVICE_STATE_OK;
+  /** @brief Number of consecutive evaluations with a healthy state. */
+  int healthy_evaluations_ = 0;
+  int evaluations_ = 0;
+  Clock::time_point next_evaluation_ = Clock::time_point::max();
+  int wake_fd_ = -1;
+  int pressure_fd_ = -1;
+  std::thread thread_;
 };
 
 }  // namespace memory_advice
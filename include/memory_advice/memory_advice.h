@@ -56,6 +56,11 @@ typedef enum MemoryAdvice_ErrorCode : int32_t {
       -5,  ///< UnregisterWatcher was called with an invalid callback.
   MEMORYADVICE_ERROR_TFLITE_MODEL_INVALID =
       -6,  ///< A correct TFLite model was not provided.
+  MEMORYADVICE_ERROR_FORECAST_UNAVAILABLE =
+      -7,  ///< Not enough predictions of the available memory were made yet
+           ///< to forecast it.
+  MEMORYADVICE_ERROR_BUDGET_INVALID =
+      -8,  ///< A budget category was invalid or could not be registered.
 } MemoryAdvice_ErrorCode;
 
 /**
@@ -74,6 +79,35 @@ typedef enum MemoryAdvice_MemoryState : int32_t {
 typedef void (*MemoryAdvice_WatcherCallback)(MemoryAdvice_MemoryState state,
                                              void *user_data);
 
+/**
+ * @brief A forecast of the memory state, from the trend of the available
+ * memory over the recent predictions.
+ */
+typedef struct MemoryAdvice_Forecast {
+  /** @brief Rate at which the available memory is consumed, in bytes per
+   * second. Negative while memory is being freed. */
+  double allocationRate;
+  /** @brief Estimated time until the memory state becomes critical, in
+   * seconds. 0 if it already is, or negative if the available memory is not
+   * decreasing towards a critical state. */
+  double timeToCritical;
+} MemoryAdvice_Forecast;
+
+/**
+ * @brief The memory budget of a category registered with
+ * MemoryAdvice_registerBudget.
+ */
+typedef struct MemoryAdvice_Budget {
+  /** @brief Bytes reported as used by the category. */
+  int64_t used;
+  /** @brief Bytes the category can still allocate within its share of the
+   * memory of the application. Negative if it is over budget. */
+  int64_t headroom;
+  /** @brief Bytes the category should free. 0 while the memory state is
+   * MEMORYADVICE_STATE_OK. */
+  int64_t evict;
+} MemoryAdvice_Budget;
+
 /**
  * @brief Initialize the Memory Advice library. This must be called before any
  * other functions.
@@ -156,14 +190,111 @@ float MemoryAdvice_getPercentageAvailableMemory();
  */
 int64_t MemoryAdvice_getTotalMemory();
 
+/**
+ * @brief Forecasts how fast the application is approaching a critical memory
+ * state.
+ *
+ * The library keeps a bounded history of its predictions of the available
+ * memory, taken whenever it is sampled (including by this function and by
+ * watchers), and fits a trend to them that is robust to short spikes. The
+ * forecast is only available once the history spans several predictions, so
+ * this function should be called regularly.
+ *
+ * @param forecast a pointer to a MemoryAdvice_Forecast, in which the forecast
+ * will be written
+ *
+ * @return MEMORYADVICE_ERROR_OK if successful,
+ * @return MEMORYADVICE_ERROR_NOT_INITIALIZED if Memory Advice was not yet
+ * initialized,
+ * @return MEMORYADVICE_ERROR_FORECAST_UNAVAILABLE if there are not enough
+ * predictions of the available memory yet.
+ */
+MemoryAdvice_ErrorCode MemoryAdvice_getForecast(
+    MemoryAdvice_Forecast *forecast);
+
+/**
+ * @brief Registers a category of memory usage of the application, such as
+ * textures or audio, to track its memory budget.
+ *
+ * The memory of the application, which is what the categories use plus what
+ * is still available, is shared between the categories in proportion to
+ * their weights. Registering a name that was already registered returns the
+ * same category, with its original weight.
+ *
+ * @param name the name of the category
+ * @param weight the share of the memory given to the category, relative to
+ * the other categories; must be positive
+ * @param category a pointer in which the identifier of the category will be
+ * written
+ *
+ * @return MEMORYADVICE_ERROR_OK if successful,
+ * @return MEMORYADVICE_ERROR_NOT_INITIALIZED if Memory Advice was not yet
+ * initialized,
+ * @return MEMORYADVICE_ERROR_BUDGET_INVALID if the weight is not positive or
+ * too many categories were registered.
+ */
+MemoryAdvice_ErrorCode MemoryAdvice_registerBudget(const char *name,
+                                                   float weight,
+                                                   int32_t *category);
+
+/**
+ * @brief Reports memory allocated for a budget category.
+ *
+ * Reports are lock-free, and can be made from any thread.
+ *
+ * @return MEMORYADVICE_ERROR_OK if successful,
+ * @return MEMORYADVICE_ERROR_NOT_INITIALIZED if Memory Advice was not yet
+ * initialized,
+ * @return MEMORYADVICE_ERROR_BUDGET_INVALID if the category was not
+ * registered.
+ */
+MemoryAdvice_ErrorCode MemoryAdvice_reportAllocation(int32_t category,
+                                                     int64_t bytes);
+
+/**
+ * @brief Reports memory freed from a budget category. The memory can be
+ * freed on another thread than the one it was allocated on.
+ *
+ * @return MEMORYADVICE_ERROR_OK if successful,
+ * @return MEMORYADVICE_ERROR_NOT_INITIALIZED if Memory Advice was not yet
+ * initialized,
+ * @return MEMORYADVICE_ERROR_BUDGET_INVALID if the category was not
+ * registered.
+ */
+MemoryAdvice_ErrorCode MemoryAdvice_reportFree(int32_t category,
+                                               int64_t bytes);
+
+/**
+ * @brief Returns the memory budget of a category, from its reported usage and
+ * the estimate of the available memory.
+ *
+ * When the memory state is not MEMORYADVICE_STATE_OK, categories over budget
+ * are advised to free the excess. When it is critical, categories are also
+ * advised to free, in proportion to their usage, the memory needed to leave
+ * the critical state.
+ *
+ * @param category a category returned by MemoryAdvice_registerBudget
+ * @param budget a pointer in which the budget will be written
+ *
+ * @return MEMORYADVICE_ERROR_OK if successful,
+ * @return MEMORYADVICE_ERROR_NOT_INITIALIZED if Memory Advice was not yet
+ * initialized,
+ * @return MEMORYADVICE_ERROR_BUDGET_INVALID if the category was not
+ * registered.
+ */
+MemoryAdvice_ErrorCode MemoryAdvice_getBudget(int32_t category,
+                                              MemoryAdvice_Budget *budget);
+
 /**
  * @brief Registers a watcher that polls the Memory Advice library periodically,
  * and invokes the watcher callback when the memory state goes critical.
  *
- * This function creates another thread that calls MemoryAdvice_getMemoryState
- * every `intervalMillis` milliseconds. If the returned state is not
- * MEMORYADVICE_STATE_OK, then calls the watcher callback with the current
- * state.
+ * All the watchers share a single thread that evaluates the memory state.
+ * While the state is not MEMORYADVICE_STATE_OK, the watcher callback is called
+ * with the current state every `intervalMillis` milliseconds, and as soon as
+ * the state gets worse. Where the kernel reports memory pressure events, the
+ * thread wakes up on them; otherwise it polls every `intervalMillis`
+ * milliseconds, less often while memory is healthy.
  *
  * @param intervalMillis the interval at which the Memory Advice library will be
  * polled
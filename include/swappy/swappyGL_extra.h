@@ -108,6 +108,28 @@ void SwappyGL_recordFrameStart(EGLDisplay display, EGLSurface surface);
  */
 void SwappyGL_getStats(SwappyStats *swappyStats);
 
+/**
+ * @brief Returns the stats collected, if statistics collection was toggled on,
+ * in buckets of the resolution set with ::SwappyGL_setStatsBucketResolutionNS.
+ *
+ * @param swappyStats Pointer to a SwappyDetailedStats that will be populated
+ * with collected stats.
+ * @see SwappyDetailedStats
+ * @see SwappyGL_enableStats
+ */
+void SwappyGL_getDetailedStats(SwappyDetailedStats *swappyStats);
+
+/**
+ * @brief Sets the duration covered by each bucket of the detailed stats.
+ *
+ * The default is 1ms. The frame statistics collected so far are cleared, as
+ * if ::SwappyGL_clearStats had been called.
+ *
+ * @param resolution_ns The bucket duration in nanoseconds, greater than 0.
+ * @see SwappyGL_getDetailedStats
+ */
+void SwappyGL_setStatsBucketResolutionNS(uint64_t resolution_ns);
+
 /**
  * @brief Clears the frame statistics collected so far.
  *
@@ -403,6 +403,36 @@ void SwappyVk_recordFrameStart(VkQueue queue, VkSwapchainKHR swapchain,
  */
 void SwappyVk_getStats(VkSwapchainKHR swapchain, SwappyStats* swappyStats);
 
+/**
+ * @brief Returns the stats collected, if statistics collection was toggled on,
+ * in buckets of the resolution set with ::SwappyVk_setStatsBucketResolutionNS.
+ *
+ * Must be externally synchronized with other SwappyVk calls, see
+ * ::SwappyVk_getStats.
+ *
+ * @param[in]  swapchain   - The swapchain for which stats are being queried.
+ * @param      swappyStats - Pointer to a SwappyDetailedStats that will be
+ * populated with the collected stats. Cannot be NULL.
+ * @see SwappyDetailedStats
+ */
+void SwappyVk_getDetailedStats(VkSwapchainKHR swapchain,
+                               SwappyDetailedStats* swappyStats);
+
+/**
+ * @brief Sets the duration covered by each bucket of the detailed stats.
+ *
+ * The default is 1ms. The frame statistics collected so far are cleared, as
+ * if ::SwappyVk_clearStats had been called. See ::SwappyVk_enableStats for
+ * more conditions.
+ *
+ * @param[in]  swapchain     - The swapchain for which stats are configured.
+ * @param      resolution_ns - The bucket duration in nanoseconds, greater
+ *                             than 0.
+ * @see SwappyVk_getDetailedStats
+ */
+void SwappyVk_setStatsBucketResolutionNS(VkSwapchainKHR swapchain,
+                                         uint64_t resolution_ns);
+
 /**
  * @brief Clears the frame statistics collected so far.
  *
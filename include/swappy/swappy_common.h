@@ -42,6 +42,13 @@
  */
 #define MAX_FRAME_BUCKETS 6
 
+/**
+ * The number of buckets of the detailed statistics. The last bucket also
+ * counts all the longer durations.
+ * @see SwappyDetailedStats
+ */
+#define SWAPPY_MAX_DETAILED_BUCKETS 64
+
 /** @cond INTERNAL */
 
 #define SWAPPY_SYSTEM_PROP_KEY_DISABLE "swappy.disable"
@@ -178,6 +185,42 @@ typedef struct SwappyStats {
   uint64_t latencyFrames[MAX_FRAME_BUCKETS];
 } SwappyStats;
 
+/**
+ * @brief The same histograms as SwappyStats, but with buckets of
+ * bucketResolutionNS instead of whole screen refreshes.
+ *
+ * A refresh period is only 8.3ms at 120Hz and 6.9ms at 144Hz, so whole
+ * refreshes can't tell apart the frame times on those displays. With the
+ * default resolution of 1ms, a frame presented 7.9ms after the call to
+ * Swappy_recordFrameStart is counted in latencyFrames[7].
+ * @see SwappyGL_setStatsBucketResolutionNS
+ * @see SwappyVk_setStatsBucketResolutionNS
+ */
+typedef struct SwappyDetailedStats {
+  /** @brief The duration covered by each bucket, in nanoseconds */
+  uint64_t bucketResolutionNS;
+
+  /** @brief Total frames swapped by swappy */
+  uint64_t totalFrames;
+
+  /** @brief Histogram of the time a frame waited in the compositor queue
+   * after rendering was completed, see SwappyStats::idleFrames */
+  uint64_t idleFrames[SWAPPY_MAX_DETAILED_BUCKETS];
+
+  /** @brief Histogram of the time passed between the requested presentation
+   * time and the actual present time, see SwappyStats::lateFrames */
+  uint64_t lateFrames[SWAPPY_MAX_DETAILED_BUCKETS];
+
+  /** @brief Histogram of the time passed between two consecutive frames, see
+   * SwappyStats::offsetFromPreviousFrame */
+  uint64_t offsetFromPreviousFrame[SWAPPY_MAX_DETAILED_BUCKETS];
+
+  /** @brief Histogram of the time passed between the call to
+   * Swappy_recordFrameStart and the actual present time, see
+   * SwappyStats::latencyFrames */
+  uint64_t latencyFrames[SWAPPY_MAX_DETAILED_BUCKETS];
+} SwappyDetailedStats;
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the cost of evaluating the heuristic formulas on each GetAdvice
+// call, before and after formulas were compiled.
+//
+// Built into its own memory_advice_formula_benchmark executable: it only
+// reports the timings, which depend on the device and its load.
+
+#include <core/formula.h>
+#include <core/metrics_collector.h>
+#include <core/metrics_snapshot.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define LOG_TAG "MemoryAdvice"
+#include "../providers/test_metrics_provider.h"
+#include "Log.h"
+#include "gtest/gtest.h"
+#include "json11/json11.hpp"
+
+namespace memory_advice_test {
+
+using namespace json11;
+using memory_advice::Formula;
+using memory_advice::MetricsCollector;
+using memory_advice::MetricsSchema;
+using memory_advice::MetricsSnapshot;
+
+namespace {
+
+constexpr int kIterations = 2000;
+
+const std::vector<std::pair<std::string, std::string>> kHeuristics = {
+    {"red", "predictedAvailable < 0.15"},
+    {"yellow", "predictedAvailable < 0.20"},
+    {"red", "proc.oom_score / 1000 > 0.9"},
+    {"yellow", "MemoryInfo.availMem * 100 / MemoryInfo.totalMem < 10"},
+    {"yellow", "MemoryInfo.threshold / MemoryInfo.totalMem > 0.05"},
+};
+
+constexpr int kPredictedAvailable = -2;
+
+// The formula evaluator used by GetAdvice before formulas were compiled.
+double LegacyEvaluateNumber(std::string formula, Json::object metrics) {
+  if (formula.find('/') != std::string::npos) {
+    return LegacyEvaluateNumber(formula.substr(0, formula.find('/')),
+                                metrics) /
+           LegacyEvaluateNumber(formula.substr(formula.find('/') + 1),
+                                metrics);
+  } else if (formula.find('*') != std::string::npos) {
+    return LegacyEvaluateNumber(formula.substr(0, formula.find('*')),
+                                metrics) *
+           LegacyEvaluateNumber(formula.substr(formula.find('*') + 1),
+                                metrics);
+  } else if (formula.find('+') != std::string::npos) {
+    return LegacyEvaluateNumber(formula.substr(0, formula.find('+')),
+                                metrics) +
+           LegacyEvaluateNumber(formula.substr(formula.find('+') + 1),
+                                metrics);
+  } else if (formula.find('-') != std::string::npos) {
+    return LegacyEvaluateNumber(formula.substr(0, formula.find('-')),
+                                metrics) -
+           LegacyEvaluateNumber(formula.substr(formula.find('-') + 1),
+                                metrics);
+  } else if (std::isdigit(formula[0])) {
+    return std::stod(formula);
+  } else {
+    return metrics[formula].number_value();
+  }
+}
+
+bool LegacyEvaluateBoolean(std::string formula, Json::object metrics) {
+  if (formula.find('>') != std::string::npos) {
+    return LegacyEvaluateNumber(formula.substr(0, formula.find('>')),
+                                metrics) >
+           LegacyEvaluateNumber(formula.substr(formula.find('>') + 1),
+                                metrics);
+  } else if (formula.find('<') != std::string::npos) {
+    return LegacyEvaluateNumber(formula.substr(0, formula.find('<')),
+                                metrics) <
+           LegacyEvaluateNumber(formula.substr(formula.find('<') + 1),
+                                metrics);
+  } else {
+    return false;
+  }
+}
+
+// The variable metrics categories of a sample, shaped like those of
+// default.json.
+Json::object MakeCategories() {
+  Json::object meminfo;
+  for (int i = 0; i < 40; ++i) {
+    meminfo["Field" + std::to_string(i)] = i * 1024.0;
+  }
+  Json::object status;
+  for (int i = 0; i < 20; ++i) {
+    status["Vm" + std::to_string(i)] = i * 4096.0;
+  }
+  return Json::object{
+      {"meminfo", meminfo},
+      {"status", status},
+      {"proc", Json::object{{"oom_score", 950}}},
+      {"MemoryInfo", Json::object{{"availMem", 2e8},
+                                  {"totalMem", 4e9},
+                                  {"threshold", 2.5e8},
+                                  {"lowMemory", false}}},
+  };
+}
+
+// The sample as read by GetAdvice before formulas were compiled. It looked up
+// the names of the formulas directly in the sample, so the metrics of the
+// heuristics are also given under their qualified names.
+Json::object MakeLegacySample(const Json::object& categories,
+                              double predicted_available) {
+  Json::object sample = categories;
+  for (const auto& category : categories) {
+    for (const auto& metric : category.second.object_items()) {
+      sample[category.first + "." + metric.first] = metric.second;
+    }
+  }
+  sample["meta"] = Json::object{{"time", 1.6e12}};
+  sample["predictedAvailable"] = predicted_available;
+  return sample;
+}
+
+// Per-GetAdvice cost, as in GetAdvice before formulas were compiled.
+int LegacyWarnings(const Json::object& sample) {
+  int warnings = 0;
+  for (const auto& heuristic : kHeuristics) {
+    std::string formula = heuristic.second;
+    formula.erase(std::remove_if(formula.begin(), formula.end(),
+                                 (int (*)(int))std::isspace),
+                  formula.end());
+    if (LegacyEvaluateBoolean(formula, sample)) ++warnings;
+  }
+  return warnings;
+}
+
+struct CompiledHeuristics {
+  std::vector<Formula> formulas;
+  std::vector<std::string> metrics;
+  // Where each of metrics is read from, as resolved by
+  // MemoryAdviceImpl::ResolveMetrics.
+  std::vector<int> indices;
+  std::vector<double> values;
+  MetricsSchema schema;
+  MetricsSnapshot snapshot;
+};
+
+// Resolves the metrics of the heuristics as MemoryAdviceImpl::ResolveMetrics
+// does, to indices in a snapshot or to the predicted available memory.
+void ResolveMetrics(const memory_advice::IMetricsProvider& provider,
+                    CompiledHeuristics* heuristics) {
+  for (const std::string& name : heuristics->metrics) {
+    size_t dot = name.find('.');
+    int index = MetricsSchema::NOT_FOUND;
+    if (name == "predictedAvailable") {
+      index = kPredictedAvailable;
+    } else if (dot != std::string::npos &&
+               provider.metrics_categories_.count(name.substr(0, dot)) != 0) {
+      index = heuristics->schema.Add(name.substr(0, dot), name.substr(dot + 1));
+    }
+    EXPECT_NE(index, MetricsSchema::NOT_FOUND) << name;
+    heuristics->indices.push_back(index);
+  }
+  heuristics->values.resize(heuristics->metrics.size());
+  heuristics->schema.Allocate(&heuristics->snapshot);
+}
+
+// Per-GetAdvice cost, as in GetAdvice now: the sample is collected into a
+// snapshot, from which the formulas read their metrics.
+int CompiledWarnings(MetricsCollector* collector,
+                     const Json::object& categories,
+                     double predicted_available,
+                     CompiledHeuristics& heuristics) {
+  heuristics.schema.Collect(collector, &categories, &heuristics.snapshot);
+  for (size_t i = 0; i < heuristics.indices.size(); ++i) {
+    int index = heuristics.indices[i];
+    if (index >= 0) {
+      heuristics.values[i] = heuristics.snapshot.values[index];
+    } else if (index == kPredictedAvailable) {
+      heuristics.values[i] = predicted_available;
+    } else {
+      heuristics.values[i] = 0.0;
+    }
+  }
+  int warnings = 0;
+  for (const Formula& formula : heuristics.formulas) {
+    if (formula.Evaluate(heuristics.values.data()) != 0.0) ++warnings;
+  }
+  return warnings;
+}
+
+template <typename F>
+double NanosecondsPerCall(F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         kIterations;
+}
+
+}  // namespace
+
+TEST(FormulaBenchmark, GetAdviceHeuristics) {
+  TestMetricsProvider provider;
+  MetricsCollector collector(&provider);
+  CompiledHeuristics heuristics;
+  for (const auto& heuristic : kHeuristics) {
+    Formula formula;
+    std::string error;
+    ASSERT_TRUE(formula.Compile(heuristic.second, &heuristics.metrics, &error))
+        << error;
+    heuristics.formulas.push_back(formula);
+  }
+  ResolveMetrics(provider, &heuristics);
+
+  // The heuristics on the sampled metrics always trigger, those on the
+  // predicted available memory depend on the prediction.
+  const Json::object categories = MakeCategories();
+  int expected_warnings = 5;
+  for (double predicted_available : {0.1, 0.18, 0.5}) {
+    Json::object sample = MakeLegacySample(categories, predicted_available);
+    EXPECT_EQ(LegacyWarnings(sample), expected_warnings)
+        << predicted_available;
+    EXPECT_EQ(CompiledWarnings(&collector, categories, predicted_available,
+                               heuristics),
+              expected_warnings)
+        << predicted_available;
+    --expected_warnings;
+  }
+
+  Json::object sample = MakeLegacySample(categories, 0.18);
+  int legacy_warnings = 0;
+  int compiled_warnings = 0;
+  double legacy =
+      NanosecondsPerCall([&]() { legacy_warnings += LegacyWarnings(sample); });
+  double compiled = NanosecondsPerCall([&]() {
+    compiled_warnings +=
+        CompiledWarnings(&collector, categories, 0.18, heuristics);
+  });
+  EXPECT_EQ(legacy_warnings, compiled_warnings);
+  ALOGI("Heuristics per GetAdvice: legacy %.0f ns, compiled %.0f ns (%.1fx)",
+        legacy, compiled, legacy / compiled);
+}
+
+}  // namespace memory_advice_test
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the latency and throughput of the calls that predict the available
+// memory, with predictions made on each call or reused while computed in the
+// background. Uses the model bundled with the library when the test runs in
+// an app, and otherwise a predictor simulating the cost of inference.
+//
+// Built into its own memory_advice_predictor_benchmark executable: it only
+// reports the timings, which depend on the device and its load.
+
+#include <core/memory_advice_impl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#define LOG_TAG "MemoryAdvice"
+#include "../providers/test_metrics_provider.h"
+#include "../providers/test_predictors.h"
+#include "Log.h"
+#include "gtest/gtest.h"
+#include "jni/jni_helper.h"
+
+namespace memory_advice_test {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+constexpr int kIterations = 500;
+constexpr auto kSimulatedInference = 500us;
+
+// Busy-waits for a typical inference time of the bundled model.
+class SimulatedPredictor : public memory_advice::IPredictor {
+ public:
+  std::vector<std::string> features = {"baseline/constant/MemoryInfo/totalMem",
+                                       "sample/MemoryInfo/availMemNorm",
+                                       "sample/proc/oom_score"};
+
+  MemoryAdvice_ErrorCode Init(std::string model_file,
+                              std::string features_file) override {
+    return MEMORYADVICE_ERROR_OK;
+  }
+  const std::vector<std::string>& Features() const override {
+    return features;
+  }
+  float Predict(const std::vector<float>& input) override {
+    auto end = Clock::now() + kSimulatedInference;
+    while (Clock::now() < end) {
+    }
+    return input[1];
+  }
+};
+
+struct Latencies {
+  double p50;
+  double p99;
+  double calls_per_second;
+};
+
+template <typename F>
+Latencies Measure(F f) {
+  std::vector<double> latencies;
+  latencies.reserve(kIterations);
+  auto start = Clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    auto call_start = Clock::now();
+    f();
+    latencies.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - call_start)
+            .count());
+  }
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  std::sort(latencies.begin(), latencies.end());
+  return {latencies[kIterations / 2], latencies[kIterations * 99 / 100],
+          kIterations / seconds};
+}
+
+}  // namespace
+
+TEST(PredictorBenchmark, GetAvailableMemory) {
+  TestMetricsProvider provider;
+  for (auto& category : provider.metrics_categories_) {
+    category.second.cost = memory_advice::IMetricsProvider::Cost::CHEAP;
+  }
+  provider.setTotalMem(4e9);
+  provider.setAvailMem(1e9);
+  provider.setOomScore(300);
+  // Without an app, there is no bundled model to load.
+  std::unique_ptr<SimulatedPredictor> simulated;
+  if (!gamesdk::jni::IsValid()) {
+    simulated = std::make_unique<SimulatedPredictor>();
+  }
+
+  for (int max_age : {0, 100}) {
+    memory_advice::MemoryAdviceImpl impl(ParametersWithMaxAge(max_age).c_str(),
+                                         &provider, nullptr, simulated.get());
+    ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+    impl.GetAvailableMemory();
+    Latencies results = Measure([&]() { impl.GetAvailableMemory(); });
+    ALOGI(
+        "GetAvailableMemory with predictions reused for %d ms: p50 %.1f us, "
+        "p99 %.1f us, %.0f calls/s",
+        max_age, results.p50, results.p99, results.calls_per_second);
+  }
+}
+
+}  // namespace memory_advice_test
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the latency and the heap allocations of the main Memory Advice
+// calls, replaying a trace of recorded metrics.
+//
+// This file replaces the global operator new and delete, so it is built into
+// its own memory_advice_replay_benchmark executable rather than the test
+// library linked into the test app.
+
+#include <core/memory_advice_impl.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#define LOG_TAG "MemoryAdvice"
+#include "../providers/trace_metrics_provider.h"
+#include "Log.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+// Only the allocations of the measured calls, on the benchmark thread, are
+// counted.
+thread_local bool count_allocations = false;
+thread_local int64_t allocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+  if (count_allocations) ++allocations;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) std::abort();
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+namespace memory_advice_test {
+
+extern const char* parameters_string;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kPasses = 5;
+
+struct Measurements {
+  std::vector<double> latencies;
+  int64_t allocations = 0;
+
+  double Percentile(int percentile) {
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[(latencies.size() - 1) * percentile / 100];
+  }
+};
+
+template <typename F>
+void Measure(Measurements* measurements, F f) {
+  allocations = 0;
+  count_allocations = true;
+  auto start = Clock::now();
+  f();
+  auto end = Clock::now();
+  count_allocations = false;
+  measurements->latencies.push_back(
+      std::chrono::duration<double, std::micro>(end - start).count());
+  measurements->allocations += allocations;
+}
+
+void Report(const char* call, Measurements& measurements) {
+  ALOGI(
+      "%s: p50 %.1f us, p90 %.1f us, p99 %.1f us, %.1f allocations per call",
+      call, measurements.Percentile(50), measurements.Percentile(90),
+      measurements.Percentile(99),
+      static_cast<double>(measurements.allocations) /
+          measurements.latencies.size());
+}
+
+}  // namespace
+
+TEST(ReplayBenchmark, MemoryAdviceCalls) {
+  Json::array trace = LoadTrace();
+  ASSERT_FALSE(trace.empty());
+  TraceMetricsProvider provider(trace);
+  TracePredictor predictor(provider);
+  memory_advice::MemoryAdviceImpl impl(
+      ReplayParameters(parameters_string).c_str(), &provider, nullptr,
+      &predictor);
+  ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+
+  Measurements memory_state, advice, available_memory;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    for (size_t i = 0; i < trace.size(); ++i) {
+      provider.Seek(i);
+      Measure(&memory_state, [&]() { impl.GetMemoryState(); });
+      Measure(&advice, [&]() { impl.GetAdvice(); });
+      Measure(&available_memory, [&]() { impl.GetAvailableMemory(); });
+    }
+  }
+  Report("GetMemoryState", memory_state);
+  Report("GetAdvice", advice);
+  Report("GetAvailableMemory", available_memory);
+
+  // The state only samples the metrics it needs
+  EXPECT_LT(memory_state.allocations, advice.allocations);
+}
+
+}  // namespace memory_advice_test
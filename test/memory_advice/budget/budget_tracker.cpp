@@ -0,0 +1,149 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <core/budget_tracker.h>
+#include <core/memory_advice_impl.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../providers/test_metrics_provider.h"
+#include "../providers/test_predictors.h"
+#include "gtest/gtest.h"
+
+namespace memory_advice_test {
+
+namespace {
+
+using memory_advice::BudgetTracker;
+
+}  // namespace
+
+TEST(BudgetTrackerTest, RegistersCategories) {
+  BudgetTracker tracker;
+  int32_t textures, audio, again;
+  EXPECT_EQ(tracker.Register("textures", 3, &textures), MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(tracker.Register("audio", 1, &audio), MEMORYADVICE_ERROR_OK);
+  EXPECT_NE(textures, audio);
+  EXPECT_EQ(tracker.Register("textures", 5, &again), MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(again, textures);
+  EXPECT_EQ(tracker.Register("meshes", 0, &again),
+            MEMORYADVICE_ERROR_BUDGET_INVALID);
+  EXPECT_EQ(tracker.Report(audio + 1, 10), MEMORYADVICE_ERROR_BUDGET_INVALID);
+
+  for (int i = 2; i < BudgetTracker::MAX_CATEGORIES; ++i) {
+    EXPECT_EQ(tracker.Register(std::to_string(i), 1, &again),
+              MEMORYADVICE_ERROR_OK);
+  }
+  EXPECT_EQ(tracker.Register("full", 1, &again),
+            MEMORYADVICE_ERROR_BUDGET_INVALID);
+}
+
+TEST(BudgetTrackerTest, CountsAllThreads) {
+  BudgetTracker tracker;
+  int32_t textures, audio;
+  tracker.Register("textures", 1, &textures);
+  tracker.Register("audio", 1, &audio);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = 0; i < 10000; ++i) {
+        tracker.Report(textures, 16);
+        if (i % 2 == 0) tracker.Report(textures, -16);
+      }
+      tracker.Report(audio, 100);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  // Memory freed on another thread than it was allocated on
+  tracker.Report(audio, -50);
+
+  std::vector<BudgetTracker::Category> categories;
+  std::vector<int64_t> used;
+  tracker.Usage(&categories, &used);
+  ASSERT_EQ(categories.size(), 2u);
+  EXPECT_EQ(categories[textures].name, "textures");
+  EXPECT_EQ(used[textures], 8 * 5000 * 16);
+  EXPECT_EQ(used[audio], 8 * 100 - 50);
+}
+
+TEST(BudgetTrackerTest, TrackersAreIndependent) {
+  int32_t id;
+  auto first = std::make_unique<BudgetTracker>();
+  first->Register("textures", 1, &id);
+  first->Report(id, 100);
+  first.reset();
+  // Possibly at the same address
+  BudgetTracker second;
+  second.Register("textures", 1, &id);
+  second.Report(id, 10);
+  std::vector<BudgetTracker::Category> categories;
+  std::vector<int64_t> used;
+  second.Usage(&categories, &used);
+  EXPECT_EQ(used[id], 10);
+}
+
+TEST(BudgetTrackerTest, HeadroomAndEviction) {
+  TestMetricsProvider provider;
+  AvailMemPredictor predictor;
+  for (auto& category : provider.metrics_categories_) {
+    category.second.cost = memory_advice::IMetricsProvider::Cost::CHEAP;
+  }
+  provider.setTotalMem(1000);
+  provider.setAvailMem(500);
+  memory_advice::MemoryAdviceImpl impl(SynchronousParameters().c_str(),
+                                       &provider, nullptr, &predictor);
+  ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+
+  int32_t textures, audio;
+  ASSERT_EQ(impl.RegisterBudget("textures", 3, &textures),
+            MEMORYADVICE_ERROR_OK);
+  ASSERT_EQ(impl.RegisterBudget("audio", 1, &audio), MEMORYADVICE_ERROR_OK);
+  impl.ReportAllocation(textures, 300);
+  impl.ReportAllocation(audio, 100);
+
+  // 900 bytes for the app, shared 3 to 1
+  MemoryAdvice_Budget budget;
+  ASSERT_EQ(impl.GetBudget(textures, &budget), MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(budget.used, 300);
+  EXPECT_EQ(budget.headroom, 375);
+  EXPECT_EQ(budget.evict, 0);
+  ASSERT_EQ(impl.GetBudget(audio, &budget), MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(budget.headroom, 125);
+  EXPECT_EQ(impl.GetBudget(audio + 1, &budget),
+            MEMORYADVICE_ERROR_BUDGET_INVALID);
+
+  // Approaching the limit, categories over budget free their excess
+  impl.ReportAllocation(audio, 200);
+  provider.setAvailMem(180);
+  ASSERT_EQ(impl.GetBudget(audio, &budget), MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(budget.headroom, 780 / 4 - 300);
+  EXPECT_EQ(budget.evict, 105);
+  ASSERT_EQ(impl.GetBudget(textures, &budget), MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(budget.evict, 0);
+
+  // Critical below 150 bytes available: the 50 missing bytes are freed in
+  // proportion to the usage
+  impl.ReportAllocation(audio, -200);
+  provider.setAvailMem(100);
+  ASSERT_EQ(impl.GetBudget(textures, &budget), MEMORYADVICE_ERROR_OK);
+  EXPECT_NEAR(budget.evict, 38, 1);
+  ASSERT_EQ(impl.GetBudget(audio, &budget), MEMORYADVICE_ERROR_OK);
+  EXPECT_NEAR(budget.evict, 13, 1);
+}
+
+}  // namespace memory_advice_test
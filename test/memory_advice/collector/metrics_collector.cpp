@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <core/metrics_collector.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../providers/test_metrics_provider.h"
+#include "gtest/gtest.h"
+
+namespace memory_advice_test {
+
+namespace {
+
+using memory_advice::MetricsCollector;
+using namespace std::chrono_literals;
+
+constexpr std::chrono::milliseconds kExpensiveLatency = 20ms;
+
+class SlowMetricsProvider : public TestMetricsProvider {
+ public:
+  std::atomic<int> memory_info_reads{0};
+
+  SlowMetricsProvider() { setExpensiveLatency(kExpensiveLatency); }
+
+  Json::object GetActivityManagerMemoryInfo() override {
+    ++memory_info_reads;
+    return TestMetricsProvider::GetActivityManagerMemoryInfo();
+  }
+};
+
+std::chrono::nanoseconds MaxAge(const SlowMetricsProvider& provider,
+                                const std::string& category) {
+  return provider.metrics_categories_.at(category).max_age;
+}
+
+}  // namespace
+
+TEST(MetricsCollectorTest, CheapCategoriesAreAlwaysRead) {
+  SlowMetricsProvider provider;
+  MetricsCollector collector(&provider);
+  provider.setOomScore(100);
+  EXPECT_EQ(collector.Get("proc")["oom_score"].number_value(), 100);
+  provider.setOomScore(200);
+  EXPECT_EQ(collector.Get("proc")["oom_score"].number_value(), 200);
+}
+
+TEST(MetricsCollectorTest, FrequentReadsDontWaitForExpensiveCategories) {
+  SlowMetricsProvider provider;
+  MetricsCollector collector(&provider);
+  provider.setAvailMem(100);
+  collector.Get("MemoryInfo");
+
+  // Sample every frame: after the first read, values come from the cache
+  // and are kept fresh in the background.
+  auto max_latency = std::chrono::nanoseconds(0);
+  auto max_age = std::chrono::nanoseconds(0);
+  double avail_mem = 0;
+  for (int frame = 0; frame < 60; ++frame) {
+    if (frame == 20) provider.setAvailMem(200);
+    auto start = MetricsCollector::Clock::now();
+    MetricsCollector::Clock::time_point time;
+    avail_mem = collector.Get("MemoryInfo", &time)["availMem"].number_value();
+    auto end = MetricsCollector::Clock::now();
+    max_latency = std::max<std::chrono::nanoseconds>(max_latency, end - start);
+    max_age = std::max<std::chrono::nanoseconds>(max_age, end - time);
+    std::this_thread::sleep_for(16ms);
+  }
+  EXPECT_LT(max_latency, kExpensiveLatency);
+  EXPECT_LE(max_age, MaxAge(provider, "MemoryInfo") + kExpensiveLatency);
+  EXPECT_EQ(avail_mem, 200);
+}
+
+TEST(MetricsCollectorTest, IdleCategoriesAreNotRefreshed) {
+  SlowMetricsProvider provider;
+  MetricsCollector collector(&provider);
+  collector.Get("MemoryInfo");
+  std::this_thread::sleep_for(MaxAge(provider, "MemoryInfo") *
+                              (MetricsCollector::IDLE_PERIODS + 1));
+  int reads = provider.memory_info_reads;
+  EXPECT_LE(reads, 1 + 2 * MetricsCollector::IDLE_PERIODS);
+  std::this_thread::sleep_for(MaxAge(provider, "MemoryInfo") * 4);
+  EXPECT_EQ(provider.memory_info_reads, reads);
+
+  // Infrequent reads are synchronous, so they get fresh values
+  provider.setAvailMem(300);
+  EXPECT_EQ(collector.Get("MemoryInfo")["availMem"].number_value(), 300);
+}
+
+TEST(MetricsCollectorTest, ReadBypassesTheCache) {
+  SlowMetricsProvider provider;
+  MetricsCollector collector(&provider);
+  provider.setAvailMem(100);
+  collector.Get("MemoryInfo");
+  provider.setAvailMem(200);
+  EXPECT_EQ(collector.Read("MemoryInfo")["availMem"].number_value(), 200);
+}
+
+}  // namespace memory_advice_test
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <core/memory_advice_impl.h>
+#include <core/memory_forecast.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "../providers/test_metrics_provider.h"
+#include "../providers/test_predictors.h"
+#include "gtest/gtest.h"
+
+namespace memory_advice_test {
+
+namespace {
+
+using memory_advice::MemoryForecast;
+using namespace std::chrono_literals;
+
+}  // namespace
+
+TEST(MemoryForecastTest, FitsLinearTrend) {
+  MemoryForecast forecast(0.001);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(forecast.Valid(), i >= MemoryForecast::MIN_SAMPLES);
+    forecast.Add(i, 1.0 - 0.01 * i);
+  }
+  EXPECT_NEAR(forecast.Slope(), -0.01, 1e-9);
+  EXPECT_NEAR(forecast.ValueAt(20), 0.8, 1e-9);
+}
+
+TEST(MemoryForecastTest, SpikesAreClipped) {
+  MemoryForecast forecast(0.001);
+  for (int i = 0; i < 20; ++i) {
+    double noise = (i % 2 == 0 ? 0.002 : -0.002);
+    double spike = i == 10 ? 0.5 : 0.0;
+    forecast.Add(i, 1.0 - 0.01 * i + noise + spike);
+  }
+  // Least squares without clipping would estimate a slope of about -0.0025
+  EXPECT_NEAR(forecast.Slope(), -0.01, 0.001);
+}
+
+TEST(MemoryForecastTest, HistoryIsBounded) {
+  MemoryForecast forecast(0.001);
+  // Seconds of uptime, far from 0
+  double start = 1e6;
+  for (int i = 0; i < 1000; ++i) {
+    double slope = i < 500 ? 0.001 : -0.002;
+    double value = i < 500 ? 0.5 + slope * i : 1.0 + slope * (i - 500);
+    forecast.Add(start + i * 0.1, value);
+  }
+  EXPECT_EQ(forecast.Size(), MemoryForecast::CAPACITY);
+  EXPECT_NEAR(forecast.Slope(), -0.02, 1e-6);
+  EXPECT_NEAR(forecast.ValueAt(start + 99.9), 1.0 - 0.002 * 499, 1e-6);
+}
+
+TEST(MemoryForecastTest, TimeToCritical) {
+  TestMetricsProvider provider;
+  AvailMemPredictor predictor;
+  for (auto& category : provider.metrics_categories_) {
+    category.second.cost = memory_advice::IMetricsProvider::Cost::CHEAP;
+  }
+  provider.setTotalMem(1000);
+  provider.setAvailMem(400);
+  memory_advice::MemoryAdviceImpl impl(SynchronousParameters().c_str(),
+                                       &provider, nullptr, &predictor);
+  ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+
+  MemoryAdvice_Forecast forecast;
+  EXPECT_EQ(impl.GetForecast(&forecast),
+            MEMORYADVICE_ERROR_FORECAST_UNAVAILABLE);
+
+  // Allocate 10 bytes per sample
+  double avail_mem = 400;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 1; i <= 8; ++i) {
+    std::this_thread::sleep_for(110ms);
+    avail_mem -= 10;
+    provider.setAvailMem(avail_mem);
+    impl.GetMemoryState();
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  ASSERT_EQ(impl.GetForecast(&forecast), MEMORYADVICE_ERROR_OK);
+  EXPECT_GT(forecast.allocationRate, 70 / seconds);
+  EXPECT_LT(forecast.allocationRate, 100 / 0.88);
+  // The default parameters are critical below 15% available
+  EXPECT_NEAR(forecast.timeToCritical,
+              (avail_mem - 150) / forecast.allocationRate,
+              0.01 * forecast.timeToCritical);
+
+  // Freeing memory
+  for (int i = 0; i < 8; ++i) {
+    std::this_thread::sleep_for(110ms);
+    avail_mem += 20;
+    provider.setAvailMem(avail_mem);
+    impl.GetMemoryState();
+  }
+  ASSERT_EQ(impl.GetForecast(&forecast), MEMORYADVICE_ERROR_OK);
+  EXPECT_LT(forecast.allocationRate, 0);
+  EXPECT_LT(forecast.timeToCritical, 0);
+
+  provider.setAvailMem(100);
+  ASSERT_EQ(impl.GetForecast(&forecast), MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(forecast.timeToCritical, 0);
+}
+
+}  // namespace memory_advice_test
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <core/formula.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace memory_advice_test {
+
+using memory_advice::Formula;
+
+double Evaluate(const std::string& text, const std::vector<double>& values,
+                std::vector<std::string>* names) {
+  Formula formula;
+  std::string error;
+  EXPECT_TRUE(formula.Compile(text, names, &error)) << error;
+  return formula.Evaluate(values.data());
+}
+
+TEST(FormulaTest, Precedence) {
+  std::vector<std::string> names;
+  EXPECT_EQ(Evaluate("1 + 2 * 3", {}, &names), 7.0);
+  EXPECT_EQ(Evaluate("(1 + 2) * 3", {}, &names), 9.0);
+  EXPECT_EQ(Evaluate("10 - 4 - 3", {}, &names), 3.0);
+  EXPECT_EQ(Evaluate("12 / 3 / 2", {}, &names), 2.0);
+  EXPECT_EQ(Evaluate("-2 * -(1 + 2)", {}, &names), 6.0);
+  EXPECT_EQ(Evaluate("1.5e2 + .5", {}, &names), 150.5);
+  EXPECT_TRUE(names.empty());
+}
+
+TEST(FormulaTest, Comparisons) {
+  std::vector<std::string> names;
+  EXPECT_EQ(Evaluate("1 + 1 < 3", {}, &names), 1.0);
+  EXPECT_EQ(Evaluate("1 + 1 > 3", {}, &names), 0.0);
+  EXPECT_EQ(Evaluate("2 <= 2", {}, &names), 1.0);
+  EXPECT_EQ(Evaluate("2 >= 3", {}, &names), 0.0);
+}
+
+TEST(FormulaTest, MetricsResolveToSlots) {
+  std::vector<std::string> names = {"oom_score"};
+  Formula available;
+  Formula oom;
+  std::string error;
+  ASSERT_TRUE(
+      available.Compile("availMem / totalMem < 0.1", &names, &error));
+  ASSERT_TRUE(oom.Compile("oom_score > availMem", &names, &error));
+  ASSERT_EQ(names,
+            std::vector<std::string>({"oom_score", "availMem", "totalMem"}));
+  EXPECT_TRUE(available.IsComparison());
+
+  std::vector<double> values = {900, 50, 1000};
+  EXPECT_EQ(available.Evaluate(values.data()), 1.0);
+  EXPECT_EQ(oom.Evaluate(values.data()), 1.0);
+  values[1] = 500;
+  EXPECT_EQ(available.Evaluate(values.data()), 0.0);
+}
+
+TEST(FormulaTest, RejectsInvalidFormulas) {
+  std::vector<std::string> names = {"a"};
+  Formula formula;
+  std::string error;
+  for (const char* text : {"", "1 +", "(1 + 2", "1 2", "a < b < c", "a $ b",
+                           "< 1"}) {
+    error.clear();
+    EXPECT_FALSE(formula.Compile(text, &names, &error)) << text;
+    EXPECT_FALSE(error.empty()) << text;
+  }
+  // Failed compilations don't register metrics
+  EXPECT_EQ(names, std::vector<std::string>({"a"}));
+
+  // 1+(1+(1+...)) needs one stack slot per nesting level
+  std::string nested;
+  for (int i = 0; i < Formula::MAX_STACK_DEPTH; ++i) nested += "1+(";
+  nested += "1" + std::string(Formula::MAX_STACK_DEPTH, ')');
+  EXPECT_FALSE(formula.Compile(nested, &names, &error));
+}
+
+TEST(FormulaTest, NotAComparison) {
+  std::vector<std::string> names;
+  Formula formula;
+  std::string error;
+  ASSERT_TRUE(formula.Compile("predictedAvailable * 2", &names, &error));
+  EXPECT_FALSE(formula.IsComparison());
+  std::vector<double> values = {0.25};
+  EXPECT_EQ(formula.Evaluate(values.data()), 0.5);
+}
+
+}  // namespace memory_advice_test
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <core/async_predictor.h>
+#include <core/memory_advice_impl.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "../providers/test_metrics_provider.h"
+#include "../providers/test_predictors.h"
+#include "gtest/gtest.h"
+
+namespace memory_advice_test {
+
+namespace {
+
+using memory_advice::AsyncPredictor;
+using namespace std::chrono_literals;
+
+class AsyncPredictionTest : public ::testing::Test {
+ protected:
+  TestMetricsProvider provider;
+  CountingPredictor predictor;
+
+  void SetUp() override {
+    for (auto& category : provider.metrics_categories_) {
+      category.second.cost = memory_advice::IMetricsProvider::Cost::CHEAP;
+    }
+    provider.setTotalMem(1000);
+    provider.setAvailMem(500);
+  }
+};
+
+// Counts the predictions made on the thread that created it.
+class CallerThreadPredictor : public CountingPredictor {
+ public:
+  std::thread::id caller = std::this_thread::get_id();
+  std::atomic<int> caller_predictions{0};
+
+  float Predict(const std::vector<float>& input) override {
+    if (std::this_thread::get_id() == caller) ++caller_predictions;
+    return CountingPredictor::Predict(input);
+  }
+};
+
+}  // namespace
+
+TEST_F(AsyncPredictionTest, RecentPredictionsAreReused) {
+  memory_advice::MemoryAdviceImpl impl(ParametersWithMaxAge(10000).c_str(),
+                                       &provider, nullptr, &predictor);
+  ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+  // The first prediction is synchronous
+  EXPECT_FLOAT_EQ(impl.GetPercentageAvailableMemory(), 50);
+  EXPECT_EQ(predictor.predictions, 1);
+
+  // The next ones are computed in the background
+  provider.setAvailMem(100);
+  EXPECT_FLOAT_EQ(impl.GetPercentageAvailableMemory(), 50);
+  while (predictor.predictions < 2) std::this_thread::sleep_for(1ms);
+  std::this_thread::sleep_for(10ms);
+  EXPECT_FLOAT_EQ(impl.GetPercentageAvailableMemory(), 10);
+  EXPECT_EQ(impl.GetMemoryState(), MEMORYADVICE_STATE_CRITICAL);
+}
+
+TEST_F(AsyncPredictionTest, StalePredictionsAreRecomputed) {
+  memory_advice::MemoryAdviceImpl impl(ParametersWithMaxAge(0).c_str(),
+                                       &provider, nullptr, &predictor);
+  ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+  EXPECT_FLOAT_EQ(impl.GetPercentageAvailableMemory(), 50);
+  std::this_thread::sleep_for(1ms);
+  provider.setAvailMem(100);
+  EXPECT_FLOAT_EQ(impl.GetPercentageAvailableMemory(), 10);
+  EXPECT_EQ(predictor.predictions, 2);
+}
+
+TEST_F(AsyncPredictionTest, ReusedPredictionsAreNotMadeByTheCaller) {
+  CallerThreadPredictor caller_predictor;
+  memory_advice::MemoryAdviceImpl impl(ParametersWithMaxAge(10000).c_str(),
+                                       &provider, nullptr, &caller_predictor);
+  ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+  for (int i = 0; i < 100; ++i) impl.GetAvailableMemory();
+  // Only the first call waits for a prediction
+  EXPECT_EQ(caller_predictor.caller_predictions, 1);
+  EXPECT_LE(caller_predictor.predictions, 100);
+}
+
+TEST(AsyncPredictorTest, OlderPredictionsAreNotPublished) {
+  CountingPredictor predictor;
+  AsyncPredictor async_predictor(&predictor);
+  EXPECT_EQ(async_predictor.Latest(), nullptr);
+  auto now = AsyncPredictor::Clock::now();
+  async_predictor.Predict({0.5f}, now);
+  EXPECT_FLOAT_EQ(async_predictor.Predict({0.2f}, now - 1s)->value, 0.2f);
+  EXPECT_FLOAT_EQ(async_predictor.Latest()->value, 0.5f);
+  EXPECT_EQ(async_predictor.Latest()->time, now);
+}
+
+TEST(AsyncPredictorTest, PendingFeaturesAreReplaced) {
+  CountingPredictor predictor;
+  AsyncPredictor async_predictor(&predictor);
+  auto now = AsyncPredictor::Clock::now();
+  for (int i = 1; i <= 100; ++i) {
+    async_predictor.Submit({i / 100.0f}, now + i * 1ms);
+  }
+  auto deadline = now + 1s;
+  std::shared_ptr<const memory_advice::Prediction> latest;
+  while ((latest = async_predictor.Latest()) == nullptr ||
+         latest->value != 1.0f) {
+    ASSERT_LT(AsyncPredictor::Clock::now(), deadline);
+    std::this_thread::sleep_for(1ms);
+  }
+  EXPECT_EQ(latest->time, now + 100ms);
+  EXPECT_LE(predictor.predictions, 100);
+}
+
+}  // namespace memory_advice_test
@@ -18,25 +18,37 @@
 
 #include <core/metrics_provider.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 using namespace json11;
 
 namespace memory_advice_test {
 
 class TestMetricsProvider : public memory_advice::IMetricsProvider {
-  double oom_score_ = 0;
-  double avail_mem_ = 0;
-  double swap_total_ = 0;
-  double total_mem_ = 0;
+  std::atomic<double> oom_score_{0};
+  std::atomic<double> avail_mem_{0};
+  std::atomic<double> swap_total_{0};
+  std::atomic<double> total_mem_{0};
+  std::chrono::milliseconds expensive_latency_{0};
+
+  // Simulates the cost of reading an expensive category.
+  void ExpensiveRead() { std::this_thread::sleep_for(expensive_latency_); }
 
  public:
   void setOomScore(double oom_score) { oom_score_ = oom_score; }
   void setSwapTotal(double swap_total) { swap_total_ = swap_total; }
   void setAvailMem(double avail_mem) { avail_mem_ = avail_mem; }
   void setTotalMem(double total_mem) { total_mem_ = total_mem; }
+  // Set before reading metrics.
+  void setExpensiveLatency(std::chrono::milliseconds latency) {
+    expensive_latency_ = latency;
+  }
 
   Json::object GetMeminfoValues() override {
     Json::object metrics_map;
-    metrics_map["SwapTotal"] = swap_total_;
+    metrics_map["SwapTotal"] = swap_total_.load();
     return metrics_map;
   }
 
@@ -47,23 +59,26 @@ class TestMetricsProvider : public memory_advice::IMetricsProvider {
 
   Json::object GetProcValues() override {
     Json::object metrics_map;
-    metrics_map["oom_score"] = oom_score_;
+    metrics_map["oom_score"] = oom_score_.load();
     return metrics_map;
   }
 
   Json::object GetActivityManagerValues() override {
+    ExpensiveRead();
     Json::object metrics_map;
     return metrics_map;
   }
 
   Json::object GetActivityManagerMemoryInfo() override {
+    ExpensiveRead();
     Json::object metrics_map;
-    metrics_map["availMem"] = avail_mem_;
-    metrics_map["totalMem"] = total_mem_;
+    metrics_map["availMem"] = avail_mem_.load();
+    metrics_map["totalMem"] = total_mem_.load();
     return metrics_map;
   }
 
   Json::object GetDebugValues() override {
+    ExpensiveRead();
     Json::object metrics_map;
     return metrics_map;
   }
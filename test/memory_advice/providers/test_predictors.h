@@ -0,0 +1,70 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <core/predictor.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "json11/json11.hpp"
+
+using namespace json11;
+
+namespace memory_advice_test {
+
+extern const char* parameters_string;
+
+// Predicts the available memory as the normalized availMem.
+class AvailMemPredictor : public memory_advice::IPredictor {
+ public:
+  std::vector<std::string> features = {"sample/MemoryInfo/availMemNorm"};
+
+  MemoryAdvice_ErrorCode Init(std::string model_file,
+                              std::string features_file) override {
+    return MEMORYADVICE_ERROR_OK;
+  }
+  const std::vector<std::string>& Features() const override {
+    return features;
+  }
+  float Predict(const std::vector<float>& input) override { return input[0]; }
+};
+
+// Predicts the normalized availMem, counting the predictions.
+class CountingPredictor : public AvailMemPredictor {
+ public:
+  std::atomic<int> predictions{0};
+
+  float Predict(const std::vector<float>& input) override {
+    ++predictions;
+    return AvailMemPredictor::Predict(input);
+  }
+};
+
+// The advisor parameters, with predictions reused for max_age milliseconds.
+inline std::string ParametersWithMaxAge(int max_age) {
+  std::string err;
+  Json::object parameters = Json::parse(parameters_string, err).object_items();
+  parameters["predictor"] = Json::object{{"maxAge", max_age}};
+  return Json(parameters).dump();
+}
+
+// The advisor parameters, with predictions made on every sample.
+inline std::string SynchronousParameters() { return ParametersWithMaxAge(0); }
+
+}  // namespace memory_advice_test
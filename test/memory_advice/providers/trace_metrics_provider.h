@@ -0,0 +1,130 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <core/metrics_provider.h>
+#include <core/predictor.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json11/json11.hpp"
+
+using namespace json11;
+
+namespace memory_advice_test {
+
+// Generated from replay/traces/level_loading.json.
+extern const char* level_loading_trace;
+
+// Loads a trace: a JSON array of the results of MemoryAdvice_getAdvice,
+// recorded in order. The file named by the MEMORY_ADVICE_TRACE environment
+// variable is loaded if set, and the bundled trace otherwise.
+inline Json::array LoadTrace() {
+  std::string text = level_loading_trace;
+  const char* path = std::getenv("MEMORY_ADVICE_TRACE");
+  if (path != nullptr) {
+    std::ifstream file(path);
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    text = buffer.str();
+  }
+  std::string err;
+  return Json::parse(text, err).array_items();
+}
+
+// Returns the memory state that a recorded advice corresponds to.
+inline MemoryAdvice_MemoryState RecordedState(const Json& advice) {
+  MemoryAdvice_MemoryState state = MEMORYADVICE_STATE_OK;
+  for (const Json& warning : advice["warnings"].array_items()) {
+    if (warning["level"].string_value() == "red") {
+      return MEMORYADVICE_STATE_CRITICAL;
+    }
+    state = MEMORYADVICE_STATE_APPROACHING_LIMIT;
+  }
+  return state;
+}
+
+// Serves the metrics of a trace, one recorded advice at a time. All the
+// categories are cheap, so that every sample reads the current advice.
+class TraceMetricsProvider : public memory_advice::IMetricsProvider {
+  const Json::array& trace_;
+  size_t index_ = 0;
+
+  Json::object Category(const std::string& name) const {
+    return trace_[index_]["metrics"][name].object_items();
+  }
+
+ public:
+  explicit TraceMetricsProvider(const Json::array& trace) : trace_(trace) {
+    for (auto& category : metrics_categories_) {
+      category.second.cost = Cost::CHEAP;
+    }
+  }
+
+  void Seek(size_t index) { index_ = index; }
+  const Json& Current() const { return trace_[index_]; }
+
+  Json::object GetMeminfoValues() override { return Category("meminfo"); }
+  Json::object GetStatusValues() override { return Category("status"); }
+  Json::object GetProcValues() override { return Category("proc"); }
+  Json::object GetActivityManagerValues() override {
+    return Category("ActivityManager");
+  }
+  Json::object GetActivityManagerMemoryInfo() override {
+    return Category("MemoryInfo");
+  }
+  Json::object GetDebugValues() override { return Category("debug"); }
+};
+
+// Replays the predictions of the available memory recorded in a trace. The
+// model is fed the recorded metrics, so that they are sampled as they would
+// be by the bundled model.
+class TracePredictor : public memory_advice::IPredictor {
+  const TraceMetricsProvider& provider_;
+  std::vector<std::string> features_ = {"sample/MemoryInfo/availMemNorm",
+                                        "sample/proc/oom_score"};
+
+ public:
+  explicit TracePredictor(const TraceMetricsProvider& provider)
+      : provider_(provider) {}
+
+  MemoryAdvice_ErrorCode Init(std::string model_file,
+                              std::string features_file) override {
+    return MEMORYADVICE_ERROR_OK;
+  }
+  const std::vector<std::string>& Features() const override {
+    return features_;
+  }
+  float Predict(const std::vector<float>& features) override {
+    return provider_.Current()["metrics"]["predictedAvailable"].number_value();
+  }
+};
+
+// The advisor parameters, with predictions made on every sample so that
+// replays are deterministic.
+inline std::string ReplayParameters(const char* parameters) {
+  std::string err;
+  Json::object object = Json::parse(parameters, err).object_items();
+  object["predictor"] = Json::object{{"maxAge", 0}};
+  return Json(object).dump();
+}
+
+}  // namespace memory_advice_test
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays traces of recorded advice, checking that Memory Advice reaches the
+// recorded memory states.
+
+#include <core/memory_advice_impl.h>
+
+#include <string>
+
+#include "../providers/trace_metrics_provider.h"
+#include "gtest/gtest.h"
+
+namespace memory_advice_test {
+
+extern const char* parameters_string;
+
+TEST(ReplayTest, StateTransitionsMatchTrace) {
+  Json::array trace = LoadTrace();
+  ASSERT_FALSE(trace.empty());
+  TraceMetricsProvider provider(trace);
+  TracePredictor predictor(provider);
+  memory_advice::MemoryAdviceImpl impl(
+      ReplayParameters(parameters_string).c_str(), &provider, nullptr,
+      &predictor);
+  ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+
+  MemoryAdvice_MemoryState recorded_state = MEMORYADVICE_STATE_UNKNOWN;
+  MemoryAdvice_MemoryState replayed_state = MEMORYADVICE_STATE_UNKNOWN;
+  int recorded_transitions = 0;
+  int replayed_transitions = 0;
+  for (size_t i = 0; i < trace.size(); ++i) {
+    provider.Seek(i);
+    MemoryAdvice_MemoryState recorded = RecordedState(trace[i]);
+    MemoryAdvice_MemoryState replayed = impl.GetMemoryState();
+    EXPECT_EQ(replayed, recorded) << "sample " << i;
+    if (recorded != recorded_state) ++recorded_transitions;
+    if (replayed != replayed_state) ++replayed_transitions;
+    recorded_state = recorded;
+    replayed_state = replayed;
+
+    // GetAdvice agrees with GetMemoryState
+    EXPECT_EQ(RecordedState(impl.GetAdvice()), replayed) << "sample " << i;
+  }
+  EXPECT_EQ(replayed_transitions, recorded_transitions);
+  EXPECT_GT(recorded_transitions, 2);
+}
+
+}  // namespace memory_advice_test
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <core/memory_advice_impl.h>
+#include <core/metrics_snapshot.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../providers/test_metrics_provider.h"
+#include "../providers/test_predictors.h"
+#include "gtest/gtest.h"
+#include "json11/json11.hpp"
+
+namespace memory_advice_test {
+
+namespace {
+
+using memory_advice::MetricsCollector;
+using memory_advice::MetricsSchema;
+using memory_advice::MetricsSnapshot;
+
+// Counts the requests made for each category. Nothing is cached, so that
+// every sample reaches the provider.
+class CountingMetricsProvider : public TestMetricsProvider {
+ public:
+  std::map<std::string, int> requests;
+
+  CountingMetricsProvider() {
+    for (auto& category : metrics_categories_) {
+      category.second.cost = Cost::CHEAP;
+    }
+  }
+
+  Json::object GetMeminfoValues() override {
+    ++requests["meminfo"];
+    return TestMetricsProvider::GetMeminfoValues();
+  }
+  Json::object GetProcValues() override {
+    ++requests["proc"];
+    return TestMetricsProvider::GetProcValues();
+  }
+  Json::object GetActivityManagerMemoryInfo() override {
+    ++requests["MemoryInfo"];
+    return TestMetricsProvider::GetActivityManagerMemoryInfo();
+  }
+  Json::object GetDebugValues() override {
+    ++requests["debug"];
+    return TestMetricsProvider::GetDebugValues();
+  }
+};
+
+// Predicts the available memory as the normalized availMem feature.
+class FeaturePredictor : public memory_advice::IPredictor {
+ public:
+  std::vector<std::string> features = {"baseline/constant/MemoryInfo/totalMem",
+                                       "sample/MemoryInfo/availMemNorm",
+                                       "sample/proc/oom_score"};
+  std::vector<float> last_input;
+
+  MemoryAdvice_ErrorCode Init(std::string model_file,
+                              std::string features_file) override {
+    return MEMORYADVICE_ERROR_OK;
+  }
+  const std::vector<std::string>& Features() const override {
+    return features;
+  }
+  float Predict(const std::vector<float>& input) override {
+    last_input = input;
+    return input[1];
+  }
+};
+
+}  // namespace
+
+TEST(MetricsSnapshotTest, CollectsOnlySchemaMetrics) {
+  CountingMetricsProvider provider;
+  provider.setOomScore(500);
+  provider.setAvailMem(100);
+  MetricsSchema schema;
+  int oom = schema.Add("proc", "oom_score");
+  int avail = schema.Add("MemoryInfo", "availMem");
+  EXPECT_EQ(schema.Add("proc", "oom_score"), oom);
+  EXPECT_EQ(schema.Find("proc", "missing"), MetricsSchema::NOT_FOUND);
+  ASSERT_EQ(schema.Size(), 2u);
+
+  MetricsCollector collector(&provider);
+  MetricsSnapshot snapshot;
+  schema.Allocate(&snapshot);
+  schema.Collect(&collector, nullptr, &snapshot);
+  EXPECT_EQ(snapshot.values[oom], 500);
+  EXPECT_EQ(snapshot.values[avail], 100);
+  EXPECT_GT(snapshot.time, 0);
+  EXPECT_EQ(provider.requests,
+            (std::map<std::string, int>{{"MemoryInfo", 1}, {"proc", 1}}));
+
+  // Categories already collected are not requested again
+  Json::object collected = {{"proc", Json::object{{"oom_score", 42}}}};
+  schema.Collect(&collector, &collected, &snapshot);
+  EXPECT_EQ(snapshot.values[oom], 42);
+  EXPECT_EQ(provider.requests["proc"], 1);
+  EXPECT_EQ(provider.requests["MemoryInfo"], 2);
+}
+
+TEST(MetricsSnapshotTest, MemoryStateMatchesAdvice) {
+  CountingMetricsProvider provider;
+  FeaturePredictor predictor;
+  provider.setOomScore(500);
+  provider.setTotalMem(1000);
+  memory_advice::MemoryAdviceImpl impl(SynchronousParameters().c_str(),
+                                       &provider, nullptr, &predictor);
+  ASSERT_EQ(impl.InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+
+  struct Case {
+    double avail_mem;
+    MemoryAdvice_MemoryState state;
+    size_t warnings;
+  };
+  for (const Case& c : {Case{500, MEMORYADVICE_STATE_OK, 0},
+                        Case{180, MEMORYADVICE_STATE_APPROACHING_LIMIT, 1},
+                        Case{100, MEMORYADVICE_STATE_CRITICAL, 2}}) {
+    provider.setAvailMem(c.avail_mem);
+    provider.requests.clear();
+    EXPECT_EQ(impl.GetMemoryState(), c.state) << c.avail_mem;
+    // Only the categories read by the model are collected
+    EXPECT_EQ(provider.requests,
+              (std::map<std::string, int>{{"MemoryInfo", 1}, {"proc", 1}}));
+    EXPECT_EQ(predictor.last_input,
+              (std::vector<float>{
+                  1000, static_cast<float>(c.avail_mem / 1000), 500}));
+    EXPECT_FLOAT_EQ(impl.GetPercentageAvailableMemory(), c.avail_mem / 10);
+
+    Json::object advice = impl.GetAdvice();
+    EXPECT_EQ(advice["warnings"].array_items().size(), c.warnings);
+    EXPECT_FLOAT_EQ(advice["metrics"]["predictedAvailable"].number_value(),
+                    c.avail_mem / 1000);
+  }
+}
+
+}  // namespace memory_advice_test
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <core/memory_advice_impl.h>
+#include <core/state_watcher.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../providers/test_metrics_provider.h"
+#include "../providers/test_predictors.h"
+#include "gtest/gtest.h"
+
+namespace memory_advice_test {
+
+extern const char* parameters_string;
+
+namespace {
+
+using memory_advice::StateWatcher;
+using namespace std::chrono_literals;
+
+struct Notifications {
+  std::atomic<int> count{0};
+  std::atomic<int> last_state{MEMORYADVICE_STATE_UNKNOWN};
+  std::atomic<int64_t> last_time{0};
+};
+
+void Notify(MemoryAdvice_MemoryState state, void* user_data) {
+  auto notifications = static_cast<Notifications*>(user_data);
+  ++notifications->count;
+  notifications->last_state = state;
+  notifications->last_time =
+      StateWatcher::Clock::now().time_since_epoch().count();
+}
+
+void NotifyOther(MemoryAdvice_MemoryState state, void* user_data) {
+  Notify(state, user_data);
+}
+
+class StateWatcherTest : public ::testing::Test {
+ protected:
+  TestMetricsProvider provider;
+  AvailMemPredictor predictor;
+  std::unique_ptr<memory_advice::MemoryAdviceImpl> impl;
+
+  void SetUp() override {
+    // Cheap metrics, so that evaluations don't wait for the cache.
+    for (auto& category : provider.metrics_categories_) {
+      category.second.cost = memory_advice::IMetricsProvider::Cost::CHEAP;
+    }
+    provider.setTotalMem(1000);
+    provider.setAvailMem(500);
+    impl = std::make_unique<memory_advice::MemoryAdviceImpl>(
+        parameters_string, &provider, nullptr, &predictor);
+    ASSERT_EQ(impl->InitializationErrorCode(), MEMORYADVICE_ERROR_OK);
+  }
+};
+
+}  // namespace
+
+TEST_F(StateWatcherTest, EvaluationsAreShared) {
+  provider.setAvailMem(100);
+  StateWatcher watcher(impl.get(), nullptr);
+  Notifications notifications[3];
+  for (auto& n : notifications) watcher.Register(Notify, &n, 20ms);
+  std::this_thread::sleep_for(210ms);
+  watcher.Unregister(Notify);
+
+  for (auto& n : notifications) {
+    EXPECT_GE(n.count, 5);
+    EXPECT_LE(n.count, 11);
+    EXPECT_EQ(n.last_state, MEMORYADVICE_STATE_CRITICAL);
+  }
+  // One evaluation for all the watchers
+  EXPECT_LE(watcher.Evaluations(), 11);
+}
+
+TEST_F(StateWatcherTest, HealthyMemoryIsPolledLessOften) {
+  StateWatcher watcher(impl.get(), nullptr);
+  Notifications notifications;
+  watcher.Register(Notify, &notifications, 10ms);
+  std::this_thread::sleep_for(300ms);
+  watcher.Unregister(Notify);
+
+  EXPECT_FALSE(watcher.PressureEventsEnabled());
+  EXPECT_EQ(notifications.count, 0);
+  EXPECT_GE(watcher.Evaluations(), 300 / (10 * StateWatcher::MAX_BACKOFF));
+  EXPECT_LE(watcher.Evaluations(), 300 / 10 / 2);
+}
+
+TEST_F(StateWatcherTest, WorseStateIsNotifiedImmediately) {
+  constexpr auto kInterval = 200ms;
+  provider.setAvailMem(180);
+  StateWatcher watcher(impl.get(), nullptr);
+  Notifications notifications;
+  watcher.Register(Notify, &notifications, kInterval);
+  while (notifications.count == 0) std::this_thread::sleep_for(1ms);
+  EXPECT_EQ(notifications.last_state, MEMORYADVICE_STATE_APPROACHING_LIMIT);
+
+  provider.setAvailMem(100);
+  while (notifications.last_state != MEMORYADVICE_STATE_CRITICAL) {
+    std::this_thread::sleep_for(1ms);
+  }
+  watcher.Unregister(Notify);
+  EXPECT_EQ(notifications.count, 2);
+}
+
+TEST_F(StateWatcherTest, UnregisteredWatchersAreNotNotified) {
+  provider.setAvailMem(100);
+  Notifications notifications, other_notifications;
+  EXPECT_EQ(impl->RegisterWatcher(10, Notify, &notifications),
+            MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(impl->RegisterWatcher(10, NotifyOther, &other_notifications),
+            MEMORYADVICE_ERROR_OK);
+  std::this_thread::sleep_for(50ms);
+  EXPECT_EQ(impl->UnregisterWatcher(Notify), MEMORYADVICE_ERROR_OK);
+  EXPECT_EQ(impl->UnregisterWatcher(Notify),
+            MEMORYADVICE_ERROR_WATCHER_NOT_FOUND);
+  // Allow for a notification in flight
+  std::this_thread::sleep_for(20ms);
+  int count = notifications.count;
+  std::this_thread::sleep_for(50ms);
+  EXPECT_EQ(notifications.count, count);
+  EXPECT_GT(other_notifications.count, count);
+  EXPECT_EQ(impl->UnregisterWatcher(NotifyOther), MEMORYADVICE_ERROR_OK);
+}
+
+}  // namespace memory_advice_test
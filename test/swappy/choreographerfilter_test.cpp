@@ -0,0 +1,211 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/ChoreographerFilter.h"
+
+#include <atomic>
+#include <thread>
+
+#include "common/Settings.h"
+#include "common/VsyncModel.h"
+#include "gtest/gtest.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+
+using duration = std::chrono::nanoseconds;
+
+namespace choreographerfilter_test {
+
+// Ticks the filter at a fixed period, the way Choreographer would.
+class FakeChoreographer {
+   public:
+    FakeChoreographer(ChoreographerFilter* filter, duration period)
+        : filter_(filter), periodNs_(period.count()), running_(true) {
+        thread_ = std::thread([this]() {
+            auto next = std::chrono::steady_clock::now();
+            while (running_) {
+                filter_->onChoreographer(std::nullopt);
+                next += duration(periodNs_.load());
+                std::this_thread::sleep_until(next);
+            }
+        });
+    }
+    ~FakeChoreographer() {
+        running_ = false;
+        thread_.join();
+    }
+    void setPeriod(duration period) { periodNs_ = period.count(); }
+
+   private:
+    ChoreographerFilter* filter_;
+    std::atomic<int64_t> periodNs_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+};
+
+// Counts the worker invocations of a filter.
+struct WorkCounter {
+    std::atomic<int> count{0};
+    ChoreographerFilter::Worker worker() {
+        return [this](std::optional<duration>) {
+            ++count;
+            return 0ns;
+        };
+    }
+    // Waits, up to a generous timeout, until the worker ran n more times.
+    bool waitForMore(int n) {
+        const int target = count + n;
+        const auto timeout = std::chrono::steady_clock::now() + 10s;
+        while (count < target) {
+            if (std::chrono::steady_clock::now() > timeout) return false;
+            std::this_thread::sleep_for(10ms);
+        }
+        return true;
+    }
+    // Waits until the worker stopped running, that is the count doesn't change
+    // over a whole interval.
+    bool waitForStop() {
+        const auto timeout = std::chrono::steady_clock::now() + 10s;
+        int previous = count;
+        while (std::chrono::steady_clock::now() < timeout) {
+            std::this_thread::sleep_for(300ms);
+            if (count == previous) return true;
+            previous = count;
+        }
+        return false;
+    }
+};
+
+using time_point = VsyncModel::time_point;
+
+constexpr duration k60HzPeriod = 16666667ns;
+constexpr duration k90HzPeriod = 11111111ns;
+
+// Feeds ticks to the model with the period of a fake clock.
+time_point Tick(VsyncModel& model, time_point now, duration period, int count) {
+    for (int i = 0; i < count; ++i) {
+        now += period;
+        model.addTimestamp(now);
+    }
+    return now;
+}
+
+}  // namespace choreographerfilter_test
+
+using namespace choreographerfilter_test;
+
+// The vsync model is tested with a fake clock, so that its predictions can be
+// checked exactly. The filter thread tests below use the real clock and only
+// check invariants that hold however the threads are scheduled.
+
+TEST(VsyncModelTest, PredictsNextVsync) {
+    const time_point start(10s);
+    VsyncModel model(k60HzPeriod, 0ns, start);
+    const time_point now = Tick(model, start, k60HzPeriod, 120);
+    EXPECT_EQ(model.getRefreshPeriod(), k60HzPeriod);
+    EXPECT_EQ(model.nextDeadline(0ns, now, time_point()), now + k60HzPeriod);
+    EXPECT_EQ(model.nextDeadline(-2ms, now, time_point()),
+              now + k60HzPeriod - 2ms);
+}
+
+TEST(VsyncModelTest, LearnsActualPeriod) {
+    const time_point start(10s);
+    VsyncModel model(k60HzPeriod, 0ns, start);
+    const duration actualPeriod = 16500000ns;
+    const time_point now = Tick(model, start, actualPeriod, 300);
+    EXPECT_NEAR(model.getRefreshPeriod().count(), actualPeriod.count(), 10000);
+    const auto deadline = model.nextDeadline(0ns, now, time_point());
+    EXPECT_NEAR((deadline - now).count(), actualPeriod.count(), 10000);
+}
+
+TEST(VsyncModelTest, FollowsRefreshRateChange) {
+    const time_point start(10s);
+    VsyncModel model(k60HzPeriod, 0ns, start);
+    time_point now = Tick(model, start, k60HzPeriod, 120);
+    model.setTimings(k90HzPeriod, 0ns);
+    now = Tick(model, now, k90HzPeriod, 120);
+    EXPECT_EQ(model.getRefreshPeriod(), k90HzPeriod);
+    EXPECT_EQ(model.nextDeadline(0ns, now, time_point()), now + k90HzPeriod);
+}
+
+TEST(VsyncModelTest, NeverTwicePerVsync) {
+    const time_point start(10s);
+    VsyncModel model(k60HzPeriod, 0ns, start);
+    const time_point now = Tick(model, start, k60HzPeriod, 120);
+    const auto deadline = model.nextDeadline(0ns, now, time_point());
+    // Woken up early, before the previous deadline: the next one is still a
+    // whole vsync later.
+    EXPECT_EQ(model.nextDeadline(0ns, deadline - 1ms, deadline),
+              deadline + k60HzPeriod);
+    // Woken up late, after several vsyncs: the missed ones are skipped.
+    EXPECT_EQ(model.nextDeadline(0ns, deadline + 3 * k60HzPeriod + 1ms,
+                                 deadline),
+              deadline + 4 * k60HzPeriod);
+}
+
+TEST(VsyncModelTest, DetectsRepeatedTimestamps) {
+    const time_point start(10s);
+    VsyncModel model(k60HzPeriod, 0ns, start);
+    const time_point now = Tick(model, start, k60HzPeriod, 10);
+    int accepted = 0;
+    while (accepted < 100 && model.addTimestamp(now)) ++accepted;
+    EXPECT_LT(accepted, 100);
+    EXPECT_TRUE(model.addTimestamp(now + k60HzPeriod));
+}
+
+TEST(ChoreographerFilterTest, WorkerRunsWhileTicking) {
+    Settings::reset();
+    WorkCounter counter;
+    ChoreographerFilter filter(k60HzPeriod, 0ns, counter.worker());
+    {
+        FakeChoreographer choreographer(&filter, k60HzPeriod);
+        EXPECT_TRUE(counter.waitForMore(30));
+    }
+    const auto jitter = filter.getWakeupJitter();
+    EXPECT_GE(jitter.samples, 30u);
+    EXPECT_GE(jitter.max, jitter.mean);
+    Settings::getInstance()->removeAllListeners();
+}
+
+TEST(ChoreographerFilterTest, KeepsRunningAcrossRefreshRateChange) {
+    Settings::reset();
+    WorkCounter counter;
+    ChoreographerFilter filter(k60HzPeriod, 0ns, counter.worker());
+    {
+        FakeChoreographer choreographer(&filter, k60HzPeriod);
+        EXPECT_TRUE(counter.waitForMore(10));
+
+        // Switch to 90Hz: the filter thread keeps running.
+        choreographer.setPeriod(k90HzPeriod);
+        Settings::getInstance()->setDisplayTimings({k90HzPeriod, 0ns, 0ns});
+        EXPECT_TRUE(counter.waitForMore(30));
+    }
+    Settings::getInstance()->removeAllListeners();
+}
+
+TEST(ChoreographerFilterTest, StopsWhenTicksStop) {
+    Settings::reset();
+    WorkCounter counter;
+    ChoreographerFilter filter(k60HzPeriod, 0ns, counter.worker());
+    {
+        FakeChoreographer choreographer(&filter, k60HzPeriod);
+        EXPECT_TRUE(counter.waitForMore(10));
+    }
+    // The filter only extrapolates a handful of vsyncs past the last tick.
+    EXPECT_TRUE(counter.waitForStop());
+    Settings::getInstance()->removeAllListeners();
+}
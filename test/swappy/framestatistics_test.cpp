@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/FrameStatistics.h"
+
+#include <atomic>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+using namespace swappy;
+
+namespace framestatistics_test {
+
+constexpr uint64_t kRefreshPeriod = 8'333'333;  // 120Hz
+
+// Frame started at startTime and presented latency ns later, as requested.
+FrameTimings makeFrame(uint64_t startTime, uint64_t latency) {
+    return {startTime, startTime + latency, startTime + latency, 0};
+}
+
+template <typename T, size_t N>
+uint64_t sum(const T (&buckets)[N]) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < N; ++i) {
+        total += buckets[i];
+    }
+    return total;
+}
+
+}  // namespace framestatistics_test
+
+using namespace framestatistics_test;
+
+TEST(FrameStatisticsTest, BucketsInRefreshPeriods) {
+    FrameStatistics stats;
+    stats.enableStats(true);
+    stats.updateFrameStats(makeFrame(0, 2 * kRefreshPeriod), kRefreshPeriod);
+    stats.updateFrameStats(makeFrame(kRefreshPeriod, 2 * kRefreshPeriod + 10),
+                           kRefreshPeriod);
+    stats.updateFrameStats(makeFrame(2 * kRefreshPeriod, 100 * kRefreshPeriod),
+                           kRefreshPeriod);
+
+    const SwappyStats swappyStats = stats.getStats();
+    EXPECT_EQ(swappyStats.totalFrames, 3u);
+    EXPECT_EQ(swappyStats.latencyFrames[2], 2u);
+    EXPECT_EQ(swappyStats.latencyFrames[MAX_FRAME_BUCKETS - 1], 1u);
+    EXPECT_EQ(swappyStats.idleFrames[0], 3u);
+    EXPECT_EQ(swappyStats.lateFrames[0], 3u);
+    EXPECT_EQ(swappyStats.offsetFromPreviousFrame[1], 1u);
+    EXPECT_EQ(sum(swappyStats.offsetFromPreviousFrame), 2u);
+    EXPECT_EQ(stats.lastLatencyRecorded(), MAX_FRAME_BUCKETS - 1);
+}
+
+TEST(FrameStatisticsTest, DetailedBucketsUseResolution) {
+    FrameStatistics stats;
+    stats.enableStats(true);
+    stats.setBucketResolution(std::chrono::milliseconds(1));
+    // 4.5ms and 7.9ms are both within the first refresh period at 120Hz
+    stats.updateFrameStats(makeFrame(0, 4'500'000), kRefreshPeriod);
+    stats.updateFrameStats(makeFrame(0, 7'900'000), kRefreshPeriod);
+
+    EXPECT_EQ(stats.getStats().latencyFrames[0], 2u);
+    const SwappyDetailedStats detailed = stats.getDetailedStats();
+    EXPECT_EQ(detailed.bucketResolutionNS, 1'000'000u);
+    EXPECT_EQ(detailed.totalFrames, 2u);
+    EXPECT_EQ(detailed.latencyFrames[4], 1u);
+    EXPECT_EQ(detailed.latencyFrames[7], 1u);
+}
+
+TEST(FrameStatisticsTest, DetailedBucketsClampLongDurations) {
+    FrameStatistics stats;
+    stats.enableStats(true);
+    stats.setBucketResolution(std::chrono::microseconds(500));
+    stats.updateFrameStats(makeFrame(0, 100 * kRefreshPeriod), kRefreshPeriod);
+
+    const SwappyDetailedStats detailed = stats.getDetailedStats();
+    EXPECT_EQ(detailed.bucketResolutionNS, 500'000u);
+    EXPECT_EQ(detailed.latencyFrames[SWAPPY_MAX_DETAILED_BUCKETS - 1], 1u);
+}
+
+TEST(FrameStatisticsTest, ClearStats) {
+    FrameStatistics stats;
+    stats.enableStats(true);
+    stats.updateFrameStats(makeFrame(0, kRefreshPeriod), kRefreshPeriod);
+    stats.clearStats();
+    EXPECT_EQ(stats.getStats().totalFrames, 0u);
+    EXPECT_EQ(sum(stats.getStats().latencyFrames), 0u);
+    EXPECT_EQ(stats.getDetailedStats().totalFrames, 0u);
+
+    stats.updateFrameStats(makeFrame(0, kRefreshPeriod), kRefreshPeriod);
+    EXPECT_EQ(stats.getStats().totalFrames, 1u);
+    EXPECT_EQ(stats.getStats().latencyFrames[1], 1u);
+}
+
+TEST(FrameStatisticsTest, ReadersSeeConsistentSnapshots) {
+    FrameStatistics stats;
+    stats.enableStats(true);
+    std::atomic<bool> running(true);
+
+    std::thread producer([&]() {
+        uint64_t time = 0;
+        while (running) {
+            stats.updateFrameStats(makeFrame(time, (time / 7) % 50'000'000),
+                                   kRefreshPeriod);
+            time += kRefreshPeriod;
+        }
+    });
+    for (int i = 0; i < 10000; ++i) {
+        const SwappyStats swappyStats = stats.getStats();
+        ASSERT_EQ(sum(swappyStats.latencyFrames), swappyStats.totalFrames);
+        ASSERT_EQ(sum(swappyStats.idleFrames), swappyStats.totalFrames);
+        if (i % 100 == 0) {
+            stats.clearStats();
+        }
+    }
+    running = false;
+    producer.join();
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Several SwappyCommon instances live in the same process when an app paces
+// more than one Vulkan swapchain.
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "common/Settings.h"
+#include "common/SwappyCommon.h"
+#include "gtest/gtest.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+
+namespace swappycommon_instances_test {
+
+constexpr std::chrono::nanoseconds kRefreshPeriod = 16'666'667ns;
+
+class SwappyCommonTest : public SwappyCommon {
+   public:
+    SwappyCommonTest(const SwappyCommonSettings& settings)
+        : SwappyCommon(settings) {}
+};
+
+SwappyCommonSettings makeSettings() {
+    SwappyCommonSettings settings = {};
+    settings.refreshPeriod = kRefreshPeriod;
+    settings.appVsyncOffset = 0ns;
+    settings.sfVsyncOffset = 0ns;
+    return settings;
+}
+
+// Renders frames on each instance from its own thread, the way an app
+// presents its swapchains, while an app choreographer ticks all of them.
+class Swapchains {
+   public:
+    explicit Swapchains(size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            mInstances.push_back(
+                std::make_unique<SwappyCommonTest>(makeSettings()));
+        }
+    }
+
+    SwappyCommon& operator[](size_t i) { return *mInstances[i]; }
+
+    void destroy(size_t i) { mInstances[i].reset(); }
+
+    void runFor(std::chrono::nanoseconds duration) {
+        std::atomic<bool> running(true);
+        std::thread choreographer([&]() {
+            while (running) {
+                for (auto& instance : mInstances) {
+                    if (instance) instance->onChoreographer(0);
+                }
+                std::this_thread::sleep_for(kRefreshPeriod);
+            }
+        });
+        std::vector<std::thread> renderThreads;
+        for (auto& instance : mInstances) {
+            if (!instance) continue;
+            renderThreads.emplace_back([&running, &instance]() {
+                const SwappyCommon::SwapHandlers handlers = {
+                    .lastFrameIsComplete = []() { return true; },
+                    .getPrevFrameGpuTime = []() { return 1ms; },
+                };
+                while (running) {
+                    instance->onPreSwap(handlers);
+                    instance->onPostSwap(handlers);
+                }
+            });
+        }
+        std::this_thread::sleep_for(duration);
+        running = false;
+        for (auto& thread : renderThreads) {
+            thread.join();
+        }
+        choreographer.join();
+    }
+
+   private:
+    std::vector<std::unique_ptr<SwappyCommonTest>> mInstances;
+};
+
+}  // namespace swappycommon_instances_test
+
+using namespace swappycommon_instances_test;
+
+TEST(SwappyCommonInstancesTest, SwapDurationIsPerInstance) {
+    Swapchains swapchains(2);
+    swapchains[0].setAutoSwapInterval(false);
+    swapchains[1].setAutoSwapInterval(false);
+    swapchains[0].setSwapDuration(2 * kRefreshPeriod);
+    swapchains[1].setSwapDuration(kRefreshPeriod);
+
+    swapchains.runFor(200ms);
+
+    EXPECT_EQ(swapchains[0].getSwapDuration(), 2 * kRefreshPeriod);
+    EXPECT_EQ(swapchains[1].getSwapDuration(), kRefreshPeriod);
+}
+
+TEST(SwappyCommonInstancesTest, DestroyingAnInstanceKeepsOthersUpdated) {
+    Swapchains swapchains(2);
+    swapchains.runFor(100ms);
+    swapchains.destroy(0);
+
+    // The remaining instance still follows display changes
+    const std::chrono::nanoseconds newRefreshPeriod = 11'111'111ns;
+    Settings::getInstance()->setDisplayTimings({newRefreshPeriod, 0ns, 0ns});
+    swapchains.runFor(100ms);
+
+    EXPECT_EQ(swapchains[1].getRefreshPeriod(), newRefreshPeriod);
+}
@@ -0,0 +1,348 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vulkan/SwappyVkSyncPool.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "vulkan/SwappyVkBase.h"
+
+using namespace swappy;
+using namespace std::chrono_literals;
+
+namespace swappyvk_syncpool_test {
+
+// Minimal Vulkan device: fences are only signaled when the test says so.
+struct FakeDevice {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::map<VkFence, bool> fenceSignaled;
+    std::map<VkQueue, std::deque<VkFence>> submitted;
+    int fencesCreated = 0;
+    int commandPoolsCreated = 0;
+    int fenceWaits = 0;
+    uintptr_t nextHandle = 1;
+
+    template <typename T>
+    T newHandle() {
+        return reinterpret_cast<T>(nextHandle++);
+    }
+
+    // Signals the oldest fence submitted to the queue, as the GPU would.
+    void completeFrame(VkQueue queue) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& fences = submitted[queue];
+        ASSERT_FALSE(fences.empty());
+        fenceSignaled[fences.front()] = true;
+        fences.pop_front();
+        condition.notify_all();
+    }
+};
+
+FakeDevice* sDevice = nullptr;
+
+VkResult createCommandPool(VkDevice, const VkCommandPoolCreateInfo*,
+                           const VkAllocationCallbacks*,
+                           VkCommandPool* pCommandPool) {
+    std::lock_guard<std::mutex> lock(sDevice->mutex);
+    ++sDevice->commandPoolsCreated;
+    *pCommandPool = sDevice->newHandle<VkCommandPool>();
+    return VK_SUCCESS;
+}
+
+VkResult createFence(VkDevice, const VkFenceCreateInfo* pCreateInfo,
+                     const VkAllocationCallbacks*, VkFence* pFence) {
+    std::lock_guard<std::mutex> lock(sDevice->mutex);
+    ++sDevice->fencesCreated;
+    *pFence = sDevice->newHandle<VkFence>();
+    sDevice->fenceSignaled[*pFence] =
+        pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT;
+    return VK_SUCCESS;
+}
+
+VkResult waitForFences(VkDevice, uint32_t fenceCount, const VkFence* pFences,
+                       VkBool32 waitAll, uint64_t timeout) {
+    std::unique_lock<std::mutex> lock(sDevice->mutex);
+    ++sDevice->fenceWaits;
+    auto done = [&]() {
+        uint32_t signaled = 0;
+        for (uint32_t i = 0; i < fenceCount; ++i) {
+            signaled += sDevice->fenceSignaled[pFences[i]] ? 1 : 0;
+        }
+        return waitAll ? signaled == fenceCount : signaled > 0;
+    };
+    if (!sDevice->condition.wait_for(lock, std::chrono::nanoseconds(timeout),
+                                     done)) {
+        return VK_TIMEOUT;
+    }
+    return VK_SUCCESS;
+}
+
+VkResult getFenceStatus(VkDevice, VkFence fence) {
+    std::lock_guard<std::mutex> lock(sDevice->mutex);
+    return sDevice->fenceSignaled[fence] ? VK_SUCCESS : VK_NOT_READY;
+}
+
+VkResult resetFences(VkDevice, uint32_t fenceCount, const VkFence* pFences) {
+    std::lock_guard<std::mutex> lock(sDevice->mutex);
+    for (uint32_t i = 0; i < fenceCount; ++i) {
+        sDevice->fenceSignaled[pFences[i]] = false;
+    }
+    return VK_SUCCESS;
+}
+
+VkResult createSemaphore(VkDevice, const VkSemaphoreCreateInfo*,
+                         const VkAllocationCallbacks*,
+                         VkSemaphore* pSemaphore) {
+    std::lock_guard<std::mutex> lock(sDevice->mutex);
+    *pSemaphore = sDevice->newHandle<VkSemaphore>();
+    return VK_SUCCESS;
+}
+
+VkResult createEvent(VkDevice, const VkEventCreateInfo*,
+                     const VkAllocationCallbacks*, VkEvent* pEvent) {
+    std::lock_guard<std::mutex> lock(sDevice->mutex);
+    *pEvent = sDevice->newHandle<VkEvent>();
+    return VK_SUCCESS;
+}
+
+VkResult allocateCommandBuffers(VkDevice, const VkCommandBufferAllocateInfo*,
+                                VkCommandBuffer* pCommandBuffers) {
+    std::lock_guard<std::mutex> lock(sDevice->mutex);
+    *pCommandBuffers = sDevice->newHandle<VkCommandBuffer>();
+    return VK_SUCCESS;
+}
+
+VkResult queueSubmit(VkQueue queue, uint32_t, const VkSubmitInfo*,
+                     VkFence fence) {
+    std::lock_guard<std::mutex> lock(sDevice->mutex);
+    sDevice->submitted[queue].push_back(fence);
+    return VK_SUCCESS;
+}
+
+VkResult beginCommandBuffer(VkCommandBuffer,
+                            const VkCommandBufferBeginInfo*) {
+    return VK_SUCCESS;
+}
+VkResult endCommandBuffer(VkCommandBuffer) { return VK_SUCCESS; }
+void cmdSetEvent(VkCommandBuffer, VkEvent, VkPipelineStageFlags) {}
+void destroyCommandPool(VkDevice, VkCommandPool,
+                        const VkAllocationCallbacks*) {}
+void destroyFence(VkDevice, VkFence, const VkAllocationCallbacks*) {}
+void destroySemaphore(VkDevice, VkSemaphore, const VkAllocationCallbacks*) {}
+void destroyEvent(VkDevice, VkEvent, const VkAllocationCallbacks*) {}
+void freeCommandBuffers(VkDevice, VkCommandPool, uint32_t,
+                        const VkCommandBuffer*) {}
+
+bool providerInit() { return true; }
+void providerClose() {}
+
+#define FAKE_FUNCTION(name, function) \
+    if (strcmp(procName, name) == 0) return reinterpret_cast<void*>(function)
+
+void* providerGetProcAddr(const char* procName) {
+    FAKE_FUNCTION("vkCreateCommandPool", createCommandPool);
+    FAKE_FUNCTION("vkDestroyCommandPool", destroyCommandPool);
+    FAKE_FUNCTION("vkCreateFence", createFence);
+    FAKE_FUNCTION("vkDestroyFence", destroyFence);
+    FAKE_FUNCTION("vkWaitForFences", waitForFences);
+    FAKE_FUNCTION("vkGetFenceStatus", getFenceStatus);
+    FAKE_FUNCTION("vkResetFences", resetFences);
+    FAKE_FUNCTION("vkCreateSemaphore", createSemaphore);
+    FAKE_FUNCTION("vkDestroySemaphore", destroySemaphore);
+    FAKE_FUNCTION("vkCreateEvent", createEvent);
+    FAKE_FUNCTION("vkDestroyEvent", destroyEvent);
+    FAKE_FUNCTION("vkCmdSetEvent", cmdSetEvent);
+    FAKE_FUNCTION("vkAllocateCommandBuffers", allocateCommandBuffers);
+    FAKE_FUNCTION("vkFreeCommandBuffers", freeCommandBuffers);
+    FAKE_FUNCTION("vkBeginCommandBuffer", beginCommandBuffer);
+    FAKE_FUNCTION("vkEndCommandBuffer", endCommandBuffer);
+    FAKE_FUNCTION("vkQueueSubmit", queueSubmit);
+    return nullptr;
+}
+
+#undef FAKE_FUNCTION
+
+const SwappyVkFunctionProvider kFakeProvider = {
+    providerInit, providerGetProcAddr, providerClose};
+
+const VkDevice kDevice = reinterpret_cast<VkDevice>(0x1000);
+const VkQueue kQueue0 = reinterpret_cast<VkQueue>(0x2000);
+const VkQueue kQueue1 = reinterpret_cast<VkQueue>(0x2001);
+const VkPresentInfoKHR kPresentInfo = {
+    .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+constexpr std::chrono::nanoseconds kFenceTimeout = 1s;
+
+class SwappyVkSyncPoolTest : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        sDevice = &mDevice;
+        LoadVulkanFunctions(&kFakeProvider);
+        mPool = std::make_unique<SwappyVkSyncPool>(kDevice);
+    }
+    void TearDown() override {
+        mPool.reset();
+        sDevice = nullptr;
+    }
+
+    bool present(SwappyVkSyncPool::Tracker& tracker, VkQueue queue) {
+        VkSemaphore semaphore;
+        EXPECT_EQ(mPool->injectFence(tracker, queue, &kPresentInfo,
+                                     kFenceTimeout, &semaphore),
+                  VK_SUCCESS);
+        return semaphore != VK_NULL_HANDLE;
+    }
+
+    // Waits for the waiter thread to retire the signaled fences.
+    bool waitForPendingFences(const SwappyVkSyncPool::Tracker& tracker,
+                              VkQueue queue, uint32_t pendingFences) {
+        const auto deadline = std::chrono::steady_clock::now() + 1s;
+        while (mPool->getPendingFences(tracker, queue) != pendingFences) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    FakeDevice mDevice;
+    std::unique_ptr<SwappyVkSyncPool> mPool;
+};
+
+}  // namespace swappyvk_syncpool_test
+
+using namespace swappyvk_syncpool_test;
+
+TEST_F(SwappyVkSyncPoolTest, RecyclesSyncObjects) {
+    SwappyVkSyncPool::Tracker tracker;
+    ASSERT_EQ(mPool->addQueue(tracker, kQueue0, 0), VK_SUCCESS);
+    EXPECT_EQ(mDevice.fencesCreated, SwappyVkSyncPool::MAX_PENDING_FENCES);
+
+    for (int frame = 0; frame < 100; ++frame) {
+        ASSERT_TRUE(present(tracker, kQueue0));
+        mDevice.completeFrame(kQueue0);
+        ASSERT_TRUE(waitForPendingFences(tracker, kQueue0, 0));
+    }
+
+    // No sync object is created after the queue was added
+    EXPECT_EQ(mDevice.fencesCreated, SwappyVkSyncPool::MAX_PENDING_FENCES);
+    EXPECT_EQ(mDevice.commandPoolsCreated, 1);
+    mPool->removeTracker(tracker);
+}
+
+TEST_F(SwappyVkSyncPoolTest, LimitsPendingFencesPerTracker) {
+    SwappyVkSyncPool::Tracker tracker;
+    ASSERT_EQ(mPool->addQueue(tracker, kQueue0, 0), VK_SUCCESS);
+
+    for (int i = 0; i < SwappyVkSyncPool::MAX_PENDING_FENCES; ++i) {
+        EXPECT_TRUE(present(tracker, kQueue0));
+    }
+    EXPECT_FALSE(present(tracker, kQueue0));
+    EXPECT_EQ(mPool->getPendingFences(tracker, kQueue0),
+              SwappyVkSyncPool::MAX_PENDING_FENCES);
+
+    mDevice.completeFrame(kQueue0);
+    ASSERT_TRUE(waitForPendingFences(tracker, kQueue0, 1));
+    EXPECT_TRUE(present(tracker, kQueue0));
+
+    mDevice.completeFrame(kQueue0);
+    mDevice.completeFrame(kQueue0);
+    mPool->removeTracker(tracker);
+}
+
+TEST_F(SwappyVkSyncPoolTest, SharesQueueFamilyAcrossTrackers) {
+    SwappyVkSyncPool::Tracker tracker0;
+    SwappyVkSyncPool::Tracker tracker1;
+    ASSERT_EQ(mPool->addQueue(tracker0, kQueue0, 0), VK_SUCCESS);
+    ASSERT_EQ(mPool->addQueue(tracker1, kQueue0, 0), VK_SUCCESS);
+    EXPECT_EQ(mDevice.commandPoolsCreated, 1);
+    EXPECT_EQ(mDevice.fencesCreated, 2 * SwappyVkSyncPool::MAX_PENDING_FENCES);
+
+    // Both trackers can keep their frames in flight at the same time
+    for (int i = 0; i < SwappyVkSyncPool::MAX_PENDING_FENCES; ++i) {
+        EXPECT_TRUE(present(tracker0, kQueue0));
+        EXPECT_TRUE(present(tracker1, kQueue0));
+    }
+    EXPECT_EQ(mPool->getPendingFences(tracker0, kQueue0),
+              SwappyVkSyncPool::MAX_PENDING_FENCES);
+    EXPECT_EQ(mPool->getPendingFences(tracker1, kQueue0),
+              SwappyVkSyncPool::MAX_PENDING_FENCES);
+
+    for (int i = 0; i < 2 * SwappyVkSyncPool::MAX_PENDING_FENCES; ++i) {
+        mDevice.completeFrame(kQueue0);
+    }
+    mPool->removeTracker(tracker0);
+
+    // A tracker added later reuses the released sync objects
+    SwappyVkSyncPool::Tracker tracker2;
+    ASSERT_EQ(mPool->addQueue(tracker2, kQueue0, 0), VK_SUCCESS);
+    EXPECT_EQ(mDevice.fencesCreated, 2 * SwappyVkSyncPool::MAX_PENDING_FENCES);
+
+    mPool->removeTracker(tracker1);
+    mPool->removeTracker(tracker2);
+}
+
+TEST_F(SwappyVkSyncPoolTest, QueuesSignalIndependently) {
+    SwappyVkSyncPool::Tracker tracker0;
+    SwappyVkSyncPool::Tracker tracker1;
+    ASSERT_EQ(mPool->addQueue(tracker0, kQueue0, 0), VK_SUCCESS);
+    ASSERT_EQ(mPool->addQueue(tracker1, kQueue1, 1), VK_SUCCESS);
+    EXPECT_EQ(mDevice.commandPoolsCreated, 2);
+
+    ASSERT_TRUE(present(tracker0, kQueue0));
+    ASSERT_TRUE(present(tracker1, kQueue1));
+
+    // The frame submitted last completes first: the single waiter thread must
+    // not be blocked on the older fence.
+    mDevice.completeFrame(kQueue1);
+    EXPECT_TRUE(waitForPendingFences(tracker1, kQueue1, 0));
+    EXPECT_EQ(mPool->getPendingFences(tracker0, kQueue0), 1u);
+
+    mDevice.completeFrame(kQueue0);
+    EXPECT_TRUE(waitForPendingFences(tracker0, kQueue0, 0));
+    EXPECT_GT(tracker0.getLastFenceTime(), 0ns);
+
+    mPool->removeTracker(tracker0);
+    mPool->removeTracker(tracker1);
+}
+
+TEST_F(SwappyVkSyncPoolTest, StopsPollingRemovedQueues) {
+    SwappyVkSyncPool::Tracker tracker0;
+    SwappyVkSyncPool::Tracker tracker1;
+    ASSERT_EQ(mPool->addQueue(tracker0, kQueue0, 0), VK_SUCCESS);
+    ASSERT_EQ(mPool->addQueue(tracker1, kQueue1, 1), VK_SUCCESS);
+    mPool->removeTracker(tracker1);
+
+    // With a single queue left, the waiter thread blocks on its fence instead
+    // of waking up regularly to check the other queues.
+    ASSERT_TRUE(present(tracker0, kQueue0));
+    std::this_thread::sleep_for(100ms);
+    {
+        std::lock_guard<std::mutex> lock(mDevice.mutex);
+        EXPECT_LT(mDevice.fenceWaits, 10);
+    }
+
+    mDevice.completeFrame(kQueue0);
+    EXPECT_TRUE(waitForPendingFences(tracker0, kQueue0, 0));
+    mPool->removeTracker(tracker0);
+}
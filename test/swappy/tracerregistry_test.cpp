@@ -0,0 +1,128 @@
+/*
+ * Copyright 2023 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "common/TracerRegistry.h"
+
+#include <atomic>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+using namespace swappy;
+
+namespace tracerregistry_test {
+
+struct Counters {
+    std::atomic<int> preWait{0};
+    std::atomic<int> postWait{0};
+    std::atomic<int64_t> lastCpuTime{0};
+};
+
+void preWaitTracer(void* userData) {
+    static_cast<Counters*>(userData)->preWait++;
+}
+
+void postWaitTracer(void* userData, int64_t cpuTime, int64_t) {
+    auto counters = static_cast<Counters*>(userData);
+    counters->postWait++;
+    counters->lastCpuTime = cpuTime;
+}
+
+SwappyTracer makeTracer(Counters* counters) {
+    SwappyTracer tracer = {};
+    tracer.preWait = preWaitTracer;
+    tracer.postWait = postWaitTracer;
+    tracer.userData = counters;
+    return tracer;
+}
+
+void dispatchPreWait(const TracerRegistry& registry) {
+    TracerRegistry::Reader reader(registry);
+    for (const auto& tracer : reader.callbacks().preWait) {
+        tracer.function(tracer.userData);
+    }
+}
+
+void dispatchPostWait(const TracerRegistry& registry, int64_t cpuTime) {
+    TracerRegistry::Reader reader(registry);
+    for (const auto& tracer : reader.callbacks().postWait) {
+        tracer.function(tracer.userData, cpuTime, 0);
+    }
+}
+
+}  // namespace tracerregistry_test
+
+using namespace tracerregistry_test;
+
+TEST(TracerRegistryTest, AddAndRemove) {
+    TracerRegistry registry;
+    Counters counters;
+    const SwappyTracer tracer = makeTracer(&counters);
+
+    registry.add(tracer);
+    dispatchPreWait(registry);
+    dispatchPostWait(registry, 42);
+    EXPECT_EQ(counters.preWait, 1);
+    EXPECT_EQ(counters.postWait, 1);
+    EXPECT_EQ(counters.lastCpuTime, 42);
+
+    registry.remove(tracer);
+    dispatchPreWait(registry);
+    EXPECT_EQ(counters.preWait, 1);
+    {
+        TracerRegistry::Reader reader(registry);
+        EXPECT_TRUE(reader.callbacks().preWait.empty());
+        EXPECT_TRUE(reader.callbacks().startFrame.empty());
+    }
+}
+
+TEST(TracerRegistryTest, SnapshotIsStableWhileReading) {
+    TracerRegistry registry;
+    Counters counters;
+    const SwappyTracer tracer = makeTracer(&counters);
+    registry.add(tracer);
+
+    TracerRegistry::Reader reader(registry);
+    registry.remove(tracer);
+    registry.add(tracer);
+    registry.add(tracer);
+    // The reader still sees the snapshot it started with.
+    EXPECT_EQ(reader.callbacks().preWait.size(), 1u);
+}
+
+TEST(TracerRegistryTest, ConcurrentRegistration) {
+    TracerRegistry registry;
+    Counters counters;
+    const SwappyTracer tracer = makeTracer(&counters);
+    std::atomic<bool> running(true);
+
+    std::thread swapThread([&]() {
+        while (running) {
+            dispatchPreWait(registry);
+            dispatchPostWait(registry, 1);
+        }
+    });
+    for (int i = 0; i < 10000; ++i) {
+        registry.add(tracer);
+        registry.remove(tracer);
+    }
+    running = false;
+    swapThread.join();
+
+    TracerRegistry::Reader reader(registry);
+    EXPECT_TRUE(reader.callbacks().preWait.empty());
+    EXPECT_TRUE(reader.callbacks().postWait.empty());
+}